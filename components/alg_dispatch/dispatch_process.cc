@@ -23,6 +23,8 @@ using KwsOutMessageT    = thead::voice::proto::KwsOutMsg;
 // pub/sub message
 using SessionMessageT   = posto::Message<thead::voice::proto::SessionMsg>;
 
+static const cx::MetaKey<KwsOutMessageT> kDispatchParam("dispatch_param");
+
 namespace cpt {
 
 class DispatchProc : public cx::PluginBase {
@@ -83,7 +85,7 @@ bool DispatchProc::Process(const std::vector<cx::BufferPtr>& data_vec) {
 
   if (ptr0) {
     auto iMemory0 = ptr0->GetMemory(0);
-    auto iMeta0   = ptr0->GetMetadata<KwsOutMessageT>("dispatch_param");
+    auto iMeta0   = ptr0->GetMetadata(kDispatchParam);
 
     int len  = iMeta0->buf_len();
 
@@ -3,34 +3,36 @@
  */
 
 #include <ulog/ulog.h>
-#include <aos/ringbuffer.h>
 #include <aos/aos.h>
 
+#include "mrbuffer.h"
 #include "dispatch_ringbuf.h"
+#include "dispatch_process.h"
 
 #define TAG "RINGBUF_GROUP"
 
-#define EVENT_CAN_WRITE 0x000000F0
-#define EVENT_CAN_READ  0x00000F0F
-
+/*
+ * one ring per data type, shared by all its readers. The voice_get_xxx_data
+ * api reads through the default reader of the type
+ */
 typedef struct _ringbuf_group_ {
-    dev_ringbuf_t rb;
-    aos_event_t   event;
-    char         *buffer;
+    mrbuf_t        rb;
+    mrbuf_reader_t reader;
+    char          *buffer;
 } ringbuf_group_t;
 
 static ringbuf_group_t g_rbgroup[TYPE_MAX];
+static int             g_rbgroup_inited;
 
 /**********************************************************
  * Dispatch API
  *********************************************************/
 int voice_get_pcm_data(void *data, int len)
 {
-    uint8_t *temp     = (uint8_t *)data;
-    int      read_len = 0;
+    int read_len = 0;
 
-    if (ringbuffer_available_read_space(&g_rbgroup[TYPE_PCM].rb) >= len) {
-        read_len = ringbuffer_read(&g_rbgroup[TYPE_PCM].rb, (uint8_t *)temp, len);
+    if (mrbuf_available(&g_rbgroup[TYPE_PCM].reader) >= len) {
+        read_len = mrbuf_read(&g_rbgroup[TYPE_PCM].reader, (uint8_t *)data, len, AOS_NO_WAIT);
     }
 
     return read_len;
@@ -38,31 +40,62 @@ int voice_get_pcm_data(void *data, int len)
 
 int voice_get_kws_data(void *data, int len)
 {
-    uint8_t *temp     = (uint8_t *)data;
-    int      read_len = len;
+    return mrbuf_read(&g_rbgroup[TYPE_KWS].reader, (uint8_t *)data, len, AOS_NO_WAIT);
+}
 
-    read_len = ringbuffer_read(&g_rbgroup[TYPE_KWS].rb, (uint8_t *)temp, len);
+int voice_get_feaec_data(void *data, int len, int timeout)
+{
+    if (g_rbgroup[TYPE_FEAEC].buffer == NULL) {
+        return -1;
+    }
 
-    return read_len;
+    return mrbuf_read(&g_rbgroup[TYPE_FEAEC].reader, (uint8_t *)data, len, timeout);
 }
 
-int voice_get_feaec_data(void *data, int len, int timeout)
+voice_reader_t *voice_reader_open(voice_data_type_e type)
 {
-    uint8_t     *temp       = (uint8_t *)data;
-    int          read_len   = len;
+    mrbuf_reader_t *reader;
 
-    if (!aos_event_is_valid(g_rbgroup[TYPE_FEAEC].event)) {
-        return -1;
+    if (type < 0 || type >= (voice_data_type_e)TYPE_MAX || !g_rbgroup_inited) {
+        return NULL;
     }
 
-    if (ringbuffer_available_read_space(&g_rbgroup[TYPE_FEAEC].rb) >= len) {
-         read_len = ringbuffer_read(&g_rbgroup[TYPE_FEAEC].rb, (uint8_t *)temp, len);
-    } else {
-        unsigned int actl_flags = 0;
-        aos_event_get(&g_rbgroup[TYPE_FEAEC].event, EVENT_CAN_READ, AOS_EVENT_OR_CLEAR, &actl_flags, timeout);
-        read_len = ringbuffer_read(&g_rbgroup[TYPE_FEAEC].rb, (uint8_t *)temp, len);
+    reader = (mrbuf_reader_t *)aos_malloc(sizeof(mrbuf_reader_t));
+    if (reader && mrbuf_reader_open(&g_rbgroup[type].rb, reader) != 0) {
+        LOGE(TAG, "too many readers of type %d", type);
+        aos_free(reader);
+        reader = NULL;
+    }
+
+    return reader;
+}
+
+void voice_reader_close(voice_reader_t *reader)
+{
+    if (reader) {
+        mrbuf_reader_close(reader);
+        aos_free(reader);
     }
-    return read_len;
+}
+
+int voice_reader_read(voice_reader_t *reader, void *data, int len, int timeout)
+{
+    return mrbuf_read(reader, data, len, timeout);
+}
+
+int voice_reader_peek(voice_reader_t *reader, const void **data, int len, int timeout)
+{
+    return mrbuf_peek(reader, (const uint8_t **)data, len, timeout);
+}
+
+int voice_reader_commit(voice_reader_t *reader, int len)
+{
+    return mrbuf_commit(reader, len);
+}
+
+uint64_t voice_reader_overflow(voice_reader_t *reader)
+{
+    return mrbuf_overflow(reader);
 }
 
 /**********************************************************
@@ -71,14 +104,11 @@ int voice_get_feaec_data(void *data, int len, int timeout)
 int dispatch_ringbuffer_create(data_type_e type, int buf_len)
 {
     if (g_rbgroup[type].buffer == NULL) {
-
-        int ret = aos_event_new(&g_rbgroup[type].event, 0);
-        if (ret != 0) {
+        g_rbgroup[type].buffer = (char *)malloc(buf_len);
+        if (g_rbgroup[type].buffer == NULL) {
             return -1;
         }
-
-        g_rbgroup[type].buffer = (char *)malloc(buf_len);
-        ringbuffer_create(&g_rbgroup[type].rb, g_rbgroup[type].buffer, buf_len);
+        mrbuf_set_buffer(&g_rbgroup[type].rb, (uint8_t *)g_rbgroup[type].buffer, buf_len);
     }
     return 0;
 }
@@ -86,32 +116,39 @@ int dispatch_ringbuffer_create(data_type_e type, int buf_len)
 int dispatch_ringbuffer_destory(data_type_e type)
 {
     if (g_rbgroup[type].buffer) {
-        ringbuffer_destroy(&g_rbgroup[type].rb);
-        aos_event_free(g_rbgroup[type].event);
+        mrbuf_set_buffer(&g_rbgroup[type].rb, NULL, 0);
+        free(g_rbgroup[type].buffer);
+        g_rbgroup[type].buffer = NULL;
     }
     return 0;
 }
 
 int dispatch_ringbuffer_write(data_type_e type, void *data, int data_len)
 {
-    if (ringbuffer_available_write_space(&g_rbgroup[type].rb) < data_len) {
-        // LOGE(TAG, "pcm ringbuffer is full");
-        return 0;
-    }
-
-    int ret = ringbuffer_write(&g_rbgroup[type].rb, (uint8_t *)data, data_len);
-    aos_event_set(g_rbgroup[type].event, EVENT_CAN_READ, AOS_EVENT_OR);
-    return ret;
+    return mrbuf_write(&g_rbgroup[type].rb, data, data_len);
 }
 
 int dispatch_ringbuffer_clear(data_type_e type)
 {
-    ringbuffer_clear(&g_rbgroup[type].rb);
+    mrbuf_clear(&g_rbgroup[type].rb);
     return 0;
 }
 
 int dispatch_ringbuffer_init()
 {
+    if (g_rbgroup_inited) {
+        return 0;
+    }
+
     memset(&g_rbgroup, 0, sizeof(g_rbgroup));
+    for (int i = 0; i < TYPE_MAX; i++) {
+        if (mrbuf_init(&g_rbgroup[i].rb) != 0 ||
+            mrbuf_reader_open(&g_rbgroup[i].rb, &g_rbgroup[i].reader) != 0) {
+            LOGE(TAG, "ringbuffer group init failed");
+            return -1;
+        }
+    }
+    g_rbgroup_inited = 1;
+
     return 0;
 }
@@ -20,6 +20,35 @@ int voice_get_kws_data(void *data, int len);
 /* 5路PCM，2MIC + 1REF + 线性AEC后AGC前数据 */
 int voice_get_feaec_data(void *data, int len, int timeout/*ms*/);
 
+/*
+ * 多读者接口：每种数据只保存一份，每个读者有自己的读位置，互不影响。
+ * 写入不会等待读者，落后超过一整个缓冲的读者丢弃最旧的数据并计入 overflow
+ */
+typedef enum {
+    VOICE_DATA_PCM = 0, /* 上云数据 */
+    VOICE_DATA_KWS,     /* 关键词数据 */
+    VOICE_DATA_FEAEC,   /* 线性AEC后数据 */
+} voice_data_type_e;
+
+typedef struct mrbuf_reader voice_reader_t;
+
+/* 打开读者，从当前写位置开始读，失败返回 NULL */
+voice_reader_t *voice_reader_open(voice_data_type_e type);
+void voice_reader_close(voice_reader_t *reader);
+
+/* 最多等待 timeout ms 直到有 len 字节，返回实际读取的长度 */
+int voice_reader_read(voice_reader_t *reader, void *data, int len, int timeout/*ms*/);
+
+/*
+ * 免拷贝读取：peek 返回缓冲内连续的一段（最多 len 字节），处理完后 commit。
+ * commit 返回 -1 表示处理期间该段已被覆盖，数据不完整
+ */
+int voice_reader_peek(voice_reader_t *reader, const void **data, int len, int timeout/*ms*/);
+int voice_reader_commit(voice_reader_t *reader, int len);
+
+/* 读者被覆盖丢失的字节数 */
+uint64_t voice_reader_overflow(voice_reader_t *reader);
+
 #ifdef __cplusplus
 }
 #endif
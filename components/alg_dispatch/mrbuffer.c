@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2022 Alibaba Group Holding Limited
+ */
+
+#include <string.h>
+
+#include "mrbuffer.h"
+
+#define MIN(x, y) ((x) > (y) ? (y) : (x))
+
+/* move a lapped reader to the oldest byte still in the ring, lock held */
+static void _reader_sync(mrbuf_reader_t *reader)
+{
+    mrbuf_t *rb = reader->rb;
+
+    if (rb->wpos - reader->rpos > rb->length) {
+        reader->overflow += rb->wpos - rb->length - reader->rpos;
+        reader->rpos = rb->wpos - rb->length;
+    }
+}
+
+/* wait until len bytes are ready or the timeout, returns the bytes ready */
+static uint32_t _reader_wait(mrbuf_reader_t *reader, uint32_t len, unsigned int timeout)
+{
+    mrbuf_t  *rb       = reader->rb;
+    long long deadline = timeout == AOS_WAIT_FOREVER ? 0 : aos_now_ms() + timeout;
+    uint32_t  avail;
+
+    for (;;) {
+        aos_mutex_lock(&rb->mutex, AOS_WAIT_FOREVER);
+        _reader_sync(reader);
+        avail = rb->wpos - reader->rpos;
+        /* a len over the ring would never be ready */
+        if (avail >= len || (rb->length && avail == rb->length) || timeout == AOS_NO_WAIT) {
+            reader->want = 0;
+            aos_mutex_unlock(&rb->mutex);
+            return avail;
+        }
+        reader->want = len;
+        aos_mutex_unlock(&rb->mutex);
+
+        if (timeout != AOS_WAIT_FOREVER) {
+            long long left = deadline - aos_now_ms();
+            /* one more look with no wait once the time is up */
+            timeout = left > 0 ? (unsigned int)left : AOS_NO_WAIT;
+            if (left <= 0) {
+                continue;
+            }
+        }
+        aos_sem_wait(&reader->sem, timeout);
+    }
+}
+
+/* copy len bytes from position pos of the ring, lock held */
+static void _ring_copy_out(mrbuf_t *rb, uint64_t pos, uint8_t *data, uint32_t len)
+{
+    uint32_t off   = pos % rb->length;
+    uint32_t first = MIN(len, rb->length - off);
+
+    memcpy(data, rb->buffer + off, first);
+    memcpy(data + first, rb->buffer, len - first);
+}
+
+/**
+ * @brief  init the ring, the storage may be attached later by mrbuf_set_buffer
+ * @param  [in] rb
+ * @return 0 on success
+ */
+int mrbuf_init(mrbuf_t *rb)
+{
+    memset(rb, 0, sizeof(mrbuf_t));
+    return aos_mutex_new(&rb->mutex);
+}
+
+/**
+ * @brief  free the ring, all the readers must be closed, the storage is the caller's
+ * @param  [in] rb
+ * @return
+ */
+void mrbuf_uninit(mrbuf_t *rb)
+{
+    aos_mutex_free(&rb->mutex);
+    rb->buffer = NULL;
+    rb->length = 0;
+}
+
+/**
+ * @brief  attach the storage, readers see an empty ring
+ * @param  [in] rb
+ * @param  [in] buffer
+ * @param  [in] length
+ * @return
+ */
+void mrbuf_set_buffer(mrbuf_t *rb, uint8_t *buffer, uint32_t length)
+{
+    aos_mutex_lock(&rb->mutex, AOS_WAIT_FOREVER);
+    rb->buffer = buffer;
+    rb->length = buffer ? length : 0;
+    rb->wpos   = 0;
+    for (int i = 0; i < MRBUF_MAX_READERS; i++) {
+        if (rb->readers[i]) {
+            rb->readers[i]->rpos = 0;
+        }
+    }
+    aos_mutex_unlock(&rb->mutex);
+}
+
+/**
+ * @brief  append data, overwriting what the slowest readers have not read yet
+ * @param  [in] rb
+ * @param  [in] data
+ * @param  [in] len
+ * @return bytes written, 0 if no storage is attached
+ */
+int mrbuf_write(mrbuf_t *rb, const void *data, uint32_t len)
+{
+    const uint8_t *src = (const uint8_t *)data;
+    uint32_t       off, first;
+
+    aos_mutex_lock(&rb->mutex, AOS_WAIT_FOREVER);
+    if (rb->buffer == NULL) {
+        aos_mutex_unlock(&rb->mutex);
+        return 0;
+    }
+
+    /* only the tail of a write longer than the ring survives */
+    if (len > rb->length) {
+        rb->wpos += len - rb->length;
+        src += len - rb->length;
+        len = rb->length;
+    }
+
+    off   = rb->wpos % rb->length;
+    first = MIN(len, rb->length - off);
+    memcpy(rb->buffer + off, src, first);
+    memcpy(rb->buffer, src + first, len - first);
+    rb->wpos += len;
+
+    for (int i = 0; i < MRBUF_MAX_READERS; i++) {
+        mrbuf_reader_t *reader = rb->readers[i];
+        if (reader && reader->want && (rb->wpos - reader->rpos >= reader->want ||
+                                       rb->wpos - reader->rpos >= rb->length)) {
+            reader->want = 0;
+            aos_sem_signal(&reader->sem);
+        }
+    }
+    aos_mutex_unlock(&rb->mutex);
+
+    return len;
+}
+
+/**
+ * @brief  drop the unread data of every reader
+ * @param  [in] rb
+ * @return
+ */
+void mrbuf_clear(mrbuf_t *rb)
+{
+    aos_mutex_lock(&rb->mutex, AOS_WAIT_FOREVER);
+    for (int i = 0; i < MRBUF_MAX_READERS; i++) {
+        if (rb->readers[i]) {
+            rb->readers[i]->rpos = rb->wpos;
+        }
+    }
+    aos_mutex_unlock(&rb->mutex);
+}
+
+/**
+ * @brief  add a reader, it starts at the write position
+ * @param  [in] rb
+ * @param  [in] reader
+ * @return 0 on success, -1 if MRBUF_MAX_READERS are open
+ */
+int mrbuf_reader_open(mrbuf_t *rb, mrbuf_reader_t *reader)
+{
+    int ret = -1;
+
+    memset(reader, 0, sizeof(mrbuf_reader_t));
+    if (aos_sem_new(&reader->sem, 0) != 0) {
+        return -1;
+    }
+    reader->rb = rb;
+
+    aos_mutex_lock(&rb->mutex, AOS_WAIT_FOREVER);
+    for (int i = 0; i < MRBUF_MAX_READERS; i++) {
+        if (rb->readers[i] == NULL) {
+            reader->rpos   = rb->wpos;
+            rb->readers[i] = reader;
+            ret            = 0;
+            break;
+        }
+    }
+    aos_mutex_unlock(&rb->mutex);
+
+    if (ret != 0) {
+        aos_sem_free(&reader->sem);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief  remove the reader
+ * @param  [in] reader
+ * @return
+ */
+void mrbuf_reader_close(mrbuf_reader_t *reader)
+{
+    mrbuf_t *rb = reader->rb;
+
+    aos_mutex_lock(&rb->mutex, AOS_WAIT_FOREVER);
+    for (int i = 0; i < MRBUF_MAX_READERS; i++) {
+        if (rb->readers[i] == reader) {
+            rb->readers[i] = NULL;
+        }
+    }
+    aos_mutex_unlock(&rb->mutex);
+    aos_sem_free(&reader->sem);
+}
+
+/**
+ * @brief  bytes ready for the reader
+ * @param  [in] reader
+ * @return
+ */
+int mrbuf_available(mrbuf_reader_t *reader)
+{
+    return _reader_wait(reader, 0, AOS_NO_WAIT);
+}
+
+/**
+ * @brief  copy out up to len bytes, waiting up to timeout ms for len bytes to arrive
+ * @param  [in] reader
+ * @param  [in] data
+ * @param  [in] len
+ * @param  [in] timeout : ms, AOS_NO_WAIT or AOS_WAIT_FOREVER
+ * @return bytes read, less than len on timeout
+ */
+int mrbuf_read(mrbuf_reader_t *reader, void *data, uint32_t len, unsigned int timeout)
+{
+    mrbuf_t *rb = reader->rb;
+
+    _reader_wait(reader, len, timeout);
+
+    aos_mutex_lock(&rb->mutex, AOS_WAIT_FOREVER);
+    _reader_sync(reader);
+    len = MIN(len, rb->wpos - reader->rpos);
+    if (len) {
+        _ring_copy_out(rb, reader->rpos, (uint8_t *)data, len);
+        reader->rpos += len;
+    }
+    aos_mutex_unlock(&rb->mutex);
+
+    return len;
+}
+
+/**
+ * @brief  look at the unread data in place, waiting up to timeout ms for len bytes.
+ *         The region is contiguous, so it may be shorter than what is available
+ *         when it reaches the end of the storage; peek again after the commit
+ * @param  [in] reader
+ * @param  [out] data : start of the region
+ * @param  [in] len
+ * @param  [in] timeout : ms
+ * @return bytes in the region, up to len
+ */
+int mrbuf_peek(mrbuf_reader_t *reader, const uint8_t **data, uint32_t len, unsigned int timeout)
+{
+    mrbuf_t *rb = reader->rb;
+    uint32_t off;
+
+    _reader_wait(reader, len, timeout);
+
+    aos_mutex_lock(&rb->mutex, AOS_WAIT_FOREVER);
+    _reader_sync(reader);
+    len = MIN(len, rb->wpos - reader->rpos);
+    if (len) {
+        off   = reader->rpos % rb->length;
+        len   = MIN(len, rb->length - off);
+        *data = rb->buffer + off;
+    } else {
+        *data = NULL;
+    }
+    aos_mutex_unlock(&rb->mutex);
+
+    return len;
+}
+
+/**
+ * @brief  consume len bytes of the region got by mrbuf_peek
+ * @param  [in] reader
+ * @param  [in] len
+ * @return len, -1 if the writer overwrote the region before the commit: the data
+ *         read from it is torn, and the loss is counted in the overflow
+ */
+int mrbuf_commit(mrbuf_reader_t *reader, uint32_t len)
+{
+    mrbuf_t *rb  = reader->rb;
+    int      ret = len;
+
+    aos_mutex_lock(&rb->mutex, AOS_WAIT_FOREVER);
+    /* the writer only moves forward, so the start still in the ring means all of it was */
+    if (rb->wpos - reader->rpos > rb->length) {
+        _reader_sync(reader);
+        ret = -1;
+    } else {
+        reader->rpos += MIN(len, rb->wpos - reader->rpos);
+    }
+    aos_mutex_unlock(&rb->mutex);
+
+    return ret;
+}
+
+/**
+ * @brief  bytes the reader lost to the writer since it was opened
+ * @param  [in] reader
+ * @return
+ */
+uint64_t mrbuf_overflow(mrbuf_reader_t *reader)
+{
+    uint64_t overflow;
+
+    aos_mutex_lock(&reader->rb->mutex, AOS_WAIT_FOREVER);
+    _reader_sync(reader);
+    overflow = reader->overflow;
+    aos_mutex_unlock(&reader->rb->mutex);
+
+    return overflow;
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2022 Alibaba Group Holding Limited
+ */
+
+#ifndef __MRBUFFER_H__
+#define __MRBUFFER_H__
+
+#include <stdint.h>
+#include <aos/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MRBUF_MAX_READERS 4
+
+typedef struct mrbuf mrbuf_t;
+
+/*
+ * one cursor in the ring, positions count every byte ever written so a reader
+ * the writer lapped sees how much it lost
+ */
+typedef struct mrbuf_reader {
+    mrbuf_t    *rb;
+    uint64_t    rpos;
+    uint64_t    overflow;   /* bytes overwritten before this reader got them */
+    uint32_t    want;       /* bytes waited for, 0 when not waiting */
+    aos_sem_t   sem;
+} mrbuf_reader_t;
+
+/*
+ * single writer, several readers with their own cursor. The writer never waits:
+ * a reader that falls a whole ring behind loses the oldest data
+ */
+struct mrbuf {
+    uint8_t        *buffer;
+    uint32_t        length;
+    uint64_t        wpos;
+    aos_mutex_t     mutex;
+    mrbuf_reader_t *readers[MRBUF_MAX_READERS];
+};
+
+/**
+ * @brief  init the ring, the storage may be attached later by mrbuf_set_buffer
+ * @param  [in] rb
+ * @return 0 on success
+ */
+int mrbuf_init(mrbuf_t *rb);
+
+/**
+ * @brief  free the ring, all the readers must be closed, the storage is the caller's
+ * @param  [in] rb
+ * @return
+ */
+void mrbuf_uninit(mrbuf_t *rb);
+
+/**
+ * @brief  attach the storage, readers see an empty ring
+ * @param  [in] rb
+ * @param  [in] buffer
+ * @param  [in] length
+ * @return
+ */
+void mrbuf_set_buffer(mrbuf_t *rb, uint8_t *buffer, uint32_t length);
+
+/**
+ * @brief  append data, overwriting what the slowest readers have not read yet
+ * @param  [in] rb
+ * @param  [in] data
+ * @param  [in] len
+ * @return bytes written, 0 if no storage is attached
+ */
+int mrbuf_write(mrbuf_t *rb, const void *data, uint32_t len);
+
+/**
+ * @brief  drop the unread data of every reader
+ * @param  [in] rb
+ * @return
+ */
+void mrbuf_clear(mrbuf_t *rb);
+
+/**
+ * @brief  add a reader, it starts at the write position
+ * @param  [in] rb
+ * @param  [in] reader
+ * @return 0 on success, -1 if MRBUF_MAX_READERS are open
+ */
+int mrbuf_reader_open(mrbuf_t *rb, mrbuf_reader_t *reader);
+
+/**
+ * @brief  remove the reader
+ * @param  [in] reader
+ * @return
+ */
+void mrbuf_reader_close(mrbuf_reader_t *reader);
+
+/**
+ * @brief  bytes ready for the reader
+ * @param  [in] reader
+ * @return
+ */
+int mrbuf_available(mrbuf_reader_t *reader);
+
+/**
+ * @brief  copy out up to len bytes, waiting up to timeout ms for len bytes to arrive
+ * @param  [in] reader
+ * @param  [in] data
+ * @param  [in] len
+ * @param  [in] timeout : ms, AOS_NO_WAIT or AOS_WAIT_FOREVER
+ * @return bytes read, less than len on timeout
+ */
+int mrbuf_read(mrbuf_reader_t *reader, void *data, uint32_t len, unsigned int timeout);
+
+/**
+ * @brief  look at the unread data in place, waiting up to timeout ms for len bytes.
+ *         The region is contiguous, so it may be shorter than what is available
+ *         when it reaches the end of the storage; peek again after the commit
+ * @param  [in] reader
+ * @param  [out] data : start of the region
+ * @param  [in] len
+ * @param  [in] timeout : ms
+ * @return bytes in the region, up to len
+ */
+int mrbuf_peek(mrbuf_reader_t *reader, const uint8_t **data, uint32_t len, unsigned int timeout);
+
+/**
+ * @brief  consume len bytes of the region got by mrbuf_peek
+ * @param  [in] reader
+ * @param  [in] len
+ * @return len, -1 if the writer overwrote the region before the commit: the data
+ *         read from it is torn, and the loss is counted in the overflow
+ */
+int mrbuf_commit(mrbuf_reader_t *reader, uint32_t len);
+
+/**
+ * @brief  bytes the reader lost to the writer since it was opened
+ * @param  [in] reader
+ * @return
+ */
+uint64_t mrbuf_overflow(mrbuf_reader_t *reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
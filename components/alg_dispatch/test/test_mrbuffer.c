@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2022 Alibaba Group Holding Limited
+ */
+
+/*
+ * Host check of mrbuffer.c on pthreads: one writer filling a small ring flat out while
+ * three readers follow it at once, copying, peeking and peeking slowly. Every byte is
+ * its position in the stream, so a reader sees torn data as a wrong byte. A reader must
+ * accept no torn data, and what it got plus what it lost must be all that was written.
+ * Then the timed reads: a read on an empty ring returns after its timeout, a short one
+ * with what is there. Exits with 1 on the first failure.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mrbuffer.h"
+
+#define RING_LEN    1000
+#define FRAME_LEN   64
+#define FRAMES      20000
+
+/* the aos calls of mrbuffer.c */
+int aos_mutex_new(aos_mutex_t *mutex)
+{
+    pthread_mutex_t *m = malloc(sizeof(pthread_mutex_t));
+    pthread_mutex_init(m, NULL);
+    *mutex = m;
+    return 0;
+}
+
+void aos_mutex_free(aos_mutex_t *mutex)
+{
+    pthread_mutex_destroy(*mutex);
+    free(*mutex);
+}
+
+int aos_mutex_lock(aos_mutex_t *mutex, unsigned int timeout)
+{
+    return pthread_mutex_lock(*mutex);
+}
+
+int aos_mutex_unlock(aos_mutex_t *mutex)
+{
+    return pthread_mutex_unlock(*mutex);
+}
+
+int aos_sem_new(aos_sem_t *sem, int count)
+{
+    sem_t *s = malloc(sizeof(sem_t));
+    sem_init(s, 0, count);
+    *sem = s;
+    return 0;
+}
+
+void aos_sem_free(aos_sem_t *sem)
+{
+    sem_destroy(*sem);
+    free(*sem);
+}
+
+long long aos_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+int aos_sem_wait(aos_sem_t *sem, unsigned int timeout)
+{
+    if (timeout == AOS_WAIT_FOREVER) {
+        while (sem_wait(*sem) != 0 && errno == EINTR) {
+        }
+        return 0;
+    }
+    long long deadline = aos_now_ms() + timeout;
+    struct timespec ts = {deadline / 1000, (deadline % 1000) * 1000000};
+    return sem_timedwait(*sem, &ts);
+}
+
+void aos_sem_signal(aos_sem_t *sem)
+{
+    sem_post(*sem);
+}
+
+enum { READ_COPY, READ_PEEK, READ_PEEK_SLOW, READ_MODES };
+
+static const char *mode_names[READ_MODES] = {"read", "peek", "slow peek"};
+
+typedef struct {
+    int              mode;
+    mrbuf_reader_t   reader;
+    uint64_t         got;
+    int              torn;
+} reader_ctx_t;
+
+static mrbuf_t           g_rb;
+static uint8_t           g_store[RING_LEN];
+static volatile int      g_writer_done;
+static pthread_barrier_t g_start;
+
+static void *reader_entry(void *arg)
+{
+    reader_ctx_t *ctx = (reader_ctx_t *)arg;
+    uint8_t       buf[FRAME_LEN];
+
+    mrbuf_reader_open(&g_rb, &ctx->reader);
+    pthread_barrier_wait(&g_start);
+
+    for (;;) {
+        int n;
+        if (ctx->mode == READ_COPY) {
+            n = mrbuf_read(&ctx->reader, buf, FRAME_LEN, 20);
+            /* the cursor of a lapped reader moves inside the read, so check the bytes follow
+               each other */
+            for (int i = 1; i < n; i++) {
+                if ((uint8_t)(buf[i] - buf[0]) != i) {
+                    ctx->torn++;
+                    break;
+                }
+            }
+        } else {
+            const uint8_t *data;
+            int            ok = 1;
+            n = mrbuf_peek(&ctx->reader, &data, FRAME_LEN, 20);
+            uint64_t start = ctx->reader.rpos;
+            for (int i = 0; i < n; i++) {
+                if (data[i] != (uint8_t)(start + i)) {
+                    ok = 0;
+                }
+            }
+            if (ctx->mode == READ_PEEK_SLOW) {
+                usleep(100);
+            }
+            /* torn data is fine as long as the commit says so */
+            if (n > 0 && mrbuf_commit(&ctx->reader, n) < 0) {
+                n = 0;
+            } else if (!ok) {
+                ctx->torn++;
+            }
+        }
+        ctx->got += n > 0 ? n : 0;
+        if (n <= 0 && g_writer_done && mrbuf_available(&ctx->reader) == 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static int concurrent_readers(void)
+{
+    reader_ctx_t ctx[READ_MODES];
+    pthread_t    threads[READ_MODES];
+    uint8_t      frame[FRAME_LEN];
+    uint64_t     pos = 0;
+    int          ret = 0;
+
+    pthread_barrier_init(&g_start, NULL, READ_MODES + 1);
+    for (int i = 0; i < READ_MODES; i++) {
+        ctx[i].mode = i;
+        ctx[i].got  = 0;
+        ctx[i].torn = 0;
+        pthread_create(&threads[i], NULL, reader_entry, &ctx[i]);
+    }
+    pthread_barrier_wait(&g_start);
+
+    for (int k = 0; k < FRAMES; k++) {
+        for (int i = 0; i < FRAME_LEN; i++) {
+            frame[i] = (uint8_t)(pos + i);
+        }
+        mrbuf_write(&g_rb, frame, FRAME_LEN);
+        pos += FRAME_LEN;
+        if (k % 8 == 0) {
+            usleep(1);
+        }
+    }
+    g_writer_done = 1;
+
+    for (int i = 0; i < READ_MODES; i++) {
+        pthread_join(threads[i], NULL);
+        uint64_t overflow = mrbuf_overflow(&ctx[i].reader);
+        printf("%-9s got %8llu lost %8llu torn %d\n", mode_names[i],
+               (unsigned long long)ctx[i].got, (unsigned long long)overflow, ctx[i].torn);
+        if (ctx[i].torn || ctx[i].got + overflow != pos) {
+            printf("%s reader: got + lost != %llu written\n", mode_names[i], (unsigned long long)pos);
+            ret = -1;
+        }
+        mrbuf_reader_close(&ctx[i].reader);
+    }
+    pthread_barrier_destroy(&g_start);
+    return ret;
+}
+
+static int timed_reads(void)
+{
+    mrbuf_reader_t reader;
+    uint8_t        buf[10];
+
+    mrbuf_reader_open(&g_rb, &reader);
+    long long start = aos_now_ms();
+    int       n     = mrbuf_read(&reader, buf, sizeof(buf), 30);
+    long long spent = aos_now_ms() - start;
+    if (n != 0 || spent < 25) {
+        printf("empty read: %d bytes after %lld ms, expected 0 after 30 ms\n", n, spent);
+        mrbuf_reader_close(&reader);
+        return -1;
+    }
+    mrbuf_write(&g_rb, "abc", 3);
+    n = mrbuf_read(&reader, buf, sizeof(buf), 20);
+    mrbuf_reader_close(&reader);
+    if (n != 3) {
+        printf("short read: %d bytes, expected 3\n", n);
+        return -1;
+    }
+    printf("timed reads: ok\n");
+    return 0;
+}
+
+int main(void)
+{
+    mrbuf_init(&g_rb);
+    mrbuf_set_buffer(&g_rb, g_store, RING_LEN);
+    int ret = concurrent_readers() || timed_reads();
+    mrbuf_uninit(&g_rb);
+    return ret ? 1 : 0;
+}
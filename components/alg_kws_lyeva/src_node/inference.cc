@@ -25,6 +25,9 @@ using InferOutMessageT = thead::voice::proto::InferOutMsg;
 
 using AlgCmdMessageT   = posto::Message<thead::voice::proto::AlgCmdMsg>;
 
+static const cx::MetaKey<SspOutMessageT> kSspParam("ssp_param");
+static const cx::MetaKey<InferOutMessageT> kKwsParam("kws_param");
+
 namespace cpt
 {
 
@@ -137,7 +140,7 @@ bool Inference::Process(const std::vector<cx::BufferPtr> &data_vec)
     auto iMemory = data_vec.at(0)->GetMemory(0);
     int16_t *data_in = (int16_t *)iMemory->data();
 
-    auto iMeta = data_vec.at(0)->GetMetadata<SspOutMessageT>("ssp_param");
+    auto iMeta = data_vec.at(0)->GetMetadata(kSspParam);
 
     if (inited_flag_ == 0) {
         int ret_init = aie_kws_init(handle_skws, iMeta->chn_num(), &frame_buf_len_, &temp_buf_len_);
@@ -223,7 +226,7 @@ bool Inference::Process(const std::vector<cx::BufferPtr> &data_vec)
         oMeta->set_first_wakeup(first_wkup);
 
         auto output = std::make_shared<cx::Buffer>();
-        output->SetMetadata("kws_param", oMeta);
+        output->SetMetadata(kKwsParam, oMeta);
 
         Send(0, output);
         Send(1, output);
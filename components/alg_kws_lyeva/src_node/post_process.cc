@@ -22,6 +22,11 @@ using KwsOutMessageT   = thead::voice::proto::KwsOutMsg;
 
 using SessionMessageT    = posto::Message<thead::voice::proto::SessionMsg>;
 
+static const cx::MetaKey<SspOutMessageT> kSspParam("ssp_param");
+static const cx::MetaKey<InferOutMessageT> kKwsParam("kws_param");
+static const cx::MetaKey<VadOutMessageT> kVadParam("vad_param");
+static const cx::MetaKey<KwsOutMessageT> kDispatchParam("dispatch_param");
+
 namespace cpt {
 
 class PostProcess : public cx::PluginBase {
@@ -54,7 +59,7 @@ void PostProcess::KwsSendMsg(uint8_t *buf, size_t buf_len, thead::voice::proto::
 
     auto output = std::make_shared<cx::Buffer>();
     output->AddMemory(oMemory);
-    output->SetMetadata("dispatch_param", oMeta);
+    output->SetMetadata(kDispatchParam, oMeta);
 
     Send(0, output);
 }
@@ -95,7 +100,7 @@ bool PostProcess::Process(const std::vector<cx::BufferPtr>& data_vec) {
   // ssp data
   if (ptr0) {
     auto iMemory0 = ptr0->GetMemory(0);
-    auto iMeta0 = ptr0->GetMetadata<SspOutMessageT>("ssp_param");
+    auto iMeta0 = ptr0->GetMetadata(kSspParam);
 
     int16_t *data = (int16_t *)iMemory0->data();
 
@@ -107,7 +112,7 @@ bool PostProcess::Process(const std::vector<cx::BufferPtr>& data_vec) {
 
   // kws state
   if (ptr1) {
-    auto iMeta1 = ptr1->GetMetadata<InferOutMessageT>("kws_param");
+    auto iMeta1 = ptr1->GetMetadata(kKwsParam);
     kws_chn = iMeta1->kws_chn();
 
     if (iMeta1->first_wakeup() == false) {
@@ -126,7 +131,7 @@ bool PostProcess::Process(const std::vector<cx::BufferPtr>& data_vec) {
 
   // vad state
   if (ptr2) {
-    auto iMeta2 = ptr2->GetMetadata<VadOutMessageT>("vad_param");
+    auto iMeta2 = ptr2->GetMetadata(kVadParam);
 
     pub_flag = 1;
     msg->body().set_cmd_id(thead::voice::proto::END);
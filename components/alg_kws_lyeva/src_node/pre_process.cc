@@ -7,6 +7,7 @@
 #if !(defined(CONFIG_BOARD_AMP_LOAD_FW) && CONFIG_BOARD_AMP_LOAD_FW)
 
 #include <memory>
+#include <vector>
 
 #include <cxvision/cxvision.h>
 #include <ulog/ulog.h>
@@ -17,6 +18,7 @@
 #define TAG "pre"
 
 #define DATA_OUT_CHAN    3
+#define DATA_OUT_POOL    8  /* 输出帧在 inference/post/vad 队列中的最大数量 */
 #if defined(CONFIG_VOICE_DBUS_SUPPORT) && CONFIG_VOICE_DBUS_SUPPORT
 #define PREPROC_IGN_CNT     80  /*唤醒后先忽略一定量数据再发送 */
 #else
@@ -41,6 +43,9 @@ using SspOutMessageT    = thead::voice::proto::SspOutMsg;
 using SessionMessageT   = posto::Message<thead::voice::proto::SessionMsg>;
 using RecordMessageT    = posto::Message<thead::voice::proto::RecordMsg>;
 
+static const cx::MetaKey<DataInputMessageT> kAlsaParam("alsa_param");
+static const cx::MetaKey<SspOutMessageT> kSspParam("ssp_param");
+
 namespace cpt {
 
 class PreProcess : public cx::PluginBase {
@@ -55,6 +60,9 @@ private:
   bool start_record_;
   int delay_cnt;
 
+  cx::MemoryPoolPtr out_pool_;
+  std::vector<int16_t> none_interleaved_buf_;
+
   std::shared_ptr<posto::Participant> participant_;
   std::shared_ptr<posto::Reader<SessionMessageT>> session_reader_;
   std::shared_ptr<posto::Reader<RecordMessageT>>  record_reader_;
@@ -134,44 +142,42 @@ bool PreProcess::Init(const std::map<std::string, std::string>& props) {
 
 bool PreProcess::DeInit() {
   T_Head_audio_free();
+  out_pool_.reset();
   return true;
 }
 
 bool PreProcess::Process(const std::vector<cx::BufferPtr>& data_vec) {
 
-  int16_t *none_interleaved_buf_;
-
   // get input data
   auto iMemory = data_vec.at(0)->GetMemory(0);
   int16_t *data_in = (int16_t *)iMemory->data();
 
-  auto iMeta = data_vec.at(0)->GetMetadata<DataInputMessageT>("alsa_param");
+  auto iMeta = data_vec.at(0)->GetMetadata(kAlsaParam);
 
-  // output data
-  int data_out_len = iMeta->frame() * (iMeta->format() / 8) * DATA_OUT_CHAN;
-  auto oMemory = cx::MemoryHelper::Malloc(data_out_len); // * 2
+  // output data, the frame size is fixed so the blocks are recycled once released
+  size_t data_out_len = iMeta->frame() * (iMeta->format() / 8) * DATA_OUT_CHAN;
+  if (!out_pool_ || out_pool_->block_size() != data_out_len) {
+    out_pool_ = cx::MemoryHelper::CreatePool(data_out_len, DATA_OUT_POOL);
+  }
+  auto oMemory = out_pool_->Malloc();
   int16_t* data_out = (int16_t *)oMemory->data();
 
-  none_interleaved_buf_ = (int16_t *)malloc(iMeta->frame() * (iMeta->format() / 8) * iMeta->chn_num());
-  /* data interleaved check */
-  for (int j = 0; j < iMeta->frame(); j++) {
-      for (int i = 0; i < iMeta->chn_num(); i++) {
-          none_interleaved_buf_[iMeta->frame() * i + j] = data_in[iMeta->chn_num() * j + i];
-      }
-  }
+  none_interleaved_buf_.resize(iMeta->frame() * iMeta->chn_num());
+  cx::pcm::Deinterleave(data_in, none_interleaved_buf_.data(), iMeta->frame(), iMeta->chn_num());
+
   // ssp and vad process
   //RUN_TIME_CHECK(500);
-  int ret = T_Head_audio_process(none_interleaved_buf_, none_interleaved_buf_ + iMeta->frame() * (iMeta->chn_num() - 1), data_out);
+  int ret = T_Head_audio_process(none_interleaved_buf_.data(),
+                                 none_interleaved_buf_.data() + iMeta->frame() * (iMeta->chn_num() - 1),
+                                 data_out);
   // int ret = 0;
   //RUN_TIME_CHECK(500);
 
   /* 若忽略信号处理，直接输出原始MIC数据 */
   // if (g_pcminput_ignore_ssp) {
-  //   memcpy(data_out, none_interleaved_buf_, data_out_len);
+  //   memcpy(data_out, none_interleaved_buf_.data(), data_out_len);
   // }
 
-  free(none_interleaved_buf_);
-
   // 信号处理输出三路，顺序为：BSS、BSS、BF，参考音直接覆盖第三路的BF
   // memcpy(&data_out[iMeta->frame() * (DATA_OUT_CHAN - 1)], data_in + iMeta->frame * (iMeta->chn_num - 1), iMeta->frame() * sizeof(int16_t));
 
@@ -183,7 +189,7 @@ bool PreProcess::Process(const std::vector<cx::BufferPtr>& data_vec) {
 
   auto output = std::make_shared<cx::Buffer>();
   output->AddMemory(oMemory);
-  output->SetMetadata("ssp_param", oMeta);
+  output->SetMetadata(kSspParam, oMeta);
 
   Send(0, output);     // inference
 
@@ -200,7 +206,11 @@ bool PreProcess::Process(const std::vector<cx::BufferPtr>& data_vec) {
   /* 5路数据录音，必须为交织格式 */
   if (start_record_ == true) {
     //TODO::
-    Send(3, output);  //record_process#1
+    /* record_process 不在本 device，池中的内存不能跨核发送 */
+    auto record = std::make_shared<cx::Buffer>();
+    record->AddMemory(cx::MemoryHelper::MallocAndCopy(data_out, data_out_len));
+    record->SetMetadata(kSspParam, oMeta);
+    Send(3, record);  //record_process#1
   }
 
   return true;
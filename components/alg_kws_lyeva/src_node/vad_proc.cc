@@ -23,6 +23,10 @@ using SspOutMessageT   = thead::voice::proto::SspOutMsg;
 using InferOutMessageT = thead::voice::proto::InferOutMsg;
 using VadOutMessageT   = thead::voice::proto::VadOutMsg;
 
+static const cx::MetaKey<SspOutMessageT> kSspParam("ssp_param");
+static const cx::MetaKey<InferOutMessageT> kKwsParam("kws_param");
+static const cx::MetaKey<VadOutMessageT> kVadParam("vad_param");
+
 namespace cpt {
 
 class VadProc : public cx::PluginBase {
@@ -79,7 +83,7 @@ bool VadProc::Process(const std::vector<cx::BufferPtr>& data_vec) {
 
   // sspout data
   if (ptr0) {
-    auto iMeta0 = ptr0->GetMetadata<SspOutMessageT>("ssp_param");
+    auto iMeta0 = ptr0->GetMetadata(kSspParam);
 
     frame_vad = iMeta0->vad_res();
 
@@ -91,7 +95,7 @@ bool VadProc::Process(const std::vector<cx::BufferPtr>& data_vec) {
 
   // kws state
   if (ptr1) {
-    auto iMeta1 = ptr1->GetMetadata<InferOutMessageT>("kws_param");
+    auto iMeta1 = ptr1->GetMetadata(kKwsParam);
 
     kws_chn = iMeta1->kws_chn();
 
@@ -173,7 +177,7 @@ VAD_BREAK:
     oMeta->set_vad_status(0);
 
     auto output = std::make_shared<cx::Buffer>();
-    output->SetMetadata("vad_param", oMeta);
+    output->SetMetadata(kVadParam, oMeta);
 
     /* 发送vad结果给 postproc */
     Send(0, output);
@@ -26,6 +26,8 @@ using DataInputMessageT = thead::voice::proto::DataInputMsg;
 // pub/sub message
 using RecordMessageT = posto::Message<thead::voice::proto::RecordMsg>;
 
+static const cx::MetaKey<DataInputMessageT> kAlsaParam("alsa_param");
+
 namespace cpt
 {
 
@@ -88,7 +90,7 @@ void DataInput::pcm_data_cb(void *data, unsigned int len, void *arg)
 
     auto output = std::make_shared<cx::Buffer>();
     output->AddMemory(oMemory);
-    output->SetMetadata("alsa_param", oMeta);
+    output->SetMetadata(kAlsaParam, oMeta);
 
     self->Send(0, output);
 
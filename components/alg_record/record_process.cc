@@ -23,6 +23,9 @@ using SspOutMessageT    = thead::voice::proto::SspOutMsg;
 // pub/sub message
 using SessionMessageT   = posto::Message<thead::voice::proto::SessionMsg>;
 
+static const cx::MetaKey<DataInputMessageT> kAlsaParam("alsa_param");
+static const cx::MetaKey<SspOutMessageT> kSspParam("ssp_param");
+
 namespace cpt
 {
 
@@ -135,7 +138,7 @@ bool RecordProc::Process(const std::vector<cx::BufferPtr> &data_vec)
         auto ptr0 = data_vec.at(0); // pcm data
         if (ptr0) {
             auto iMemory0 = ptr0->GetMemory(0);
-            auto iMeta0   = ptr0->GetMetadata<DataInputMessageT>("alsa_param");
+            auto iMeta0   = ptr0->GetMetadata(kAlsaParam);
 
             int len = iMeta0->frame();
             int chn = iMeta0->chn_num();
@@ -175,7 +178,7 @@ bool RecordProc::Process(const std::vector<cx::BufferPtr> &data_vec)
         // ssp data
         if (ptr1) {
             auto iMemory1 = ptr1->GetMemory(0);
-            auto iMeta1   = ptr1->GetMetadata<SspOutMessageT>("ssp_param");
+            auto iMeta1   = ptr1->GetMetadata(kSspParam);
 
             int alg_rec_num = iMeta1->chn_num();
 
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2018-2021 Alibaba Group Holding Limited
+ */
+
+/*
+ * hash_set / hash_get cost against the key count, built once per implementation (see
+ * CMakeLists.txt):
+ *   legacy: hash.c as it was, a fixed number of chained buckets, a strdup per key and
+ *           the xor-shift hash of the characters
+ *   open:   hash.c of this component, open addressing with robin hood probing, growing
+ *           past 7/8 full, short keys inline and the others in a key arena
+ * The table starts with 16 buckets as kv makes it, and gets <keys> keys such as kv uses,
+ * short ones with a numeric suffix and long ones with a path in front. Reports the time
+ * per insert, per lookup of a present and of an absent key, per delete and insert again,
+ * and the load factor at the end: keys per bucket for legacy, per slot for open. The key
+ * counts put the open table at loads from 1/2 to 7/8.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef BENCH_MODE
+#define BENCH_MODE "open"
+#endif
+
+#ifdef BENCH_LEGACY
+typedef struct _hash_entry_t hash_entry_t;
+
+typedef struct {
+    size_t             size;
+    size_t             keys_nb;
+    hash_entry_t       **entries;
+} hash_t;
+
+struct _hash_entry_t {
+    char               *key;
+    void               *value;
+    hash_entry_t       *next;
+};
+
+static int hash_init(hash_t *hash, size_t size)
+{
+    memset(hash, 0, sizeof(hash_t));
+    hash->entries = (hash_entry_t**)calloc(size, sizeof(hash_entry_t*));
+    hash->size = size;
+
+    return hash->entries ? 0 : -1;
+}
+
+static void hash_uninit(hash_t *table)
+{
+    int i;
+    hash_entry_t *entry, *next;
+
+    for (i = 0; i < table->size; i++) {
+        entry = table->entries[i];
+        while (entry) {
+            next = entry->next;
+            free(entry->key);
+            free(entry);
+            entry = next;
+        }
+    }
+    free(table->entries);
+}
+
+static unsigned _hash_key(hash_t *table, const char *key)
+{
+    int shift = 0;
+    unsigned int hash = 0;
+
+    if (table->size == 1)
+        return 0;
+    while (*key != '\0') {
+        hash ^= ((int)*key++ << shift);
+        shift += 4;
+        if (shift > 24)
+            shift = 0;
+    }
+
+    return hash % table->size;
+}
+
+static int hash_set(hash_t *table, const char *key, void *data)
+{
+    int idx = _hash_key(table, key);
+    hash_entry_t *entry = table->entries[idx];
+
+    while (entry) {
+        if (strcmp(key, entry->key) == 0) {
+            entry->value = data;
+            return 0;
+        }
+        entry = entry->next;
+    }
+
+    entry = (hash_entry_t *)calloc(1, sizeof(hash_entry_t));
+    if (!entry)
+        return -1;
+    entry->key = strdup(key);
+    if (!entry->key) {
+        free(entry);
+        return -1;
+    }
+    entry->value        = data;
+    entry->next         = table->entries[idx];
+    table->entries[idx] = entry;
+    table->keys_nb++;
+
+    return 0;
+}
+
+static void *hash_get2(hash_t *table, const char *key, int *valid)
+{
+    hash_entry_t *entry = table->entries[_hash_key(table, key)];
+
+    while (entry) {
+        if (!strcmp(key, entry->key)) {
+            *valid = 1;
+            return entry->value;
+        }
+        entry = entry->next;
+    }
+    *valid = 0;
+
+    return NULL;
+}
+
+static int hash_del(hash_t *table, const char *key)
+{
+    int idx = _hash_key(table, key);
+    hash_entry_t *entry = table->entries[idx], *prev = NULL;
+
+    while (entry) {
+        if (strcmp(key, entry->key) == 0) {
+            free(entry->key);
+            if (prev)
+                prev->next = entry->next;
+            else
+                table->entries[idx] = entry->next;
+            free(entry);
+            table->keys_nb--;
+            return 0;
+        }
+        prev  = entry;
+        entry = entry->next;
+    }
+
+    return -1;
+}
+#else
+#include <aos/hash.h>
+
+/* the few aos symbols pulled in by aos/hash.c */
+void *aos_zalloc(size_t size)
+{
+    return calloc(1, size);
+}
+
+void aos_free(void *mem)
+{
+    free(mem);
+}
+
+int ulog(const unsigned char s, const char *mod, const char *f, const unsigned long l, const char *fmt, ...)
+{
+    return 0;
+}
+
+void aos_except_process(int err, const char *file, int line, const char *func_name, void *caller)
+{
+    printf("except %d at %s:%d\n", err, file, line);
+    abort();
+}
+#endif
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int run(int count, const char *fmt)
+{
+    char (*keys)[48] = malloc((size_t)count * 2 * sizeof(keys[0]));
+    hash_t table;
+    long long t0;
+    double t_set, t_hit, t_miss, t_del;
+    int i, valid, rounds, r, failed = 0;
+
+    if (!keys)
+        return -1;
+    for (i = 0; i < count * 2; i++)
+        snprintf(keys[i], sizeof(keys[i]), fmt, i);
+    /* enough lookups per mode for a steady time on small tables */
+    rounds = 1 + 200000 / count;
+
+    hash_init(&table, 16);
+    t0 = now_ns();
+    for (i = 0; i < count; i++)
+        failed |= hash_set(&table, keys[i], (void *)(intptr_t)(i + 1));
+    t_set = (double)(now_ns() - t0) / count;
+
+    t0 = now_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < count; i++)
+            failed |= (intptr_t)hash_get2(&table, keys[i], &valid) != i + 1 || !valid;
+    }
+    t_hit = (double)(now_ns() - t0) / count / rounds;
+
+    t0 = now_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = count; i < count * 2; i++)
+            failed |= hash_get2(&table, keys[i], &valid) != NULL || valid;
+    }
+    t_miss = (double)(now_ns() - t0) / count / rounds;
+
+    t0 = now_ns();
+    for (i = 0; i < count; i++) {
+        failed |= hash_del(&table, keys[i]);
+        failed |= hash_set(&table, keys[i], (void *)(intptr_t)(i + 1));
+    }
+    t_del = (double)(now_ns() - t0) / count;
+
+    for (i = 0; i < count; i++)
+        failed |= (intptr_t)hash_get2(&table, keys[i], &valid) != i + 1 || !valid;
+    failed |= table.keys_nb != (size_t)count;
+
+    printf("%-6s %-26s keys %6d  load %7.2f  set %7.1f ns  hit %7.1f ns  miss %7.1f ns  "
+           "del+set %7.1f ns  %s\n",
+           BENCH_MODE, fmt, count, (double)table.keys_nb / table.size, t_set, t_hit, t_miss,
+           t_del, failed ? "MISMATCH" : "ok");
+
+    hash_uninit(&table);
+    free(keys);
+
+    return failed ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const int counts[] = { 16, 56, 100, 448, 1000, 7168 };
+    size_t i;
+    int    rc = 0;
+
+    for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        if (argc > 1 && atoi(argv[1]) > 0 && counts[i] > atoi(argv[1]))
+            break;
+        rc |= run(counts[i], "key_%d");
+        rc |= run(counts[i], "/sys/config/wifi/ssid_%d");
+    }
+
+    return rc ? 1 : 0;
+}
@@ -13,27 +13,41 @@ typedef struct _hash_t       hash_t;
 typedef struct _hash_entry_t hash_entry_t;
 typedef struct _hash_iter_t  hash_iter_t;
 
+/* keys shorter than this are kept in the entry itself, longer ones in the key arena */
+#ifndef HASH_KEY_INLINE
+#define HASH_KEY_INLINE        16
+#endif
+
 struct _hash_t {
-    size_t             size;
+    size_t             size;           ///< slots, a power of 2
     size_t             keys_nb;
-    hash_entry_t       **entries;
+    hash_entry_t       *entries;       ///< open addressing, robin hood probing
+    char               *arena;         ///< keys too long to be inline
+    size_t             arena_size;
+    size_t             arena_used;
+    size_t             arena_dead;     ///< bytes of deleted keys, reclaimed on compaction
 };
 
 struct _hash_entry_t {
-    char               *key;
     void               *value;
-    hash_entry_t       *next;
+    uint32_t           hash;
+    uint16_t           dist;           ///< probe length + 1, 0 for a free slot
+    uint16_t           len;            ///< key length
+    union {
+        char           inline_key[HASH_KEY_INLINE];
+        uint32_t       offset;         ///< of the key in the arena
+    } key;
 };
 
 struct _hash_iter_t {
     hash_t             *table;
     hash_entry_t       *entry;
-    int                idx;
+    size_t             idx;
 };
 
 /**
- * @brief  init the hash-table
- * @param  [in] size : table size
+ * @brief  init the hash-table, it grows when needed
+ * @param  [in] size : number of keys expected
  * @return 0/-1
  */
 int hash_init(hash_t *hash, size_t size);
@@ -46,7 +60,8 @@ int hash_init(hash_t *hash, size_t size);
 void hash_uninit(hash_t *table);
 
 /**
- * @brief  add a key-value pair to the hash-table
+ * @brief  add a key-value pair to the hash-table, a new key may move the entries
+ *         and so end an iteration going on
  * @param  [in] table
  * @param  [in] key
  * @param  [in] data : value of the key is a pointer, may be need free by the caller after free
@@ -6,22 +6,183 @@
 
 #define TAG                    "hash"
 
+#define HASH_SLOTS_MIN         8
+#define HASH_ARENA_MIN         64
+/* grow past 7/8 full, robin hood probing keeps the probes short up to there */
+#define HASH_FULL(n, size)     ((n) * 8 > (size) * 7)
+
+static inline uint32_t _rd32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void _mum32(uint32_t *a, uint32_t *b)
+{
+    uint64_t c = (uint64_t)*a * *b;
+    *a = (uint32_t)c;
+    *b = (uint32_t)(c >> 32);
+}
+
+/* wyhash32 style: 8 bytes per 32x32->64 multiply, every input bit reaches the low bits */
+static uint32_t _hash_key(const char *key, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)key;
+    uint32_t seed = 0x53c5ca59u ^ (uint32_t)len, see1 = (uint32_t)len;
+    size_t i = len;
+
+    for (; i > 8; i -= 8, p += 8) {
+        seed ^= _rd32(p);
+        see1 ^= _rd32(p + 4);
+        _mum32(&seed, &see1);
+    }
+    if (i >= 4) {
+        seed ^= _rd32(p);
+        see1 ^= _rd32(p + i - 4);
+    } else if (i) {
+        seed ^= ((uint32_t)p[0] << 16) | ((uint32_t)p[i >> 1] << 8) | p[i - 1];
+    }
+    see1 ^= 0x74743c1bu;
+    _mum32(&seed, &see1);
+    seed ^= 0x53c5ca59u;
+    _mum32(&seed, &see1);
+
+    return seed ^ see1;
+}
+
+static inline const char *_entry_key(const hash_t *table, const hash_entry_t *entry)
+{
+    return entry->len < HASH_KEY_INLINE ? entry->key.inline_key : table->arena + entry->key.offset;
+}
+
+static hash_entry_t *_hash_find(hash_t *table, const char *key, size_t len, uint32_t hash)
+{
+    size_t mask = table->size - 1;
+    size_t idx  = hash & mask;
+    uint16_t dist;
+    hash_entry_t *entry;
+
+    if (!table->entries)
+        return NULL;
+    for (dist = 1;; dist++, idx = (idx + 1) & mask) {
+        entry = &table->entries[idx];
+        /* a free slot or one closer to its home than we are: the key is not there */
+        if (entry->dist < dist)
+            return NULL;
+        if (entry->hash == hash && entry->len == len && !memcmp(_entry_key(table, entry), key, len))
+            return entry;
+    }
+}
+
+/* robin hood insert of an entry not in the table, the caller made sure a slot is free */
+static void _hash_place(hash_entry_t *entries, size_t size, hash_entry_t *entry)
+{
+    size_t mask = size - 1;
+    size_t idx  = entry->hash & mask;
+    hash_entry_t tmp;
+
+    for (entry->dist = 1;; entry->dist++, idx = (idx + 1) & mask) {
+        if (entries[idx].dist == 0) {
+            entries[idx] = *entry;
+            return;
+        }
+        /* take the slot from an entry nearer to its home, it goes on in our place */
+        if (entries[idx].dist < entry->dist) {
+            tmp          = entries[idx];
+            entries[idx] = *entry;
+            *entry       = tmp;
+        }
+    }
+}
+
+static int _hash_grow(hash_t *table)
+{
+    size_t i, size = table->size * 2;
+    hash_entry_t *entries;
+
+    entries = (hash_entry_t *)aos_zalloc(size * sizeof(hash_entry_t));
+    if (!entries) {
+        LOGE(TAG, "may be oom, size = %u", size);
+        return -1;
+    }
+    for (i = 0; i < table->size; i++) {
+        if (table->entries[i].dist)
+            _hash_place(entries, size, &table->entries[i]);
+    }
+    aos_free(table->entries);
+    table->entries = entries;
+    table->size    = size;
+
+    return 0;
+}
+
+/* a new arena holding the live keys and room for need more bytes */
+static int _arena_rebuild(hash_t *table, size_t need)
+{
+    size_t i, off = 0;
+    size_t size = (table->arena_used - table->arena_dead + need) * 2;
+    char *arena;
+
+    size  = size < HASH_ARENA_MIN ? HASH_ARENA_MIN : size;
+    arena = (char *)aos_zalloc(size);
+    if (!arena) {
+        LOGE(TAG, "may be oom, size = %u", size);
+        return -1;
+    }
+    for (i = 0; i < table->size; i++) {
+        hash_entry_t *entry = &table->entries[i];
+        if (entry->dist && entry->len >= HASH_KEY_INLINE) {
+            memcpy(arena + off, table->arena + entry->key.offset, entry->len + 1);
+            entry->key.offset = off;
+            off += entry->len + 1;
+        }
+    }
+    aos_free(table->arena);
+    table->arena      = arena;
+    table->arena_size = size;
+    table->arena_used = off;
+    table->arena_dead = 0;
+
+    return 0;
+}
+
+static int _key_store(hash_t *table, hash_entry_t *entry, const char *key, size_t len)
+{
+    if (len < HASH_KEY_INLINE) {
+        memcpy(entry->key.inline_key, key, len + 1);
+        return 0;
+    }
+
+    if (table->arena_used + len + 1 > table->arena_size && _arena_rebuild(table, len + 1) < 0)
+        return -1;
+    memcpy(table->arena + table->arena_used, key, len + 1);
+    entry->key.offset  = table->arena_used;
+    table->arena_used += len + 1;
+
+    return 0;
+}
+
 /**
- * @brief  init the hash-table
- * @param  [in] size : table size
+ * @brief  init the hash-table, it grows when needed
+ * @param  [in] size : number of keys expected
  * @return 0/-1
  */
 int hash_init(hash_t *hash, size_t size)
 {
+    size_t slots = HASH_SLOTS_MIN;
+
     CHECK_PARAM(hash && size, -1);
     memset(hash, 0, sizeof(hash_t));
-    hash->entries = (hash_entry_t**)aos_zalloc(size * sizeof(hash_entry_t*));
+    while (HASH_FULL(size, slots))
+        slots *= 2;
+    hash->entries = (hash_entry_t*)aos_zalloc(slots * sizeof(hash_entry_t));
     if (!hash->entries) {
         LOGE(TAG, "may be oom, size = %u", size);
         return -1;
     }
 
-    hash->size = size;
+    hash->size = slots;
 
     return 0;
 }
@@ -33,40 +194,13 @@ int hash_init(hash_t *hash, size_t size)
  */
 void hash_uninit(hash_t *table)
 {
-    int i;
-    hash_entry_t *entry, *next;
-
     if (table) {
-        for (i = 0; i < table->size; i++) {
-            entry = table->entries[i];
-            while (entry) {
-                next = entry->next;
-                aos_free(entry->key);
-                aos_free(entry);
-                entry = next;
-            }
-        }
         aos_free(table->entries);
+        aos_free(table->arena);
+        memset(table, 0, sizeof(hash_t));
     }
 }
 
-static unsigned _hash_key(hash_t *table, const char *key)
-{
-    int shift = 0;
-    unsigned int hash = 0;
-
-    if (table->size == 1)
-        return 0;
-    while (*key != '\0') {
-        hash ^= ((int)*key++ << shift);
-        shift += 4;
-        if (shift > 24)
-            shift = 0;
-    }
-
-    return hash % table->size;
-}
-
 /**
  * @brief  add a key-value pair to the hash-table
  * @param  [in] table
@@ -76,35 +210,33 @@ static unsigned _hash_key(hash_t *table, const char *key)
  */
 int hash_set(hash_t *table, const char *key, void *data)
 {
-    int idx = 0;
-    hash_entry_t *entry = NULL;
+    size_t len;
+    uint32_t hash;
+    hash_entry_t *entry, tmp;
 
-    CHECK_PARAM(table && key, -1);
-    idx = _hash_key(table, key);
-    entry = table->entries[idx];
-    while (entry) {
-        if (strcmp(key, entry->key) == 0) {
-            entry->value = data;
-            return 0;
-        }
-        entry = entry->next;
+    CHECK_PARAM(table && table->entries && key, -1);
+    len = strlen(key);
+    if (len >= UINT16_MAX)
+        return -1;
+    hash  = _hash_key(key, len);
+    entry = _hash_find(table, key, len, hash);
+    if (entry) {
+        entry->value = data;
+        return 0;
     }
 
-    /* allocate and fill a new entry */
-    entry = (hash_entry_t *)aos_zalloc(sizeof(hash_entry_t));
-    if (!entry) {
-        LOGE(TAG, "may be oom");
+    /* one slot stays free, lookups stop there */
+    if (HASH_FULL(table->keys_nb + 1, table->size) && _hash_grow(table) < 0 &&
+        table->keys_nb + 2 > table->size)
         return -1;
-    }
-    entry->key = strdup(key);
-    if (!entry->key) {
-        aos_free(entry);
-        LOGE(TAG, "may be oom");
+
+    memset(&tmp, 0, sizeof(tmp));
+    if (_key_store(table, &tmp, key, len) < 0)
         return -1;
-    }
-    entry->value        = data;
-    entry->next         = table->entries[idx];
-    table->entries[idx] = entry;
+    tmp.value = data;
+    tmp.hash  = hash;
+    tmp.len   = len;
+    _hash_place(table->entries, table->size, &tmp);
     table->keys_nb++;
 
     return 0;
@@ -119,28 +251,16 @@ int hash_set(hash_t *table, const char *key, void *data)
  */
 void *hash_get2(hash_t *table, const char *key, int *valid)
 {
-    int idx;
-    void *value = NULL;
+    size_t len;
     hash_entry_t *entry;
 
-    CHECK_PARAM(key, NULL);
-    idx = _hash_key(table, key);
-    entry = table->entries[idx];
-    while (entry) {
-        if (!strcmp(key, entry->key)) {
-            if (valid)
-                *valid = 1;
-            value = entry->value;
-            return value;
-        }
-
-        entry = entry->next;
-    }
-
+    CHECK_PARAM(table && key, NULL);
+    len   = strlen(key);
+    entry = _hash_find(table, key, len, _hash_key(key, len));
     if (valid)
-        *valid = 0;
+        *valid = entry != NULL;
 
-    return value;
+    return entry ? entry->value : NULL;
 }
 
 /**
@@ -162,21 +282,12 @@ void *hash_get(hash_t *table, const char *key)
  */
 int hash_key_is_valid(hash_t *table, const char *key)
 {
-    int idx;
-    hash_entry_t *entry;
+    int valid = 0;
 
     CHECK_PARAM(key, 0);
-    idx = _hash_key(table, key);
-    entry = table->entries[idx];
-    while (entry) {
-        if (!strcmp(key, entry->key)) {
-            return 1;
-        }
-
-        entry = entry->next;
-    }
+    hash_get2(table, key, &valid);
 
-    return 0;
+    return valid;
 }
 
 /**
@@ -187,28 +298,29 @@ int hash_key_is_valid(hash_t *table, const char *key)
  */
 int hash_del(hash_t *table, const char *key)
 {
-    int idx;
-    hash_entry_t *entry, *prev = NULL;
-
-    CHECK_PARAM(key, -1);
-    idx = _hash_key(table, key);
-    entry = table->entries[idx];
-    while (entry) {
-        if (strcmp(key, entry->key) == 0) {
-            aos_free(entry->key);
-            if (prev)
-                prev->next = entry->next;
-            else
-                table->entries[idx] = entry->next;
-            aos_free(entry);
-            table->keys_nb--;
-            return 0;
-        }
-        prev  = entry;
-        entry = entry->next;
+    size_t len, idx, next, mask;
+    hash_entry_t *entry;
+
+    CHECK_PARAM(table && key, -1);
+    len   = strlen(key);
+    entry = _hash_find(table, key, len, _hash_key(key, len));
+    if (!entry)
+        return -1;
+
+    if (entry->len >= HASH_KEY_INLINE)
+        table->arena_dead += entry->len + 1;
+
+    /* shift the entries after it back one slot, up to a free one or one at home */
+    mask = table->size - 1;
+    idx  = entry - table->entries;
+    for (next = (idx + 1) & mask; table->entries[next].dist > 1; idx = next, next = (next + 1) & mask) {
+        table->entries[idx] = table->entries[next];
+        table->entries[idx].dist--;
     }
+    memset(&table->entries[idx], 0, sizeof(hash_entry_t));
+    table->keys_nb--;
 
-    return -1;
+    return 0;
 }
 
 /**
@@ -221,7 +333,6 @@ int hash_iter_init(hash_t *table, hash_iter_t *iter)
 {
     CHECK_PARAM(table && iter, -1);
     memset(iter, 0, sizeof(hash_iter_t));
-    iter = (hash_iter_t *) malloc(sizeof(*iter));
     iter->table = table;
 
     return 0;
@@ -246,29 +357,19 @@ void hash_iter_uninit(hash_iter_t *iter)
 const char *hash_iter_foreach(hash_iter_t *iter)
 {
     CHECK_PARAM(iter && iter->table, NULL);
-    hash_t *table       = iter->table;
-    hash_entry_t *entry = iter->entry;
-
-    if (entry) {
-        entry = entry->next;
-    } else {
-        while (iter->idx < iter->table->size) {
-            entry = table->entries[iter->idx];
-            if (entry) {
-                iter->idx++;
-                break;
-            }
-            iter->idx++;
+    hash_t *table = iter->table;
+
+    iter->entry = NULL;
+    while (iter->idx < table->size) {
+        hash_entry_t *entry = &table->entries[iter->idx++];
+        if (entry->dist) {
+            iter->entry = entry;
+            return _entry_key(table, entry);
         }
     }
 
-    if (!entry || (iter->idx > table->size)) {
-        /* foreach over */
-        return NULL;
-    }
-    iter->entry = entry;
-
-    return entry->key;
+    /* foreach over */
+    return NULL;
 }
 
 /**
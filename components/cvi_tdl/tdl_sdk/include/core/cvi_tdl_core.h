@@ -365,6 +365,20 @@ DLL_EXPORT CVI_S32 CVI_TDL_SetModelThreshold(cvitdl_handle_t handle,
 DLL_EXPORT CVI_S32 CVI_TDL_SetModelNmsThreshold(cvitdl_handle_t handle,
                                                 CVI_TDL_SUPPORTED_MODEL_E model, float threshold);
 
+/**
+ * @brief Set how many frames an asynchronous inference keeps on the TPU. With depth >= 2 the
+ * postprocess of a frame runs while the TPU works on the next one. 0 or 1 makes the asynchronous
+ * interfaces synchronous. Frames still in flight are completed first. The vpss depth of the model
+ * has to cover the frames in flight.
+ *
+ * @param handle An TDL SDK handle.
+ * @param model Supported model id, must be opened.
+ * @param depth Number of frames in flight.
+ * @return int Return CVI_TDL_SUCCESS on success.
+ */
+DLL_EXPORT CVI_S32 CVI_TDL_SetPipelineDepth(cvitdl_handle_t handle,
+                                           CVI_TDL_SUPPORTED_MODEL_E model, uint32_t depth);
+
 /**
  * @brief Get the threshold of an TDL Inference
  *
@@ -770,6 +784,44 @@ DLL_EXPORT CVI_S32 CVI_TDL_PersonVehicle_Detection(const cvitdl_handle_t handle,
 DLL_EXPORT CVI_S32 CVI_TDL_Detection(const cvitdl_handle_t handle, VIDEO_FRAME_INFO_S *frame,
                                      CVI_TDL_SUPPORTED_MODEL_E model_index, cvtdl_object_t *obj);
 
+/**
+ * @brief Completion of an asynchronous detection.
+ *
+ * @param ret Inference status of the frame.
+ * @param obj The obj given to CVI_TDL_Detection_Async, filled when ret is CVI_TDL_SUCCESS.
+ * @param user_data The user_data given to CVI_TDL_Detection_Async.
+ */
+typedef void (*cvitdl_detection_callback)(CVI_S32 ret, cvtdl_object_t *obj, void *user_data);
+
+/**
+ * @brief Asynchronous object detection, see CVI_TDL_SetPipelineDepth. The frame is queued on the
+ * TPU and callback runs on the calling thread once its result is ready, usually during a later
+ * CVI_TDL_Detection_Async or CVI_TDL_Detection_Flush call. obj and frame must stay valid until
+ * then. Detection models without a pipelined path complete before returning.
+ *
+ * @param handle An TDL SDK handle.
+ * @param frame Input video frame.
+ * @param model_index The object detection model id selected to use.
+ * @param obj Output detect result.
+ * @param callback Called once per frame accepted, not called when the return value is an error.
+ * @param user_data Passed to callback.
+ * @return int Return CVI_TDL_SUCCESS on success.
+ */
+DLL_EXPORT CVI_S32 CVI_TDL_Detection_Async(const cvitdl_handle_t handle, VIDEO_FRAME_INFO_S *frame,
+                                           CVI_TDL_SUPPORTED_MODEL_E model_index,
+                                           cvtdl_object_t *obj, cvitdl_detection_callback callback,
+                                           void *user_data);
+
+/**
+ * @brief Complete every frame CVI_TDL_Detection_Async still has in flight.
+ *
+ * @param handle An TDL SDK handle.
+ * @param model_index The object detection model id selected to use.
+ * @return int Return CVI_TDL_SUCCESS if every frame succeeded.
+ */
+DLL_EXPORT CVI_S32 CVI_TDL_Detection_Flush(const cvitdl_handle_t handle,
+                                           CVI_TDL_SUPPORTED_MODEL_E model_index);
+
 /**
  * @brief Set object model output layer names.
  *
@@ -990,6 +1042,19 @@ DLL_EXPORT CVI_S32 CVI_TDL_DeepSORT_DebugInfo_1(const cvitdl_handle_t handle, ch
 DLL_EXPORT CVI_S32 CVI_TDL_DeepSORT_GetTracker_Inactive(const cvitdl_handle_t handle,
                                                         cvtdl_tracker_t *tracker);
 
+/**
+ * @brief Match ReID features through an int8 appearance gallery and keep the appearance of
+ * removed confirmed tracks, so that a returning target gets its old id back.
+ *
+ * @param handle An TDL SDK handle.
+ * @param enable Turn the gallery on or off, off drops every stored appearance.
+ * @param inactive_capacity Number of removed tracks kept, the oldest are dropped first.
+ * @param ivf_lists Number of IVF lists indexing the removed tracks, 0 for a linear scan.
+ * @return int Return CVI_TDL_SUCCESS on success.
+ */
+DLL_EXPORT CVI_S32 CVI_TDL_DeepSORT_SetReidGallery(const cvitdl_handle_t handle, bool enable,
+                                                   uint32_t inactive_capacity, uint32_t ivf_lists);
+
 /**
  * @brief Calculate iou score between faces and heads.
  *
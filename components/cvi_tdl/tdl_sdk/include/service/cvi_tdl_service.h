@@ -380,6 +380,77 @@ DLL_EXPORT cvtdl_service_brush_t CVI_TDL_Service_GetDefaultBrush();
 DLL_EXPORT CVI_S32 CVI_TDL_Service_DrawHandKeypoint(cvitdl_service_handle_t handle,
                                                     VIDEO_FRAME_INFO_S *frame,
                                                     const cvtdl_handpose21_meta_ts *meta);
+
+/**
+ * @brief Create the per-frame stage scheduler of the service handle, dropping any stages added
+ * before.
+ * @ingroup core_cvitdlservice
+ *
+ * @param handle A service handle.
+ * @param num_workers Threads running stages besides the caller of Scheduler_Run, 0 runs every
+ * stage on the calling thread.
+ * @param essential_priority Stages with a priority at or above this are never skipped.
+ * @return CVI_S32 Return CVI_TDL_SUCCESS if succeed.
+ */
+DLL_EXPORT CVI_S32 CVI_TDL_Service_Scheduler_Init(cvitdl_service_handle_t handle,
+                                                  uint32_t num_workers,
+                                                  int32_t essential_priority);
+
+/**
+ * @brief Add a stage to the scheduler. Its dependencies must have been added before.
+ * @ingroup core_cvitdlservice
+ *
+ * @param handle A service handle.
+ * @param stage Stage description.
+ * @param stage_id Output id of the stage, used in dependencies, states and statistics.
+ * @return CVI_S32 Return CVI_TDL_SUCCESS if succeed.
+ */
+DLL_EXPORT CVI_S32 CVI_TDL_Service_Scheduler_AddStage(cvitdl_service_handle_t handle,
+                                                      const cvtdl_service_stage_t *stage,
+                                                      uint32_t *stage_id);
+
+/**
+ * @brief Run every stage for one frame. Non essential stages that are not expected to finish
+ * within budget_us (or their own deadline) are skipped together with the stages depending on
+ * them.
+ * @ingroup core_cvitdlservice
+ *
+ * @param handle A service handle.
+ * @param frame Frame passed to every stage.
+ * @param frame_data Per frame data passed to every stage, e.g. the meta shared by the stages.
+ * @param budget_us Frame budget in microseconds, 0 to never skip on budget.
+ * @param states Output state of every stage, indexed by stage id. Can be NULL.
+ * @param elapsed_us Output time the frame took. Can be NULL.
+ * @return CVI_S32 Return CVI_TDL_SUCCESS if no stage failed.
+ */
+DLL_EXPORT CVI_S32 CVI_TDL_Service_Scheduler_Run(cvitdl_service_handle_t handle,
+                                                 VIDEO_FRAME_INFO_S *frame, void *frame_data,
+                                                 uint32_t budget_us,
+                                                 cvtdl_service_stage_state_e *states,
+                                                 uint32_t *elapsed_us);
+
+/**
+ * @brief Get the latency histogram and run counters of a stage.
+ * @ingroup core_cvitdlservice
+ *
+ * @param handle A service handle.
+ * @param stage_id Stage id.
+ * @param stats Output statistics.
+ * @return CVI_S32 Return CVI_TDL_SUCCESS if succeed.
+ */
+DLL_EXPORT CVI_S32 CVI_TDL_Service_Scheduler_GetStageStats(cvitdl_service_handle_t handle,
+                                                           uint32_t stage_id,
+                                                           cvtdl_service_stage_stats_t *stats);
+
+/**
+ * @brief Clear the statistics and latency estimates of all stages.
+ * @ingroup core_cvitdlservice
+ *
+ * @param handle A service handle.
+ * @return CVI_S32 Return CVI_TDL_SUCCESS if succeed.
+ */
+DLL_EXPORT CVI_S32 CVI_TDL_Service_Scheduler_ResetStats(cvitdl_service_handle_t handle);
+
 #ifdef __cplusplus
 }
 #endif
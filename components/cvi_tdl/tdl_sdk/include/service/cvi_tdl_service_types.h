@@ -66,4 +66,79 @@ typedef struct {
   uint32_t size;
 } cvtdl_service_brush_t;
 
+/** @typedef cvtdl_service_stage_func
+ *  @ingroup core_cvitdlservice
+ *  @brief One stage of a scheduled frame, usually a CVI_TDL_* model call. Returns
+ *  CVI_TDL_SUCCESS on success, stages depending on a failed stage are skipped.
+ */
+typedef CVI_S32 (*cvtdl_service_stage_func)(VIDEO_FRAME_INFO_S* frame, void* frame_data,
+                                            void* user_data);
+
+/** @struct cvtdl_service_stage_t
+ *  @ingroup core_cvitdlservice
+ *  @brief A stage of the per-frame scheduler.
+ *
+ * @var cvtdl_service_stage_t::name
+ * Name used in logs, copied.
+ * @var cvtdl_service_stage_t::func
+ * Stage function, may run on a scheduler worker thread.
+ * @var cvtdl_service_stage_t::user_data
+ * Passed to func.
+ * @var cvtdl_service_stage_t::priority
+ * Ready stages run highest priority first. Stages below the essential priority of the scheduler
+ * are skipped when they are not expected to finish within the frame budget or their deadline.
+ * @var cvtdl_service_stage_t::deadline_us
+ * Latest finish time counted from the start of the frame, 0 for none.
+ * @var cvtdl_service_stage_t::deps
+ * Ids of the stages this one consumes, all added before it.
+ * @var cvtdl_service_stage_t::num_deps
+ * Length of deps.
+ */
+typedef struct {
+  const char* name;
+  cvtdl_service_stage_func func;
+  void* user_data;
+  int32_t priority;
+  uint32_t deadline_us;
+  const uint32_t* deps;
+  uint32_t num_deps;
+} cvtdl_service_stage_t;
+
+/** @enum cvtdl_service_stage_state_e
+ *  @ingroup core_cvitdlservice
+ *  @brief What happened to a stage in the last scheduled frame.
+ */
+typedef enum {
+  STAGE_NOT_RUN = 0,
+  STAGE_DONE,
+  STAGE_FAILED,
+  STAGE_SKIPPED_BUDGET,
+  STAGE_SKIPPED_DEADLINE,
+  STAGE_SKIPPED_DEPENDENCY,
+} cvtdl_service_stage_state_e;
+
+#define CVTDL_STAGE_HIST_BINS 32
+
+/** @struct cvtdl_service_stage_stats_t
+ *  @ingroup core_cvitdlservice
+ *  @brief Latency statistics of a scheduled stage.
+ *
+ * @var cvtdl_service_stage_stats_t::histogram
+ * histogram[i] counts the runs that took [2^i, 2^(i+1)) us, runs under 1 us go to bin 0.
+ * @var cvtdl_service_stage_stats_t::deadline_misses
+ * Runs that finished after their deadline.
+ */
+typedef struct {
+  uint64_t runs;
+  uint64_t failures;
+  uint64_t skips;
+  uint64_t deadline_misses;
+  float mean_us;
+  uint32_t p50_us;
+  uint32_t p90_us;
+  uint32_t p99_us;
+  uint32_t max_us;
+  uint32_t histogram[CVTDL_STAGE_HIST_BINS];
+} cvtdl_service_stage_stats_t;
+
 #endif  // End of _CVI_TDL_SERVICE_TYPES_H_
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "core.hpp"
+#include <math.h>
+#include <algorithm>
 #include <stdexcept>
+#include "color_kernels.hpp"
 #include "core/utils/vpss_helper.h"
 #include "demangle.hpp"
 #include "error_msg.hpp"
@@ -267,6 +270,13 @@ void Core::setupTensorInfo(CVI_TENSOR *tensor, int32_t num_tensors,
 int Core::modelClose() {
   int ret = CVI_TDL_SUCCESS;
 
+  // the TPU must not write into the slot buffers once they are gone
+  flushPipeline();
+  bindInputs(nullptr);
+  m_slots.clear();
+  m_pipeline_depth = 0;
+  m_next_slot = 0;
+
   if (mp_mi->handle != nullptr) {
     ret = CVI_NN_CleanupModel(mp_mi->handle);
     if (ret != CVI_RC_SUCCESS) {  // NOLINT
@@ -285,14 +295,14 @@ CVI_TENSOR *Core::getInputTensor(int idx) {
   if (idx >= mp_mi->in.num) {
     return NULL;
   }
-  return mp_mi->in.tensors + idx;
+  return (m_bound_in ? m_bound_in : mp_mi->in.tensors) + idx;
 }
 
 CVI_TENSOR *Core::getOutputTensor(int idx) {
   if (idx >= mp_mi->out.num) {
     return NULL;
   }
-  return mp_mi->out.tensors + idx;
+  return (m_bound_out ? m_bound_out : mp_mi->out.tensors) + idx;
 }
 
 const TensorInfo &Core::getOutputTensorInfo(const std::string &name) {
@@ -487,9 +497,7 @@ int Core::vpssPreprocess(VIDEO_FRAME_INFO_S *srcFrame, VIDEO_FRAME_INFO_S *dstFr
   return CVI_TDL_SUCCESS;
 }
 
-int Core::run(std::vector<VIDEO_FRAME_INFO_S *> &frames) {
-  int ret = CVI_TDL_SUCCESS;
-
+int Core::checkSkipVpss() {
   if (m_skip_vpss_preprocess && !allowExportChannelAttribute()) {
     LOGE(
         "cannot skip vpss preprocessing for model: %s, please set false to "
@@ -497,6 +505,138 @@ int Core::run(std::vector<VIDEO_FRAME_INFO_S *> &frames) {
         demangle::type_no_scope(*this).c_str());
     return CVI_TDL_ERR_INVALID_ARGS;
   }
+  return CVI_TDL_SUCCESS;
+}
+
+int Core::preprocessFrames(std::vector<VIDEO_FRAME_INFO_S *> &frames,
+                           std::vector<std::shared_ptr<VIDEO_FRAME_INFO_S>> &dstFrames) {
+  if (m_vpss_config.size() != frames.size()) {
+    LOGE("The size of vpss config does not match the number of frames. (%zu vs %zu)\n",
+         m_vpss_config.size(), frames.size());
+    return CVI_TDL_ERR_INFERENCE;
+  }
+
+  dstFrames.reserve(frames.size());
+  for (uint32_t i = 0; i < frames.size(); i++) {
+    VIDEO_FRAME_INFO_S *f = new VIDEO_FRAME_INFO_S;
+    memset(f, 0, sizeof(VIDEO_FRAME_INFO_S));
+    int vpssret = vpssPreprocess(frames[i], f, m_vpss_config[i]);
+    if (vpssret != CVI_TDL_SUCCESS) {
+      // if preprocess fail, just delete frame.
+      if (f->stVFrame.u64PhyAddr[0] != 0) {
+        mp_vpss_inst->releaseFrame(f, 0);
+      }
+      delete f;
+      return vpssret;
+    } else {
+      dstFrames.push_back(std::shared_ptr<VIDEO_FRAME_INFO_S>({f, [this](VIDEO_FRAME_INFO_S *f) {
+                                                                this->mp_vpss_inst->releaseFrame(f,
+                                                                                                 0);
+                                                                delete f;
+                                                              }}));
+    }
+  }
+  return CVI_TDL_SUCCESS;
+}
+
+static bool isSoftwareFrame(const VIDEO_FRAME_INFO_S *frame) {
+  const VIDEO_FRAME_S &f = frame->stVFrame;
+  switch (f.enPixelFormat) {
+    case PIXEL_FORMAT_NV21:
+    case PIXEL_FORMAT_NV12:
+    case PIXEL_FORMAT_YUV_PLANAR_420:
+      return f.u64PhyAddr[0] == 0 && f.pu8VirAddr[0] != nullptr;
+    default:
+      return false;
+  }
+}
+
+int Core::softwarePreprocess(std::vector<VIDEO_FRAME_INFO_S *> &frames) {
+  if (aligned_input || frames.size() != (uint32_t)mp_mi->in.num ||
+      m_vpss_config.size() != frames.size()) {
+    LOGE("software preprocess needs one unaligned input tensor per frame\n");
+    return CVI_TDL_ERR_INVALID_ARGS;
+  }
+
+  for (uint32_t i = 0; i < frames.size(); i++) {
+    const VIDEO_FRAME_S &f = frames[i]->stVFrame;
+    const VPSS_CHN_ATTR_S &attr = m_vpss_config[i].chn_attr;
+    CVI_TENSOR *tensor = mp_mi->in.tensors + i;
+    const bool bgr = attr.enPixelFormat == PIXEL_FORMAT_BGR_888_PLANAR;
+    if (!isSoftwareFrame(frames[i]) || tensor->fmt != CVI_FMT_INT8 || tensor->aligned ||
+        tensor->shape.dim[1] != 3 || !attr.stNormalize.bEnable ||
+        m_vpss_config[i].crop_attr.bEnable ||
+        (!bgr && attr.enPixelFormat != PIXEL_FORMAT_RGB_888_PLANAR) ||
+        (f.enPixelFormat == PIXEL_FORMAT_YUV_PLANAR_420 && f.u32Stride[1] != f.u32Stride[2])) {
+      LOGE("software preprocess does not support frame format %d into a tensor of format %d\n",
+           f.enPixelFormat, tensor->fmt);
+      return CVI_TDL_ERR_INVALID_ARGS;
+    }
+
+    cvitdl::Yuv420Image src;
+    src.y = f.pu8VirAddr[0];
+    src.y_stride = f.u32Stride[0];
+    src.uv_stride = f.u32Stride[1];
+    src.width = f.u32Width;
+    src.height = f.u32Height;
+    if (f.enPixelFormat == PIXEL_FORMAT_YUV_PLANAR_420) {
+      src.u = f.pu8VirAddr[1];
+      src.v = f.pu8VirAddr[2];
+      src.uv_step = 1;
+    } else {
+      src.u = f.pu8VirAddr[1] + (f.enPixelFormat == PIXEL_FORMAT_NV21 ? 1 : 0);
+      src.v = f.pu8VirAddr[1] + (f.enPixelFormat == PIXEL_FORMAT_NV21 ? 0 : 1);
+      src.uv_step = 2;
+    }
+
+    // the image rect inside the tensor, as the aspect ratio of the channel places it
+    const int tw = tensor->shape.dim[3], th = tensor->shape.dim[2];
+    int rx = 0, ry = 0, rw = tw, rh = th;
+    if (attr.stAspectRatio.enMode == ASPECT_RATIO_AUTO) {
+      float ratio = std::min(float(tw) / src.width, float(th) / src.height);
+      rw = std::min(tw, int(src.width * ratio + 0.5f));
+      rh = std::min(th, int(src.height * ratio + 0.5f));
+      if (m_vpss_config[i].rescale_type != RESCALE_RB) {
+        rx = (tw - rw) / 2;
+        ry = (th - rh) / 2;
+      }
+    } else if (attr.stAspectRatio.enMode == ASPECT_RATIO_MANUAL) {
+      const RECT_S &rect = attr.stAspectRatio.stVideoRect;
+      rx = std::max(0, std::min(tw - 1, int(rect.s32X)));
+      ry = std::max(0, std::min(th - 1, int(rect.s32Y)));
+      rw = std::max(1, std::min(tw - rx, int(rect.u32Width)));
+      rh = std::max(1, std::min(th - ry, int(rect.u32Height)));
+    }
+
+    // written in the tensor's own memory, the forward flushes it to the device
+    tensor->mem_type = CVI_MEM_SYSTEM;
+    int8_t *base = static_cast<int8_t *>(CVI_NN_TensorPtr(tensor));
+    const size_t plane_size = static_cast<size_t>(tw) * th;
+    int8_t *planes[3];
+    for (int p = 0; p < 3; p++) {
+      int8_t *plane = base + p * plane_size;
+      if (rw != tw || rh != th) {
+        // bgcolor is 0xRRGGBB, plane p holds R, G, B or B, G, R
+        int shift = (bgr ? p : 2 - p) * 8;
+        float bg = float((attr.stAspectRatio.u32BgColor >> shift) & 0xff);
+        int q = int(lrintf(bg * attr.stNormalize.factor[p] - attr.stNormalize.mean[p]));
+        memset(plane, std::max(-128, std::min(127, q)), plane_size);
+      }
+      planes[p] = plane + static_cast<size_t>(ry) * tw + rx;
+    }
+    cvitdl::yuv420_resize_to_int8(src, planes, rw, rh, tw, attr.stNormalize.factor,
+                                  attr.stNormalize.mean, bgr);
+  }
+  return CVI_TDL_SUCCESS;
+}
+
+int Core::run(std::vector<VIDEO_FRAME_INFO_S *> &frames) {
+  int ret = checkSkipVpss();
+  if (ret != CVI_TDL_SUCCESS) {
+    return ret;
+  }
+  // frames queued by runAsync go first, the program and its neuron memory are shared with them
+  flushPipeline();
   model_timer_.TicToc("runstart");
   std::vector<std::shared_ptr<VIDEO_FRAME_INFO_S>> dstFrames;
 
@@ -506,42 +646,23 @@ int Core::run(std::vector<VIDEO_FRAME_INFO_S *> &frames) {
 
   if (mp_mi->conf.input_mem_type == CVI_MEM_DEVICE) {
     if (m_skip_vpss_preprocess) {
-      // skip vpss preprocess is true, just register frame directly.
-      ret = registerFrame2Tensor(frames);
+      // skip vpss preprocess is true, just register frame directly, YUV420 frames without a
+      // physical address are preprocessed on the CPU instead.
+      ret = !frames.empty() && isSoftwareFrame(frames[0]) ? softwarePreprocess(frames)
+                                                          : registerFrame2Tensor(frames);
     } else {
-      if (m_vpss_config.size() != frames.size()) {
-        LOGE("The size of vpss config does not match the number of frames. (%zu vs %zu)\n",
-             m_vpss_config.size(), frames.size());
-        return CVI_TDL_ERR_INFERENCE;
-      }
-
-      dstFrames.reserve(frames.size());
-      for (uint32_t i = 0; i < frames.size(); i++) {
-        VIDEO_FRAME_INFO_S *f = new VIDEO_FRAME_INFO_S;
-        memset(f, 0, sizeof(VIDEO_FRAME_INFO_S));
-        int vpssret = vpssPreprocess(frames[i], f, m_vpss_config[i]);
-        if (vpssret != CVI_TDL_SUCCESS) {
-          // if preprocess fail, just delete frame.
-          if (f->stVFrame.u64PhyAddr[0] != 0) {
-            mp_vpss_inst->releaseFrame(f, 0);
-          }
-          delete f;
-          return vpssret;
-        } else {
-          dstFrames.push_back(
-              std::shared_ptr<VIDEO_FRAME_INFO_S>({f, [this](VIDEO_FRAME_INFO_S *f) {
-                                                     this->mp_vpss_inst->releaseFrame(f, 0);
-                                                     delete f;
-                                                   }}));
-        }
+      ret = preprocessFrames(frames, dstFrames);
+      if (ret != CVI_TDL_SUCCESS) {
+        return ret;
       }
       ret = registerFrame2Tensor(dstFrames);
     }
   }
   model_timer_.TicToc("vpss");
   if (ret == CVI_TDL_SUCCESS) {
-    int rcret = CVI_NN_Forward(mp_mi->handle, mp_mi->in.tensors, mp_mi->in.num, mp_mi->out.tensors,
-                               mp_mi->out.num);
+    // with a pipeline the system memory inputs were filled through the slot bound to the getters
+    CVI_TENSOR *in = m_bound_in ? m_bound_in : mp_mi->in.tensors;
+    int rcret = CVI_NN_Forward(mp_mi->handle, in, mp_mi->in.num, mp_mi->out.tensors, mp_mi->out.num);
 
     if (rcret == CVI_RC_SUCCESS) {
       // save debuginfo
@@ -559,6 +680,169 @@ int Core::run(std::vector<VIDEO_FRAME_INFO_S *> &frames) {
   return ret;
 }
 
+int Core::setPipelineDepth(uint32_t depth) {
+  int ret = flushPipeline();
+  bindInputs(nullptr);
+  m_slots.clear();
+  m_next_slot = 0;
+  m_pipeline_depth = depth;
+  if (depth <= 1) {
+    return ret;
+  }
+  if (!isInitialized()) {
+    LOGE("Model is not opened yet! Please set pipeline depth when model is ready.\n");
+    m_pipeline_depth = 0;
+    return CVI_TDL_ERR_NOT_YET_INITIALIZED;
+  }
+
+  m_slots.resize(depth);
+  for (PipelineSlot &slot : m_slots) {
+    slot.in.assign(mp_mi->in.tensors, mp_mi->in.tensors + mp_mi->in.num);
+    slot.out.assign(mp_mi->out.tensors, mp_mi->out.tensors + mp_mi->out.num);
+    // device inputs are fed from vpss frames right before the forward, only system memory inputs
+    // need a buffer of their own
+    if (mp_mi->conf.input_mem_type == CVI_MEM_SYSTEM) {
+      slot.in_mem.resize(mp_mi->in.num);
+      for (int32_t i = 0; i < mp_mi->in.num; i++) {
+        slot.in_mem[i].resize(CVI_NN_TensorSize(&slot.in[i]));
+        slot.in[i].sys_mem = slot.in_mem[i].data();
+        slot.in[i].mem_type = CVI_MEM_SYSTEM;
+      }
+    }
+    slot.out_mem.resize(mp_mi->out.num);
+    for (int32_t i = 0; i < mp_mi->out.num; i++) {
+      slot.out_mem[i].resize(CVI_NN_TensorSize(&slot.out[i]));
+      slot.out[i].sys_mem = slot.out_mem[i].data();
+      slot.out[i].mem_type = CVI_MEM_SYSTEM;
+    }
+  }
+  bindInputs(&m_slots[0]);
+  return ret;
+}
+
+void Core::bindInputs(PipelineSlot *slot) {
+  if (mp_mi->conf.input_mem_type != CVI_MEM_SYSTEM) {
+    return;
+  }
+  m_bound_in = slot ? slot->in.data() : nullptr;
+  for (int32_t i = 0; i < mp_mi->in.num; i++) {
+    CVI_TENSOR *tensor = slot ? &slot->in[i] : mp_mi->in.tensors + i;
+    auto it = m_input_tensor_info.find(CVI_NN_TensorName(mp_mi->in.tensors + i));
+    if (it == m_input_tensor_info.end()) continue;
+    it->second.tensor_handle = tensor;
+    it->second.raw_pointer = CVI_NN_TensorPtr(tensor);
+  }
+}
+
+void Core::bindOutputs(PipelineSlot *slot) {
+  m_bound_out = slot ? slot->out.data() : nullptr;
+  for (int32_t i = 0; i < mp_mi->out.num; i++) {
+    CVI_TENSOR *tensor = slot ? &slot->out[i] : mp_mi->out.tensors + i;
+    auto it = m_output_tensor_info.find(CVI_NN_TensorName(mp_mi->out.tensors + i));
+    if (it == m_output_tensor_info.end()) continue;
+    it->second.tensor_handle = tensor;
+    it->second.raw_pointer = CVI_NN_TensorPtr(tensor);
+  }
+  onOutputsBound();
+}
+
+int Core::waitSlot(PipelineSlot &slot) {
+  if (slot.task != nullptr) {
+    int rcret = CVI_NN_ForwardWait(mp_mi->handle, slot.task);
+    slot.task = nullptr;
+    if (rcret != CVI_RC_SUCCESS) {
+      LOGE("NN forward failed: %s\n", get_tpu_error_msg(rcret));
+      slot.ret = CVI_TDL_ERR_INFERENCE;
+    }
+  }
+  return slot.ret;
+}
+
+int Core::completeOldest() {
+  PipelineSlot &slot = m_slots[m_inflight.front()];
+  m_inflight.pop_front();
+  int ret = waitSlot(slot);
+  // vpss frames go back to the pool as soon as the TPU is done with them
+  slot.frames.clear();
+  PipelineCallback done;
+  done.swap(slot.done);
+  bindOutputs(&slot);
+  done(ret);
+  bindOutputs(nullptr);
+  return ret;
+}
+
+int Core::flushPipeline() {
+  int ret = CVI_TDL_SUCCESS;
+  while (!m_inflight.empty()) {
+    int slot_ret = completeOldest();
+    if (slot_ret != CVI_TDL_SUCCESS) {
+      ret = slot_ret;
+    }
+  }
+  return ret;
+}
+
+int Core::runAsync(std::vector<VIDEO_FRAME_INFO_S *> &frames, const PipelineCallback &done) {
+  if (m_slots.empty()) {
+    int ret = run(frames);
+    if (ret == CVI_TDL_SUCCESS) {
+      done(ret);
+    }
+    return ret;
+  }
+  int ret = checkSkipVpss();
+  if (ret != CVI_TDL_SUCCESS) {
+    return ret;
+  }
+  PipelineSlot &slot = m_slots[m_next_slot];
+
+  // vpss does not touch the model, so it overlaps the TPU run of the previous frame
+  if (mp_mi->conf.input_mem_type == CVI_MEM_DEVICE && !m_skip_vpss_preprocess) {
+    ret = preprocessFrames(frames, slot.frames);
+  }
+  // feeding frames rewrites the model input tensors, the previous frame must be off the TPU
+  if (ret == CVI_TDL_SUCCESS && !m_inflight.empty()) {
+    waitSlot(m_slots[m_inflight.back()]);
+  }
+  if (ret == CVI_TDL_SUCCESS && mp_mi->conf.input_mem_type == CVI_MEM_DEVICE) {
+    if (!m_skip_vpss_preprocess) {
+      ret = registerFrame2Tensor(slot.frames);
+    } else {
+      ret = !frames.empty() && isSoftwareFrame(frames[0]) ? softwarePreprocess(frames)
+                                                          : registerFrame2Tensor(frames);
+    }
+    // the slot runs on what was fed (physical addresses, layout), the model tensors move on
+    if (ret == CVI_TDL_SUCCESS) {
+      std::copy(mp_mi->in.tensors, mp_mi->in.tensors + mp_mi->in.num, slot.in.begin());
+    }
+  }
+  if (ret == CVI_TDL_SUCCESS) {
+    int rcret = CVI_NN_ForwardAsync(mp_mi->handle, slot.in.data(), mp_mi->in.num, slot.out.data(),
+                                    mp_mi->out.num, &slot.task);
+    if (rcret != CVI_RC_SUCCESS) {
+      LOGE("NN forward failed: %s\n", get_tpu_error_msg(rcret));
+      slot.task = nullptr;
+      ret = CVI_TDL_ERR_INFERENCE;
+    }
+  }
+  if (ret != CVI_TDL_SUCCESS) {
+    slot.frames.clear();
+    return ret;
+  }
+
+  slot.ret = CVI_TDL_SUCCESS;
+  slot.done = done;
+  m_inflight.push_back(m_next_slot);
+  m_next_slot = (m_next_slot + 1) % m_slots.size();
+  // postprocess the oldest frames while the TPU runs this one, the next slot is free afterwards
+  while (m_inflight.size() >= m_pipeline_depth) {
+    completeOldest();
+  }
+  bindInputs(&m_slots[m_next_slot]);
+  return CVI_TDL_SUCCESS;
+}
+
 template <typename T>
 int Core::registerFrame2Tensor(std::vector<T> &frames) {
   int ret = 0;
@@ -4,6 +4,8 @@
 #include "core/core/cvtdl_vpss_types.h"
 
 #include <cviruntime.h>
+#include <deque>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -53,6 +55,9 @@ struct TensorInfo {
   }
   float qscale;
 };
+// completion of a pipelined frame, ret is the inference status of that frame
+typedef std::function<void(int ret)> PipelineCallback;
+
 struct VPSSConfig {
   meta_rescale_type_e rescale_type = RESCALE_CENTER;
   CVI_FRAME_TYPE frame_type = CVI_FRAME_PLANAR;
@@ -110,10 +115,30 @@ class Core {
   void setraw(bool raw);
 #endif
 
+  /**
+   * Number of frames runAsync keeps in flight, each owning its own input and output tensors.
+   * With depth >= 2 the postprocess of frame k runs while the TPU runs frame k + 1. 0 or 1 makes
+   * runAsync synchronous. Frames still in flight are completed first.
+   */
+  int setPipelineDepth(uint32_t depth);
+  uint32_t getPipelineDepth() const { return m_pipeline_depth; }
+  // complete every frame in flight, in submission order
+  int flushPipeline();
+
  protected:
   virtual int vpssPreprocess(VIDEO_FRAME_INFO_S *srcFrame, VIDEO_FRAME_INFO_S *dstFrame,
                              VPSSConfig &config);
   int run(std::vector<VIDEO_FRAME_INFO_S *> &frames);
+  /**
+   * Pipelined run(). Preprocesses frames, queues them on the TPU with CVI_NN_ForwardAsync and then
+   * completes the oldest frames until fewer than depth are in flight. done runs on the calling
+   * thread with the output tensor getters bound to the outputs of its own frame, and must not call
+   * runAsync itself. done is not called when runAsync fails. Frames given without vpss preprocess
+   * must stay valid until done has run.
+   */
+  int runAsync(std::vector<VIDEO_FRAME_INFO_S *> &frames, const PipelineCallback &done);
+  // called after the output tensor getters were pointed at other buffers
+  virtual void onOutputsBound() {}
 
   /*
    * Input/Output getter functions
@@ -192,6 +217,29 @@ class Core {
  private:
   template <typename T>
   inline int __attribute__((always_inline)) registerFrame2Tensor(std::vector<T> &frames);
+  int preprocessFrames(std::vector<VIDEO_FRAME_INFO_S *> &frames,
+                       std::vector<std::shared_ptr<VIDEO_FRAME_INFO_S>> &dstFrames);
+  // skipped vpss with YUV420 frames in virtual memory: converts, resizes and normalizes them on
+  // the CPU straight into the input tensors, the way the vpss channel of the model would
+  int softwarePreprocess(std::vector<VIDEO_FRAME_INFO_S *> &frames);
+
+  struct PipelineSlot {
+    std::vector<CVI_TENSOR> in;
+    std::vector<CVI_TENSOR> out;
+    // system memory inputs are written here by the preprocess, outputs are stored here by the TPU
+    std::vector<std::vector<uint8_t>> in_mem;
+    std::vector<std::vector<uint8_t>> out_mem;
+    // vpss frames referenced by the input tensors
+    std::vector<std::shared_ptr<VIDEO_FRAME_INFO_S>> frames;
+    void *task = nullptr;
+    int ret = CVI_TDL_SUCCESS;
+    PipelineCallback done;
+  };
+  int checkSkipVpss();
+  int waitSlot(PipelineSlot &slot);
+  int completeOldest();
+  void bindInputs(PipelineSlot *slot);
+  void bindOutputs(PipelineSlot *slot);
 
   void setupTensorInfo(CVI_TENSOR *tensor, int32_t num_tensors,
                        std::map<std::string, TensorInfo> *tensor_info);
@@ -205,6 +253,15 @@ class Core {
 
   // Cvimodel related
   std::unique_ptr<CvimodelInfo> mp_mi;
+
+  // pipelined execution
+  uint32_t m_pipeline_depth = 0;
+  std::vector<PipelineSlot> m_slots;
+  std::deque<uint32_t> m_inflight;  // slot indexes, oldest first
+  uint32_t m_next_slot = 0;
+  // tensors returned by the getters while a slot is bound, nullptr for the model tensors
+  CVI_TENSOR *m_bound_in = nullptr;
+  CVI_TENSOR *m_bound_out = nullptr;
 #ifndef CONFIG_ALIOS
   bool raw = false;
 #endif
@@ -11,6 +11,7 @@
 #include "bmruntime_common.h"
 #include "bmruntime_profile.h"
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <stdexcept>
@@ -91,6 +92,8 @@ struct VPSSConfig {
   VPSS_CROP_INFO_S crop_attr;
 };
 
+typedef std::function<void(int ret)> PipelineCallback;
+
 class Core {
  public:
   Core(CVI_MEM_TYPE_E input_mem_type);
@@ -137,10 +140,23 @@ class Core {
                       uint32_t rh, PIXEL_FORMAT_E enDstFormat);
   VpssEngine *get_vpss_instance() { return mp_vpss_inst; }
 
+  // bmruntime has no queued forward here, runAsync stays synchronous
+  int setPipelineDepth(uint32_t depth) { return CVI_TDL_SUCCESS; }
+  uint32_t getPipelineDepth() const { return 0; }
+  int flushPipeline() { return CVI_TDL_SUCCESS; }
+
  protected:
   virtual int vpssPreprocess(VIDEO_FRAME_INFO_S *srcFrame, VIDEO_FRAME_INFO_S *dstFrame,
                              VPSSConfig &config);
   int run(std::vector<VIDEO_FRAME_INFO_S *> &frames);
+  int runAsync(std::vector<VIDEO_FRAME_INFO_S *> &frames, const PipelineCallback &done) {
+    int ret = run(frames);
+    if (ret == CVI_TDL_SUCCESS) {
+      done(ret);
+    }
+    return ret;
+  }
+  virtual void onOutputsBound() {}
 
   /*
    * Input/Output getter functions
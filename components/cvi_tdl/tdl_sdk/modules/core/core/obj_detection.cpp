@@ -8,7 +8,8 @@
 
 namespace cvitdl {
 
-DetectionBase::DetectionBase() : Core(CVI_MEM_DEVICE) {
+DetectionBase::DetectionBase()
+    : Core(CVI_MEM_DEVICE), anchor_reject_profiler_("anchor_reject") {
   alg_param_.anchor_len = 0;
   alg_param_.stride_len = 0;
   alg_param_.cls = 80;
@@ -56,6 +57,35 @@ void DetectionBase::set_algparam(const cvtdl_det_algo_param_t &alg_param) {
   alg_param_.strides = strides;
 }
 
+DetTensorView DetectionBase::getOutputTensorView(const std::string &name, bool channel_last) {
+  const TensorInfo &info = getOutputTensorInfo(name);
+  DetTensorView view;
+  view.ptr = info.raw_pointer;
+  view.is_int8 = info.tensor_size == info.tensor_elem;
+  view.qscale = view.is_int8 ? info.qscale : 1.f;
+  if (channel_last) {
+    view.feat_h = info.shape.dim[1];
+    view.feat_w = info.shape.dim[2];
+    view.channel = info.shape.dim[3];
+  } else {
+    view.channel = info.shape.dim[1];
+    view.feat_h = info.shape.dim[2];
+    view.feat_w = info.shape.dim[3];
+  }
+  view.num_anchor = view.feat_h * view.feat_w;
+  return view;
+}
+
+DetDecodeParam DetectionBase::getDecodeParam() {
+  CVI_SHAPE shape = getInputShape(0);
+  DetDecodeParam param;
+  param.score_threshold = m_model_threshold;
+  param.num_cls = alg_param_.cls;
+  param.clip_width = shape.dim[3];
+  param.clip_height = shape.dim[2];
+  return param;
+}
+
 void DetectionBase::set_out_names(const std::vector<std::string> &names) {
   // As for why not make a quantitative judgment here:
   // getNumOutputTensor()will not be assigned until the modelOpen method is called,
@@ -2,6 +2,8 @@
 #include <bitset>
 #include "core/object/cvtdl_object_types.h"
 #include "core_internel.hpp"
+#include "det_decoder.hpp"
+#include "profiler.hpp"
 #define DEFAULT_MODEL_THRESHOLD 0.5
 #define DEFAULT_MODEL_NMS_THRESHOLD 0.5
 
@@ -15,11 +17,26 @@ class DetectionBase : public Core {
     LOGE("inference function not implement!\n");
     return 0;
   }
+  /**
+   * Pipelined inference, see Core::setPipelineDepth. obj_meta is filled right before done runs,
+   * which may be during a later call. Detectors without a pipelined path run synchronously.
+   */
+  virtual int inferenceAsync(VIDEO_FRAME_INFO_S *srcFrame, cvtdl_object_t *obj_meta,
+                             const PipelineCallback &done) {
+    int ret = inference(srcFrame, obj_meta);
+    if (ret == CVI_TDL_SUCCESS) {
+      done(ret);
+    }
+    return ret;
+  }
 
   virtual const cvtdl_det_algo_param_t &get_algparam() { return alg_param_; }
   virtual void set_algparam(const cvtdl_det_algo_param_t &alg_param);
   virtual void set_out_names(const std::vector<std::string> &);
 
+  // share of anchors the int8 prefilter rejected before any float work, over all frames so far
+  float getAnchorRejectRatio() const { return anchor_reject_profiler_.Ratio(); }
+
  private:
   virtual int onModelOpened() override {
     LOGE("onModelOpened function not implement!\n");
@@ -32,6 +49,26 @@ class DetectionBase : public Core {
                              VPSSConfig &vpss_config) override;
 
  protected:
+  /**
+   * Resolve an output tensor for the per-frame parsers, call it from onModelOpened.
+   * channel_last selects the n x h x w x c layout used by the yolov5/yolov6/yolox/ppyoloe heads,
+   * otherwise the tensor is n x c x h x w.
+   */
+  DetTensorView getOutputTensorView(const std::string &name, bool channel_last = false);
+
+  // decoder parameters from the current model threshold, class count and input size
+  DetDecodeParam getDecodeParam();
+
+  // decode all branches of a head into arena and record the anchor rejection ratio
+  template <typename Config>
+  void decodeHeads(const std::vector<DetHeadBranch> &branches, const DetDecodeParam &param,
+                   DetCandidateArena *arena) {
+    DetDecoder<Config>::decode(branches, param, arena);
+    anchor_reject_profiler_.Add(arena->earlyRejected(), arena->scanned());
+  }
+
+  RatioProfiler anchor_reject_profiler_;
+
   cvtdl_det_algo_param_t alg_param_;
   std::vector<std::string> setting_out_names_;
 };
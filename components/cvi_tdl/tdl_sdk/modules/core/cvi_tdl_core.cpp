@@ -545,6 +545,17 @@ CVI_S32 CVI_TDL_SetModelThreshold(cvitdl_handle_t handle, CVI_TDL_SUPPORTED_MODE
   return CVI_TDL_SUCCESS;
 }
 
+CVI_S32 CVI_TDL_SetPipelineDepth(cvitdl_handle_t handle, CVI_TDL_SUPPORTED_MODEL_E config,
+                                 uint32_t depth) {
+  cvitdl_context_t *ctx = static_cast<cvitdl_context_t *>(handle);
+  Core *instance = getInferenceInstance(config, ctx);
+  if (instance == nullptr) {
+    LOGE("Cannot create model: %s\n", CVI_TDL_GetModelName(config));
+    return CVI_TDL_ERR_OPEN_MODEL;
+  }
+  return instance->setPipelineDepth(depth);
+}
+
 CVI_S32 CVI_TDL_GetModelThreshold(cvitdl_handle_t handle, CVI_TDL_SUPPORTED_MODEL_E config,
                                   float *threshold) {
   cvitdl_context_t *ctx = static_cast<cvitdl_context_t *>(handle);
@@ -1167,6 +1178,46 @@ CVI_S32 CVI_TDL_Detection(const cvitdl_handle_t handle, VIDEO_FRAME_INFO_S *fram
   }
 }
 
+CVI_S32 CVI_TDL_Detection_Async(const cvitdl_handle_t handle, VIDEO_FRAME_INFO_S *frame,
+                                CVI_TDL_SUPPORTED_MODEL_E model_index, cvtdl_object_t *obj,
+                                cvitdl_detection_callback callback, void *user_data) {
+  cvitdl_context_t *ctx = static_cast<cvitdl_context_t *>(handle);
+  DetectionBase *model = dynamic_cast<DetectionBase *>(getInferenceInstance(model_index, ctx));
+  if (model == nullptr) {
+    LOGE("No instance found\n");
+    return CVI_TDL_ERR_OPEN_MODEL;
+  }
+  if (callback == nullptr) {
+    LOGE("callback is null\n");
+    return CVI_TDL_ERR_INVALID_ARGS;
+  }
+  if (!model->isInitialized()) {
+    LOGE("Model (%s)is not yet opened! Please call CVI_TDL_OpenModel to initialize model\n",
+         CVI_TDL_GetModelName(model_index));
+    return CVI_TDL_ERR_NOT_YET_INITIALIZED;
+  }
+  if (initVPSSIfNeeded(ctx, model_index) != CVI_SUCCESS) {
+    return CVI_TDL_ERR_INIT_VPSS;
+  }
+  return model->inferenceAsync(frame, obj, [model, obj, callback, user_data](int ret) {
+    if (ret == CVI_TDL_SUCCESS) {
+      ret = model->after_inference();
+    }
+    callback(ret, obj, user_data);
+  });
+}
+
+CVI_S32 CVI_TDL_Detection_Flush(const cvitdl_handle_t handle,
+                                CVI_TDL_SUPPORTED_MODEL_E model_index) {
+  cvitdl_context_t *ctx = static_cast<cvitdl_context_t *>(handle);
+  DetectionBase *model = dynamic_cast<DetectionBase *>(getInferenceInstance(model_index, ctx));
+  if (model == nullptr) {
+    LOGE("No instance found\n");
+    return CVI_TDL_ERR_OPEN_MODEL;
+  }
+  return model->flushPipeline();
+}
+
 CVI_S32 CVI_TDL_Set_Outputlayer_Names(const cvitdl_handle_t handle,
                                       CVI_TDL_SUPPORTED_MODEL_E model_index,
                                       const char **output_names, size_t size) {
@@ -1455,6 +1506,18 @@ CVI_S32 CVI_TDL_DeepSORT_GetTracker_Inactive(const cvitdl_handle_t handle,
   return ctx->ds_tracker->get_trackers_inactive(tracker);
 }
 
+CVI_S32 CVI_TDL_DeepSORT_SetReidGallery(const cvitdl_handle_t handle, bool enable,
+                                        uint32_t inactive_capacity, uint32_t ivf_lists) {
+  cvitdl_context_t *ctx = static_cast<cvitdl_context_t *>(handle);
+  DeepSORT *ds_tracker = ctx->ds_tracker;
+  if (ds_tracker == nullptr) {
+    LOGE("Please initialize DeepSORT first.\n");
+    return CVI_FAILURE;
+  }
+  ctx->ds_tracker->set_reid_gallery(enable, inactive_capacity, ivf_lists);
+  return CVI_SUCCESS;
+}
+
 CVI_S32 CVI_TDL_FaceHeadIouScore(const cvitdl_handle_t handle, cvtdl_face_t *faces,
                                  cvtdl_face_t *heads) {
   cvitdl_context_t *ctx = static_cast<cvitdl_context_t *>(handle);
@@ -193,10 +193,7 @@ CVI_S32 DeepSORT::track_impl(Tracking_Result &high_result, Tracking_Result &low_
   }
 
   LOGD("Kalman Trackers predict\n");
-  for (KalmanTracker &tracker_ : k_trackers) {
-    // kf_.predict(tracker_.kalman_state, tracker_.x, tracker_.P, conf->kfilter_conf);
-    tracker_.predict(kf_, conf);
-  }
+  kf_batch_.predict(k_trackers, conf);
   check_bound_state(conf);
   /*****************************     high score bbox match   start
    * *************************************/
@@ -443,7 +440,9 @@ CVI_S32 DeepSORT::track_impl(Tracking_Result &high_result, Tracking_Result &low_
   LOGD("Create new kalman trackers (Unmatched BBoxes)");
   for (size_t i = 0; i < high_unmatched_bbox_idxes.size(); i++) {
     int bbox_idx = high_unmatched_bbox_idxes[i];
-    uint64_t new_id = get_nextID(class_id);
+    uint64_t new_id = use_reid ? get_nextID(class_id, HighFeatures[bbox_idx],
+                                            conf->max_distance_consine)
+                               : get_nextID(class_id);
     const BBOX &bbox_ = HighBBoxes[bbox_idx];
     // KalmanTracker tracker_(new_id, bbox_, feature_);
     if (conf->ktracker_conf.enable_QA_feature_init &&
@@ -475,6 +474,7 @@ CVI_S32 DeepSORT::track_impl(Tracking_Result &high_result, Tracking_Result &low_
   LOGD("Check kalman trackers state, and remove invalid trackers");
   for (auto it_ = k_trackers.begin(); it_ != k_trackers.end();) {
     if (it_->tracker_state == k_tracker_state_e::MISS) {
+      release_tracker(*it_, conf);
       it_ = k_trackers.erase(it_);
     } else {
       it_++;
@@ -905,10 +905,7 @@ CVI_S32 DeepSORT::track_impl_cross(Tracking_Result2 &result, const std::vector<B
   }
 
   LOGD("Kalman Trackers predict\n");
-  for (KalmanTracker &tracker_ : k_trackers) {
-    // kf_.predict(tracker_.kalman_state, tracker_.x, tracker_.P, conf->kfilter_conf);
-    tracker_.predict(kf_, conf);
-  }
+  kf_batch_.predict(k_trackers, conf);
   check_bound_state(conf);
 
   std::vector<std::pair<int, int>> matched_pairs;
@@ -1099,6 +1096,7 @@ CVI_S32 DeepSORT::track_impl_cross(Tracking_Result2 &result, const std::vector<B
   LOGD("Check kalman trackers state, and remove invalid trackers");
   for (auto it_ = k_trackers.begin(); it_ != k_trackers.end();) {
     if (it_->tracker_state == k_tracker_state_e::MISS) {
+      release_tracker(*it_, conf);
       it_ = k_trackers.erase(it_);
     } else {
       it_++;
@@ -1109,7 +1107,9 @@ CVI_S32 DeepSORT::track_impl_cross(Tracking_Result2 &result, const std::vector<B
   LOGD("Create new kalman trackers (Unmatched BBoxes)");
   for (size_t i = 0; i < unmatched_bbox_idxes.size(); i++) {
     int bbox_idx = unmatched_bbox_idxes[i];
-    uint64_t new_id = get_nextID(class_id);
+    uint64_t new_id =
+        use_reid ? get_nextID(class_id, Features[bbox_idx], conf->max_distance_consine)
+                 : get_nextID(class_id);
     const BBOX &bbox_ = BBoxes[bbox_idx];
     // KalmanTracker tracker_(new_id, bbox_, feature_);
     if (conf->ktracker_conf.enable_QA_feature_init &&
@@ -1169,12 +1169,13 @@ CVI_S32 DeepSORT::track_impl(Tracking_Result &result, const std::vector<BBOX> &B
   }
 
   LOGD("Kalman Trackers predict\n");
-  for (KalmanTracker &tracker_ : k_trackers) {
-    // kf_.predict(tracker_.kalman_state, tracker_.x, tracker_.P, conf->kfilter_conf);
-    if (tracker_.class_id == class_id) {
-      tracker_.predict(kf_, conf);
+  std::vector<int> predict_idxes;
+  for (size_t i = 0; i < k_trackers.size(); i++) {
+    if (k_trackers[i].class_id == class_id) {
+      predict_idxes.push_back(i);
     }
   }
+  kf_batch_.predict(k_trackers, predict_idxes, conf);
   check_bound_state(conf);
 
   std::vector<std::pair<int, int>> matched_pairs;
@@ -1334,6 +1335,7 @@ CVI_S32 DeepSORT::track_impl(Tracking_Result &result, const std::vector<BBOX> &B
   LOGD("Check kalman trackers state, and remove invalid trackers");
   for (auto it_ = k_trackers.begin(); it_ != k_trackers.end();) {
     if (it_->tracker_state == k_tracker_state_e::MISS) {
+      release_tracker(*it_, conf);
       it_ = k_trackers.erase(it_);
     } else {
       it_++;
@@ -1344,7 +1346,9 @@ CVI_S32 DeepSORT::track_impl(Tracking_Result &result, const std::vector<BBOX> &B
   LOGD("Create new kalman trackers (Unmatched BBoxes)");
   for (size_t i = 0; i < unmatched_bbox_idxes.size(); i++) {
     int bbox_idx = unmatched_bbox_idxes[i];
-    uint64_t new_id = get_nextID(class_id);
+    uint64_t new_id =
+        use_reid ? get_nextID(class_id, Features[bbox_idx], conf->max_distance_consine)
+                 : get_nextID(class_id);
     const BBOX &bbox_ = BBoxes[bbox_idx];
     // KalmanTracker tracker_(new_id, bbox_, feature_);
     if (conf->ktracker_conf.enable_QA_feature_init &&
@@ -1409,22 +1413,35 @@ MatchResult DeepSORT::match(const std::vector<BBOX> &BBoxes, const std::vector<F
   switch (cost_method) {
     case Feature_CosineDistance: {
       LOGD("Feature Cost Matrix (Consine Distance)");
-      cost_matrix = KalmanTracker::getCostMatrix_Feature(k_trackers, BBoxes, Features,
-                                                         Tracker_IDXes, BBox_IDXes);
+      if (use_reid_gallery_) {
+        std::vector<uint64_t> ids(Tracker_IDXes.size());
+        std::vector<int> class_ids(Tracker_IDXes.size());
+        for (size_t i = 0; i < Tracker_IDXes.size(); i++) {
+          const KalmanTracker &tracker = k_trackers[Tracker_IDXes[i]];
+          reid_gallery_.syncTrack(tracker.id, tracker.class_id, tracker.features,
+                                  tracker.features_version);
+          ids[i] = tracker.id;
+          class_ids[i] = tracker.class_id;
+        }
+        reid_gallery_.costMatrix(ids, class_ids, Features, BBox_IDXes, cost_matrix);
+      } else {
+        cost_matrix = KalmanTracker::getCostMatrix_Feature(k_trackers, BBoxes, Features,
+                                                           Tracker_IDXes, BBox_IDXes);
+      }
       // gating cost matrix with different methods
       if (track_face_) {
         KalmanTracker::restrictCostMatrix_BBox(cost_matrix, k_trackers, BBoxes, Tracker_IDXes,
                                                BBox_IDXes, max_distance);
       } else {
-        KalmanTracker::restrictCostMatrix_Mahalanobis(
-            cost_matrix, kf_, k_trackers, BBoxes, Tracker_IDXes, BBox_IDXes, kf_conf, max_distance);
+        kf_batch_.restrictCostMatrix(cost_matrix, k_trackers, BBoxes, Tracker_IDXes, BBox_IDXes,
+                                     kf_conf, max_distance);
       }
 
     } break;
     case Kalman_MahalanobisDistance: {
       LOGD("Kalman Cost Matrix (Mahalanobis Distance)");
-      cost_matrix = KalmanTracker::getCostMatrix_Mahalanobis(kf_, k_trackers, BBoxes, Tracker_IDXes,
-                                                             BBox_IDXes, kf_conf, max_distance);
+      cost_matrix = kf_batch_.getCostMatrix(k_trackers, BBoxes, Tracker_IDXes, BBox_IDXes, kf_conf,
+                                            max_distance);
 #ifdef DEBUG_TRACK
       std::cout << "mahah cost matrix:\n" << cost_matrix << std::endl;
 #endif
@@ -1443,9 +1460,9 @@ MatchResult DeepSORT::match(const std::vector<BBOX> &BBoxes, const std::vector<F
       return result_;
   }
 
-  CVIMunkres cvi_munkres_solver(&cost_matrix);
-  if (cvi_munkres_solver.solve() == MUNKRES_FAILURE) {
-    LOGW("MUNKRES algorithm failed.");
+  std::vector<int> row_match;
+  if (!solve_assignment(cost_matrix, max_distance, row_match)) {
+    LOGW("assignment algorithm (%d) failed.", assignment_solver_);
     // return empty results if failed to solve
     result_.unmatched_tracker_idxes.clear();
     result_.unmatched_bbox_idxes.clear();
@@ -1460,7 +1477,7 @@ MatchResult DeepSORT::match(const std::vector<BBOX> &BBoxes, const std::vector<F
   memset(matched_bbox_j, false, bbox_num * sizeof(bool));
 
   for (int i = 0; i < tracker_num; i++) {
-    int bbox_j = cvi_munkres_solver.m_match_result[i];
+    int bbox_j = row_match[i];
     if (bbox_j != -1) {
       if (cost_matrix(i, bbox_j) < max_distance) {
         matched_tracker_i[i] = true;
@@ -1492,6 +1509,22 @@ MatchResult DeepSORT::match(const std::vector<BBOX> &BBoxes, const std::vector<F
   return result_;
 }
 
+bool DeepSORT::solve_assignment(const COST_MATRIX &cost_matrix, float max_distance,
+                                std::vector<int> &row_match) {
+  if (assignment_solver_ == ASSIGNMENT_LAPJV) {
+    // pairs gated to max_distance are dropped by match() anyway, so they never enter the solver
+    return lapjv_solver_.solve(cost_matrix, max_distance, row_match);
+  }
+  COST_MATRIX cost = cost_matrix;
+  CVIMunkres cvi_munkres_solver(&cost);
+  if (cvi_munkres_solver.solve() == MUNKRES_FAILURE) {
+    return false;
+  }
+  row_match.assign(cvi_munkres_solver.m_match_result,
+                   cvi_munkres_solver.m_match_result + cost_matrix.rows());
+  return true;
+}
+
 MatchResult DeepSORT::refine_uncrowd(const std::vector<BBOX> &BBoxes,
                                      const std::vector<FEATURE> &Features,
                                      const std::vector<int> &Tracker_IDXes,
@@ -1583,6 +1616,40 @@ uint64_t DeepSORT::get_nextID(int class_id) {
   }
 }
 
+uint64_t DeepSORT::get_nextID(int class_id, const FEATURE &feature, float max_distance) {
+  ReidMatch match;
+  if (use_reid_gallery_ && feature.size() > 0 &&
+      reid_gallery_.searchInactive(feature, class_id, &match) && match.distance < max_distance) {
+    reid_gallery_.removeInactive(match.id, match.class_id);
+    return match.id;
+  }
+  return get_nextID(class_id);
+}
+
+void DeepSORT::release_tracker(const KalmanTracker &tracker, cvtdl_deepsort_config_t *conf) {
+  if (!use_reid_gallery_) return;
+  // only identities that were confirmed once are worth recovering
+  if (tracker.features.empty() ||
+      tracker.matched_counter < conf->ktracker_conf.accreditation_threshold) {
+    reid_gallery_.removeTrack(tracker.id, tracker.class_id);
+    return;
+  }
+  reid_gallery_.syncTrack(tracker.id, tracker.class_id, tracker.features,
+                          tracker.features_version);
+  reid_gallery_.retireTrack(tracker.id, tracker.class_id);
+}
+
+void DeepSORT::set_reid_gallery(bool enable, int inactive_capacity, int ivf_lists,
+                                int ivf_probes) {
+  use_reid_gallery_ = enable;
+  if (!enable) {
+    reid_gallery_.clear();
+    return;
+  }
+  reid_gallery_.setInactiveCapacity(inactive_capacity);
+  reid_gallery_.setIndex(ivf_lists, ivf_probes);
+}
+
 void DeepSORT::cleanCounter() {
   id_counter = 0;
   for (auto &it : specific_id_counter) {
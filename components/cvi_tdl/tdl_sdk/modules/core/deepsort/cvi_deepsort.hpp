@@ -2,9 +2,12 @@
 
 #include "cvi_deepsort_types_internal.hpp"
 #include "cvi_distance_metric.hpp"
+#include "cvi_kalman_batch.hpp"
 #include "cvi_kalman_filter.hpp"
 #include "cvi_kalman_tracker.hpp"
+#include "cvi_lapjv.hpp"
 #include "cvi_munkres.hpp"
+#include "cvi_reid_gallery.hpp"
 
 #include "core/cvi_tdl_core.h"
 
@@ -72,6 +75,15 @@ class DeepSORT {
 
   CVI_S32 get_trackers_inactive(cvtdl_tracker_t *tracker) const;
   void set_timestamp(uint32_t ts) { current_timestamp_ = ts; }
+  // assignment backend used by match(), LAPJV by default, Munkres is kept as reference
+  void set_assignment_solver(assignment_solver_e solver) { assignment_solver_ = solver; }
+  /**
+   * Match appearance through the int8 ReID gallery and keep the mean appearance of removed
+   * confirmed tracks, up to inactive_capacity of them, so that a new track close enough to one
+   * (max_distance_consine) takes its id back. ivf_lists > 1 indexes the inactive gallery.
+   */
+  void set_reid_gallery(bool enable, int inactive_capacity = 1024, int ivf_lists = 0,
+                        int ivf_probes = 4);
 
   /* DEBUG CODE */
   // TODO: refactor these functions.
@@ -87,6 +99,7 @@ class DeepSORT {
   std::map<int, uint64_t> specific_id_counter;
   std::vector<KalmanTracker> k_trackers;
   KalmanFilter kf_;
+  KalmanBatch kf_batch_;
   uint32_t image_width_;
   uint32_t image_height_;
   // consumer counting
@@ -106,6 +119,9 @@ class DeepSORT {
   std::map<uint64_t, std::vector<float>> old_coordinate;
 
   uint64_t get_nextID(int class_id);
+  // id of the closest inactive identity in the ReID gallery when there is one, else get_nextID
+  uint64_t get_nextID(int class_id, const FEATURE &feature, float max_distance);
+  void release_tracker(const KalmanTracker &tracker, cvtdl_deepsort_config_t *conf);
   MatchResult get_match_result(MatchResult &prev_match, const std::vector<BBOX> &BBoxes,
                                const std::vector<FEATURE> &Features, bool use_reid,
                                float crowd_iou_thresh, cvtdl_deepsort_config_t *conf);
@@ -124,6 +140,11 @@ class DeepSORT {
                              const std::vector<int> &Tracker_IDXes,
                              const std::vector<int> &BBox_IDXes, float iou_thresh);
   void compute_distance();
-  void solve_assignment();
+  bool solve_assignment(const COST_MATRIX &cost_matrix, float max_distance,
+                        std::vector<int> &row_match);
   bool track_face_ = false;
+  assignment_solver_e assignment_solver_ = ASSIGNMENT_LAPJV;
+  CVILapjv lapjv_solver_;
+  bool use_reid_gallery_ = false;
+  ReidGallery reid_gallery_;
 };
@@ -0,0 +1,286 @@
+#include "cvi_kalman_batch.hpp"
+#include "cvi_deepsort_utils.hpp"
+
+#include <math.h>
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define KF_USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define KF_USE_SSE
+#endif
+
+// dst[i] += src[i]
+static void plane_add(float *dst, const float *src, int n) {
+  int i = 0;
+#if defined(KF_USE_NEON)
+  for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+#elif defined(KF_USE_SSE)
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+  }
+#endif
+  for (; i < n; i++) dst[i] += src[i];
+}
+
+// dst[i] = (alpha * base[i] + beta)^2, base == NULL stands for a zero plane
+static void plane_noise(float *dst, const float *base, float alpha, float beta, int n) {
+  if (base == NULL) {
+    std::fill(dst, dst + n, beta * beta);
+    return;
+  }
+  int i = 0;
+#if defined(KF_USE_NEON)
+  float32x4_t va = vdupq_n_f32(alpha);
+  float32x4_t vb = vdupq_n_f32(beta);
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t v = vaddq_f32(vmulq_f32(va, vld1q_f32(base + i)), vb);
+    vst1q_f32(dst + i, vmulq_f32(v, v));
+  }
+#elif defined(KF_USE_SSE)
+  __m128 va = _mm_set1_ps(alpha);
+  __m128 vb = _mm_set1_ps(beta);
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_add_ps(_mm_mul_ps(va, _mm_loadu_ps(base + i)), vb);
+    _mm_storeu_ps(dst + i, _mm_mul_ps(v, v));
+  }
+#endif
+  for (; i < n; i++) {
+    float v = alpha * base[i] + beta;
+    dst[i] = v * v;
+  }
+}
+
+static void plane_clamp(float *dst, float lo, float hi, int n) {
+  int i = 0;
+#if defined(KF_USE_NEON)
+  float32x4_t vlo = vdupq_n_f32(lo);
+  float32x4_t vhi = vdupq_n_f32(hi);
+  for (; i + 4 <= n; i += 4) {
+    vst1q_f32(dst + i, vminq_f32(vmaxq_f32(vld1q_f32(dst + i), vlo), vhi));
+  }
+#elif defined(KF_USE_SSE)
+  __m128 vlo = _mm_set1_ps(lo);
+  __m128 vhi = _mm_set1_ps(hi);
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(dst + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(dst + i), vlo), vhi));
+  }
+#endif
+  for (; i < n; i++) dst[i] = std::min(std::max(dst[i], lo), hi);
+}
+
+/*
+ * out[j] = |L^-1 (z_j - hx)|^2 for the m measurements stored as planes z[k * m + j].
+ * L is the lower cholesky factor of the innovation covariance, inv its inverted diagonal.
+ */
+static void maha_row(const float *z, int m, const float hx[DIM_Z], const float L[DIM_Z][DIM_Z],
+                     const float inv[DIM_Z], float *out) {
+  const float *zx = z;
+  const float *zy = z + m;
+  const float *za = z + 2 * m;
+  const float *zh = z + 3 * m;
+  int j = 0;
+#if defined(KF_USE_NEON)
+  for (; j + 4 <= m; j += 4) {
+    float32x4_t d0 = vsubq_f32(vld1q_f32(zx + j), vdupq_n_f32(hx[0]));
+    float32x4_t d1 = vsubq_f32(vld1q_f32(zy + j), vdupq_n_f32(hx[1]));
+    float32x4_t d2 = vsubq_f32(vld1q_f32(za + j), vdupq_n_f32(hx[2]));
+    float32x4_t d3 = vsubq_f32(vld1q_f32(zh + j), vdupq_n_f32(hx[3]));
+    float32x4_t y0 = vmulq_n_f32(d0, inv[0]);
+    float32x4_t y1 = vmulq_n_f32(vmlsq_n_f32(d1, y0, L[1][0]), inv[1]);
+    float32x4_t y2 = vmulq_n_f32(vmlsq_n_f32(vmlsq_n_f32(d2, y0, L[2][0]), y1, L[2][1]), inv[2]);
+    float32x4_t y3 = vmlsq_n_f32(vmlsq_n_f32(d3, y0, L[3][0]), y1, L[3][1]);
+    y3 = vmulq_n_f32(vmlsq_n_f32(y3, y2, L[3][2]), inv[3]);
+    float32x4_t acc = vmulq_f32(y0, y0);
+    acc = vmlaq_f32(acc, y1, y1);
+    acc = vmlaq_f32(acc, y2, y2);
+    acc = vmlaq_f32(acc, y3, y3);
+    vst1q_f32(out + j, acc);
+  }
+#elif defined(KF_USE_SSE)
+  for (; j + 4 <= m; j += 4) {
+    __m128 d0 = _mm_sub_ps(_mm_loadu_ps(zx + j), _mm_set1_ps(hx[0]));
+    __m128 d1 = _mm_sub_ps(_mm_loadu_ps(zy + j), _mm_set1_ps(hx[1]));
+    __m128 d2 = _mm_sub_ps(_mm_loadu_ps(za + j), _mm_set1_ps(hx[2]));
+    __m128 d3 = _mm_sub_ps(_mm_loadu_ps(zh + j), _mm_set1_ps(hx[3]));
+    __m128 y0 = _mm_mul_ps(d0, _mm_set1_ps(inv[0]));
+    __m128 y1 = _mm_sub_ps(d1, _mm_mul_ps(y0, _mm_set1_ps(L[1][0])));
+    y1 = _mm_mul_ps(y1, _mm_set1_ps(inv[1]));
+    __m128 y2 = _mm_sub_ps(d2, _mm_mul_ps(y0, _mm_set1_ps(L[2][0])));
+    y2 = _mm_sub_ps(y2, _mm_mul_ps(y1, _mm_set1_ps(L[2][1])));
+    y2 = _mm_mul_ps(y2, _mm_set1_ps(inv[2]));
+    __m128 y3 = _mm_sub_ps(d3, _mm_mul_ps(y0, _mm_set1_ps(L[3][0])));
+    y3 = _mm_sub_ps(y3, _mm_mul_ps(y1, _mm_set1_ps(L[3][1])));
+    y3 = _mm_sub_ps(y3, _mm_mul_ps(y2, _mm_set1_ps(L[3][2])));
+    y3 = _mm_mul_ps(y3, _mm_set1_ps(inv[3]));
+    __m128 acc = _mm_add_ps(_mm_mul_ps(y0, y0), _mm_mul_ps(y1, y1));
+    acc = _mm_add_ps(acc, _mm_mul_ps(y2, y2));
+    acc = _mm_add_ps(acc, _mm_mul_ps(y3, y3));
+    _mm_storeu_ps(out + j, acc);
+  }
+#endif
+  for (; j < m; j++) {
+    float y0 = (zx[j] - hx[0]) * inv[0];
+    float y1 = (zy[j] - hx[1] - L[1][0] * y0) * inv[1];
+    float y2 = (za[j] - hx[2] - L[2][0] * y0 - L[2][1] * y1) * inv[2];
+    float y3 = (zh[j] - hx[3] - L[3][0] * y0 - L[3][1] * y1 - L[3][2] * y2) * inv[3];
+    out[j] = y0 * y0 + y1 * y1 + y2 * y2 + y3 * y3;
+  }
+}
+
+void KalmanBatch::reserve(int n) {
+  if (n <= capacity_) return;
+  capacity_ = std::max(n, 2 * capacity_);
+  x_.resize(DIM_X * capacity_);
+  p_.resize(DIM_X * DIM_X * capacity_);
+  q_.resize(DIM_X * capacity_);
+}
+
+void KalmanBatch::predict(std::vector<KalmanTracker> &trackers, cvtdl_deepsort_config_t *conf) {
+  all_idxes_.resize(trackers.size());
+  for (size_t i = 0; i < trackers.size(); i++) all_idxes_[i] = i;
+  predict(trackers, all_idxes_, conf);
+}
+
+void KalmanBatch::predict(std::vector<KalmanTracker> &trackers, const std::vector<int> &idxes,
+                          cvtdl_deepsort_config_t *conf) {
+  const cvtdl_kalman_filter_config_t &kf_conf = conf->kfilter_conf;
+  lanes_.clear();
+  for (int idx : idxes) {
+    if (trackers[idx].kalman_state == kalman_state_e::UPDATED) {
+      lanes_.push_back(idx);
+    } else {
+      trackers[idx].predict(kf_, conf);
+    }
+  }
+  const int n = lanes_.size();
+  if (n == 0) return;
+  reserve(n);
+
+  /* gather */
+  for (int l = 0; l < n; l++) {
+    const KalmanTracker &t = trackers[lanes_[l]];
+    for (int k = 0; k < DIM_X; k++) x_[k * capacity_ + l] = t.x(k);
+    for (int r = 0; r < DIM_X; r++) {
+      for (int c = 0; c < DIM_X; c++) p_[(r * DIM_X + c) * capacity_ + l] = t.P(r, c);
+    }
+  }
+
+  /* process noise from the state before prediction */
+  for (int i = 0; i < DIM_X; i++) {
+    const float *base = kf_conf.Q_x_idx[i] == -1 ? NULL : xPlane(kf_conf.Q_x_idx[i]);
+    plane_noise(q_.data() + i * capacity_, base, kf_conf.Q_alpha[i], kf_conf.Q_beta[i], n);
+  }
+
+  /* P = F * P * F^t + Q, with F = [I I; 0 I] */
+  for (int r = 0; r < DIM_Z; r++) {
+    for (int c = 0; c < DIM_X; c++) plane_add(pPlane(r, c), pPlane(r + DIM_Z, c), n);
+  }
+  for (int r = 0; r < DIM_X; r++) {
+    for (int c = 0; c < DIM_Z; c++) plane_add(pPlane(r, c), pPlane(r, c + DIM_Z), n);
+  }
+  for (int i = 0; i < DIM_X; i++) plane_add(pPlane(i, i), q_.data() + i * capacity_, n);
+
+  /* x = F * x */
+  for (int k = 0; k < DIM_Z; k++) plane_add(xPlane(k), xPlane(k + DIM_Z), n);
+  if (kf_conf.enable_X_constraint_0) {
+    for (int k = 0; k < DIM_Z; k++) {
+      plane_clamp(xPlane(k), kf_conf.X_constraint_min[k], kf_conf.X_constraint_max[k], n);
+    }
+  }
+  if (kf_conf.enable_X_constraint_1) {
+    for (int k = DIM_Z; k < DIM_X; k++) {
+      plane_clamp(xPlane(k), kf_conf.X_constraint_min[k], kf_conf.X_constraint_max[k], n);
+    }
+  }
+
+  /* scatter */
+  for (int l = 0; l < n; l++) {
+    KalmanTracker &t = trackers[lanes_[l]];
+    for (int k = 0; k < DIM_X; k++) t.x(k) = x_[k * capacity_ + l];
+    for (int r = 0; r < DIM_X; r++) {
+      for (int c = 0; c < DIM_X; c++) t.P(r, c) = p_[(r * DIM_X + c) * capacity_ + l];
+    }
+    t.kalman_state = kalman_state_e::PREDICTED;
+    t.unmatched_times += 1;
+    t.ages_ += 1;
+  }
+}
+
+void KalmanBatch::mahalanobis(const std::vector<KalmanTracker> &trackers,
+                              const std::vector<int> &Tracker_IDXes,
+                              const std::vector<BBOX> &BBoxes, const std::vector<int> &BBox_IDXes,
+                              const cvtdl_kalman_filter_config_t &kfilter_conf,
+                              COST_MATRIX &maha) {
+  const int num_t = Tracker_IDXes.size();
+  const int m = BBox_IDXes.size();
+  maha.resize(num_t, m);
+  if (num_t == 0 || m == 0) return;
+
+  z_.resize(DIM_Z * m);
+  row_.resize(m);
+  for (int j = 0; j < m; j++) {
+    BBOX xyah = bbox_tlwh2xyah(BBoxes[BBox_IDXes[j]]);
+    for (int k = 0; k < DIM_Z; k++) z_[k * m + j] = xyah(k);
+  }
+
+  for (int i = 0; i < num_t; i++) {
+    const KalmanTracker &t = trackers[Tracker_IDXes[i]];
+    /* innovation covariance S = H * P * H^t + R, only the lower triangle is read */
+    float S[DIM_Z][DIM_Z];
+    for (int r = 0; r < DIM_Z; r++) {
+      for (int c = 0; c <= r; c++) S[r][c] = t.P(r, c);
+      float x_base = (kfilter_conf.R_x_idx[r] == -1) ? 0.0 : t.x(kfilter_conf.R_x_idx[r]);
+      float v = kfilter_conf.R_alpha[r] * x_base + kfilter_conf.R_beta[r];
+      S[r][r] += v * v;
+    }
+    float L[DIM_Z][DIM_Z];
+    float inv[DIM_Z];
+    for (int c = 0; c < DIM_Z; c++) {
+      float d = S[c][c];
+      for (int k = 0; k < c; k++) d -= L[c][k] * L[c][k];
+      L[c][c] = sqrtf(d);
+      inv[c] = 1.f / L[c][c];
+      for (int r = c + 1; r < DIM_Z; r++) {
+        float s = S[r][c];
+        for (int k = 0; k < c; k++) s -= L[r][k] * L[c][k];
+        L[r][c] = s * inv[c];
+      }
+    }
+    float hx[DIM_Z];
+    for (int k = 0; k < DIM_Z; k++) hx[k] = t.x(k);
+
+    maha_row(z_.data(), m, hx, L, inv, row_.data());
+    for (int j = 0; j < m; j++) maha(i, j) = row_[j];
+  }
+}
+
+COST_MATRIX KalmanBatch::getCostMatrix(const std::vector<KalmanTracker> &trackers,
+                                       const std::vector<BBOX> &BBoxes,
+                                       const std::vector<int> &Tracker_IDXes,
+                                       const std::vector<int> &BBox_IDXes,
+                                       const cvtdl_kalman_filter_config_t &kfilter_conf,
+                                       float upper_bound) {
+  COST_MATRIX cost_m;
+  mahalanobis(trackers, Tracker_IDXes, BBoxes, BBox_IDXes, kfilter_conf, cost_m);
+  cost_m = cost_m.cwiseMin(upper_bound);
+  return cost_m;
+}
+
+void KalmanBatch::restrictCostMatrix(COST_MATRIX &cost_matrix,
+                                     const std::vector<KalmanTracker> &trackers,
+                                     const std::vector<BBOX> &BBoxes,
+                                     const std::vector<int> &Tracker_IDXes,
+                                     const std::vector<int> &BBox_IDXes,
+                                     const cvtdl_kalman_filter_config_t &kfilter_conf,
+                                     float upper_bound) {
+  COST_MATRIX maha;
+  mahalanobis(trackers, Tracker_IDXes, BBoxes, BBox_IDXes, kfilter_conf, maha);
+  for (int j = 0; j < maha.cols(); j++) {
+    for (int i = 0; i < maha.rows(); i++) {
+      if (maha(i, j) > kfilter_conf.chi2_threshold) cost_matrix(i, j) = upper_bound;
+    }
+  }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include "cvi_kalman_tracker.hpp"
+
+/**
+ * Batched Kalman predict and gating for DeepSORT.
+ *
+ * The selected trackers are gathered into structure-of-arrays planes (one plane per state entry
+ * and per covariance entry, lane = tracker) so predict runs as a handful of NEON/SSE plane adds
+ * for all tracks at once instead of two 8x8 matrix products per tracker. F = [I I; 0 I] is applied
+ * structurally, which gives the same sums as KalmanFilter::predict.
+ *
+ * mahalanobis() factors the 4x4 innovation covariance of each tracker once and evaluates the
+ * squared distance to every measurement with a kernel vectorized over detections, producing the
+ * whole tracks x detections gating matrix in one call.
+ *
+ * KalmanTracker still owns x / P, the engine only keeps its planes between calls.
+ */
+class KalmanBatch {
+ public:
+  KalmanBatch() = default;
+
+  /**
+   * Same as calling KalmanTracker::predict on trackers[idxes[i]] for every i. Trackers not in the
+   * UPDATED state go through the per-tracker path, which reports the error.
+   */
+  void predict(std::vector<KalmanTracker> &trackers, const std::vector<int> &idxes,
+               cvtdl_deepsort_config_t *conf);
+  // predict every tracker
+  void predict(std::vector<KalmanTracker> &trackers, cvtdl_deepsort_config_t *conf);
+
+  /**
+   * maha(i, j) = squared mahalanobis distance between trackers[Tracker_IDXes[i]] and the xyah
+   * measurement of BBoxes[BBox_IDXes[j]], as KalmanFilter::mahalanobis computes it.
+   */
+  void mahalanobis(const std::vector<KalmanTracker> &trackers,
+                   const std::vector<int> &Tracker_IDXes, const std::vector<BBOX> &BBoxes,
+                   const std::vector<int> &BBox_IDXes,
+                   const cvtdl_kalman_filter_config_t &kfilter_conf, COST_MATRIX &maha);
+
+  // batched KalmanTracker::getCostMatrix_Mahalanobis
+  COST_MATRIX getCostMatrix(const std::vector<KalmanTracker> &trackers,
+                            const std::vector<BBOX> &BBoxes, const std::vector<int> &Tracker_IDXes,
+                            const std::vector<int> &BBox_IDXes,
+                            const cvtdl_kalman_filter_config_t &kfilter_conf, float upper_bound);
+  // batched KalmanTracker::restrictCostMatrix_Mahalanobis
+  void restrictCostMatrix(COST_MATRIX &cost_matrix, const std::vector<KalmanTracker> &trackers,
+                          const std::vector<BBOX> &BBoxes, const std::vector<int> &Tracker_IDXes,
+                          const std::vector<int> &BBox_IDXes,
+                          const cvtdl_kalman_filter_config_t &kfilter_conf, float upper_bound);
+
+ private:
+  void reserve(int n);
+  float *xPlane(int k) { return x_.data() + k * capacity_; }
+  float *pPlane(int r, int c) { return p_.data() + (r * DIM_X + c) * capacity_; }
+
+  // per-tracker path for trackers in the wrong state
+  KalmanFilter kf_;
+  int capacity_ = 0;
+  std::vector<float> x_;  // DIM_X planes
+  std::vector<float> p_;  // DIM_X * DIM_X planes, row major
+  std::vector<float> q_;  // DIM_X planes of process noise
+  std::vector<int> lanes_;
+  std::vector<int> all_idxes_;
+
+  // measurement planes (x, y, a, h) and one row of distances
+  std::vector<float> z_;
+  std::vector<float> row_;
+};
@@ -53,6 +53,7 @@ void KalmanTracker::update_feature(const FEATURE &feature, int feature_budget_si
     FEATURE tmp_feature = feature;
     normalize_feature(tmp_feature);
     features.push_back(tmp_feature);
+    features_version++;
     init_feature = true;
     feature_update_counter = 0;
     return;
@@ -71,6 +72,7 @@ void KalmanTracker::update_feature(const FEATURE &feature, int feature_budget_si
     if (features.size() > static_cast<size_t>(feature_budget_size)) {
       features.erase(features.begin());
     }
+    features_version++;
   }
 }
 
@@ -21,6 +21,7 @@ const float chi2_100[5] = {0,   2.706,   4.605,   6.251,   7.779};
 class KalmanTracker : public Tracker {
  public:
   std::vector<FEATURE> features;
+  uint32_t features_version = 0;  // bumped on every change of features
   kalman_state_e kalman_state;
   k_tracker_state_e tracker_state;
   bool bounding;
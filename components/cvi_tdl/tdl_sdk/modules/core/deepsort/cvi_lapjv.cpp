@@ -0,0 +1,209 @@
+/*
+ * reference:
+ *     R. Jonker, A. Volgenant, "A shortest augmenting path algorithm for dense and sparse linear
+ *     assignment problems", Computing 38, 1987.
+ */
+
+#include "cvi_lapjv.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+static const double kInf = std::numeric_limits<double>::infinity();
+
+/*
+ * Extended problem of size n + m:
+ *   row i < n       : real columns j with cost(i, j) < gate, plus its own dummy column m + i
+ *   row n + j       : real column j, plus dummy column m + i for every feasible (i, j) at cost 0
+ * A perfect matching always exists (every row can take its dummy) and real pairs are only used
+ * when cheaper than the two unmatched costs they replace.
+ */
+void CVILapjv::buildGraph(const Eigen::MatrixXf &cost, float gate) {
+  const int rows = cost.rows();
+  const int cols = cost.cols();
+  size_ = rows + cols;
+
+  float max_cost = -std::numeric_limits<float>::max();
+  float min_cost = std::numeric_limits<float>::max();
+  for (int j = 0; j < cols; j++) {
+    for (int i = 0; i < rows; i++) {
+      float c = cost(i, j);
+      if (std::isfinite(c) && c < gate) {
+        max_cost = std::max(max_cost, c);
+        min_cost = std::min(min_cost, c);
+      }
+    }
+  }
+  // with a huge gate (DeepSORT passes FLT_MAX when unbounded) the unmatched cost is capped to a
+  // value that still makes every extra match worth it, which keeps the potentials well scaled
+  double limit = gate;
+  if (max_cost >= min_cost) {
+    double cap = std::min(rows, cols) * (static_cast<double>(max_cost) - min_cost) +
+                 std::fabs(max_cost) + std::fabs(min_cost) + 1.0;
+    limit = std::min(limit, cap);
+  }
+  const float unmatched = static_cast<float>(limit / 2);
+
+  row_offset_.assign(size_ + 1, 0);
+  edge_col_.clear();
+  edge_cost_.clear();
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < cols; j++) {
+      float c = cost(i, j);
+      if (std::isfinite(c) && c < gate) addEdge(j, c);
+    }
+    addEdge(cols + i, unmatched);
+    row_offset_[i + 1] = edge_col_.size();
+  }
+  for (int j = 0; j < cols; j++) {
+    addEdge(j, unmatched);
+    for (int i = 0; i < rows; i++) {
+      float c = cost(i, j);
+      if (std::isfinite(c) && c < gate) addEdge(cols + i, 0.f);
+    }
+    row_offset_[rows + j + 1] = edge_col_.size();
+  }
+}
+
+// column reduction followed by reduction transfer, the first two phases of JV
+void CVILapjv::initReduction() {
+  u_.assign(size_, 0);
+  v_.assign(size_, kInf);
+  col4row_.assign(size_, -1);
+  row4col_.assign(size_, -1);
+  pred_.assign(size_, -1);
+
+  // v_j = min_i c_ij, pred_ holds the argmin row (every column has at least one edge)
+  for (int r = 0; r < size_; r++) {
+    for (int e = row_offset_[r]; e < row_offset_[r + 1]; e++) {
+      int j = edge_col_[e];
+      if (edge_cost_[e] < v_[j]) {
+        v_[j] = edge_cost_[e];
+        pred_[j] = r;
+      }
+    }
+  }
+  for (int j = size_ - 1; j >= 0; j--) {
+    int r = pred_[j];
+    if (col4row_[r] < 0) {
+      col4row_[r] = j;
+      row4col_[j] = r;
+    }
+  }
+
+  // give each assigned row the slack to its second best column, which lowers the potential of
+  // the assigned column and lets later augmentations stop earlier
+  for (int r = 0; r < size_; r++) {
+    int x = col4row_[r];
+    if (x < 0) continue;
+    double second = kInf;
+    double tight = 0;
+    for (int e = row_offset_[r]; e < row_offset_[r + 1]; e++) {
+      int j = edge_col_[e];
+      if (j == x) {
+        tight = edge_cost_[e];
+      } else {
+        second = std::min(second, edge_cost_[e] - v_[j]);
+      }
+    }
+    if (second == kInf) continue;
+    u_[r] = second;
+    v_[x] = tight - second;
+  }
+}
+
+bool CVILapjv::augment(int free_row) {
+  typedef std::pair<double, int> HeapItem;
+  std::greater<HeapItem> heap_cmp;
+  heap_.clear();
+  touched_cols_.clear();
+  scanned_cols_.clear();
+  visited_rows_.clear();
+
+  double min_val = 0;
+  int i = free_row;
+  int sink = -1;
+  while (sink < 0) {
+    visited_rows_.push_back(i);
+    for (int e = row_offset_[i]; e < row_offset_[i + 1]; e++) {
+      int j = edge_col_[e];
+      if (scanned_[j]) continue;
+      double r = min_val + edge_cost_[e] - u_[i] - v_[j];
+      if (r < dist_[j]) {
+        if (dist_[j] == kInf) touched_cols_.push_back(j);
+        dist_[j] = r;
+        pred_[j] = i;
+        heap_.push_back(HeapItem(r, j));
+        std::push_heap(heap_.begin(), heap_.end(), heap_cmp);
+      }
+    }
+
+    int j = -1;
+    while (!heap_.empty()) {
+      std::pop_heap(heap_.begin(), heap_.end(), heap_cmp);
+      HeapItem top = heap_.back();
+      heap_.pop_back();
+      if (!scanned_[top.second] && top.first <= dist_[top.second]) {
+        j = top.second;
+        break;
+      }
+    }
+    if (j < 0) break;
+
+    min_val = dist_[j];
+    scanned_[j] = 1;
+    scanned_cols_.push_back(j);
+    if (row4col_[j] < 0) {
+      sink = j;
+    } else {
+      i = row4col_[j];
+    }
+  }
+
+  if (sink >= 0) {
+    u_[free_row] += min_val;
+    for (size_t k = 1; k < visited_rows_.size(); k++) {
+      int r = visited_rows_[k];
+      u_[r] += min_val - dist_[col4row_[r]];
+    }
+    for (int j : scanned_cols_) v_[j] -= min_val - dist_[j];
+
+    int j = sink;
+    while (true) {
+      int r = pred_[j];
+      row4col_[j] = r;
+      std::swap(col4row_[r], j);
+      if (r == free_row) break;
+    }
+  }
+
+  for (int j : touched_cols_) {
+    dist_[j] = kInf;
+    scanned_[j] = 0;
+  }
+  return sink >= 0;
+}
+
+bool CVILapjv::solve(const Eigen::MatrixXf &cost, float gate, std::vector<int> &row_match) {
+  const int rows = cost.rows();
+  const int cols = cost.cols();
+  row_match.assign(rows, -1);
+  if (rows == 0 || cols == 0) return true;
+
+  buildGraph(cost, gate);
+  initReduction();
+
+  dist_.assign(size_, kInf);
+  pred_.assign(size_, -1);
+  scanned_.assign(size_, 0);
+  for (int r = 0; r < size_; r++) {
+    if (col4row_[r] < 0 && !augment(r)) return false;
+  }
+
+  for (int i = 0; i < rows; i++) {
+    if (col4row_[i] < cols) row_match[i] = col4row_[i];
+  }
+  return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Eigen/Eigen>
+#include <vector>
+
+enum assignment_solver_e {
+  ASSIGNMENT_MUNKRES = 0,  // CVIMunkres, dense reference implementation
+  ASSIGNMENT_LAPJV,        // CVILapjv, sparse shortest augmenting path
+};
+
+/**
+ * Sparse Jonker-Volgenant assignment solver.
+ *
+ * Pairs whose cost is >= gate are infeasible and never enter the solver. The rectangular problem
+ * is extended to a square one where leaving a row or column unmatched costs gate / 2, so a pair is
+ * only assigned when it is cheaper than leaving both sides alone. Only feasible pairs are stored
+ * (CSR), the duals are initialized by column reduction and reduction transfer and the remaining
+ * free rows are augmented one by one with a heap based Dijkstra over reduced costs. Buffers are
+ * kept between solves, so a solver owned by the tracker does not allocate once warmed up.
+ */
+class CVILapjv {
+ public:
+  CVILapjv() = default;
+
+  /**
+   * rows x cols cost matrix. row_match receives, for each row, the matched column or -1.
+   * Non finite costs are treated as infeasible. Returns false if an augmentation fails, which
+   * cannot happen on the extended problem and only guards against corrupted input.
+   */
+  bool solve(const Eigen::MatrixXf &cost, float gate, std::vector<int> &row_match);
+
+ private:
+  void addEdge(int col, float cost) {
+    edge_col_.push_back(col);
+    edge_cost_.push_back(cost);
+  }
+  void buildGraph(const Eigen::MatrixXf &cost, float gate);
+  void initReduction();
+  bool augment(int free_row);
+
+  int size_ = 0;
+  // extended square problem in CSR, row r owns edges [row_offset_[r], row_offset_[r + 1])
+  std::vector<int> row_offset_;
+  std::vector<int> edge_col_;
+  std::vector<float> edge_cost_;
+
+  std::vector<double> u_, v_;
+  std::vector<int> col4row_, row4col_;
+
+  // per augmentation scratch
+  std::vector<double> dist_;
+  std::vector<int> pred_;
+  std::vector<char> scanned_;
+  std::vector<int> touched_cols_, scanned_cols_, visited_rows_;
+  std::vector<std::pair<double, int>> heap_;
+};
@@ -0,0 +1,462 @@
+#include "cvi_reid_gallery.hpp"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "cvi_tdl_log.hpp"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define REID_USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define REID_USE_SSE
+#endif
+
+// inactive entries per IVF list before the index is (re)built, and k-means rounds per build
+#define IVF_MIN_PER_LIST 8
+#define IVF_KMEANS_ITERS 8
+
+#if defined(REID_USE_NEON)
+// codes are clamped to [-127, 127], two products always fit in int16
+static inline int32x4_t dot_s8x16(int32x4_t acc, int8x16_t a, int8x16_t b) {
+  int16x8_t p = vmull_s8(vget_low_s8(a), vget_low_s8(b));
+  p = vmlal_s8(p, vget_high_s8(a), vget_high_s8(b));
+  return vpadalq_s16(acc, p);
+}
+
+static inline int32_t hsum_s32(int32x4_t acc) {
+  int32x2_t s2 = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+  return vget_lane_s32(vpadd_s32(s2, s2), 0);
+}
+#elif defined(REID_USE_SSE)
+// sign extend 16 int8 to two int16 vectors by duplicating each byte and shifting back
+static inline void widen_s8(__m128i v, __m128i *lo, __m128i *hi) {
+  *lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+  *hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+}
+
+static inline __m128i dot_s8x16(__m128i acc, __m128i a_lo, __m128i a_hi, const int8_t *b) {
+  __m128i b_lo, b_hi;
+  widen_s8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b)), &b_lo, &b_hi);
+  acc = _mm_add_epi32(acc, _mm_madd_epi16(a_lo, b_lo));
+  return _mm_add_epi32(acc, _mm_madd_epi16(a_hi, b_hi));
+}
+
+static inline int32_t hsum_s32(__m128i acc) {
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(acc);
+}
+#endif
+
+void int8_dot_batch(const int8_t *query, const int8_t *base, int n, int dim, int32_t *dst) {
+  const int simd_dim = dim & ~15;
+  int i = 0;
+#if defined(REID_USE_NEON) || defined(REID_USE_SSE)
+  // four codes per pass so that every query block is loaded once for all of them
+  for (; i + 4 <= n; i += 4) {
+    const int8_t *c0 = base + static_cast<size_t>(i) * dim;
+    const int8_t *c1 = c0 + dim;
+    const int8_t *c2 = c1 + dim;
+    const int8_t *c3 = c2 + dim;
+#if defined(REID_USE_NEON)
+    int32x4_t acc0 = vdupq_n_s32(0), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+    for (int d = 0; d < simd_dim; d += 16) {
+      int8x16_t q = vld1q_s8(query + d);
+      acc0 = dot_s8x16(acc0, q, vld1q_s8(c0 + d));
+      acc1 = dot_s8x16(acc1, q, vld1q_s8(c1 + d));
+      acc2 = dot_s8x16(acc2, q, vld1q_s8(c2 + d));
+      acc3 = dot_s8x16(acc3, q, vld1q_s8(c3 + d));
+    }
+#else
+    __m128i acc0 = _mm_setzero_si128(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+    for (int d = 0; d < simd_dim; d += 16) {
+      __m128i q_lo, q_hi;
+      widen_s8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(query + d)), &q_lo, &q_hi);
+      acc0 = dot_s8x16(acc0, q_lo, q_hi, c0 + d);
+      acc1 = dot_s8x16(acc1, q_lo, q_hi, c1 + d);
+      acc2 = dot_s8x16(acc2, q_lo, q_hi, c2 + d);
+      acc3 = dot_s8x16(acc3, q_lo, q_hi, c3 + d);
+    }
+#endif
+    int32_t sums[4] = {hsum_s32(acc0), hsum_s32(acc1), hsum_s32(acc2), hsum_s32(acc3)};
+    for (int d = simd_dim; d < dim; d++) {
+      sums[0] += static_cast<int32_t>(query[d]) * c0[d];
+      sums[1] += static_cast<int32_t>(query[d]) * c1[d];
+      sums[2] += static_cast<int32_t>(query[d]) * c2[d];
+      sums[3] += static_cast<int32_t>(query[d]) * c3[d];
+    }
+    memcpy(dst + i, sums, sizeof(sums));
+  }
+#endif
+  for (; i < n; i++) {
+    const int8_t *code = base + static_cast<size_t>(i) * dim;
+    int32_t sum = 0;
+    int d = 0;
+#if defined(REID_USE_NEON)
+    int32x4_t acc = vdupq_n_s32(0);
+    for (; d < simd_dim; d += 16) acc = dot_s8x16(acc, vld1q_s8(query + d), vld1q_s8(code + d));
+    sum = hsum_s32(acc);
+#elif defined(REID_USE_SSE)
+    __m128i acc = _mm_setzero_si128();
+    for (; d < simd_dim; d += 16) {
+      __m128i q_lo, q_hi;
+      widen_s8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(query + d)), &q_lo, &q_hi);
+      acc = dot_s8x16(acc, q_lo, q_hi, code + d);
+    }
+    sum = hsum_s32(acc);
+#endif
+    for (; d < dim; d++) sum += static_cast<int32_t>(query[d]) * code[d];
+    dst[i] = sum;
+  }
+}
+
+static inline float code_distance(int32_t dot, float inv_a, float inv_b) {
+  return 0.5f * (1.f - static_cast<float>(dot) * inv_a * inv_b);
+}
+
+void ReidGallery::setBudget(int budget) { budget_ = std::max(1, budget); }
+
+void ReidGallery::setInactiveCapacity(int capacity) {
+  inactive_capacity_ = std::max(1, capacity);
+  evictInactive();
+}
+
+void ReidGallery::setIndex(int nlist, int nprobe) {
+  nprobe_ = std::max(1, nprobe);
+  if (nlist == nlist_) return;
+  nlist_ = nlist;
+  reindex();
+}
+
+void ReidGallery::clear() {
+  dim_ = 0;
+  seq_ = 0;
+  trained_size_ = 0;
+  active_.clear();
+  lists_.clear();
+  centroids_.clear();
+  inactive_pos_.clear();
+  inactive_order_.clear();
+}
+
+bool ReidGallery::checkDim(int dim) {
+  if (dim <= 0) return false;
+  if (dim_ == 0) dim_ = dim;
+  if (dim != dim_) {
+    LOGE("ReID gallery holds %d-d features, got %d-d.\n", dim_, dim);
+    return false;
+  }
+  return true;
+}
+
+float ReidGallery::quantize(const float *feature, int8_t *code) const {
+  float norm = 0;
+  for (int d = 0; d < dim_; d++) norm += feature[d] * feature[d];
+  if (norm <= 0) {
+    memset(code, 0, dim_);
+    return 0;
+  }
+  float scale = 127.f / sqrtf(norm);
+  int32_t code_norm = 0;
+  for (int d = 0; d < dim_; d++) {
+    int q = static_cast<int>(lrintf(feature[d] * scale));
+    q = std::min(127, std::max(-127, q));
+    code[d] = static_cast<int8_t>(q);
+    code_norm += q * q;
+  }
+  return code_norm > 0 ? 1.f / sqrtf(static_cast<float>(code_norm)) : 0.f;
+}
+
+void ReidGallery::accumulate(const int8_t *code, float inv_norm, float *out) const {
+  for (int d = 0; d < dim_; d++) out[d] += code[d] * inv_norm;
+}
+
+void ReidGallery::pushSample(ActiveTrack &track, const float *feature, bool evict) {
+  if (evict && !track.inv_norms.empty()) {
+    track.codes.erase(track.codes.begin(), track.codes.begin() + dim_);
+    track.inv_norms.erase(track.inv_norms.begin());
+  }
+  size_t offset = track.codes.size();
+  track.codes.resize(offset + dim_);
+  track.inv_norms.push_back(quantize(feature, track.codes.data() + offset));
+}
+
+void ReidGallery::syncTrack(uint64_t id, int class_id, const std::vector<FEATURE> &features,
+                            uint32_t version) {
+  auto it = active_.find(key(id, class_id));
+  bool fresh = it == active_.end();
+  if (!fresh && it->second.version == version) return;
+  for (const FEATURE &f : features) {
+    if (!checkDim(f.cols())) return;
+  }
+  ActiveTrack &track = fresh ? active_[key(id, class_id)] : it->second;
+  size_t count = track.inv_norms.size();
+  track.class_id = class_id;
+  if (!fresh && version == track.version + 1 && !features.empty() &&
+      (features.size() == count + 1 || features.size() == count)) {
+    pushSample(track, features.back().data(), features.size() == count);
+  } else {
+    track.codes.clear();
+    track.inv_norms.clear();
+    for (const FEATURE &f : features) pushSample(track, f.data(), false);
+  }
+  track.version = version;
+}
+
+void ReidGallery::addSample(uint64_t id, int class_id, const FEATURE &feature) {
+  if (!checkDim(feature.cols())) return;
+  ActiveTrack &track = active_[key(id, class_id)];
+  track.class_id = class_id;
+  pushSample(track, feature.data(), track.inv_norms.size() >= static_cast<size_t>(budget_));
+}
+
+void ReidGallery::removeTrack(uint64_t id, int class_id) { active_.erase(key(id, class_id)); }
+
+void ReidGallery::retireTrack(uint64_t id, int class_id) {
+  auto it = active_.find(key(id, class_id));
+  if (it == active_.end()) return;
+  const ActiveTrack &track = it->second;
+  if (!track.inv_norms.empty()) {
+    fbuf_.assign(dim_, 0.f);
+    for (size_t s = 0; s < track.inv_norms.size(); s++) {
+      accumulate(track.codes.data() + s * dim_, track.inv_norms[s], fbuf_.data());
+    }
+    std::vector<int8_t> code(dim_);
+    float inv_norm = quantize(fbuf_.data(), code.data());
+    insertInactive(id, class_id, code.data(), inv_norm);
+  }
+  active_.erase(it);
+}
+
+void ReidGallery::costMatrix(const std::vector<uint64_t> &ids, const std::vector<int> &class_ids,
+                             const std::vector<FEATURE> &Features,
+                             const std::vector<int> &BBox_IDXes, COST_MATRIX &cost) {
+  int rows = ids.size();
+  int cols = BBox_IDXes.size();
+  cost.setConstant(rows, cols, 1.f);
+  if (rows == 0 || cols == 0 || !checkDim(Features[BBox_IDXes[0]].cols())) return;
+
+  query_codes_.resize(static_cast<size_t>(cols) * dim_);
+  query_inv_norms_.resize(cols);
+  for (int j = 0; j < cols; j++) {
+    const FEATURE &f = Features[BBox_IDXes[j]];
+    if (!checkDim(f.cols())) return;
+    query_inv_norms_[j] = quantize(f.data(), query_codes_.data() + static_cast<size_t>(j) * dim_);
+  }
+  dots_.resize(cols);
+  for (int i = 0; i < rows; i++) {
+    auto it = active_.find(key(ids[i], class_ids[i]));
+    if (it == active_.end()) continue;
+    const ActiveTrack &track = it->second;
+    // one sample against every detection per kernel call
+    for (size_t s = 0; s < track.inv_norms.size(); s++) {
+      int8_dot_batch(track.codes.data() + s * dim_, query_codes_.data(), cols, dim_, dots_.data());
+      for (int j = 0; j < cols; j++) {
+        float d = code_distance(dots_[j], track.inv_norms[s], query_inv_norms_[j]);
+        if (d < cost(i, j)) cost(i, j) = d;
+      }
+    }
+  }
+}
+
+int ReidGallery::nearestList(const float *feature) const {
+  int best = 0;
+  float best_score = -FLT_MAX;
+  for (int c = 0; c < static_cast<int>(centroids_.size()) / dim_; c++) {
+    const float *centroid = centroids_.data() + static_cast<size_t>(c) * dim_;
+    float score = 0;
+    for (int d = 0; d < dim_; d++) score += centroid[d] * feature[d];
+    if (score > best_score) {
+      best_score = score;
+      best = c;
+    }
+  }
+  return best;
+}
+
+void ReidGallery::insertInactive(uint64_t id, int class_id, const int8_t *code, float inv_norm) {
+  uint64_t k = key(id, class_id);
+  eraseInactive(k);
+  int list = 0;
+  if (!centroids_.empty()) {
+    fbuf_.assign(dim_, 0.f);
+    accumulate(code, inv_norm, fbuf_.data());
+    list = nearestList(fbuf_.data());
+  }
+  if (lists_.empty()) lists_.resize(1);
+  InactiveList &l = lists_[list];
+  l.codes.insert(l.codes.end(), code, code + dim_);
+  l.inv_norms.push_back(inv_norm);
+  l.ids.push_back(id);
+  l.class_ids.push_back(class_id);
+  inactive_pos_[k] = {list, static_cast<int>(l.ids.size()) - 1, ++seq_};
+  inactive_order_.emplace_back(k, seq_);
+  evictInactive();
+
+  // build the index once there is enough to cluster, rebuild whenever the gallery doubled
+  size_t size = inactive_pos_.size();
+  if (nlist_ > 1 && size >= static_cast<size_t>(nlist_) * IVF_MIN_PER_LIST &&
+      size >= 2 * trained_size_) {
+    reindex();
+  }
+}
+
+void ReidGallery::eraseInactive(uint64_t k) {
+  auto it = inactive_pos_.find(k);
+  if (it == inactive_pos_.end()) return;
+  InactiveList &l = lists_[it->second.list];
+  int pos = it->second.pos;
+  int last = static_cast<int>(l.ids.size()) - 1;
+  if (pos != last) {
+    memcpy(l.codes.data() + static_cast<size_t>(pos) * dim_,
+           l.codes.data() + static_cast<size_t>(last) * dim_, dim_);
+    l.inv_norms[pos] = l.inv_norms[last];
+    l.ids[pos] = l.ids[last];
+    l.class_ids[pos] = l.class_ids[last];
+    inactive_pos_[key(l.ids[pos], l.class_ids[pos])].pos = pos;
+  }
+  l.codes.resize(static_cast<size_t>(last) * dim_);
+  l.inv_norms.pop_back();
+  l.ids.pop_back();
+  l.class_ids.pop_back();
+  inactive_pos_.erase(it);
+}
+
+void ReidGallery::evictInactive() {
+  while (inactive_pos_.size() > static_cast<size_t>(inactive_capacity_) &&
+         !inactive_order_.empty()) {
+    std::pair<uint64_t, uint64_t> oldest = inactive_order_.front();
+    inactive_order_.pop_front();
+    auto it = inactive_pos_.find(oldest.first);
+    if (it != inactive_pos_.end() && it->second.seq == oldest.second) eraseInactive(oldest.first);
+  }
+  // drop the order entries of identities that were recovered or re-inserted meanwhile
+  if (inactive_order_.size() > 2 * inactive_pos_.size() + 16) {
+    std::deque<std::pair<uint64_t, uint64_t>> order;
+    for (const auto &e : inactive_order_) {
+      auto it = inactive_pos_.find(e.first);
+      if (it != inactive_pos_.end() && it->second.seq == e.second) order.push_back(e);
+    }
+    inactive_order_.swap(order);
+  }
+}
+
+void ReidGallery::reindex() {
+  size_t n = inactive_pos_.size();
+  std::vector<InactiveList> old_lists;
+  old_lists.swap(lists_);
+  centroids_.clear();
+  trained_size_ = 0;
+  if (n == 0) return;
+
+  // unit vectors of every entry, in list order
+  std::vector<float> points(n * dim_, 0.f);
+  size_t p = 0;
+  for (const InactiveList &l : old_lists) {
+    for (size_t i = 0; i < l.ids.size(); i++, p++) {
+      accumulate(l.codes.data() + i * dim_, l.inv_norms[i], points.data() + p * dim_);
+    }
+  }
+
+  int nlist = 1;
+  std::vector<int> assign(n, 0);
+  if (nlist_ > 1 && n >= static_cast<size_t>(nlist_) * IVF_MIN_PER_LIST) {
+    // spherical k-means, seeded with evenly spaced entries
+    nlist = nlist_;
+    centroids_.resize(static_cast<size_t>(nlist) * dim_);
+    for (int c = 0; c < nlist; c++) {
+      memcpy(centroids_.data() + static_cast<size_t>(c) * dim_,
+             points.data() + (n * c / nlist) * dim_, dim_ * sizeof(float));
+    }
+    std::vector<float> sums(centroids_.size());
+    std::vector<int> members(nlist);
+    for (int iter = 0; iter < IVF_KMEANS_ITERS; iter++) {
+      std::fill(sums.begin(), sums.end(), 0.f);
+      std::fill(members.begin(), members.end(), 0);
+      for (size_t i = 0; i < n; i++) {
+        assign[i] = nearestList(points.data() + i * dim_);
+        float *sum = sums.data() + static_cast<size_t>(assign[i]) * dim_;
+        for (int d = 0; d < dim_; d++) sum[d] += points[i * dim_ + d];
+        members[assign[i]]++;
+      }
+      for (int c = 0; c < nlist; c++) {
+        // an empty list keeps its centroid
+        if (members[c] == 0) continue;
+        float *sum = sums.data() + static_cast<size_t>(c) * dim_;
+        float norm = 0;
+        for (int d = 0; d < dim_; d++) norm += sum[d] * sum[d];
+        if (norm <= 0) continue;
+        float inv = 1.f / sqrtf(norm);
+        float *centroid = centroids_.data() + static_cast<size_t>(c) * dim_;
+        for (int d = 0; d < dim_; d++) centroid[d] = sum[d] * inv;
+      }
+    }
+    for (size_t i = 0; i < n; i++) assign[i] = nearestList(points.data() + i * dim_);
+    trained_size_ = n;
+  }
+
+  lists_.resize(nlist);
+  p = 0;
+  for (const InactiveList &l : old_lists) {
+    for (size_t i = 0; i < l.ids.size(); i++, p++) {
+      InactiveList &dst = lists_[assign[p]];
+      dst.codes.insert(dst.codes.end(), l.codes.begin() + i * dim_,
+                       l.codes.begin() + (i + 1) * dim_);
+      dst.inv_norms.push_back(l.inv_norms[i]);
+      dst.ids.push_back(l.ids[i]);
+      dst.class_ids.push_back(l.class_ids[i]);
+      InactivePos &pos = inactive_pos_[key(l.ids[i], l.class_ids[i])];
+      pos.list = assign[p];
+      pos.pos = static_cast<int>(dst.ids.size()) - 1;
+    }
+  }
+}
+
+bool ReidGallery::searchInactive(const FEATURE &feature, int class_id, ReidMatch *match) {
+  if (inactive_pos_.empty() || !checkDim(feature.cols())) return false;
+  query_codes_.resize(dim_);
+  float query_inv_norm = quantize(feature.data(), query_codes_.data());
+
+  // lists to scan, the nprobe closest centroids once the index is built
+  std::vector<int> probes;
+  if (centroids_.empty()) {
+    for (size_t l = 0; l < lists_.size(); l++) probes.push_back(l);
+  } else {
+    int nlist = centroids_.size() / dim_;
+    std::vector<std::pair<float, int>> scores(nlist);
+    for (int c = 0; c < nlist; c++) {
+      const float *centroid = centroids_.data() + static_cast<size_t>(c) * dim_;
+      float score = 0;
+      for (int d = 0; d < dim_; d++) score += centroid[d] * feature[d];
+      scores[c] = std::make_pair(-score, c);
+    }
+    int nprobe = std::min(nprobe_, nlist);
+    std::partial_sort(scores.begin(), scores.begin() + nprobe, scores.end());
+    for (int c = 0; c < nprobe; c++) probes.push_back(scores[c].second);
+  }
+
+  bool found = false;
+  for (int l : probes) {
+    const InactiveList &list = lists_[l];
+    int n = list.ids.size();
+    if (n == 0) continue;
+    dots_.resize(n);
+    int8_dot_batch(query_codes_.data(), list.codes.data(), n, dim_, dots_.data());
+    for (int i = 0; i < n; i++) {
+      if (list.class_ids[i] != class_id) continue;
+      float d = code_distance(dots_[i], query_inv_norm, list.inv_norms[i]);
+      if (!found || d < match->distance) {
+        found = true;
+        match->id = list.ids[i];
+        match->class_id = class_id;
+        match->distance = d;
+      }
+    }
+  }
+  return found;
+}
+
+void ReidGallery::removeInactive(uint64_t id, int class_id) { eraseInactive(key(id, class_id)); }
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include "cvi_distance_metric.hpp"
+
+// dst[i] = <query, base[i]> for n int8 vectors of dim entries stored back to back
+void int8_dot_batch(const int8_t *query, const int8_t *base, int n, int dim, int32_t *dst);
+
+struct ReidMatch {
+  uint64_t id;
+  int class_id;
+  float distance;
+};
+
+/**
+ * Appearance gallery for DeepSORT.
+ *
+ * Features are stored as int8 codes (unit vector * 127) together with the inverse norm of the
+ * code, so a cosine distance costs one int8 dot product and two multiplies. The dot products of
+ * one sample against a block of codes run through int8_dot_batch (NEON / SSE2, scalar tail).
+ *
+ * Active tracks mirror KalmanTracker::features (bounded by its feature budget, oldest evicted
+ * first). Retired tracks are folded into one mean appearance and kept in the
+ * inactive gallery (FIFO, `inactive_capacity` entries) so that a returning identity can get its
+ * id back. Once the inactive gallery is large enough an IVF index (spherical k-means coarse
+ * quantizer, `nprobe` lists scanned per query) replaces the linear scan.
+ */
+class ReidGallery {
+ public:
+  ReidGallery() = default;
+
+  // samples kept per active track by addSample, oldest evicted first
+  void setBudget(int budget);
+  void setInactiveCapacity(int capacity);
+  // nlist <= 1 keeps the inactive gallery as a flat list
+  void setIndex(int nlist, int nprobe);
+  void clear();
+
+  /**
+   * Mirror the feature history of an active track. version has to change whenever features
+   * changes; one push_back (and at most one erase of the oldest entry) per version step is picked
+   * up incrementally, anything else re-quantizes the whole history.
+   */
+  void syncTrack(uint64_t id, int class_id, const std::vector<FEATURE> &features,
+                 uint32_t version);
+  void addSample(uint64_t id, int class_id, const FEATURE &feature);
+  void removeTrack(uint64_t id, int class_id);
+  // fold the samples of an active track into the inactive gallery
+  void retireTrack(uint64_t id, int class_id);
+
+  /**
+   * cost(i, j) = min over the samples of track (ids[i], class_ids[i]) of the cosine distance to
+   * Features[BBox_IDXes[j]]. Tracks without samples get the largest distance (1).
+   */
+  void costMatrix(const std::vector<uint64_t> &ids, const std::vector<int> &class_ids,
+                  const std::vector<FEATURE> &Features, const std::vector<int> &BBox_IDXes,
+                  COST_MATRIX &cost);
+
+  // closest inactive identity of class_id, false if the inactive gallery has none
+  bool searchInactive(const FEATURE &feature, int class_id, ReidMatch *match);
+  void removeInactive(uint64_t id, int class_id);
+
+  size_t numActive() const { return active_.size(); }
+  size_t numInactive() const { return inactive_pos_.size(); }
+  bool indexed() const { return !centroids_.empty(); }
+
+ private:
+  struct ActiveTrack {
+    int class_id = 0;
+    uint32_t version = 0;
+    std::vector<int8_t> codes;  // oldest first
+    std::vector<float> inv_norms;
+  };
+  struct InactiveList {
+    std::vector<int8_t> codes;
+    std::vector<float> inv_norms;
+    std::vector<uint64_t> ids;
+    std::vector<int> class_ids;
+  };
+  struct InactivePos {
+    int list;
+    int pos;
+    uint64_t seq;
+  };
+
+  static uint64_t key(uint64_t id, int class_id) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(class_id)) << 32) | (id & 0xffffffff);
+  }
+  bool checkDim(int dim);
+  // returns the inverse norm of the code, 0 for a zero feature
+  float quantize(const float *feature, int8_t *code) const;
+  // out += code / |code|
+  void accumulate(const int8_t *code, float inv_norm, float *out) const;
+  void pushSample(ActiveTrack &track, const float *feature, bool evict);
+  int nearestList(const float *feature) const;
+  void insertInactive(uint64_t id, int class_id, const int8_t *code, float inv_norm);
+  void eraseInactive(uint64_t key);
+  void evictInactive();
+  // re-cluster the inactive gallery, or flatten it when it is too small for nlist_ lists
+  void reindex();
+
+  int dim_ = 0;
+  int budget_ = 8;
+  int inactive_capacity_ = 1024;
+  int nlist_ = 0;
+  int nprobe_ = 1;
+  uint64_t seq_ = 0;
+  size_t trained_size_ = 0;
+
+  std::unordered_map<uint64_t, ActiveTrack> active_;
+  std::vector<InactiveList> lists_;
+  std::vector<float> centroids_;  // nlist_ x dim_, unit length
+  std::unordered_map<uint64_t, InactivePos> inactive_pos_;
+  std::deque<std::pair<uint64_t, uint64_t>> inactive_order_;  // <key, seq>, oldest first
+
+  // scratch
+  std::vector<int8_t> query_codes_;
+  std::vector<float> query_inv_norms_;
+  std::vector<int32_t> dots_;
+  std::vector<float> fbuf_;
+};
@@ -669,6 +669,7 @@ void DeepSORT::update_tracks(cvtdl_deepsort_config_t *conf,
                 << ",pairtrack:" << it_->get_pair_trackid() << std::endl;
 #endif
       erased_tids.push_back(it_->id);
+      release_tracker(*it_, conf);
       it_ = k_trackers.erase(it_);
 
     } else {
@@ -14,115 +14,6 @@
 
 namespace cvitdl {
 
-static void convert_det_struct(const Detections &dets, cvtdl_object_t *out, int im_height,
-                               int im_width, meta_rescale_type_e type) {
-  CVI_TDL_MemAllocInit(dets.size(), out);
-  out->height = im_height;
-  out->width = im_width;
-  out->rescale_type = type;
-
-  memset(out->info, 0, sizeof(cvtdl_object_info_t) * out->size);
-  for (uint32_t i = 0; i < out->size; ++i) {
-    clip_bbox(im_height, im_width, dets[i]);
-    out->info[i].bbox.x1 = dets[i]->x1;
-    out->info[i].bbox.y1 = dets[i]->y1;
-    out->info[i].bbox.x2 = dets[i]->x2;
-    out->info[i].bbox.y2 = dets[i]->y2;
-    out->info[i].bbox.score = dets[i]->score;
-    out->info[i].classes = dets[i]->label;
-    const std::string &classname = coco_utils::class_names_91[out->info[i].classes];
-    strncpy(out->info[i].name, classname.c_str(), sizeof(out->info[i].name));
-  }
-}
-
-float yoloe_sigmoid(float x) { return 1.0 / (1.0 + exp(-x)); }
-
-template <typename T>
-void decode_yoloe_bbox(T *ptr, float qscale, int basic_pos, int grid0, int grid1, int stride,
-                       int label, float box_prob, PtrDectRect &det) {
-  float x1 = (-ptr[basic_pos + 0] * qscale + grid0 + 0.5) * stride;
-  float y1 = (-ptr[basic_pos + 1] * qscale + grid1 + 0.5) * stride;
-  float x2 = (ptr[basic_pos + 2] * qscale + grid0 + 0.5) * stride;
-  float y2 = (ptr[basic_pos + 3] * qscale + grid1 + 0.5) * stride;
-  det->label = label;
-  det->score = box_prob;
-  det->x1 = x1;
-  det->y1 = y1;
-  det->x2 = x2;
-  det->y2 = y2;
-}
-
-template <typename T>
-int yoloe_argmax(T *ptr, int basic_pos, int cls_len) {
-  int max_idx = 0;
-  for (int i = 0; i < cls_len; i++) {
-    if (ptr[i + basic_pos] > ptr[max_idx + basic_pos]) {
-      max_idx = i;
-    }
-  }
-  return max_idx;
-}
-
-void PPYoloE::generate_ppyoloe_proposals(Detections &detections, int frame_width,
-                                         int frame_height) {
-  CVI_SHAPE shape = getInputShape(0);
-  int target_w = shape.dim[3];
-  int target_h = shape.dim[2];
-
-  for (auto stride : strides_) {
-    TensorInfo oinfo_box = getOutputTensorInfo(box_out_names_[stride]);
-    int num_per_pixel_box = oinfo_box.tensor_size / oinfo_box.tensor_elem;
-    float qscale_box = num_per_pixel_box == 1 ? oinfo_box.qscale : 1;
-    int8_t *ptr_int8_box = static_cast<int8_t *>(oinfo_box.raw_pointer);
-    float *ptr_float_box = static_cast<float *>(oinfo_box.raw_pointer);
-
-    TensorInfo oinfo_cls = getOutputTensorInfo(class_out_names_[stride]);
-    int num_per_pixel_cls = oinfo_cls.tensor_size / oinfo_cls.tensor_elem;
-    float qscale_cls = num_per_pixel_cls == 1 ? oinfo_cls.qscale : 1;
-    int8_t *ptr_int8_cls = static_cast<int8_t *>(oinfo_cls.raw_pointer);
-    float *ptr_float_cls = static_cast<float *>(oinfo_cls.raw_pointer);
-
-    int num_grid_w = target_w / stride;
-    int num_grid_h = target_h / stride;
-
-    int basic_pos_cls = 0;
-    int basic_pos_box = 0;
-    for (int g1 = 0; g1 < num_grid_h; g1++) {
-      for (int g0 = 0; g0 < num_grid_w; g0++) {
-        float class_score = 0.0f;
-        int label = 0;
-        if (num_per_pixel_cls == 1) {
-          label = yoloe_argmax<int8_t>(ptr_int8_cls, basic_pos_cls, alg_param_.cls);
-          class_score = ptr_int8_cls[label + basic_pos_cls] * qscale_cls;
-        } else {
-          label = yoloe_argmax<float>(ptr_float_cls, basic_pos_cls, alg_param_.cls);
-          class_score = ptr_float_cls[label + basic_pos_cls];
-        }
-
-        class_score = yoloe_sigmoid(class_score);
-        if (class_score < m_model_threshold) {
-          basic_pos_cls += alg_param_.cls;
-          basic_pos_box += 4;
-          continue;
-        }
-
-        PtrDectRect det = std::make_shared<object_detect_rect_t>();
-        if (num_per_pixel_box == 1) {
-          decode_yoloe_bbox<int8_t>(ptr_int8_box, qscale_box, basic_pos_box, g0, g1, stride, label,
-                                    class_score, det);
-        } else {
-          decode_yoloe_bbox<float>(ptr_float_box, qscale_box, basic_pos_box, g0, g1, stride, label,
-                                   class_score, det);
-        }
-        basic_pos_cls += alg_param_.cls;
-        basic_pos_box += 4;
-        clip_bbox(frame_width, frame_height, det);
-        detections.push_back(det);
-      }
-    }
-  }
-}
-
 PPYoloE::PPYoloE() {
   // default param
   float mean[3] = {123.675, 116.28, 103.52};
@@ -181,6 +72,19 @@ int PPYoloE::onModelOpened() {
     }
   }
 
+  branches_.clear();
+  int total_anchor = 0;
+  for (int stride : strides_) {
+    DetHeadBranch branch;
+    branch.stride_x = stride;
+    branch.stride_y = stride;
+    branch.box = getOutputTensorView(box_out_names_[stride], true);
+    branch.cls = getOutputTensorView(class_out_names_[stride], true);
+    branches_.push_back(branch);
+    total_anchor += branch.cls.num_anchor;
+  }
+  arena_.setCapacity(total_anchor);
+
   return CVI_TDL_SUCCESS;
 }
 
@@ -202,16 +106,20 @@ int PPYoloE::inference(VIDEO_FRAME_INFO_S *srcFrame, cvtdl_object_t *obj_meta) {
 
 void PPYoloE::outputParser(const int image_width, const int image_height, const int frame_width,
                            const int frame_height, cvtdl_object_t *obj_meta) {
-  Detections vec_obj;
-  generate_ppyoloe_proposals(vec_obj, image_width, image_height);
+  arena_.reset();
+  decodeHeads<HeadConfig>(branches_, getDecodeParam(), &arena_);
 
-  // Do nms on output result
-  Detections final_dets = nms_multi_class(vec_obj, m_model_nms_threshold);
+  // Do nms on output result, boxes are already clipped to the input size
+  const std::vector<int> &keep = arena_.nms(m_model_nms_threshold);
 
   CVI_SHAPE shape = getInputShape(0);
 
-  convert_det_struct(final_dets, obj_meta, shape.dim[2], shape.dim[3],
-                     m_vpss_config[0].rescale_type);
+  arena_.exportObjects(keep, obj_meta, shape.dim[2], shape.dim[3]);
+  obj_meta->rescale_type = m_vpss_config[0].rescale_type;
+  for (uint32_t i = 0; i < obj_meta->size; ++i) {
+    const std::string &classname = coco_utils::class_names_91[obj_meta->info[i].classes];
+    strncpy(obj_meta->info[i].name, classname.c_str(), sizeof(obj_meta->info[i].name));
+  }
 
   if (!hasSkippedVpssPreprocess()) {
     for (uint32_t i = 0; i < obj_meta->size; ++i) {
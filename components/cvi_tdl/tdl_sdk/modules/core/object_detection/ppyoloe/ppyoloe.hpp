@@ -17,10 +17,16 @@ class PPYoloE final : public DetectionBase {
   int onModelOpened() override;
   void outputParser(const int image_width, const int image_height, const int frame_width,
                     const int frame_height, cvtdl_object_t *obj_meta);
-  void generate_ppyoloe_proposals(Detections &detections, int frame_width, int frame_height);
 
   std::vector<int> strides_;
   std::map<int, std::string> box_out_names_;
   std::map<int, std::string> class_out_names_;
+
+  typedef DetHeadConfig<DetLayout::CHANNEL_LAST, DetBoxCoding::LTRB, DetScoring::CLS_SIGMOID,
+                        DetClip::CLIP>
+      HeadConfig;
+  // tensors resolved in onModelOpened, one entry per stride
+  std::vector<DetHeadBranch> branches_;
+  DetCandidateArena arena_;
 };
 }  // namespace cvitdl
\ No newline at end of file
@@ -25,8 +25,7 @@ class YoloV10Detection final : public DetectionBase {
   void parseDecodeBranch(const int image_width, const int image_height, const int frame_width,
                          const int frame_height, cvtdl_object_t *obj_meta);
 
-  void decode_bbox_feature_map(int stride, int anchor_idx, std::vector<float> &decode_box);
-  void postProcess(Detections &dets, int frame_width, int frame_height, cvtdl_object_t *obj_meta);
+  void postProcess(int frame_width, int frame_height, cvtdl_object_t *obj_meta);
   std::map<std::string, std::string> out_names_;
 
   // if output seperate featuremap
@@ -36,5 +35,12 @@ class YoloV10Detection final : public DetectionBase {
   std::map<int, std::string> bbox_class_out_names;
   int m_box_channel_ = 0;
   int m_cls_channel_ = 0;
+
+  typedef DetHeadConfig<DetLayout::PLANAR, DetBoxCoding::DFL_LTRB, DetScoring::CLS_SIGMOID,
+                        DetClip::CLIP_MIN_SIZE>
+      HeadConfig;
+  // tensors resolved in onModelOpened, one entry per stride
+  std::vector<DetHeadBranch> branches_;
+  DetCandidateArena arena_;
 };
 }  // namespace cvitdl
@@ -17,11 +17,10 @@ class Yolov5 final : public DetectionBase {
  private:
   int onModelOpened() override;
 
-  void generate_yolov5_proposals(Detections &vec_obj);
+  void generate_yolov5_proposals();
   void outputParser(const int image_width, const int image_height, const int frame_width,
                     const int frame_height, cvtdl_object_t *obj_meta);
-  void Yolov5PostProcess(Detections &dets, int frame_width, int frame_height,
-                         cvtdl_object_t *obj_meta);
+  void Yolov5PostProcess(int frame_width, int frame_height, cvtdl_object_t *obj_meta);
 
   std::map<int, std::string> class_out_names_;
   std::map<int, std::string> conf_out_names_;
@@ -29,5 +28,12 @@ class Yolov5 final : public DetectionBase {
   std::vector<int> strides_;
   cvtdl_bbox_t yolo_box;
   bool roi_flag = false;
+
+  typedef DetHeadConfig<DetLayout::CHANNEL_LAST, DetBoxCoding::XYWH_ANCHOR,
+                        DetScoring::OBJ_X_CLS_SIGMOID, DetClip::CLIP_MIN_SIZE>
+      HeadConfig;
+  // tensors resolved in onModelOpened, one entry per stride
+  std::vector<DetHeadBranch> branches_;
+  DetCandidateArena arena_;
 };
 }  // namespace cvitdl
@@ -23,43 +23,8 @@
 
 namespace cvitdl {
 
-template <typename T>
-inline void parse_cls_info(T *p_cls_ptr, int num_cls, int anchor_idx, float qscale,
-                           float *p_max_logit, int *p_max_cls) {
-  int max_logit_c = -1;
-  float max_logit = -1000;
-  for (int c = 0; c < num_cls; c++) {
-    float logit = p_cls_ptr[num_cls * anchor_idx + c];
-    if (logit > max_logit) {
-      max_logit = logit;
-      max_logit_c = c;
-    }
-  }
-  *p_max_logit = max_logit * qscale;
-  *p_max_cls = max_logit_c;
-}
-
-float sigmoid(float x) { return 1.0 / (1.0 + exp(-x)); }
-
 int max_val(int x, int y) { return x > y ? x : y; }
 
-static void convert_det_struct(const Detections &dets, cvtdl_object_t *obj, int im_height,
-                               int im_width) {
-  CVI_TDL_MemAllocInit(dets.size(), obj);
-  obj->height = im_height;
-  obj->width = im_width;
-  memset(obj->info, 0, sizeof(cvtdl_object_info_t) * obj->size);
-
-  for (uint32_t i = 0; i < obj->size; ++i) {
-    obj->info[i].bbox.x1 = dets[i]->x1;
-    obj->info[i].bbox.y1 = dets[i]->y1;
-    obj->info[i].bbox.x2 = dets[i]->x2;
-    obj->info[i].bbox.y2 = dets[i]->y2;
-    obj->info[i].bbox.score = dets[i]->score;
-    obj->info[i].classes = dets[i]->label;
-  }
-}
-
 Yolov6::Yolov6() {
   // defalut param
 
@@ -139,6 +104,19 @@ int Yolov6::onModelOpened() {
     }
   }
 
+  branches_.clear();
+  int total_anchor = 0;
+  for (int stride : strides_) {
+    DetHeadBranch branch;
+    branch.box = getOutputTensorView(box_out_names_[stride], true);
+    branch.cls = getOutputTensorView(class_out_names_[stride], true);
+    branch.stride_x = input_shape.dim[3] / branch.box.feat_w;
+    branch.stride_y = input_shape.dim[2] / branch.box.feat_h;
+    branches_.push_back(branch);
+    total_anchor += branch.cls.num_anchor;
+  }
+  arena_.setCapacity(total_anchor);
+
   return CVI_TDL_SUCCESS;
 }
 
@@ -160,43 +138,6 @@ int Yolov6::inference(VIDEO_FRAME_INFO_S *srcFrame, cvtdl_object_t *obj_meta) {
   return CVI_TDL_SUCCESS;
 }
 
-void Yolov6::decode_bbox_feature_map(int stride, int anchor_idx, std::vector<float> &decode_box) {
-  std::string box_name = box_out_names_[stride];
-  TensorInfo boxinfo = getOutputTensorInfo(box_name);
-  CVI_SHAPE input_shape = getInputShape(0);
-  int box_val_num = 4;
-
-  int num_per_pixel = boxinfo.tensor_size / boxinfo.tensor_elem;
-  int8_t *p_box_int8 = static_cast<int8_t *>(boxinfo.raw_pointer);
-  float *p_box_float = static_cast<float *>(boxinfo.raw_pointer);
-
-  int32_t feat_w = boxinfo.shape.dim[1];
-  int32_t feat_h = boxinfo.shape.dim[2];
-
-  int stride_x = input_shape.dim[2] / feat_w;
-  int stride_y = input_shape.dim[3] / feat_h;
-
-  int anchor_y = anchor_idx / feat_w;
-  int anchor_x = anchor_idx % feat_w;
-
-  float grid_y = anchor_y + 0.5;
-  float grid_x = anchor_x + 0.5;
-
-  std::vector<float> box_vals;
-  for (int i = 0; i < box_val_num; i++) {
-    if (num_per_pixel == 1) {
-      box_vals.push_back(p_box_int8[anchor_idx * 4 + i] * boxinfo.qscale);
-    } else {
-      box_vals.push_back(p_box_float[anchor_idx * 4 + i]);
-    }
-  }
-
-  std::vector<float> box = {(grid_x - box_vals[0]) * stride_x, (grid_y - box_vals[1]) * stride_y,
-                            (grid_x + box_vals[2]) * stride_x, (grid_y + box_vals[3]) * stride_y};
-
-  decode_box = box;
-}
-
 void Yolov6::clip_bbox(int frame_width, int frame_height, cvtdl_bbox_t *bbox) {
   if (bbox->x1 < 0) {
     bbox->x1 = 0;
@@ -236,11 +177,10 @@ cvtdl_bbox_t Yolov6::boxRescale(int frame_width, int frame_height, int width, in
   return rescale_bbox;
 }
 
-void Yolov6::postProcess(Detections &dets, int frame_width, int frame_height,
-                         cvtdl_object_t *obj_meta) {
-  Detections final_dets = nms_multi_class(dets, m_model_nms_threshold);
+void Yolov6::postProcess(int frame_width, int frame_height, cvtdl_object_t *obj_meta) {
+  const std::vector<int> &keep = arena_.nms(m_model_nms_threshold);
   CVI_SHAPE shape = getInputShape(0);
-  convert_det_struct(final_dets, obj_meta, shape.dim[2], shape.dim[3]);
+  arena_.exportObjects(keep, obj_meta, shape.dim[2], shape.dim[3]);
   // rescale bounding box to original image
   if (!hasSkippedVpssPreprocess()) {
     for (uint32_t i = 0; i < obj_meta->size; ++i) {
@@ -254,50 +194,9 @@ void Yolov6::postProcess(Detections &dets, int frame_width, int frame_height,
 
 void Yolov6::outputParser(const int iamge_width, const int image_height, const int frame_width,
                           const int frame_height, cvtdl_object_t *obj_meta) {
-  Detections vec_obj;
-
-  float inverse_th = std::log(m_model_threshold / (1 - m_model_threshold));
-
-  for (size_t i = 0; i < strides_.size(); i++) {
-    int stride = strides_[i];
-    std::string cls_name = class_out_names_[stride];
-
-    TensorInfo classinfo = getOutputTensorInfo(cls_name);
-    int num_per_pixel = classinfo.tensor_size / classinfo.tensor_elem;
-    int8_t *p_cls_int8 = static_cast<int8_t *>(classinfo.raw_pointer);
-    float *p_cls_float = static_cast<float *>(classinfo.raw_pointer);
-
-    int num_cls = alg_param_.cls;
-    int num_anchor = classinfo.shape.dim[1] * classinfo.shape.dim[2];
-    float cls_qscale = num_per_pixel == 1 ? classinfo.qscale : 1;
-
-    for (int j = 0; j < num_anchor; j++) {
-      int max_logit_c = -1;
-      float max_logit = -1000;
-      if (num_per_pixel == 1) {
-        parse_cls_info<int8_t>(p_cls_int8, num_cls, j, cls_qscale, &max_logit, &max_logit_c);
-      } else {
-        parse_cls_info<float>(p_cls_float, num_cls, j, cls_qscale, &max_logit, &max_logit_c);
-      }
-      if (max_logit < inverse_th) {
-        continue;
-      }
-
-      float score = sigmoid(max_logit);
-      std::vector<float> box;
-      decode_bbox_feature_map(stride, j, box);
-
-      PtrDectRect det = std::make_shared<object_detect_rect_t>();
-      det->score = score;
-      det->x1 = box[0];
-      det->y1 = box[1];
-      det->x2 = box[2];
-      det->y2 = box[3];
-      det->label = max_logit_c;
-      vec_obj.push_back(det);
-    }
-  }
-  postProcess(vec_obj, frame_width, frame_height, obj_meta);
+  arena_.reset();
+  decodeHeads<HeadConfig>(branches_, getDecodeParam(), &arena_);
+  postProcess(frame_width, frame_height, obj_meta);
 }
 // namespace cvitdl
 }  // namespace cvitdl
\ No newline at end of file
@@ -15,11 +15,10 @@ class Yolov6 final : public DetectionBase {
  private:
   int onModelOpened() override;
 
-  void decode_bbox_feature_map(int stride, int anchor_idx, std::vector<float> &decode_box);
   void clip_bbox(int frame_width, int frame_height, cvtdl_bbox_t *bbox);
   cvtdl_bbox_t boxRescale(int frame_width, int frame_height, int width, int height,
                           cvtdl_bbox_t bbox);
-  void postProcess(Detections &dets, int frame_width, int frame_height, cvtdl_object_t *obj_meta);
+  void postProcess(int frame_width, int frame_height, cvtdl_object_t *obj_meta);
   void outputParser(const int image_width, const int image_height, const int frame_width,
                     const int frame_hegiht, cvtdl_object_t *obj_meta);
   int vpssPreprocess(VIDEO_FRAME_INFO_S *srcFrame, VIDEO_FRAME_INFO_S *dstFrame,
@@ -28,5 +27,12 @@ class Yolov6 final : public DetectionBase {
   std::map<int, std::string> class_out_names_;
   std::map<int, std::string> box_out_names_;
   std::vector<int> strides_;
+
+  typedef DetHeadConfig<DetLayout::CHANNEL_LAST, DetBoxCoding::LTRB, DetScoring::CLS_SIGMOID,
+                        DetClip::NONE>
+      HeadConfig;
+  // tensors resolved in onModelOpened, one entry per stride
+  std::vector<DetHeadBranch> branches_;
+  DetCandidateArena arena_;
 };
 }  // namespace cvitdl
\ No newline at end of file
@@ -13,10 +13,16 @@ class YoloV8Detection final : public DetectionBase {
   YoloV8Detection(PAIR_INT yolov8_pair);
   ~YoloV8Detection();
   int inference(VIDEO_FRAME_INFO_S *srcFrame, cvtdl_object_t *obj_meta) override;
+  int inferenceAsync(VIDEO_FRAME_INFO_S *srcFrame, cvtdl_object_t *obj_meta,
+                     const PipelineCallback &done) override;
   bool allowExportChannelAttribute() const override { return true; }
 
  private:
   int onModelOpened() override;
+  void onOutputsBound() override { resolveBranches(); }
+  // point branches_ at the current output tensors
+  void resolveBranches();
+  void parseOutputs(int frame_width, int frame_height, cvtdl_object_t *obj_meta);
 
   void outputParser(const int image_width, const int image_height, const int frame_width,
                     const int frame_height, cvtdl_object_t *obj_meta);
@@ -24,8 +30,7 @@ class YoloV8Detection final : public DetectionBase {
   void parseDecodeBranch(const int image_width, const int image_height, const int frame_width,
                          const int frame_height, cvtdl_object_t *obj_meta);
 
-  void decode_bbox_feature_map(int stride, int anchor_idx, std::vector<float> &decode_box);
-  void postProcess(Detections &dets, int frame_width, int frame_height, cvtdl_object_t *obj_meta);
+  void postProcess(int frame_width, int frame_height, cvtdl_object_t *obj_meta);
   std::map<std::string, std::string> out_names_;
 
   // if output seperate featuremap
@@ -34,5 +39,12 @@ class YoloV8Detection final : public DetectionBase {
   std::map<int, std::string> bbox_out_names;
   std::map<int, std::string> bbox_class_out_names;
   int m_box_channel_ = 64;
+
+  typedef DetHeadConfig<DetLayout::PLANAR, DetBoxCoding::DFL_LTRB, DetScoring::CLS_SIGMOID,
+                        DetClip::CLIP_MIN_SIZE>
+      HeadConfig;
+  // tensors resolved by resolveBranches, one entry per stride
+  std::vector<DetHeadBranch> branches_;
+  DetCandidateArena arena_;
 };
 }  // namespace cvitdl
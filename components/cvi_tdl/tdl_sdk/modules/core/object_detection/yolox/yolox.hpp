@@ -17,11 +17,17 @@ class YoloX final : public DetectionBase {
   int onModelOpened() override;
   void outputParser(const int image_width, const int image_height, const int frame_width,
                     const int frame_height, cvtdl_object_t *obj_meta);
-  void generate_yolox_proposals(Detections &detections);
 
   std::vector<int> strides_;
   std::map<int, std::string> class_out_names_;
   std::map<int, std::string> object_out_names_;
   std::map<int, std::string> box_out_names_;
+
+  typedef DetHeadConfig<DetLayout::CHANNEL_LAST, DetBoxCoding::XYWH_EXP,
+                        DetScoring::OBJ_X_CLS_SIGMOID, DetClip::CLIP_MIN_SIZE>
+      HeadConfig;
+  // tensors resolved in onModelOpened, one entry per stride
+  std::vector<DetHeadBranch> branches_;
+  DetCandidateArena arena_;
 };
 }  // namespace cvitdl
\ No newline at end of file
@@ -1,10 +1,11 @@
 #include "melspec.hpp"
+#include <algorithm>
 #include <iostream>
 #include "cvi_tdl_log.hpp"
 
 using namespace melspec;
 
-static Matrixf melfilter(int sr, int n_fft, int n_mels, int fmin, int fmax, bool htk) {
+Matrixf melspec::melfilter(int sr, int n_fft, int n_mels, int fmin, int fmax, bool htk) {
   int n_f = n_fft / 2 + 1;
   Vectorf fft_freqs = (Vectorf::LinSpaced(n_f, 0.f, static_cast<float>(n_f - 1)) * sr) / n_fft;
 
@@ -56,7 +57,8 @@ static Matrixf melfilter(int sr, int n_fft, int n_mels, int fmin, int fmax, bool
   return weights.transpose();
 }
 
-void quant_feat(float *p_feat_src, float q_scale, int len, float logmin_val, int8_t *p_feat_quant) {
+void quant_feat(const float *p_feat_src, float q_scale, int len, float logmin_val,
+                int8_t *p_feat_quant) {
   for (int i = 0; i < len; i++) {
     float v = p_feat_src[i];
     if (logmin_val != 0) {
@@ -75,10 +77,159 @@ void quant_feat(float *p_feat_src, float q_scale, int len, float logmin_val, int
   }
 }
 
+void melspec::quant_mel_frames(const float *const *p_frames, int n_frames, int n_mel,
+                               int8_t *p_dst, float q_scale, bool fixed, float logmin_val,
+                               float eps, float s, float alpha, float delta, float r) {
+  if (!fixed) {
+    for (int i = 0; i < n_frames; i++) {
+      quant_feat(p_frames[i], q_scale, n_mel, logmin_val, p_dst + i * n_mel);
+    }
+    return;
+  }
+
+  // pcen, the smoothed state starts from the first frame of the window
+  std::vector<float> state(p_frames[0], p_frames[0] + n_mel);
+  std::vector<float> pcen(n_mel);
+  float pcen_bias = powf(delta, r);
+  for (int i = 0; i < n_frames; i++) {
+    const float *p_mel = p_frames[i];
+    for (int n = 0; n < n_mel; n++) {
+      if (i != 0) state[n] = (1 - s) * state[n] + s * p_mel[n];
+      pcen[n] = powf(p_mel[n] / powf(state[n] + eps, alpha) + delta, r) - pcen_bias;
+    }
+    quant_feat(pcen.data(), q_scale, n_mel, 0, p_dst + i * n_mel);
+  }
+}
+
+MelStreamExtract::MelStreamExtract(int sr, int n_fft, int n_hop, int n_mel, int fmin, int fmax,
+                                   bool htk, int ring_frames)
+    : num_fft_(n_fft), num_hop_(n_hop), num_mel_(n_mel), ring_frames_(ring_frames) {
+  int n_f = n_fft / 2 + 1;
+  fft_.init(n_fft);
+  window_.resize(n_fft);
+  for (int i = 0; i < n_fft; i++) {
+    window_[i] = 0.5f * (1.f - cosf(i * 2.f * M_PI / n_fft));
+  }
+  pending_.resize(n_fft);
+  frame_buf_.resize(n_fft);
+  fft_re_.resize(n_f);
+  fft_im_.resize(n_f);
+  power_.resize(n_f);
+  ring_.resize(ring_frames * n_mel);
+  rows_.resize(ring_frames);
+
+  // each filter is a triangle over a few bins, keep only its non-zero span
+  Matrixf basis = melfilter(sr, n_fft, n_mel, fmin, fmax, htk);
+  mel_bin_.resize(n_mel);
+  mel_len_.resize(n_mel);
+  mel_offset_.resize(n_mel);
+  for (int m = 0; m < n_mel; m++) {
+    int first = 0, last = -1;
+    for (int k = 0; k < n_f; k++) {
+      if (basis(k, m) != 0) {
+        if (last < 0) first = k;
+        last = k;
+      }
+    }
+    mel_bin_[m] = first;
+    mel_len_[m] = last - first + 1;
+    mel_offset_[m] = mel_weight_.size();
+    for (int k = first; k <= last; k++) {
+      mel_weight_.push_back(basis(k, m));
+    }
+  }
+}
+
+void MelStreamExtract::reset() {
+  num_frames_ = 0;
+  pending_len_ = 0;
+}
+
+void MelStreamExtract::compute_frame(const float *p_samples, float *p_mel) {
+  int n_f = num_fft_ / 2 + 1;
+  for (int i = 0; i < num_fft_; i++) {
+    frame_buf_[i] = p_samples[i] * window_[i];
+  }
+  fft_.fft(frame_buf_.data(), fft_re_.data(), fft_im_.data());
+  for (int k = 0; k < n_f; k++) {
+    power_[k] = fft_re_[k] * fft_re_[k] + fft_im_[k] * fft_im_[k];
+  }
+  for (int m = 0; m < num_mel_; m++) {
+    const float *p_power = power_.data() + mel_bin_[m];
+    const float *p_weight = mel_weight_.data() + mel_offset_[m];
+    float sum = 0;
+    for (int k = 0; k < mel_len_[m]; k++) {
+      sum += p_power[k] * p_weight[k];
+    }
+    p_mel[m] = sum;
+  }
+}
+
+void MelStreamExtract::compute_reflect_frame(const short *p_data, int data_len, int start,
+                                             float *p_mel) {
+  const float scale = 1.0 / 32768.0;
+  for (int j = 0; j < num_fft_; j++) {
+    int srcidx = start + j;
+    if (srcidx < 0) {
+      srcidx = -srcidx;
+    } else if (srcidx >= data_len) {
+      int over = srcidx - data_len;
+      srcidx = data_len - over - 2;
+    }
+    frame_buf_[j] = p_data[srcidx] * scale;
+  }
+  compute_frame(frame_buf_.data(), p_mel);
+}
+
+void MelStreamExtract::push(const short *p_data, int data_len) {
+  const float scale = 1.0 / 32768.0;
+  while (data_len > 0) {
+    int n = std::min(data_len, num_fft_ - pending_len_);
+    float *p_pending = pending_.data() + pending_len_;
+    for (int i = 0; i < n; i++) {
+      p_pending[i] = p_data[i] * scale;
+    }
+    pending_len_ += n;
+    p_data += n;
+    data_len -= n;
+
+    if (pending_len_ == num_fft_) {
+      compute_frame(pending_.data(), ring_.data() + (num_frames_ % ring_frames_) * num_mel_);
+      num_frames_++;
+      memmove(pending_.data(), pending_.data() + num_hop_,
+              (num_fft_ - num_hop_) * sizeof(pending_[0]));
+      pending_len_ -= num_hop_;
+    }
+  }
+}
+
+const float *MelStreamExtract::frame(int64_t k) const {
+  if (k < 0 || k >= num_frames_ || k < num_frames_ - ring_frames_) {
+    return nullptr;
+  }
+  return ring_.data() + (k % ring_frames_) * num_mel_;
+}
+
+int MelStreamExtract::output(int8_t *p_dst, int dst_len, float q_scale, bool fixed, float eps,
+                             float s, float alpha, float delta, float r) {
+  int n_frames = dst_len / num_mel_;
+  if (n_frames > num_frames_ || n_frames > ring_frames_) {
+    return -1;
+  }
+  for (int i = 0; i < n_frames; i++) {
+    rows_[i] = frame(num_frames_ - n_frames + i);
+  }
+  quant_mel_frames(rows_.data(), n_frames, num_mel_, p_dst, q_scale, fixed, 1.0e-6, eps, s, alpha,
+                   delta, r);
+  return 0;
+}
+
 MelFeatureExtract::MelFeatureExtract(int num_frames, int sr, int n_fft, int n_hop, int n_mel,
                                      int fmin, int fmax, const std::string &mode, bool htk,
                                      bool center /*=true*/, int power /*=2*/,
-                                     bool is_log /*=true*/) {
+                                     bool is_log /*=true*/)
+    : stream_(sr, n_fft, n_hop, n_mel, fmin, fmax, htk,
+              1 + (num_frames + (center ? n_fft / 2 * 2 : 0) - n_fft) / n_hop) {
   num_wav_len_ = num_frames;
   num_fft_ = n_fft;
   num_mel_ = n_mel;
@@ -91,21 +242,9 @@ MelFeatureExtract::MelFeatureExtract(int num_frames, int sr, int n_fft, int n_ho
   mode_ = mode;
   int pad_len = center ? n_fft / 2 : 0;
   pad_len_ = pad_len;
-
-  window_ =
-      0.5 *
-      (1.f - (Vectorf::LinSpaced(n_fft, 0.f, static_cast<float>(n_fft - 1)) * 2.f * M_PI / n_fft)
-                 .array()
-                 .cos());
-  mel_basis_ = melfilter(sr, n_fft, n_mel, fmin, fmax, htk);
   is_log_ = is_log;
 }
-MelFeatureExtract::~MelFeatureExtract() {
-  if (mp_sft_mag_vec_ != nullptr) {
-    delete mp_sft_mag_vec_;
-    mp_sft_mag_vec_ = nullptr;
-  }
-}
+MelFeatureExtract::~MelFeatureExtract() {}
 void MelFeatureExtract::pad(Vectorf &x, int left, int right, const std::string &mode, float value) {
   // Vectorf x_pad_ = Vectorf::Constant(left+x.size()+right, value);
   if (x_pad_.size() == 0) {
@@ -252,100 +391,22 @@ void MelFeatureExtract::melspectrogram_optimze(short *p_data, int data_len, int8
                                                int dst_len, float q_scale, bool fix, float eps,
                                                float s, float alpha, float delta, float r) {
   int pad_len = center_ ? num_fft_ / 2 : 0;
-
-  int n_f = num_fft_ / 2 + 1;
   int padded_len = data_len + 2 * pad_len;
   int n_frames = 1 + (padded_len - num_fft_) / num_hop_;
-
-  Eigen::FFT<float> fft;
-  melspec::Vectorf segment(num_fft_);
-  melspec::Vectorf specmag(n_f);
-  melspec::Vectorf last_state(num_mel_);
-
-  const float scale = 1.0 / 32768.0;
-  for (int i = 0; i < n_frames; ++i) {
-    int start_idx = i * num_hop_;
-    for (int j = 0; j < num_fft_; j++) {
-      int srcidx = start_idx + j - pad_len;
-      if (srcidx < 0) {
-        srcidx = -srcidx;
-      } else if (srcidx >= data_len) {
-        int over = srcidx - data_len;
-        srcidx = data_len - over - 2;
-      }
-      segment[j] = p_data[srcidx] * scale;  // TODO:fuquan.ke this could be optimized
-    }
-    melspec::Vectorf x_frame = window_.array() * segment.array();
-    melspec::Vectorcf spec_ri = fft.fwd(x_frame);
-    // compute mag
-    melspec::Vectorf specmag = spec_ri.leftCols(n_f).cwiseAbs().array().pow(2);
-
-    int8_t *pdst_r = p_dst + i * num_mel_;
-    melspec::Vectorf rowv = specmag * mel_basis_;
-
-    if (fix) {  // use pcen
-
-      if (i == 0) {
-        last_state = rowv;
-      } else {
-        last_state = (1 - s) * last_state + s * rowv;
-      }
-
-      melspec::Vectorf pcen_data =
-          (rowv.array() / (last_state.array() + eps).pow(alpha) + delta).pow(r) - pow(delta, r);
-
-      for (int n = 0; n < num_mel_; n++) {
-        int16_t qval = pcen_data[n] * q_scale;
-
-        if (qval < -128) {
-          qval = -128;
-        } else if (qval > 127) {
-          qval = 127;
-        }
-        pdst_r[n] = qval;
-      }
-    } else {
-      for (int n = 0; n < num_mel_; n++) {
-        float v = rowv[n];
-        if (v < min_val_) v = min_val_;
-        if (is_log_) {
-          v = 10 * log10f(v);
-        }
-        int16_t qval = v * q_scale;
-        if (qval < -128) {
-          // std::cout<<"overflow qval:"<<qval<<std::endl;
-          qval = -128;
-        } else if (qval > 127) {
-          // std::cout<<"overflow qval:"<<qval<<std::endl;
-          qval = 127;
-        }
-        pdst_r[n] = qval;
-      }
-    }
+  if (n_frames * num_mel_ > dst_len) {
+    LOGE("mel output size error, frames:%d, dst_len:%d\n", n_frames, dst_len);
+    return;
   }
-}
 
-std::map<float, int> MelFeatureExtract::generate_seg_pack_idx(int pack_idx, int pack_len,
-                                                              int hop_len, int wav_len) {
-  std::map<float, int> pack_seg_map;
-  if (pack_idx == -1) {
-    return pack_seg_map;
-  }
-  int pad_len = center_ ? num_fft_ / 2 : 0;
-  int padded_len = num_wav_len_ + 2 * pad_len;
-  int n_frames = 1 + (padded_len - num_fft_) / num_hop_;
-  float packf = pack_len;  // to process the case num_hop less than pack_len
-  // std::cout<<"pack:"<<pack_idx<<",";
+  mel_frames_.resize(n_frames * num_mel_);
+  rows_.resize(n_frames);
   for (int i = 0; i < n_frames; ++i) {
-    int start_idx = i * num_hop_ - pad_len;
-    if (start_idx < 0 || start_idx + num_fft_ >= num_wav_len_) continue;
-    float seg_pack_idx = start_idx / packf + pack_idx;
-
-    pack_seg_map[seg_pack_idx] = i;
-    // std::cout<<i<<":"<<seg_pack_idx<<",";
+    float *p_mel = mel_frames_.data() + i * num_mel_;
+    stream_.compute_reflect_frame(p_data, data_len, i * num_hop_ - pad_len, p_mel);
+    rows_[i] = p_mel;
   }
-  // std::cout<<"\n";
-  return pack_seg_map;
+  quant_mel_frames(rows_.data(), n_frames, num_mel_, p_dst, q_scale, fix,
+                   is_log_ ? min_val_ : 0, eps, s, alpha, delta, r);
 }
 
 int MelFeatureExtract::melspectrogram_pack_optimize(short *p_data, int data_len, int pack_len,
@@ -365,110 +426,47 @@ int MelFeatureExtract::melspectrogram_pack_optimize(short *p_data, int data_len,
     return -1;
   }
 
-  std::map<float, int> last_seg_pack =
-      generate_seg_pack_idx(last_pack_idx_, pack_len, num_hop_, num_wav_len_);
-  std::map<float, int> cur_seg_pack =
-      generate_seg_pack_idx(start_pack_idx, pack_len, num_hop_, num_wav_len_);
-
-  std::map<int, int> seg_map;
-  for (auto iter = cur_seg_pack.begin(); iter != cur_seg_pack.end(); ++iter) {
-    float pack_idx = iter->first;
-    int seg_idx = iter->second;
-    if (last_seg_pack.count(pack_idx)) {
-      seg_map[seg_idx] = last_seg_pack[pack_idx];
-    }
-  }
-  int num_copy_frame = 0;
-  // copy segment feature from previous frame
-  for (auto iter = seg_map.begin(); iter != seg_map.end(); ++iter) {
-    int cur_seg = iter->first;
-    int prev_seg = iter->second;
-    if (cur_seg > prev_seg) {
-      printf("error, current seg:%d,prev seg:%d\n", cur_seg, prev_seg);
-      return -1;
-    }
-
-    if (fix) {  // update sft mag vec
-      float *p_cur_mag = mp_sft_mag_vec_ + cur_seg * num_mel_;
-      float *p_prev_mag = mp_sft_mag_vec_ + prev_seg * num_mel_;
-      memcpy(p_cur_mag, p_prev_mag, num_mel_ * sizeof(p_prev_mag[0]));
-    } else {
-      int8_t *p_cur_seg = p_dst + cur_seg * num_mel_;
-      int8_t *p_prev_seg = p_dst + prev_seg * num_mel_;
-      memcpy(p_cur_seg, p_prev_seg, num_mel_ * sizeof(p_dst[0]));
-      num_copy_frame += 1;
-    }
-  }
-
   int pad_len = center_ ? num_fft_ / 2 : 0;
-  int n_f = num_fft_ / 2 + 1;
   int padded_len = num_wav_len_ + 2 * pad_len;
   int n_frames = 1 + (padded_len - num_fft_) / num_hop_;
-  if (fix && mp_sft_mag_vec_ == nullptr) {
-    mp_sft_mag_vec_ = new float[n_frames * num_mel_];
+  if (n_frames * num_mel_ > dst_len) {
+    printf("error,mel frames:%d,dst_len:%d\n", n_frames, dst_len);
+    return -1;
   }
 
-  melspec::Vectorf segment(num_fft_);
-  melspec::Vectorf specmag(n_f);
-  const float scale = 1.0 / 32768.0;
-  melspec::Vectorf last_state(num_mel_);
-  float pcen_bias = pow(delta, r);
+  // frames inside the window come from the stream, which only takes the packs not seen yet;
+  // it starts at the first frame that needs no padding
+  int first = (pad_len + num_hop_ - 1) / num_hop_ * num_hop_ - pad_len;
+  int64_t window_pos = (int64_t)start_pack_idx * pack_len;
+  int64_t shift = (int64_t)(start_pack_idx - last_pack_idx_) * pack_len;
+  if (last_pack_idx_ == -1 || shift <= 0 || shift > num_wav_len_) {
+    stream_.reset();
+    stream_.push(p_data + first, num_wav_len_ - first);
+    stream_origin_ = window_pos + first;
+  } else {
+    stream_.push(p_data + num_wav_len_ - shift, shift);
+  }
 
-  int num_skip = 0;
+  mel_frames_.resize(n_frames * num_mel_);
+  rows_.resize(n_frames);
   for (int i = 0; i < n_frames; ++i) {
-    int8_t *pdst_r = p_dst + i * num_mel_;
-    if (seg_map.count(i)) {
-      if (fix) {
-        Eigen::Map<Eigen::Matrix<float, 1, Eigen::Dynamic, Eigen::RowMajor>> rowv(
-            mp_sft_mag_vec_ + i * num_mel_, 1, num_mel_);
-        last_state = (1 - s) * last_state + s * rowv;
-        melspec::Vectorf pcen_data =
-            (rowv.array() / (last_state.array() + eps).pow(alpha) + delta).pow(r) - pcen_bias;
-        quant_feat(pcen_data.data(), q_scale, num_mel_, 0, pdst_r);
-      }
-
-      num_skip += 1;
-      continue;
-    }
-    int start_idx = i * num_hop_;
-    for (int j = 0; j < num_fft_; j++) {
-      int srcidx = start_idx + j - pad_len;
-      if (srcidx < 0) {
-        srcidx = -srcidx;
-      } else if (srcidx >= num_wav_len_) {
-        int over = srcidx - num_wav_len_;
-        srcidx = num_wav_len_ - over - 2;
-      }
-      segment[j] = p_data[srcidx] * scale;  // TODO:fuquan.ke this could be optimized
-    }
-
-    melspec::Vectorf x_frame = window_.array() * segment.array();
-    melspec::Vectorcf spec_ri = fft_.fwd(x_frame);
-    // compute mag
-    melspec::Vectorf specmag = spec_ri.leftCols(n_f).cwiseAbs().array().pow(2);
-
-    if (fix) {
-      Eigen::Map<Eigen::Matrix<float, 1, Eigen::Dynamic, Eigen::RowMajor>> rowv(
-          mp_sft_mag_vec_ + i * num_mel_, 1, num_mel_);
-      rowv = specmag * mel_basis_;
-      // memcpy(mp_sft_mag_vec_ + i * num_mel_, rowv.data(), sizeof(mp_sft_mag_vec_[0]) * num_mel_);
-      if (i == 0) {
-        last_state = rowv;
-      } else {
-        last_state = (1 - s) * last_state + s * rowv;
-      }
-
-      melspec::Vectorf pcen_data =
-          (rowv.array() / (last_state.array() + eps).pow(alpha) + delta).pow(r) - pcen_bias;
-
-      quant_feat(pcen_data.data(), q_scale, num_mel_, 0, pdst_r);
-    } else {
-      melspec::Vectorf rowv = specmag * mel_basis_;
-      quant_feat(rowv.data(), q_scale, num_mel_, min_val_, pdst_r);
+    int start_idx = i * num_hop_ - pad_len;
+    const float *p_mel = nullptr;
+    if (start_idx >= 0 && start_idx + num_fft_ <= num_wav_len_) {
+      p_mel = stream_.frame((window_pos + start_idx - stream_origin_) / num_hop_);
+    }
+    if (p_mel == nullptr) {
+      float *p_edge = mel_frames_.data() + i * num_mel_;
+      stream_.compute_reflect_frame(p_data, num_wav_len_, start_idx, p_edge);
+      p_mel = p_edge;
     }
+    rows_[i] = p_mel;
   }
+  quant_mel_frames(rows_.data(), n_frames, num_mel_, p_dst, q_scale, fix, min_val_, eps, s, alpha,
+                   delta, r);
+
   last_pack_idx_ = start_pack_idx;
   last_pack_len_ = pack_len;
 
   return 0;
-}
\ No newline at end of file
+}
@@ -1,7 +1,7 @@
 
-#include <map>
 #include <string>
 #include <vector>
+#include "ESCFFT.hpp"
 #include "Eigen/Core"
 #include "unsupported/Eigen/FFT"
 namespace melspec {
@@ -15,6 +15,78 @@ typedef Eigen::Matrix<std::complex<float>, 1, Eigen::Dynamic, Eigen::RowMajor> V
 typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> Matrixf;
 typedef Eigen::Matrix<std::complex<float>, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
     Matrixcf;
+
+/**
+ * @brief Mel power frames of an audio stream. Samples are pushed as they arrive and every
+ * completed hop adds one frame to a ring, so a sliding window costs one frame per hop instead of
+ * the whole window. Frames use a real fft over a precomputed hann window and sparse mel rows.
+ */
+class MelStreamExtract {
+ public:
+  MelStreamExtract(int sr, int n_fft, int n_hop, int n_mel, int fmin, int fmax, bool htk,
+                   int ring_frames);
+
+  void reset();
+  /**
+   * @brief append samples, frame k covers samples [k * n_hop, k * n_hop + n_fft) of the stream
+   */
+  void push(const short *p_data, int data_len);
+  // frames computed since reset
+  int64_t num_frames() const { return num_frames_; }
+  // mel power of frame k, null if it is not computed yet or left the ring
+  const float *frame(int64_t k) const;
+
+  /**
+   * @brief mel power of the frame of p_data starting at start, samples outside the data are
+   * reflected as the center padding does
+   */
+  void compute_reflect_frame(const short *p_data, int data_len, int start, float *p_mel);
+  void compute_frame(const float *p_samples, float *p_mel);
+
+  /**
+   * @brief quantize the latest dst_len / n_mel frames in time order into p_dst, log mel or pcen
+   * when fixed
+   * @return 0 on success, -1 if fewer frames are in the ring
+   */
+  int output(int8_t *p_dst, int dst_len, float q_scale, bool fixed = false, float eps = 1E-6,
+             float s = 0.025, float alpha = 0.98, float delta = 2, float r = 0.5);
+
+  int num_mel() const { return num_mel_; }
+
+ private:
+  int num_fft_;
+  int num_hop_;
+  int num_mel_;
+  int ring_frames_;
+  int64_t num_frames_ = 0;
+  int pending_len_ = 0;
+
+  ESCFFT fft_;
+  std::vector<float> window_;
+  std::vector<float> pending_;  // samples of the next frame
+  std::vector<float> frame_buf_;
+  std::vector<float> fft_re_;
+  std::vector<float> fft_im_;
+  std::vector<float> power_;
+  // non-zero span of each mel filter: first fft bin, bin count, offset in mel_weight_
+  std::vector<int> mel_bin_;
+  std::vector<int> mel_len_;
+  std::vector<int> mel_offset_;
+  std::vector<float> mel_weight_;
+  std::vector<float> ring_;  // ring_frames x n_mel
+  std::vector<const float *> rows_;
+};
+
+// mel filter bank, n_fft / 2 + 1 rows by n_mels columns
+Matrixf melfilter(int sr, int n_fft, int n_mels, int fmin, int fmax, bool htk);
+
+/**
+ * @brief log mel (or pcen when fixed) of mel power frames, quantized in place into p_dst
+ */
+void quant_mel_frames(const float *const *p_frames, int n_frames, int n_mel, int8_t *p_dst,
+                      float q_scale, bool fixed, float logmin_val, float eps, float s, float alpha,
+                      float delta, float r);
+
 class MelFeatureExtract {
  public:
   MelFeatureExtract(int num_frames, int sr, int n_fft, int n_hop, int n_mel, int fmin, int fmax,
@@ -31,13 +103,6 @@ class MelFeatureExtract {
                               float alpha = 0.98, float delta = 2, float r = 0.5);
   void pad(Vectorf &x, int left, int right, const std::string &mode, float value);
 
-  /**
-   * @brief generate pack index for each segment of this frame
-   * @param pack_idx start pack index of this frame
-   * @return std::map<float,int>
-   */
-  std::map<float, int> generate_seg_pack_idx(int pack_idx, int pack_len, int hop_len, int wav_len);
-
   /**
    * @brief opitmize implementation for pack version
    * @param pack_len the input data(p_data) is combined with many packs,each with size equal
@@ -52,15 +117,15 @@ class MelFeatureExtract {
 
  private:
   // float *mp_buffer;
-  Matrixf mel_basis_;
   Vectorf x_pad_;
-  Vectorf window_;
 
   int num_wav_len_;  // data length used to extract mel feature
   int last_pack_idx_ = -1;
   int last_pack_len_ = -1;
-  float *mp_sft_mag_vec_ = nullptr;  // num_frame x num_mel_
-  Eigen::FFT<float> fft_;
+  MelStreamExtract stream_;        // frames of the packs, ring of one window
+  int64_t stream_origin_ = 0;      // sample position of stream frame 0, counted in packs
+  std::vector<float> mel_frames_;  // frames computed outside the stream, num_frame x num_mel_
+  std::vector<const float *> rows_;
 
   int num_fft_;
   int win_len_;
@@ -1,14 +1,12 @@
-
 #include "ccl.hpp"
 #include <stdint.h>
 #include <algorithm>
+#include <climits>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <vector>
 #include "cvi_tdl_log.hpp"
-#define CC_MAX_NUM_LABELS 200
-#define MAX_CC_OBJECTS 200
 
 #define CC_SUPER_PIXEL_H 2
 #define CC_SUPER_PIXEL_W 2
@@ -16,69 +14,155 @@
 #define CC_SCAN_WINDOW_W 2
 #define CC_FG_SUPER_PIX_THD 3
 #define BLOCK_SIZE 2
+// cells per side of the grid used to find the boxes a box intersects
+#define CC_BOX_GRID_CELLS 16
+
+namespace cvitdl {
+
+// first byte of [x, width) that is (or is not, when fg is false) foreground
+static inline int scan_row(const unsigned char *p_row, int x, int width, bool fg) {
+  const uint64_t ones = 0x0101010101010101ULL;
+  const uint64_t highs = 0x8080808080808080ULL;
+  for (; x + 8 <= width; x += 8) {
+    uint64_t v;
+    memcpy(&v, p_row + x, sizeof(v));
+    // looking for foreground: skip all-zero words; for background: skip words without a zero byte
+    bool skip = fg ? v == 0 : ((v - ones) & ~v & highs) == 0;
+    if (!skip) break;
+  }
+  while (x < width && (p_row[x] != 0) != fg) x++;
+  return x;
+}
 
-typedef struct CCTag {
-  int maskWidth;
-  int maskHeight;
-  int ccSuperPixelSize;
-  int superPixMapW;
-  int superPixMapH;
+void CCLEngine::extract_runs(const unsigned char *p_map, int width, int height, int stride) {
+  row_begin_.resize(height + 1);
+  run_x1_.clear();
+  run_x2_.clear();
+  run_y_.clear();
+  for (int y = 0; y < height; y++) {
+    const unsigned char *p_row = p_map + static_cast<size_t>(y) * stride;
+    row_begin_[y] = static_cast<int>(run_x1_.size());
+    int x = 0;
+    while ((x = scan_row(p_row, x, width, true)) < width) {
+      int x2 = scan_row(p_row, x + 1, width, false);
+      run_x1_.push_back(x);
+      run_x2_.push_back(x2);
+      run_y_.push_back(y);
+      x = x2;
+    }
+  }
+  row_begin_[height] = static_cast<int>(run_x1_.size());
+}
+
+template <typename LabelT>
+static inline LabelT find_root(std::vector<LabelT> &parent, LabelT i) {
+  while (parent[i] != i) {
+    parent[i] = parent[parent[i]];  // path halving
+    i = parent[i];
+  }
+  return i;
+}
+
+template <typename LabelT>
+void CCLEngine::resolve(std::vector<LabelT> &parent) {
+  int num_runs = static_cast<int>(run_x1_.size());
+  int height = static_cast<int>(row_begin_.size()) - 1;
+  parent.resize(num_runs);
+  for (int k = 0; k < num_runs; k++) parent[k] = static_cast<LabelT>(k);
+
+  // union each run with the runs of the row above it touches, diagonals included
+  for (int y = 1; y < height; y++) {
+    int j = row_begin_[y - 1], j_end = row_begin_[y];
+    for (int k = row_begin_[y]; k < row_begin_[y + 1]; k++) {
+      while (j < j_end && run_x2_[j] < run_x1_[k]) j++;
+      for (int m = j; m < j_end && run_x1_[m] <= run_x2_[k]; m++) {
+        LabelT a = find_root(parent, static_cast<LabelT>(k));
+        LabelT b = find_root(parent, static_cast<LabelT>(m));
+        if (a < b) {
+          parent[b] = a;
+        } else if (b < a) {
+          parent[a] = b;
+        }
+      }
+    }
+  }
 
-  int numTotalObj;
+  // roots are the smallest run of their component, so components number in raster order
+  run_comp_.resize(num_runs);
+  components_.clear();
+  sum_x_.clear();
+  sum_y_.clear();
+  for (int k = 0; k < num_runs; k++) {
+    LabelT root = find_root(parent, static_cast<LabelT>(k));
+    int comp;
+    int len = run_x2_[k] - run_x1_[k];
+    if (root == static_cast<LabelT>(k)) {
+      comp = static_cast<int>(components_.size());
+      CCLComponent c;
+      c.area = 0;
+      c.y1 = c.y2 = run_y_[k];
+      c.x1 = run_x1_[k];
+      c.x2 = run_x2_[k] - 1;
+      components_.push_back(c);
+      sum_x_.push_back(0);
+      sum_y_.push_back(0);
+    } else {
+      comp = run_comp_[root];
+      CCLComponent &c = components_[comp];
+      c.y2 = run_y_[k];
+      c.x1 = std::min(c.x1, run_x1_[k]);
+      c.x2 = std::max(c.x2, run_x2_[k] - 1);
+    }
+    run_comp_[k] = comp;
+    components_[comp].area += len;
+    sum_x_[comp] += 0.5 * (run_x1_[k] + run_x2_[k] - 1) * len;
+    sum_y_[comp] += static_cast<double>(run_y_[k]) * len;
+  }
+  for (size_t i = 0; i < components_.size(); i++) {
+    components_[i].cx = static_cast<float>(sum_x_[i] / components_[i].area);
+    components_[i].cy = static_cast<float>(sum_y_[i] / components_[i].area);
+  }
+}
 
-  int maxID;
+const std::vector<CCLComponent> &CCLEngine::label(const unsigned char *p_map, int width,
+                                                  int height, int stride) {
+  extract_runs(p_map, width, height, stride);
+  if (run_x1_.size() <= 0xFFFF) {
+    resolve(parent16_);
+  } else {
+    resolve(parent32_);
+  }
+  return components_;
+}
+
+}  // namespace cvitdl
 
-  unsigned char *dataSuperPixMap;
-  unsigned char *dataSuperPixFG;
-  unsigned char *eqCCLabelArray;
+typedef struct CCTag {
+  int maskWidth = 0;
+  int maskHeight = 0;
+  int superPixMapW = 0;
+  int superPixMapH = 0;
 
-  int numObjects;
-  int *boundingBoxesTmp;
-  int *boundingBoxes;
+  std::vector<unsigned char> dataSuperPixMap;
+  std::vector<unsigned char> dataSuperPixFG;
+  std::vector<unsigned short> colSum;
 
+  cvitdl::CCLEngine engine;
+  std::vector<int> boundingBoxes;
 } CCLType;
 
-void *create_connect_instance() {
-  CCLType *p_inst = new CCLType();
-  memset(p_inst, 0, sizeof(CCLType));
-  return p_inst;
-}
+void *create_connect_instance() { return new CCLType(); }
 
 void init_connected_component(CCLType *ccGst, int width, int height) {
-  int superPixMapW, superPixMapH;
-
   ccGst->maskWidth = width;
   ccGst->maskHeight = height;
 
   ccGst->superPixMapW = width / CC_SUPER_PIXEL_W;
   ccGst->superPixMapH = height / CC_SUPER_PIXEL_H;
 
-  superPixMapW = ccGst->superPixMapW;
-  superPixMapH = ccGst->superPixMapH;
-
-  ccGst->dataSuperPixMap = new unsigned char[superPixMapW * superPixMapH];
-
-  memset(ccGst->dataSuperPixMap, 0, superPixMapH * superPixMapW);
-
-  ccGst->dataSuperPixFG = new unsigned char[superPixMapH * superPixMapW];
-  memset(ccGst->dataSuperPixFG, 0, superPixMapH * superPixMapW);
-
-  ccGst->eqCCLabelArray = new unsigned char[CC_MAX_NUM_LABELS + 1];
-
-  ccGst->boundingBoxesTmp = new int[MAX_CC_OBJECTS * 5];
-  ccGst->boundingBoxes = new int[MAX_CC_OBJECTS * 5];
-}
-
-void release_connected_component(CCLType *ccGst) {
-  if (ccGst->maskWidth > 0 && ccGst->maskHeight > 0) {
-    delete[] ccGst->dataSuperPixMap;
-    delete[] ccGst->dataSuperPixFG;
-    delete[] ccGst->eqCCLabelArray;
-    delete[] ccGst->boundingBoxesTmp;
-    delete[] ccGst->boundingBoxes;
-  }
-
-  memset(ccGst, 0, sizeof(CCLType));
+  ccGst->dataSuperPixMap.assign(ccGst->superPixMapW * ccGst->superPixMapH, 0);
+  ccGst->dataSuperPixFG.assign(ccGst->superPixMapW * ccGst->superPixMapH, 0);
+  ccGst->colSum.assign(ccGst->superPixMapW, 0);
 }
 
 bool cluster_box(int *p_boxes, int ci, int i) {
@@ -105,49 +189,91 @@ bool cluster_box(int *p_boxes, int ci, int i) {
   p_boxes[5 * ci + 4] = out_C1;
   return true;
 }
+
+/*
+ * Going from the largest box down, each box is merged into the first larger box still alive it
+ * intersects. The larger boxes are kept in a coarse grid so only those sharing a cell are tested,
+ * a box that grows by a merge is added to the cells it newly covers.
+ */
 int filter_inside_boxes(int *p_boxes, int num_src) {
+  if (num_src <= 1) return num_src;
+
   // sort with box area
-  struct area_info {
-    int area;
-    int index;
-  };
-  std::vector<area_info> box_areas;
+  std::vector<int> order(num_src);
+  std::vector<int> box_area(num_src);
+  int max_r = 1, max_c = 1;
   for (int i = 0; i < num_src; i++) {
     int R0 = p_boxes[5 * i + 1];
     int C0 = p_boxes[5 * i + 2];
     int R1 = p_boxes[5 * i + 3];
     int C1 = p_boxes[5 * i + 4];
-    int area = (R1 - R0) * (C1 - C0);
-    area_info a_info;
-    a_info.area = area;
-    a_info.index = i;
-    box_areas.push_back(a_info);
+    box_area[i] = (R1 - R0) * (C1 - C0);
+    order[i] = i;
+    max_r = std::max(max_r, R1 + 1);
+    max_c = std::max(max_c, C1 + 1);
   }
+  std::stable_sort(order.begin(), order.end(),
+                   [&box_area](int a, int b) { return box_area[a] > box_area[b]; });
+
+  int cell_h = std::max(1, (max_r + CC_BOX_GRID_CELLS - 1) / CC_BOX_GRID_CELLS);
+  int cell_w = std::max(1, (max_c + CC_BOX_GRID_CELLS - 1) / CC_BOX_GRID_CELLS);
+  auto cell_r = [&](int r) { return std::min(std::max(r, 0) / cell_h, CC_BOX_GRID_CELLS - 1); };
+  auto cell_c = [&](int c) { return std::min(std::max(c, 0) / cell_w, CC_BOX_GRID_CELLS - 1); };
+  // ranks in order of the boxes covering each cell
+  std::vector<std::vector<int>> grid(CC_BOX_GRID_CELLS * CC_BOX_GRID_CELLS);
+
+  // add rank to the cells of the box not inside the cell range [r0, r1] x [c0, c1]
+  auto insert = [&](int rank, int r0, int c0, int r1, int c1) {
+    int idx = order[rank];
+    for (int gr = cell_r(p_boxes[5 * idx + 1]); gr <= cell_r(p_boxes[5 * idx + 3]); gr++) {
+      for (int gc = cell_c(p_boxes[5 * idx + 2]); gc <= cell_c(p_boxes[5 * idx + 4]); gc++) {
+        if (gr >= r0 && gr <= r1 && gc >= c0 && gc <= c1) continue;
+        grid[gr * CC_BOX_GRID_CELLS + gc].push_back(rank);
+      }
+    }
+  };
 
-  std::sort(box_areas.begin(), box_areas.end(),
-            [](const area_info &a, const area_info &b) { return a.area > b.area; });
-
-  for (size_t i = 1; i < box_areas.size(); i++) {
-    int indi = box_areas[i].index;
-    // std::cout<<"indi:"<<indi<<",area:"<<box_areas[i].area<<std::endl;
-    for (size_t c = 0; c < i; c++) {
-      int indc = box_areas[c].index;
-      if (p_boxes[5 * indc] < 0) continue;
-      if (cluster_box(p_boxes, indc, indi)) {
-        p_boxes[5 * indi] = -1;
-        break;
+  insert(0, 1, 1, 0, 0);
+  for (int k = 1; k < num_src; k++) {
+    int indi = order[k];
+    int best = INT_MAX;
+    for (int gr = cell_r(p_boxes[5 * indi + 1]); gr <= cell_r(p_boxes[5 * indi + 3]); gr++) {
+      for (int gc = cell_c(p_boxes[5 * indi + 2]); gc <= cell_c(p_boxes[5 * indi + 4]); gc++) {
+        for (int rank : grid[gr * CC_BOX_GRID_CELLS + gc]) {
+          if (rank >= best) continue;
+          int indc = order[rank];
+          if (p_boxes[5 * indc] < 0) continue;
+          int inter_w = std::min(p_boxes[5 * indi + 4], p_boxes[5 * indc + 4]) -
+                        std::max(p_boxes[5 * indi + 2], p_boxes[5 * indc + 2]);
+          int inter_h = std::min(p_boxes[5 * indi + 3], p_boxes[5 * indc + 3]) -
+                        std::max(p_boxes[5 * indi + 1], p_boxes[5 * indc + 1]);
+          if (inter_w > 0 && inter_h > 0) best = rank;
+        }
       }
     }
+
+    if (best == INT_MAX) {
+      insert(k, 1, 1, 0, 0);
+      continue;
+    }
+    int indc = order[best];
+    int r0 = cell_r(p_boxes[5 * indc + 1]), c0 = cell_c(p_boxes[5 * indc + 2]);
+    int r1 = cell_r(p_boxes[5 * indc + 3]), c1 = cell_c(p_boxes[5 * indc + 4]);
+    cluster_box(p_boxes, indc, indi);
+    p_boxes[5 * indi] = -1;
+    insert(best, r0, c0, r1, c1);
   }
+
   int ctFinal = 0;
   for (int i = 0; i < num_src; i++) {
     if (p_boxes[5 * i] > 0) {
-      memcpy(p_boxes + 5 * ctFinal, p_boxes + 5 * i, 5 * sizeof(int));
+      memmove(p_boxes + 5 * ctFinal, p_boxes + 5 * i, 5 * sizeof(int));
       ctFinal++;
     }
   }
   return ctFinal;
 }
+
 int dump_ive_image_frame(const std::string &filepath, uint8_t *ptr_img, int w, int h, int wstride) {
   FILE *fp = fopen(filepath.c_str(), "wb");
   if (fp == nullptr) {
@@ -171,298 +297,88 @@ int dump_ive_image_frame(const std::string &filepath, uint8_t *ptr_img, int w, i
   std::cout << "closed:" << filepath << std::endl;
   return 0;
 }
+
 int *extract_connected_component(unsigned char *p_fg_mask, int width, int height, int wstride,
                                  int area_thresh, void *p_cc_inst, int *p_num_boxes) {
-  int r, c, i, j, rBlk, cBlk;
-  int xA, xB, xC, xD;
-  int cumulatedBlkSum, superPixMapW, superPixMapH;
-  int ctFGPixels, imgDataWStep;
-  int lbVal, currLabel, R0, C0, R1, C1, objectSize;
-  int tmpMaxLabel;
-
-  unsigned char *ptrImgData;
-  unsigned char *ptrImgData0;
-  unsigned char *ptrSuperPixMap;
-  unsigned char *ptrSuperPixMap0;
-  unsigned char *ptrSuperPixFG;
-  unsigned char *ptrSuperPixFG0;
-  unsigned char *ptrLabelMap;
-  unsigned char *ptrLabelMap0;
-  unsigned char *eqLabelArray;
-  unsigned char *ptrUCHAR;
-
-  int *boundingBoxes;
-  int *boundingBoxesFinal;
-  int ctFinal;
-
   CCLType *ccGst = (CCLType *)p_cc_inst;
   if (ccGst->maskWidth != width || ccGst->maskHeight != height) {
     LOGI("allocate ccl,w:%d,h:%d\n", width, height);
-
-    release_connected_component(ccGst);
     init_connected_component(ccGst, width, height);
-    // std::cout<<"to allocate
-    // ccl,w:"<<width<<",height:"<<height<<",maskw:"<<ccGst->maskWidth<<std::endl;
-  }
-
-  // imgW = ccGst->maskWidth;
-  superPixMapW = ccGst->superPixMapW;
-  superPixMapH = ccGst->superPixMapH;
-
-  ptrSuperPixMap0 = ccGst->dataSuperPixMap;
-  ptrSuperPixFG0 = ccGst->dataSuperPixFG;
-  eqLabelArray = ccGst->eqCCLabelArray;
-
-  ptrImgData0 = p_fg_mask;
-
-  tmpMaxLabel = 0;
-
-  /* reset foreground super pixels.*/
-  memset(ccGst->dataSuperPixMap, 0, superPixMapH * superPixMapW * sizeof(unsigned char));
-  memset(ccGst->dataSuperPixFG, 0, superPixMapH * superPixMapW * sizeof(unsigned char));
-
-  ptrUCHAR = ccGst->eqCCLabelArray;
-
-  for (i = 0; i < (CC_MAX_NUM_LABELS + 1); i += 1) {
-    *ptrUCHAR = i;
-    ptrUCHAR += 1;
-  }
-
-  ccGst->numTotalObj = 0;
-
-  /***********************************************/
-  /*	Sum up foreground count within suer pixels.*/
-  imgDataWStep = (CC_SUPER_PIXEL_H * wstride);
-
-  for (rBlk = 0; rBlk < superPixMapH; rBlk += 1) {
-    for (cBlk = 0; cBlk < superPixMapW; cBlk += 1) {
-      ptrImgData = ptrImgData0 + (rBlk * imgDataWStep) + (cBlk * CC_SUPER_PIXEL_W);
-
-      cumulatedBlkSum = 0;
-
-      for (r = 0; r < CC_SUPER_PIXEL_H; r += 1) {
-        for (c = 0; c < CC_SUPER_PIXEL_W; c += 1) {
-          if ((*ptrImgData) > 0) cumulatedBlkSum += 1;
-
-          ptrImgData += 1;
-        } /* c */
-
-        ptrImgData += (wstride - CC_SUPER_PIXEL_W);
-      } /* r */
-
-      *(ptrSuperPixFG0 + (rBlk * superPixMapW) + cBlk) = cumulatedBlkSum;
-    } /*end of: for ( cBlk )*/
-  }   /*end of: for ( rBlk )*/
-
-  /**************************/
-  /* Scan image for objects */
-  /**************************/
-
-  for (r = 0; r < (superPixMapH - CC_SCAN_WINDOW_H); r += 1) {
-    for (c = 0; c < (superPixMapW - CC_SCAN_WINDOW_W); c += 1) {
-      /* sum up pixel in scanning window.*/
-
-      ctFGPixels = 0;
-
-      ptrSuperPixFG = ptrSuperPixFG0 + (r * superPixMapW) + c;
-
-      for (i = 0; i < CC_SCAN_WINDOW_H; i += 1) {
-        for (j = 0; j < CC_SCAN_WINDOW_W; j += 1) {
-          ctFGPixels += (*ptrSuperPixFG);
-          ptrSuperPixFG += 1;
-
-        } /* col: j */
-
-        ptrSuperPixFG += (superPixMapW - CC_SCAN_WINDOW_W);
-      } /* row: i */
-
-      /* mark foreground.*/
-
-      if (ctFGPixels > CC_FG_SUPER_PIX_THD) {
-        ptrSuperPixMap = ptrSuperPixMap0 + (r * superPixMapW) + c;
-
-        for (i = 0; i < CC_SCAN_WINDOW_H; i += 1) {
-          for (j = 0; j < CC_SCAN_WINDOW_W; j += 1) {
-            *(ptrSuperPixMap) = 255;
-            ptrSuperPixMap += 1;
-          }
-
-          ptrSuperPixMap += (superPixMapW - CC_SCAN_WINDOW_W);
-        }
-
-      } /*end of: mark foreground.*/
-
-    } /*end of: for ( c )*/
-  }   /*end of: for ( r )*/
-
-  // now the map is saved in ptrSuperPixMap
-  /*	Connected component labeling.*/
-
-  currLabel = 1;
-  // dump_ive_image_frame("/mnt/data/admin1_data/alios_test/md/fg.bin",ptrSuperPixMap0,ccGst->superPixMapW,ccGst->superPixMapH,ccGst->superPixMapW);
-  /* put label in [*ptrSuperPixFG].*/
-  memset(ccGst->dataSuperPixFG, 0, superPixMapH * superPixMapW * sizeof(unsigned char));
-  ptrLabelMap0 = ccGst->dataSuperPixFG;
-
-  /* the 1st pass for setting label and flooding label.*/
-  for (r = 1; r < superPixMapH; r += 1) {
-    ptrSuperPixMap = ptrSuperPixMap0 + (r * superPixMapW) + 1;
-    ptrLabelMap = ptrLabelMap0 + (r * superPixMapW) + 1;
-
-    for (c = 1; c < superPixMapW; c += 1) {
-      if ((*ptrSuperPixMap) > 0) {
-        /*	xB	xC	xD	*/
-        /*	xA	x		*/
-        xA = *(ptrLabelMap - 1);
-        xB = *(ptrLabelMap - 1 - superPixMapW);
-        xC = *(ptrLabelMap - superPixMapW);
-        xD = *(ptrLabelMap - superPixMapW + 1);
-
-        lbVal = CC_MAX_NUM_LABELS;
-
-        if (xA > 0) lbVal = xA;
-        if ((xB > 0) && (xB < lbVal)) lbVal = xB;
-        if ((xC > 0) && (xC < lbVal)) lbVal = xC;
-        if ((xD > 0) && (xD < lbVal)) lbVal = xD;
-
-        if (lbVal < CC_MAX_NUM_LABELS) {
-          /* make connection and flood label.*/
-          if (xA > lbVal) {
-            *(eqLabelArray + xA) = *(eqLabelArray + lbVal);
-          }
-          if (xB > lbVal) {
-            *(eqLabelArray + xB) = *(eqLabelArray + lbVal);
-          }
-          if (xC > lbVal) {
-            *(eqLabelArray + xC) = *(eqLabelArray + lbVal);
-          }
-          if (xD > lbVal) {
-            *(eqLabelArray + xD) = *(eqLabelArray + lbVal);
-          }
-        } else {
-          /* new label.*/
-          lbVal = currLabel;
-          if (currLabel <
-              (CC_MAX_NUM_LABELS - 1)) {  // the maximum label would be CC_MAX_NUM_LABELS-1
-            currLabel += 1;
-          }
-        }
-
-        /* save label for this pixel.*/
-        *(ptrLabelMap) = lbVal;
-
-      } /*end of: if foreground.*/
-
-      ptrSuperPixMap += 1;
-      ptrLabelMap += 1;
-    } /* col */
-  }   /* row */
-
-  /* the 2nd pass to flush with equivalent labels.*/
-  for (r = 1; r < superPixMapH; r += 1) {
-    ptrLabelMap = ptrLabelMap0 + (r * superPixMapW) + 1;
-
-    for (c = 1; c < superPixMapW; c += 1) {
-      lbVal = (*ptrLabelMap);
-
-      if (lbVal > 0) {
-        /* equivalent label.*/
-        lbVal = *(eqLabelArray + lbVal);
-        *ptrLabelMap = lbVal;
-
-        // find the maximal label.
-        if (lbVal > tmpMaxLabel) {
-          tmpMaxLabel = lbVal;
-        }
-
-        // display only:
-        *(ccGst->dataSuperPixMap + (r * superPixMapW) + c) = lbVal;
-
-      } /*end of: if foreground.*/
-
-      ptrLabelMap += 1;
-    } /* col */
-  }   /* row */
-
-  // this would not happen
-  if (tmpMaxLabel > CC_MAX_NUM_LABELS) {
-    printf("ccl error maxlable:%d\n", tmpMaxLabel);
-    *p_num_boxes = 0;
-    return ccGst->boundingBoxes;
   }
-  ccGst->maxID = tmpMaxLabel;
 
-  if (tmpMaxLabel > 0) {
-    tmpMaxLabel = tmpMaxLabel;
-  }
-
-  // determine the bounding boxes of each object
-  boundingBoxes = ccGst->boundingBoxesTmp;
-  for (i = 0; i <= ccGst->maxID; i++) {
-    boundingBoxes[5 * i + 0] = 0;
-    boundingBoxes[5 * i + 1] = 10000;
-    boundingBoxes[5 * i + 2] = 10000;
-    boundingBoxes[5 * i + 3] = -10000;
-    boundingBoxes[5 * i + 4] = -10000;
+  int superPixMapW = ccGst->superPixMapW;
+  int superPixMapH = ccGst->superPixMapH;
+  unsigned char *ptrSuperPixFG0 = ccGst->dataSuperPixFG.data();
+  unsigned char *ptrSuperPixMap0 = ccGst->dataSuperPixMap.data();
+  unsigned short *colSum = ccGst->colSum.data();
+
+  /*	Sum up foreground count within super pixels.*/
+  for (int rBlk = 0; rBlk < superPixMapH; rBlk++) {
+    const unsigned char *ptrRow0 = p_fg_mask + rBlk * CC_SUPER_PIXEL_H * wstride;
+    const unsigned char *ptrRow1 = ptrRow0 + wstride;
+    unsigned char *ptrSuperPixFG = ptrSuperPixFG0 + rBlk * superPixMapW;
+    for (int cBlk = 0; cBlk < superPixMapW; cBlk++) {
+      int c = cBlk * CC_SUPER_PIXEL_W;
+      ptrSuperPixFG[cBlk] =
+          (ptrRow0[c] > 0) + (ptrRow0[c + 1] > 0) + (ptrRow1[c] > 0) + (ptrRow1[c + 1] > 0);
+    }
   }
 
-  for (r = 1; r < superPixMapH; r += 1) {
-    ptrLabelMap = ccGst->dataSuperPixMap + (r * superPixMapW) + 1;
-
-    for (c = 1; c < superPixMapW; c += 1) {
-      lbVal = *ptrLabelMap;
-      ptrLabelMap++;
-
-      if (lbVal >= 1) {
-        if (lbVal > (CC_MAX_NUM_LABELS - 1)) lbVal = CC_MAX_NUM_LABELS - 1;
-
-        lbVal = lbVal - 1;
-        boundingBoxes[5 * lbVal] = boundingBoxes[5 * lbVal] + 1;
-
-        if (r < boundingBoxes[5 * lbVal + 1]) boundingBoxes[5 * lbVal + 1] = r;
-        if (c < boundingBoxes[5 * lbVal + 2]) boundingBoxes[5 * lbVal + 2] = c;
-        if (r > boundingBoxes[5 * lbVal + 3]) boundingBoxes[5 * lbVal + 3] = r;
-        if (c > boundingBoxes[5 * lbVal + 4]) boundingBoxes[5 * lbVal + 4] = c;
+  /* mark the scanning windows holding enough foreground.*/
+  memset(ptrSuperPixMap0, 0, superPixMapH * superPixMapW);
+  for (int r = 0; r < (superPixMapH - CC_SCAN_WINDOW_H); r++) {
+    const unsigned char *ptrFG0 = ptrSuperPixFG0 + r * superPixMapW;
+    const unsigned char *ptrFG1 = ptrFG0 + superPixMapW;
+    for (int c = 0; c < superPixMapW; c++) colSum[c] = ptrFG0[c] + ptrFG1[c];
+
+    unsigned char *ptrMap0 = ptrSuperPixMap0 + r * superPixMapW;
+    unsigned char *ptrMap1 = ptrMap0 + superPixMapW;
+    for (int c = 0; c < (superPixMapW - CC_SCAN_WINDOW_W); c++) {
+      if (colSum[c] + colSum[c + 1] > CC_FG_SUPER_PIX_THD) {
+        ptrMap0[c] = ptrMap0[c + 1] = 255;
+        ptrMap1[c] = ptrMap1[c + 1] = 255;
       }
     }
   }
 
-  // clean up: remove small ones and remove overlap
-  boundingBoxes = ccGst->boundingBoxesTmp;
-  boundingBoxesFinal = ccGst->boundingBoxes;
-  ctFinal = 0;
+  /* the first super pixel row and column are never labeled.*/
+  if (superPixMapH > 0) memset(ptrSuperPixMap0, 0, superPixMapW);
+  for (int r = 0; r < superPixMapH; r++) ptrSuperPixMap0[r * superPixMapW] = 0;
 
-  // remove overlapped boxes
+  // dump_ive_image_frame("/mnt/data/admin1_data/alios_test/md/fg.bin",ptrSuperPixMap0,superPixMapW,superPixMapH,superPixMapW);
+  const std::vector<cvitdl::CCLComponent> &comps =
+      ccGst->engine.label(ptrSuperPixMap0, superPixMapW, superPixMapH, superPixMapW);
+
+  // clean up: remove small ones and remove overlap
+  std::vector<int> &boundingBoxes = ccGst->boundingBoxes;
+  boundingBoxes.resize(5 * std::max<size_t>(comps.size(), 1));
+  int ctFinal = 0;
   int area_super_thresh = area_thresh / BLOCK_SIZE / BLOCK_SIZE;
-  for (i = 0; i < tmpMaxLabel; i++) {
-    objectSize = boundingBoxes[5 * i + 0];
-    if (objectSize > area_super_thresh) {
-      R0 = boundingBoxes[5 * i + 1] * BLOCK_SIZE;
-      C0 = boundingBoxes[5 * i + 2] * BLOCK_SIZE;
-      R1 = boundingBoxes[5 * i + 3] * BLOCK_SIZE;
-      C1 = boundingBoxes[5 * i + 4] * BLOCK_SIZE;
+  for (const cvitdl::CCLComponent &comp : comps) {
+    if (comp.area > area_super_thresh) {
+      int R0 = comp.y1 * BLOCK_SIZE;
+      int C0 = comp.x1 * BLOCK_SIZE;
+      int R1 = comp.y2 * BLOCK_SIZE;
+      int C1 = comp.x2 * BLOCK_SIZE;
       int area = (C1 - C0) * (R1 - R0);
       if (area < area_thresh) continue;
-      boundingBoxesFinal[5 * ctFinal + 0] = objectSize;
-      boundingBoxesFinal[5 * ctFinal + 1] = R0;
-      boundingBoxesFinal[5 * ctFinal + 2] = C0;
-      boundingBoxesFinal[5 * ctFinal + 3] = R1;
-      boundingBoxesFinal[5 * ctFinal + 4] = C1;
+      boundingBoxes[5 * ctFinal + 0] = comp.area;
+      boundingBoxes[5 * ctFinal + 1] = R0;
+      boundingBoxes[5 * ctFinal + 2] = C0;
+      boundingBoxes[5 * ctFinal + 3] = R1;
+      boundingBoxes[5 * ctFinal + 4] = C1;
       ctFinal++;
     }
   }
 
-  ctFinal = filter_inside_boxes(boundingBoxesFinal, ctFinal);
-  ctFinal = filter_inside_boxes(boundingBoxesFinal, ctFinal);
-  ccGst->maxID = ctFinal;
-  ccGst->numObjects = ctFinal;
-  *p_num_boxes = ccGst->numObjects;
-  return ccGst->boundingBoxes;
+  // remove overlapped boxes
+  ctFinal = filter_inside_boxes(boundingBoxes.data(), ctFinal);
+  ctFinal = filter_inside_boxes(boundingBoxes.data(), ctFinal);
+  *p_num_boxes = ctFinal;
+  return boundingBoxes.data();
 } /*end of: void extract_connected_component() | connected component labeling.*/
 
 void destroy_connected_component(void *ccGst) {
   if (ccGst == NULL) return;
-  CCLType *p_inst = (CCLType *)ccGst;
-  release_connected_component(p_inst);
-  delete p_inst;
+  delete (CCLType *)ccGst;
 }
@@ -1,10 +1,59 @@
 #ifndef FILE_CCL_HPP
 #define FILE_CCL_HPP
+#include <stdint.h>
+#include <vector>
 
 void* create_connect_instance();
 
+/**
+ * Boxes of the moving regions of a frame difference mask, 5 ints per box:
+ * (area in super pixels, y1, x1, y2, x2). The buffer belongs to p_cc_inst.
+ */
 int* extract_connected_component(unsigned char* p_fg_mask, int width, int height, int wstride,
                                  int area_thresh, void* p_cc_inst, int* p_num_boxes);
 void destroy_connected_component(void* p_cc_inst);
 
+namespace cvitdl {
+
+struct CCLComponent {
+  int area;            // pixel count
+  int y1, x1, y2, x2;  // inclusive bounding box
+  float cy, cx;        // centroid
+};
+
+/**
+ * 8-connected components of a binary map, labeled on runs instead of pixels.
+ *
+ * The first pass extracts the foreground runs of every row (skipping 8 background bytes at a
+ * time) and unions each run with the runs it touches in the row above; union-find keeps the
+ * smallest run index as root and compresses paths. The second pass walks the runs, not the
+ * pixels, to sum area, bounding box and centroid per root. Run labels are 16 bits while a map
+ * has fewer than 65536 runs and 32 bits beyond, so the number of components is unbounded.
+ * Components come out in raster order of their first pixel. Buffers are reused across calls.
+ */
+class CCLEngine {
+ public:
+  const std::vector<CCLComponent>& label(const unsigned char* p_map, int width, int height,
+                                         int stride);
+  const std::vector<CCLComponent>& components() const { return components_; }
+  // component index of run k of the last label() call
+  int run_component(int k) const { return run_comp_[k]; }
+  int num_runs() const { return static_cast<int>(run_x1_.size()); }
+
+ private:
+  void extract_runs(const unsigned char* p_map, int width, int height, int stride);
+  template <typename LabelT>
+  void resolve(std::vector<LabelT>& parent);
+
+  std::vector<int> row_begin_;  // first run of each row, height + 1 entries
+  std::vector<int> run_x1_, run_x2_, run_y_;  // half open [x1, x2)
+  std::vector<uint16_t> parent16_;
+  std::vector<uint32_t> parent32_;
+  std::vector<int> run_comp_;
+  std::vector<double> sum_x_, sum_y_;
+  std::vector<CCLComponent> components_;
+};
+
+}  // namespace cvitdl
+
 #endif
@@ -0,0 +1,362 @@
+#include "color_kernels.hpp"
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define COLOR_USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define COLOR_USE_SSE
+#endif
+
+namespace {
+
+// R = (1220542(Y - 16) + 1673527(V - 128)                  + (1 << 19)) >> 20
+// G = (1220542(Y - 16) - 852492(V - 128) - 409993(U - 128) + (1 << 19)) >> 20
+// B = (1220542(Y - 16)                  + 2116026(U - 128) + (1 << 19)) >> 20
+constexpr int kShift = 20;
+constexpr int kHalf = 1 << (kShift - 1);
+constexpr int kCY = 1220542;
+constexpr int kCUB = 2116026;
+constexpr int kCUG = -409993;
+constexpr int kCVG = -852492;
+constexpr int kCVR = 1673527;
+
+// bilinear coefficients of the fused resize, as INTER_RESIZE_COEF_BITS in cv::resize
+constexpr int kCoefBits = 11;
+constexpr int kCoefOne = 1 << kCoefBits;
+
+inline uint8_t clip_u8(int v) { return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v)); }
+
+struct ChromaTerms {
+  int r, g, b;
+};
+
+inline ChromaTerms chroma_terms(int u, int v) {
+  u -= 128;
+  v -= 128;
+  return {kHalf + kCVR * v, kHalf + kCVG * v + kCUG * u, kHalf + kCUB * u};
+}
+
+// Destination of a row pair, packed (r,g,b triplets) or one row per plane. ridx is where red
+// goes: 0 for RGB, 2 for BGR.
+struct PackedRows {
+  uint8_t* row[2];
+  int ridx;
+
+  void put(int r, int x, int y, const ChromaTerms& c) {
+    uint8_t* p = row[r] + 3 * x;
+    int yc = std::max(0, y - 16) * kCY;
+    p[ridx] = clip_u8((yc + c.r) >> kShift);
+    p[1] = clip_u8((yc + c.g) >> kShift);
+    p[2 - ridx] = clip_u8((yc + c.b) >> kShift);
+  }
+#if defined(COLOR_USE_NEON)
+  void put16(int r, int x, uint8x16_t rv, uint8x16_t gv, uint8x16_t bv) {
+    uint8x16x3_t t;
+    t.val[0] = ridx == 0 ? rv : bv;
+    t.val[1] = gv;
+    t.val[2] = ridx == 0 ? bv : rv;
+    vst3q_u8(row[r] + 3 * x, t);
+  }
+#elif defined(COLOR_USE_SSE)
+  // SSE2 has no byte shuffle, interleaving the three low halves goes through the stack
+  void put8(int r, int x, __m128i rv, __m128i gv, __m128i bv) {
+    alignas(16) uint8_t ch[3][16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(ch[ridx]), rv);
+    _mm_store_si128(reinterpret_cast<__m128i*>(ch[1]), gv);
+    _mm_store_si128(reinterpret_cast<__m128i*>(ch[2 - ridx]), bv);
+    uint8_t* p = row[r] + 3 * x;
+    for (int i = 0; i < 8; i++, p += 3) {
+      p[0] = ch[0][i];
+      p[1] = ch[1][i];
+      p[2] = ch[2][i];
+    }
+  }
+#endif
+};
+
+struct PlanarRows {
+  uint8_t* const* row[2];
+  int ridx;
+
+  void put(int r, int x, int y, const ChromaTerms& c) {
+    int yc = std::max(0, y - 16) * kCY;
+    row[r][ridx][x] = clip_u8((yc + c.r) >> kShift);
+    row[r][1][x] = clip_u8((yc + c.g) >> kShift);
+    row[r][2 - ridx][x] = clip_u8((yc + c.b) >> kShift);
+  }
+#if defined(COLOR_USE_NEON)
+  void put16(int r, int x, uint8x16_t rv, uint8x16_t gv, uint8x16_t bv) {
+    vst1q_u8(row[r][ridx] + x, rv);
+    vst1q_u8(row[r][1] + x, gv);
+    vst1q_u8(row[r][2 - ridx] + x, bv);
+  }
+#elif defined(COLOR_USE_SSE)
+  void put8(int r, int x, __m128i rv, __m128i gv, __m128i bv) {
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(row[r][ridx] + x), rv);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(row[r][1] + x), gv);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(row[r][2 - ridx] + x), bv);
+  }
+#endif
+};
+
+#if defined(COLOR_USE_NEON)
+// (y + uv) >> shift for the low and high four lanes, saturated to 8 bits
+inline uint8x8_t narrow_u8(int32x4_t y_lo, int32x4_t y_hi, int32x4_t uv_lo, int32x4_t uv_hi) {
+  int16x4_t lo = vqmovn_s32(vshrq_n_s32(vaddq_s32(y_lo, uv_lo), kShift));
+  int16x4_t hi = vqmovn_s32(vshrq_n_s32(vaddq_s32(y_hi, uv_hi), kShift));
+  return vqmovun_s16(vcombine_s16(lo, hi));
+}
+
+inline void luma_terms(uint8x8_t y, int32x4_t* lo, int32x4_t* hi) {
+  uint16x8_t w = vmovl_u8(vqsub_u8(y, vdup_n_u8(16)));
+  *lo = vmulq_n_s32(vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(w))), kCY);
+  *hi = vmulq_n_s32(vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(w))), kCY);
+}
+
+inline uint8x16_t zip_channel(uint8x8_t even, uint8x8_t odd) {
+  uint8x8x2_t z = vzip_u8(even, odd);
+  return vcombine_u8(z.val[0], z.val[1]);
+}
+#elif defined(COLOR_USE_SSE)
+// low 32 bits of a 32x32 product, _mm_mullo_epi32 is SSE4.1
+inline __m128i mullo_epi32(__m128i a, __m128i b) {
+  __m128i even = _mm_mul_epu32(a, b);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// even and odd pixels (four lanes each) back to eight bytes in pixel order
+inline __m128i narrow_u8(__m128i y_even, __m128i y_odd, __m128i uv) {
+  __m128i e = _mm_srai_epi32(_mm_add_epi32(y_even, uv), kShift);
+  __m128i o = _mm_srai_epi32(_mm_add_epi32(y_odd, uv), kShift);
+  __m128i w = _mm_packs_epi32(_mm_unpacklo_epi32(e, o), _mm_unpackhi_epi32(e, o));
+  return _mm_packus_epi16(w, w);
+}
+#endif
+
+template <typename Rows>
+void convert_row_pair(const uint8_t* y1, const uint8_t* y2, const uint8_t* u, const uint8_t* v,
+                      int uv_step, Rows& out, int width) {
+  int x = 0;
+#if defined(COLOR_USE_NEON)
+  const int32x4_t half = vdupq_n_s32(kHalf);
+  const uint8_t* uv_base = u < v ? u : v;
+  for (; x + 16 <= width; x += 16) {
+    uint8x8_t u8, v8;
+    if (uv_step == 1) {
+      u8 = vld1_u8(u + x / 2);
+      v8 = vld1_u8(v + x / 2);
+    } else {
+      uint8x8x2_t c = vld2_u8(uv_base + x);
+      u8 = u < v ? c.val[0] : c.val[1];
+      v8 = u < v ? c.val[1] : c.val[0];
+    }
+    int16x8_t us = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), vdupq_n_s16(128));
+    int16x8_t vs = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), vdupq_n_s16(128));
+    int32x4_t u_lo = vmovl_s16(vget_low_s16(us)), u_hi = vmovl_s16(vget_high_s16(us));
+    int32x4_t v_lo = vmovl_s16(vget_low_s16(vs)), v_hi = vmovl_s16(vget_high_s16(vs));
+    int32x4_t ruv_lo = vmlaq_n_s32(half, v_lo, kCVR), ruv_hi = vmlaq_n_s32(half, v_hi, kCVR);
+    int32x4_t guv_lo = vmlaq_n_s32(vmlaq_n_s32(half, v_lo, kCVG), u_lo, kCUG);
+    int32x4_t guv_hi = vmlaq_n_s32(vmlaq_n_s32(half, v_hi, kCVG), u_hi, kCUG);
+    int32x4_t buv_lo = vmlaq_n_s32(half, u_lo, kCUB), buv_hi = vmlaq_n_s32(half, u_hi, kCUB);
+
+    const uint8_t* ys[2] = {y1, y2};
+    for (int r = 0; r < 2; r++) {
+      uint8x8x2_t yy = vld2_u8(ys[r] + x);
+      int32x4_t e_lo, e_hi, o_lo, o_hi;
+      luma_terms(yy.val[0], &e_lo, &e_hi);
+      luma_terms(yy.val[1], &o_lo, &o_hi);
+      uint8x16_t rv = zip_channel(narrow_u8(e_lo, e_hi, ruv_lo, ruv_hi),
+                                  narrow_u8(o_lo, o_hi, ruv_lo, ruv_hi));
+      uint8x16_t gv = zip_channel(narrow_u8(e_lo, e_hi, guv_lo, guv_hi),
+                                  narrow_u8(o_lo, o_hi, guv_lo, guv_hi));
+      uint8x16_t bv = zip_channel(narrow_u8(e_lo, e_hi, buv_lo, buv_hi),
+                                  narrow_u8(o_lo, o_hi, buv_lo, buv_hi));
+      out.put16(r, x, rv, gv, bv);
+    }
+  }
+#elif defined(COLOR_USE_SSE)
+  const __m128i half = _mm_set1_epi32(kHalf);
+  const __m128i c_y = _mm_set1_epi32(kCY);
+  const __m128i c_ub = _mm_set1_epi32(kCUB), c_ug = _mm_set1_epi32(kCUG);
+  const __m128i c_vg = _mm_set1_epi32(kCVG), c_vr = _mm_set1_epi32(kCVR);
+  const __m128i c128 = _mm_set1_epi32(128);
+  const __m128i c16 = _mm_set1_epi16(16);
+  const __m128i lo16 = _mm_set1_epi32(0xffff);
+  const __m128i zero = _mm_setzero_si128();
+  for (; x + 8 <= width; x += 8) {
+    const uint8_t* pu = u + (x / 2) * uv_step;
+    const uint8_t* pv = v + (x / 2) * uv_step;
+    __m128i uu = _mm_sub_epi32(
+        _mm_setr_epi32(pu[0], pu[uv_step], pu[2 * uv_step], pu[3 * uv_step]), c128);
+    __m128i vv = _mm_sub_epi32(
+        _mm_setr_epi32(pv[0], pv[uv_step], pv[2 * uv_step], pv[3 * uv_step]), c128);
+    __m128i ruv = _mm_add_epi32(half, mullo_epi32(vv, c_vr));
+    __m128i guv = _mm_add_epi32(_mm_add_epi32(half, mullo_epi32(vv, c_vg)), mullo_epi32(uu, c_ug));
+    __m128i buv = _mm_add_epi32(half, mullo_epi32(uu, c_ub));
+
+    const uint8_t* ys[2] = {y1, y2};
+    for (int r = 0; r < 2; r++) {
+      __m128i y16 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ys[r] + x));
+      y16 = _mm_subs_epu16(_mm_unpacklo_epi8(y16, zero), c16);
+      __m128i ye = mullo_epi32(_mm_and_si128(y16, lo16), c_y);
+      __m128i yo = mullo_epi32(_mm_srli_epi32(y16, 16), c_y);
+      out.put8(r, x, narrow_u8(ye, yo, ruv), narrow_u8(ye, yo, guv), narrow_u8(ye, yo, buv));
+    }
+  }
+#endif
+  for (; x < width; x += 2) {
+    ChromaTerms c = chroma_terms(u[(x / 2) * uv_step], v[(x / 2) * uv_step]);
+    out.put(0, x, y1[x], c);
+    out.put(0, x + 1, y1[x + 1], c);
+    out.put(1, x, y2[x], c);
+    out.put(1, x + 1, y2[x + 1], c);
+  }
+}
+
+}  // namespace
+
+namespace cvitdl {
+
+void yuv420_row_pair_to_rgb(const uint8_t* y1, const uint8_t* y2, const uint8_t* u,
+                            const uint8_t* v, int uv_step, uint8_t* row1, uint8_t* row2,
+                            int width, bool bgr) {
+  PackedRows out{{row1, row2}, bgr ? 2 : 0};
+  convert_row_pair(y1, y2, u, v, uv_step, out, width);
+}
+
+void yuv420_row_pair_to_planar(const uint8_t* y1, const uint8_t* y2, const uint8_t* u,
+                               const uint8_t* v, int uv_step, uint8_t* const dst1[3],
+                               uint8_t* const dst2[3], int width, bool bgr) {
+  PlanarRows out{{dst1, dst2}, bgr ? 2 : 0};
+  convert_row_pair(y1, y2, u, v, uv_step, out, width);
+}
+
+void yuv420_to_rgb(const Yuv420Image& src, uint8_t* dst, int dst_stride, bool bgr) {
+  for (int j = 0; j < src.height; j += 2) {
+    const uint8_t* y1 = src.y + static_cast<size_t>(j) * src.y_stride;
+    size_t uv_off = static_cast<size_t>(j / 2) * src.uv_stride;
+    uint8_t* row1 = dst + static_cast<size_t>(j) * dst_stride;
+    yuv420_row_pair_to_rgb(y1, y1 + src.y_stride, src.u + uv_off, src.v + uv_off, src.uv_step,
+                           row1, row1 + dst_stride, src.width, bgr);
+  }
+}
+
+void yuv420_to_rgb_planar(const Yuv420Image& src, uint8_t* const dst[3],
+                          const int dst_stride[3], bool bgr) {
+  for (int j = 0; j < src.height; j += 2) {
+    const uint8_t* y1 = src.y + static_cast<size_t>(j) * src.y_stride;
+    size_t uv_off = static_cast<size_t>(j / 2) * src.uv_stride;
+    uint8_t* rows1[3];
+    uint8_t* rows2[3];
+    for (int c = 0; c < 3; c++) {
+      rows1[c] = dst[c] + static_cast<size_t>(j) * dst_stride[c];
+      rows2[c] = rows1[c] + dst_stride[c];
+    }
+    yuv420_row_pair_to_planar(y1, y1 + src.y_stride, src.u + uv_off, src.v + uv_off,
+                              src.uv_step, rows1, rows2, src.width, bgr);
+  }
+}
+
+void yuv420_resize_to_int8(const Yuv420Image& src, int8_t* const dst[3], int dst_width,
+                           int dst_height, int dst_stride, const float factor[3],
+                           const float mean[3], bool bgr) {
+  const int sw = src.width, sh = src.height;
+  const double scale_x = static_cast<double>(sw) / dst_width;
+  const double scale_y = static_cast<double>(sh) / dst_height;
+
+  // horizontal taps, shared by every output row
+  std::vector<int> xofs(dst_width * 2);
+  std::vector<int> xalpha(dst_width);
+  for (int dx = 0; dx < dst_width; dx++) {
+    double fx = (dx + 0.5) * scale_x - 0.5;
+    int sx = static_cast<int>(floor(fx));
+    fx -= sx;
+    if (sx < 0) {
+      sx = 0;
+      fx = 0;
+    }
+    if (sx >= sw - 1) {
+      sx = sw - 1;
+      fx = 0;
+    }
+    xofs[dx * 2] = sx * 3;
+    xofs[dx * 2 + 1] = std::min(sx + 1, sw - 1) * 3;
+    xalpha[dx] = static_cast<int>(lrint(fx * kCoefOne));
+  }
+
+  // the current source row pair in RGB and two horizontally resampled rows
+  std::vector<uint8_t> rgb(static_cast<size_t>(sw) * 3 * 2);
+  std::vector<int> hbuf(static_cast<size_t>(dst_width) * 3 * 2);
+  int rgb_pair = -1;
+  int hrow_y[2] = {-1, -1};
+
+  auto hrow = [&](int sy, int keep) -> const int* {
+    if (hrow_y[0] == sy) return hbuf.data();
+    if (hrow_y[1] == sy) return hbuf.data() + dst_width * 3;
+    int slot = hrow_y[0] == keep ? 1 : 0;
+    int pair = sy / 2;
+    if (pair != rgb_pair) {
+      const uint8_t* y1 = src.y + static_cast<size_t>(pair * 2) * src.y_stride;
+      size_t uv_off = static_cast<size_t>(pair) * src.uv_stride;
+      yuv420_row_pair_to_rgb(y1, y1 + src.y_stride, src.u + uv_off, src.v + uv_off, src.uv_step,
+                             rgb.data(), rgb.data() + sw * 3, sw, false);
+      rgb_pair = pair;
+    }
+    const uint8_t* s = rgb.data() + (sy & 1) * sw * 3;
+    int* h = hbuf.data() + slot * dst_width * 3;
+    for (int dx = 0; dx < dst_width; dx++) {
+      const uint8_t* s0 = s + xofs[dx * 2];
+      const uint8_t* s1 = s + xofs[dx * 2 + 1];
+      int a = xalpha[dx];
+      h[dx * 3 + 0] = s0[0] * (kCoefOne - a) + s1[0] * a;
+      h[dx * 3 + 1] = s0[1] * (kCoefOne - a) + s1[1] * a;
+      h[dx * 3 + 2] = s0[2] * (kCoefOne - a) + s1[2] * a;
+    }
+    hrow_y[slot] = sy;
+    return h;
+  };
+
+  // factor and mean follow the output planes, like the VPSS normalize of a BGR channel
+  float scale[3], bias[3];
+  int8_t* planes[3];
+  for (int c = 0; c < 3; c++) {
+    const int p = bgr ? 2 - c : c;
+    scale[c] = factor[p] / static_cast<float>(kCoefOne * kCoefOne);
+    bias[c] = mean[p];
+    planes[c] = dst[p];
+  }
+
+  for (int dy = 0; dy < dst_height; dy++) {
+    double fy = (dy + 0.5) * scale_y - 0.5;
+    int sy = static_cast<int>(floor(fy));
+    fy -= sy;
+    if (sy < 0) {
+      sy = 0;
+      fy = 0;
+    }
+    if (sy >= sh - 1) {
+      sy = sh - 1;
+      fy = 0;
+    }
+    const int b = static_cast<int>(lrint(fy * kCoefOne));
+    const int sy1 = std::min(sy + 1, sh - 1);
+    const int* h0 = hrow(sy, sy1);
+    const int* h1 = hrow(sy1, sy);
+
+    for (int c = 0; c < 3; c++) {
+      int8_t* out = planes[c] + static_cast<size_t>(dy) * dst_stride;
+      for (int dx = 0; dx < dst_width; dx++) {
+        int v = h0[dx * 3 + c] * (kCoefOne - b) + h1[dx * 3 + c] * b;
+        int q = static_cast<int>(lrintf(v * scale[c] - bias[c]));
+        out[dx] = static_cast<int8_t>(q < -128 ? -128 : (q > 127 ? 127 : q));
+      }
+    }
+  }
+}
+}  // namespace cvitdl
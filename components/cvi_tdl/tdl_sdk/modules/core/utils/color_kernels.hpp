@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+
+namespace cvitdl {
+
+/**
+ * One YUV420 frame, planar (I420/YV12) or semi-planar (NV12/NV21).
+ *
+ * u and v point at the first chroma sample of each component and uv_step is the distance in
+ * bytes between two horizontally adjacent samples: 1 for planar, 2 for semi-planar, where
+ * NV12 is u = uv, v = uv + 1 and NV21 is u = uv + 1, v = uv. Width and height must be even.
+ */
+struct Yuv420Image {
+  const uint8_t* y;
+  const uint8_t* u;
+  const uint8_t* v;
+  int y_stride;
+  int uv_stride;  // bytes between two chroma rows
+  int uv_step;
+  int width;
+  int height;
+};
+
+/**
+ * BT.601 video range to RGB for the two luma rows sharing one chroma row. Same fixed-point
+ * formula as cv::cvtColor(COLOR_YUV2RGB_NV12/I420), results match it bit for bit.
+ */
+void yuv420_row_pair_to_rgb(const uint8_t* y1, const uint8_t* y2, const uint8_t* u,
+                            const uint8_t* v, int uv_step, uint8_t* row1, uint8_t* row2,
+                            int width, bool bgr);
+
+// Planar output of the row pair, dst1/dst2 hold the R, G, B (B, G, R if bgr) rows.
+void yuv420_row_pair_to_planar(const uint8_t* y1, const uint8_t* y2, const uint8_t* u,
+                               const uint8_t* v, int uv_step, uint8_t* const dst1[3],
+                               uint8_t* const dst2[3], int width, bool bgr);
+
+void yuv420_to_rgb(const Yuv420Image& src, uint8_t* dst, int dst_stride, bool bgr);
+
+void yuv420_to_rgb_planar(const Yuv420Image& src, uint8_t* const dst[3],
+                          const int dst_stride[3], bool bgr);
+
+/**
+ * Converts, resizes (bilinear, pixel centers aligned like cv::resize INTER_LINEAR) and
+ * quantizes src into a planar int8 model input in a single pass:
+ *
+ *   dst[p][y][x] = saturate(round(pixel[p] * factor[p] - mean[p]))
+ *
+ * where plane p is R, G, B, or B, G, R with bgr. factor and mean are the quantized values from
+ * InputPreParam, i.e. already multiplied by the input tensor's quant scale. Only two converted
+ * source rows are kept alive instead of a full RGB frame and a full resized frame.
+ */
+void yuv420_resize_to_int8(const Yuv420Image& src, int8_t* const dst[3], int dst_width,
+                           int dst_height, int dst_stride, const float factor[3],
+                           const float mean[3], bool bgr);
+}  // namespace cvitdl
@@ -1,4 +1,5 @@
 #include "color.hpp"
+#include "color_kernels.hpp"
 #include "types_c.h"
 
 #define EXT_FUNCTION 0
@@ -232,49 +233,13 @@ struct YUV420sp2RGB888Invoker : cv::ParallelLoopBody {
     int rangeBegin = range.start * 2;
     int rangeEnd = range.end * 2;
 
-    // R = 1.164(Y - 16) + 1.596(V - 128)
-    // G = 1.164(Y - 16) - 0.813(V - 128) - 0.391(U - 128)
-    // B = 1.164(Y - 16)                  + 2.018(U - 128)
-
-    // R = (1220542(Y - 16) + 1673527(V - 128)                  + (1 << 19)) >> 20
-    // G = (1220542(Y - 16) - 852492(V - 128) - 409993(U - 128) + (1 << 19)) >> 20
-    // B = (1220542(Y - 16)                  + 2116026(U - 128) + (1 << 19)) >> 20
-
     const uchar *y1 = my1 + rangeBegin * stride, *uv = muv + rangeBegin * stride / 2;
 
     for (int j = rangeBegin; j < rangeEnd; j += 2, y1 += stride * 2, uv += stride) {
       uchar* row1 = dst_data + dst_step * j;
       uchar* row2 = dst_data + dst_step * (j + 1);
-      const uchar* y2 = y1 + stride;
-
-      for (int i = 0; i < width; i += 2, row1 += 6, row2 += 6) {
-        int u = int(uv[i + 0 + uIdx]) - 128;
-        int v = int(uv[i + 1 - uIdx]) - 128;
-
-        int ruv = (1 << (ITUR_BT_601_SHIFT - 1)) + ITUR_BT_601_CVR * v;
-        int guv = (1 << (ITUR_BT_601_SHIFT - 1)) + ITUR_BT_601_CVG * v + ITUR_BT_601_CUG * u;
-        int buv = (1 << (ITUR_BT_601_SHIFT - 1)) + ITUR_BT_601_CUB * u;
-
-        int y00 = std::max(0, int(y1[i]) - 16) * ITUR_BT_601_CY;
-        row1[2 - bIdx] = cv::saturate_cast<uchar>((y00 + ruv) >> ITUR_BT_601_SHIFT);
-        row1[1] = cv::saturate_cast<uchar>((y00 + guv) >> ITUR_BT_601_SHIFT);
-        row1[bIdx] = cv::saturate_cast<uchar>((y00 + buv) >> ITUR_BT_601_SHIFT);
-
-        int y01 = std::max(0, int(y1[i + 1]) - 16) * ITUR_BT_601_CY;
-        row1[5 - bIdx] = cv::saturate_cast<uchar>((y01 + ruv) >> ITUR_BT_601_SHIFT);
-        row1[4] = cv::saturate_cast<uchar>((y01 + guv) >> ITUR_BT_601_SHIFT);
-        row1[3 + bIdx] = cv::saturate_cast<uchar>((y01 + buv) >> ITUR_BT_601_SHIFT);
-
-        int y10 = std::max(0, int(y2[i]) - 16) * ITUR_BT_601_CY;
-        row2[2 - bIdx] = cv::saturate_cast<uchar>((y10 + ruv) >> ITUR_BT_601_SHIFT);
-        row2[1] = cv::saturate_cast<uchar>((y10 + guv) >> ITUR_BT_601_SHIFT);
-        row2[bIdx] = cv::saturate_cast<uchar>((y10 + buv) >> ITUR_BT_601_SHIFT);
-
-        int y11 = std::max(0, int(y2[i + 1]) - 16) * ITUR_BT_601_CY;
-        row2[5 - bIdx] = cv::saturate_cast<uchar>((y11 + ruv) >> ITUR_BT_601_SHIFT);
-        row2[4] = cv::saturate_cast<uchar>((y11 + guv) >> ITUR_BT_601_SHIFT);
-        row2[3 + bIdx] = cv::saturate_cast<uchar>((y11 + buv) >> ITUR_BT_601_SHIFT);
-      }
+      cvitdl::yuv420_row_pair_to_rgb(y1, y1 + stride, uv + uIdx, uv + 1 - uIdx, 2, row1, row2,
+                                     width, bIdx == 0);
     }
   }
 };
@@ -322,36 +287,7 @@ struct YUV420p2RGB888Invoker : cv::ParallelLoopBody {
          j += 2, y1 += stride * 2, u1 += uvsteps[(usIdx++) & 1], v1 += uvsteps[(vsIdx++) & 1]) {
       uchar* row1 = dst_data + dst_step * j;
       uchar* row2 = dst_data + dst_step * (j + 1);
-      const uchar* y2 = y1 + stride;
-
-      for (int i = 0; i < width / 2; i += 1, row1 += 6, row2 += 6) {
-        int u = int(u1[i]) - 128;
-        int v = int(v1[i]) - 128;
-
-        int ruv = (1 << (ITUR_BT_601_SHIFT - 1)) + ITUR_BT_601_CVR * v;
-        int guv = (1 << (ITUR_BT_601_SHIFT - 1)) + ITUR_BT_601_CVG * v + ITUR_BT_601_CUG * u;
-        int buv = (1 << (ITUR_BT_601_SHIFT - 1)) + ITUR_BT_601_CUB * u;
-
-        int y00 = std::max(0, int(y1[2 * i]) - 16) * ITUR_BT_601_CY;
-        row1[2 - bIdx] = cv::saturate_cast<uchar>((y00 + ruv) >> ITUR_BT_601_SHIFT);
-        row1[1] = cv::saturate_cast<uchar>((y00 + guv) >> ITUR_BT_601_SHIFT);
-        row1[bIdx] = cv::saturate_cast<uchar>((y00 + buv) >> ITUR_BT_601_SHIFT);
-
-        int y01 = std::max(0, int(y1[2 * i + 1]) - 16) * ITUR_BT_601_CY;
-        row1[5 - bIdx] = cv::saturate_cast<uchar>((y01 + ruv) >> ITUR_BT_601_SHIFT);
-        row1[4] = cv::saturate_cast<uchar>((y01 + guv) >> ITUR_BT_601_SHIFT);
-        row1[3 + bIdx] = cv::saturate_cast<uchar>((y01 + buv) >> ITUR_BT_601_SHIFT);
-
-        int y10 = std::max(0, int(y2[2 * i]) - 16) * ITUR_BT_601_CY;
-        row2[2 - bIdx] = cv::saturate_cast<uchar>((y10 + ruv) >> ITUR_BT_601_SHIFT);
-        row2[1] = cv::saturate_cast<uchar>((y10 + guv) >> ITUR_BT_601_SHIFT);
-        row2[bIdx] = cv::saturate_cast<uchar>((y10 + buv) >> ITUR_BT_601_SHIFT);
-
-        int y11 = std::max(0, int(y2[2 * i + 1]) - 16) * ITUR_BT_601_CY;
-        row2[5 - bIdx] = cv::saturate_cast<uchar>((y11 + ruv) >> ITUR_BT_601_SHIFT);
-        row2[4] = cv::saturate_cast<uchar>((y11 + guv) >> ITUR_BT_601_SHIFT);
-        row2[3 + bIdx] = cv::saturate_cast<uchar>((y11 + buv) >> ITUR_BT_601_SHIFT);
-      }
+      cvitdl::yuv420_row_pair_to_rgb(y1, y1 + stride, u1, v1, 1, row1, row2, width, bIdx == 0);
     }
   }
 };
@@ -0,0 +1,310 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "det_postprocess.hpp"
+
+namespace cvitdl {
+
+// memory order of the head tensors
+enum class DetLayout {
+  PLANAR,        // n x c x h x w, one plane per channel (yolov8/yolov10)
+  CHANNEL_LAST,  // a x h x w x c, channels of an anchor are contiguous (yolov5/yolov6/yolox/ppyoloe)
+};
+
+// box regression of the head
+enum class DetBoxCoding {
+  DFL_LTRB,     // distribution focal loss distances to the grid center (yolov8/yolov10)
+  LTRB,         // distances to the grid center (yolov6/ppyoloe)
+  XYWH_ANCHOR,  // sigmoid xywh relative to grid and anchor size (yolov5)
+  XYWH_EXP,     // xy offset in the grid, exp(wh) in strides (yolox)
+};
+
+// how the candidate score is formed
+enum class DetScoring {
+  CLS_SIGMOID,        // sigmoid(best class logit)
+  OBJ_X_CLS_SIGMOID,  // sigmoid(objectness) * sigmoid(best class logit)
+};
+
+// what happens to a decoded box before it enters the arena
+enum class DetClip {
+  NONE,
+  CLIP,           // clamp to the input size
+  CLIP_MIN_SIZE,  // clamp and drop boxes not wider/higher than one pixel
+};
+
+/**
+ * Compile time description of a detection head. A model only declares its configuration, e.g.
+ *   typedef DetHeadConfig<DetLayout::PLANAR, DetBoxCoding::DFL_LTRB, DetScoring::CLS_SIGMOID,
+ *                         DetClip::CLIP_MIN_SIZE> HeadConfig;
+ * and DetDecoder<HeadConfig> generates the scanning loop for it.
+ */
+template <DetLayout kLayoutT, DetBoxCoding kBoxT, DetScoring kScoreT, DetClip kClipT>
+struct DetHeadConfig {
+  static constexpr DetLayout kLayout = kLayoutT;
+  static constexpr DetBoxCoding kBox = kBoxT;
+  static constexpr DetScoring kScore = kScoreT;
+  static constexpr DetClip kClip = kClipT;
+};
+
+// one output level of a head, resolved in onModelOpened
+struct DetHeadBranch {
+  int stride_x = 0;
+  int stride_y = 0;
+  // anchors per grid cell, only anchor based heads have more than one
+  int num_anchor_per_grid = 1;
+  // num_anchor_per_grid (w, h) pairs for DetBoxCoding::XYWH_ANCHOR
+  const uint32_t *anchors = nullptr;
+  // first class channel when box and class share one tensor
+  int cls_offset = 0;
+  DetTensorView box;
+  DetTensorView cls;
+  DetTensorView obj;  // DetScoring::OBJ_X_CLS_SIGMOID only
+
+  int gridW() const { return cls.feat_w; }
+  int gridSize() const { return cls.feat_h * cls.feat_w; }
+};
+
+struct DetDecodeParam {
+  float score_threshold = 0.5f;
+  int num_cls = 0;
+  int reg_max = 16;  // DFL bins per side
+  // DetClip bounds, the nn input size
+  float clip_width = 0;
+  float clip_height = 0;
+  // reject anchors of int8 heads on the raw class/objectness bytes before dequantizing them,
+  // the result is identical, turning it off is only useful for comparisons
+  bool int8_early_exit = true;
+};
+
+// index of the largest of num_cls values spaced step apart, the first one wins on ties
+template <typename T>
+inline int det_argmax(const T *ptr, int step, int num_cls) {
+  int max_idx = 0;
+  T max_val = ptr[0];
+  for (int c = 1; c < num_cls; c++) {
+    if (ptr[c * step] > max_val) {
+      max_val = ptr[c * step];
+      max_idx = c;
+    }
+  }
+  return max_idx;
+}
+
+// logit that maps to score_threshold through the sigmoid
+inline float det_inverse_sigmoid(float score) {
+  if (score <= 0.f) return -INFINITY;
+  if (score >= 1.f) return INFINITY;
+  return logf(score / (1.f - score));
+}
+
+/**
+ * Smallest int8 value whose dequantized logit can reach inverse_th, one quantization step lower
+ * than the exact bound so rounding never rejects an anchor the float check would keep.
+ * Returns 128 when no int8 value can pass.
+ */
+inline int det_int8_threshold(float inverse_th, float qscale) {
+  float t = ceilf(inverse_th / qscale) - 1;
+  if (t > 127) return 128;
+  if (t < -128) return -128;
+  return static_cast<int>(t);
+}
+
+template <typename Config>
+class DetDecoder {
+ public:
+  static void decode(const std::vector<DetHeadBranch> &branches, const DetDecodeParam &param,
+                     DetCandidateArena *arena) {
+    float inverse_th = det_inverse_sigmoid(param.score_threshold);
+    for (const DetHeadBranch &branch : branches) {
+      if (branch.cls.is_int8 && param.int8_early_exit) {
+        decodeBranchInt8(branch, param, inverse_th, arena);
+      } else if (branch.cls.is_int8) {
+        decodeBranch<int8_t>(branch, param, inverse_th, arena);
+      } else {
+        decodeBranch<float>(branch, param, inverse_th, arena);
+      }
+    }
+  }
+
+ private:
+  static constexpr bool kPlanar = Config::kLayout == DetLayout::PLANAR;
+
+  template <typename T>
+  static const T *data(const DetTensorView &view) {
+    return static_cast<const T *>(view.ptr);
+  }
+
+  // element offset of channel c of anchor a (a = anchor_in_grid * grid_size + grid_idx)
+  static int offset(const DetTensorView &view, int grid_size, int a, int c) {
+    return kPlanar ? c * grid_size + a : a * view.channel + c;
+  }
+
+  template <typename T>
+  static void decodeBranch(const DetHeadBranch &branch, const DetDecodeParam &param,
+                           float inverse_th, DetCandidateArena *arena) {
+    int num_anchor = branch.num_anchor_per_grid * branch.gridSize();
+    for (int a = 0; a < num_anchor; a++) {
+      decodeAnchor<T>(branch, param, inverse_th, a, arena);
+    }
+    arena->addScanned(num_anchor, 0);
+  }
+
+  /**
+   * Most anchors of a frame are background. An anchor can only pass when one of its class bytes
+   * (and its objectness byte) reaches the int8 threshold, so those bytes are compared with SIMD
+   * first and the float work only runs for the anchors left.
+   */
+  static void decodeBranchInt8(const DetHeadBranch &branch, const DetDecodeParam &param,
+                               float inverse_th, DetCandidateArena *arena) {
+    const int grid_size = branch.gridSize();
+    const int num_anchor = branch.num_anchor_per_grid * grid_size;
+    const int cls_th = det_int8_threshold(inverse_th, branch.cls.qscale);
+    if (cls_th > 127) {
+      arena->addScanned(num_anchor, num_anchor);
+      return;
+    }
+
+    uint8_t *mask = arena->scratchMask(num_anchor);
+    bool use_obj = Config::kScore == DetScoring::OBJ_X_CLS_SIGMOID && branch.obj.is_int8;
+    if (kPlanar) {
+      // one pass per class plane marks the anchors with any class over threshold
+      memset(mask, 0, num_anchor);
+      const int8_t *plane = branch.cls.i8() + branch.cls_offset * grid_size;
+      for (int c = 0; c < param.num_cls; c++) {
+        int8_mark_ge(plane + c * grid_size, grid_size, cls_th, mask);
+      }
+    } else if (use_obj) {
+      // the objectness plane is contiguous, the product can not exceed sigmoid(objectness)
+      int obj_th = det_int8_threshold(inverse_th, branch.obj.qscale);
+      memset(mask, 0, num_anchor);
+      if (obj_th <= 127) int8_mark_ge(branch.obj.i8(), num_anchor, obj_th, mask);
+    } else {
+      memset(mask, 1, num_anchor);
+    }
+
+    int rejected = 0;
+    const int8_t *cls = branch.cls.i8();
+    for (int a = 0; a < num_anchor; a++) {
+      if (!mask[a]) {
+        rejected++;
+        continue;
+      }
+      if (!kPlanar) {
+        const int8_t *p = cls + a * branch.cls.channel + branch.cls_offset;
+        if (!int8_any_ge(p, param.num_cls, cls_th)) {
+          rejected++;
+          continue;
+        }
+      }
+      decodeAnchor<int8_t>(branch, param, inverse_th, a, arena);
+    }
+    arena->addScanned(num_anchor, rejected);
+  }
+
+  // a = anchor_in_grid * grid_size + grid_idx
+  template <typename T>
+  static void decodeAnchor(const DetHeadBranch &branch, const DetDecodeParam &param,
+                           float inverse_th, int a, DetCandidateArena *arena) {
+    const int grid_size = branch.gridSize();
+    const int cls_step = kPlanar ? grid_size : 1;
+    const int k = a / grid_size;
+    const int g = a - k * grid_size;
+
+    float score;
+    if (Config::kScore == DetScoring::OBJ_X_CLS_SIGMOID) {
+      // the product can not exceed sigmoid(objectness)
+      float obj_logit = branch.obj.at(a);
+      if (obj_logit < inverse_th) return;
+      score = 1.f / (1.f + expf(-obj_logit));
+    } else {
+      score = 1.f;
+    }
+
+    const T *p = data<T>(branch.cls) + offset(branch.cls, grid_size, a, branch.cls_offset);
+    int label = det_argmax<T>(p, cls_step, param.num_cls);
+    float logit = p[label * cls_step] * branch.cls.qscale;
+    if (Config::kScore == DetScoring::CLS_SIGMOID) {
+      if (logit < inverse_th) return;
+      score = 1.f / (1.f + expf(-logit));
+    } else {
+      score *= 1.f / (1.f + expf(-logit));
+      if (score < param.score_threshold) return;
+    }
+
+    const int grid_w = branch.gridW();
+    float box[4];
+    decodeBox(branch, param, grid_size, a, k, g % grid_w, g / grid_w, box);
+    if (Config::kClip != DetClip::NONE) {
+      clip_box_xyxy(param.clip_width, param.clip_height, &box[0], &box[1], &box[2], &box[3]);
+    }
+    if (Config::kClip == DetClip::CLIP_MIN_SIZE &&
+        (box[2] - box[0] <= 1 || box[3] - box[1] <= 1)) {
+      return;
+    }
+    arena->push(box[0], box[1], box[2], box[3], score, label);
+  }
+
+  static void decodeBox(const DetHeadBranch &branch, const DetDecodeParam &param, int grid_size,
+                        int a, int anchor_in_grid, int grid_x, int grid_y, float box[4]) {
+    const DetTensorView &view = branch.box;
+    float sx = branch.stride_x;
+    float sy = branch.stride_y;
+
+    if (Config::kBox == DetBoxCoding::DFL_LTRB) {
+      float logits[4 * DFL_MAX_REG];
+      int count = 4 * param.reg_max;
+      if (kPlanar) {
+        view.gatherPlanar(a, 0, count, logits);
+      } else {
+        for (int c = 0; c < count; c++) logits[c] = view.at(offset(view, grid_size, a, c));
+      }
+      float dist[4];
+      dfl_decode(logits, param.reg_max, dist);
+      ltrbToBox(dist, grid_x, grid_y, sx, sy, box);
+      return;
+    }
+
+    float v[4];
+    for (int c = 0; c < 4; c++) v[c] = view.at(offset(view, grid_size, a, c));
+
+    if (Config::kBox == DetBoxCoding::LTRB) {
+      ltrbToBox(v, grid_x, grid_y, sx, sy, box);
+    } else if (Config::kBox == DetBoxCoding::XYWH_ANCHOR) {
+      for (int c = 0; c < 4; c++) v[c] = 1.f / (1.f + expf(-v[c]));
+      float pw = branch.anchors[anchor_in_grid * 2];
+      float ph = branch.anchors[anchor_in_grid * 2 + 1];
+      float x = (2 * v[0] - 0.5f + grid_x) * sx;
+      float y = (2 * v[1] - 0.5f + grid_y) * sy;
+      float w = (v[2] * 2) * (v[2] * 2) * pw;
+      float h = (v[3] * 2) * (v[3] * 2) * ph;
+      box[0] = x - w / 2;
+      box[1] = y - h / 2;
+      box[2] = x + w / 2;
+      box[3] = y + h / 2;
+    } else {
+      float x = (v[0] + grid_x) * sx;
+      float y = (v[1] + grid_y) * sy;
+      float w = expf(v[2]) * sx;
+      float h = expf(v[3]) * sy;
+      box[0] = x - w * 0.5f;
+      box[1] = y - h * 0.5f;
+      box[2] = box[0] + w;
+      box[3] = box[1] + h;
+    }
+  }
+
+  static void ltrbToBox(const float dist[4], int grid_x, int grid_y, float sx, float sy,
+                        float box[4]) {
+    float cx = grid_x + 0.5f;
+    float cy = grid_y + 0.5f;
+    box[0] = (cx - dist[0]) * sx;
+    box[1] = (cy - dist[1]) * sy;
+    box[2] = (cx + dist[2]) * sx;
+    box[3] = (cy + dist[3]) * sy;
+  }
+};
+
+}  // namespace cvitdl
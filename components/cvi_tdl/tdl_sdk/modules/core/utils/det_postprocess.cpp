@@ -0,0 +1,229 @@
+#include "det_postprocess.hpp"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <numeric>
+
+#include "core/cvi_tdl_types_mem_internal.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DET_USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define DET_USE_SSE
+#endif
+
+namespace cvitdl {
+
+// cephes expf: exp(x) = 2^n * exp(r), r in [-ln2/2, ln2/2], degree 5 polynomial for exp(r)
+static const float kExpHi = 88.3762626647949f;
+static const float kExpLo = -88.3762626647949f;
+static const float kLog2e = 1.44269504088896341f;
+static const float kLn2Hi = 0.693359375f;
+static const float kLn2Lo = -2.12194440e-4f;
+static const float kExpP0 = 1.9875691500E-4f;
+static const float kExpP1 = 1.3981999507E-3f;
+static const float kExpP2 = 8.3334519073E-3f;
+static const float kExpP3 = 4.1665795894E-2f;
+static const float kExpP4 = 1.6666665459E-1f;
+static const float kExpP5 = 5.0000001201E-1f;
+
+static inline float exp_scalar(float x) {
+  x = std::min(std::max(x, kExpLo), kExpHi);
+  float fx = floorf(x * kLog2e + 0.5f);
+  x = x - fx * kLn2Hi - fx * kLn2Lo;
+  float y = kExpP0;
+  y = y * x + kExpP1;
+  y = y * x + kExpP2;
+  y = y * x + kExpP3;
+  y = y * x + kExpP4;
+  y = y * x + kExpP5;
+  y = y * x * x + x + 1.f;
+  union {
+    int32_t i;
+    float f;
+  } pow2n;
+  pow2n.i = (static_cast<int32_t>(fx) + 127) << 23;
+  return y * pow2n.f;
+}
+
+void exp_inplace(float *data, int n) {
+  int i = 0;
+#if defined(DET_USE_NEON)
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t x = vld1q_f32(data + i);
+    x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(kExpLo)), vdupq_n_f32(kExpHi));
+    float32x4_t fx = vmlaq_f32(vdupq_n_f32(0.5f), x, vdupq_n_f32(kLog2e));
+    // floor: truncate then subtract 1 where truncation rounded up
+    float32x4_t tmp = vcvtq_f32_s32(vcvtq_s32_f32(fx));
+    uint32x4_t mask = vcgtq_f32(tmp, fx);
+    uint32x4_t one = vandq_u32(mask, vreinterpretq_u32_f32(vdupq_n_f32(1.f)));
+    fx = vsubq_f32(tmp, vreinterpretq_f32_u32(one));
+    x = vmlsq_f32(x, fx, vdupq_n_f32(kLn2Hi));
+    x = vmlsq_f32(x, fx, vdupq_n_f32(kLn2Lo));
+    float32x4_t y = vdupq_n_f32(kExpP0);
+    y = vmlaq_f32(vdupq_n_f32(kExpP1), y, x);
+    y = vmlaq_f32(vdupq_n_f32(kExpP2), y, x);
+    y = vmlaq_f32(vdupq_n_f32(kExpP3), y, x);
+    y = vmlaq_f32(vdupq_n_f32(kExpP4), y, x);
+    y = vmlaq_f32(vdupq_n_f32(kExpP5), y, x);
+    y = vmlaq_f32(vaddq_f32(x, vdupq_n_f32(1.f)), y, vmulq_f32(x, x));
+    int32x4_t pow2n = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(fx), vdupq_n_s32(127)), 23);
+    vst1q_f32(data + i, vmulq_f32(y, vreinterpretq_f32_s32(pow2n)));
+  }
+#elif defined(DET_USE_SSE)
+  for (; i + 4 <= n; i += 4) {
+    __m128 x = _mm_loadu_ps(data + i);
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(kExpLo)), _mm_set1_ps(kExpHi));
+    __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(kLog2e)), _mm_set1_ps(0.5f));
+    __m128 tmp = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+    __m128 mask = _mm_and_ps(_mm_cmpgt_ps(tmp, fx), _mm_set1_ps(1.f));
+    fx = _mm_sub_ps(tmp, mask);
+    x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(kLn2Hi)));
+    x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(kLn2Lo)));
+    __m128 y = _mm_set1_ps(kExpP0);
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP1));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP2));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP3));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP4));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP5));
+    y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(x, x)), x), _mm_set1_ps(1.f));
+    __m128i pow2n = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127)), 23);
+    _mm_storeu_ps(data + i, _mm_mul_ps(y, _mm_castsi128_ps(pow2n)));
+  }
+#endif
+  for (; i < n; i++) data[i] = exp_scalar(data[i]);
+}
+
+void int8_mark_ge(const int8_t *data, int n, int8_t th, uint8_t *mask) {
+  int i = 0;
+#if defined(DET_USE_NEON)
+  int8x16_t vth = vdupq_n_s8(th);
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t ge = vcgeq_s8(vld1q_s8(data + i), vth);
+    vst1q_u8(mask + i, vorrq_u8(vld1q_u8(mask + i), ge));
+  }
+#elif defined(DET_USE_SSE)
+  if (th == INT8_MIN) {
+    memset(mask, 1, n);
+    return;
+  }
+  __m128i vth = _mm_set1_epi8(static_cast<char>(th - 1));
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    __m128i *p = reinterpret_cast<__m128i *>(mask + i);
+    _mm_storeu_si128(p, _mm_or_si128(_mm_loadu_si128(p), _mm_cmpgt_epi8(x, vth)));
+  }
+#endif
+  for (; i < n; i++) mask[i] |= data[i] >= th;
+}
+
+bool int8_any_ge(const int8_t *data, int n, int8_t th) {
+  int i = 0;
+#if defined(DET_USE_NEON)
+  int8x16_t vth = vdupq_n_s8(th);
+  uint8x16_t acc = vdupq_n_u8(0);
+  for (; i + 16 <= n; i += 16) acc = vorrq_u8(acc, vcgeq_s8(vld1q_s8(data + i), vth));
+  uint64x2_t acc64 = vreinterpretq_u64_u8(acc);
+  if (vgetq_lane_u64(acc64, 0) | vgetq_lane_u64(acc64, 1)) return true;
+#elif defined(DET_USE_SSE)
+  if (th == INT8_MIN) return n > 0;
+  __m128i vth = _mm_set1_epi8(static_cast<char>(th - 1));
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    acc = _mm_or_si128(acc, _mm_cmpgt_epi8(x, vth));
+  }
+  if (_mm_movemask_epi8(acc)) return true;
+#endif
+  for (; i < n; i++) {
+    if (data[i] >= th) return true;
+  }
+  return false;
+}
+
+void DetTensorView::gatherPlanar(int anchor_idx, int channel_offset, int count, float *out) const {
+  if (is_int8) {
+    const int8_t *p = i8() + channel_offset * num_anchor + anchor_idx;
+    for (int c = 0; c < count; c++) out[c] = p[c * num_anchor] * qscale;
+  } else {
+    const float *p = f32() + channel_offset * num_anchor + anchor_idx;
+    for (int c = 0; c < count; c++) out[c] = p[c * num_anchor];
+  }
+}
+
+void dfl_decode(const float *logits, int reg_max, float dist[4]) {
+  float prob[4 * DFL_MAX_REG];
+  for (int i = 0; i < 4; i++) {
+    const float *src = logits + i * reg_max;
+    float *dst = prob + i * reg_max;
+    float max_logit = src[0];
+    for (int j = 1; j < reg_max; j++) max_logit = std::max(max_logit, src[j]);
+    for (int j = 0; j < reg_max; j++) dst[j] = src[j] - max_logit;
+  }
+  exp_inplace(prob, 4 * reg_max);
+  for (int i = 0; i < 4; i++) {
+    const float *p = prob + i * reg_max;
+    float sum = 0;
+    float sum_val = 0;
+    for (int j = 0; j < reg_max; j++) {
+      sum += p[j];
+      sum_val += p[j] * j;
+    }
+    dist[i] = sum_val / sum;
+  }
+}
+
+DetCandidateArena::DetCandidateArena(int capacity) : capacity_(capacity) {}
+
+void DetCandidateArena::setCapacity(int capacity) {
+  capacity_ = capacity;
+  engine_.reserve(capacity);
+  keep_.reserve(capacity);
+}
+
+const std::vector<int> &DetCandidateArena::nms(float iou_threshold) {
+  cfg_.iou_threshold = iou_threshold;
+  engine_.run(cfg_, keep_);
+  return keep_;
+}
+
+const std::vector<int> &DetCandidateArena::nms(const NmsConfig &cfg) {
+  engine_.run(cfg, keep_);
+  return keep_;
+}
+
+const std::vector<int> &DetCandidateArena::topk(uint32_t max_det) {
+  keep_.resize(engine_.size());
+  std::iota(keep_.begin(), keep_.end(), 0);
+  size_t num_to_keep = std::min<size_t>(keep_.size(), max_det);
+  const float *scores = engine_.scores();
+  std::partial_sort(keep_.begin(), keep_.begin() + num_to_keep, keep_.end(),
+                    [scores](int a, int b) {
+                      return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+                    });
+  keep_.resize(num_to_keep);
+  return keep_;
+}
+
+void DetCandidateArena::exportObjects(const std::vector<int> &keep, cvtdl_object_t *obj,
+                                      int im_height, int im_width) const {
+  CVI_TDL_MemAllocInit(keep.size(), obj);
+  obj->height = im_height;
+  obj->width = im_width;
+  memset(obj->info, 0, sizeof(cvtdl_object_info_t) * obj->size);
+
+  for (uint32_t i = 0; i < obj->size; ++i) {
+    int k = keep[i];
+    obj->info[i].bbox.x1 = engine_.x1(k);
+    obj->info[i].bbox.y1 = engine_.y1(k);
+    obj->info[i].bbox.x2 = engine_.x2(k);
+    obj->info[i].bbox.y2 = engine_.y2(k);
+    obj->info[i].bbox.score = engine_.score(k);
+    obj->info[i].classes = engine_.label(k);
+  }
+}
+
+}  // namespace cvitdl
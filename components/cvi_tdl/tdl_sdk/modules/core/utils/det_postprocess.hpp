@@ -0,0 +1,148 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+#include "core/object/cvtdl_object_types.h"
+#include "nms_engine.hpp"
+
+namespace cvitdl {
+
+/**
+ * An output tensor of a detection head, resolved once in onModelOpened so the per-frame parsers
+ * do not go through the string keyed tensor map. The raw pointer of a cvimodel output does not
+ * change between forwards.
+ */
+struct DetTensorView {
+  const void *ptr = nullptr;
+  float qscale = 1.f;  // 1 for float tensors
+  bool is_int8 = false;
+  int channel = 0;
+  int feat_h = 0;
+  int feat_w = 0;
+  int num_anchor = 0;
+
+  const int8_t *i8() const { return static_cast<const int8_t *>(ptr); }
+  const float *f32() const { return static_cast<const float *>(ptr); }
+  float at(int idx) const { return is_int8 ? i8()[idx] * qscale : f32()[idx]; }
+  bool valid() const { return ptr != nullptr; }
+
+  // dequantize count channels of anchor_idx from a channel-major (c x h x w) tensor
+  void gatherPlanar(int anchor_idx, int channel_offset, int count, float *out) const;
+};
+
+// largest reg_max supported by dfl_decode
+#define DFL_MAX_REG 32
+
+/**
+ * Softmax expectation of a distribution focal loss head (yolov8/yolov10).
+ * logits holds 4 groups of reg_max values (left, top, right, bottom), dist receives the
+ * expected distance of each group in units of stride.
+ */
+void dfl_decode(const float *logits, int reg_max, float dist[4]);
+
+// data[i] = exp(data[i]), polynomial approximation vectorized with NEON/SSE
+void exp_inplace(float *data, int n);
+
+/**
+ * int8 prefilter kernels (NEON/SSE with scalar tail) used to reject anchors on raw quantized
+ * class scores. int8_mark_ge sets mask[i] to non-zero where data[i] >= th and leaves the other
+ * entries untouched, int8_any_ge tells whether any of the n values reaches th.
+ */
+void int8_mark_ge(const int8_t *data, int n, int8_t th, uint8_t *mask);
+bool int8_any_ge(const int8_t *data, int n, int8_t th);
+
+inline float fast_sigmoid(float x) {
+  float v = -x;
+  exp_inplace(&v, 1);
+  return 1.f / (1.f + v);
+}
+
+// same rule as clip_bbox in object_utils, coordinates >= size are set to size - 1
+inline void clip_box_xyxy(float width, float height, float *x1, float *y1, float *x2, float *y2) {
+  if (*x1 < 0) *x1 = 0;
+  if (*y1 < 0) *y1 = 0;
+  if (*x2 < 0) *x2 = 0;
+  if (*y2 < 0) *y2 = 0;
+  if (*x1 >= width) *x1 = width - 1;
+  if (*y1 >= height) *y1 = height - 1;
+  if (*x2 >= width) *x2 = width - 1;
+  if (*y2 >= height) *y2 = height - 1;
+}
+
+/**
+ * Fixed capacity store for decoded candidates, owned by a model and reused for every frame.
+ * Candidates land directly in the NMS buffers, so once warmed up a frame with thousands of
+ * anchors over threshold performs no heap allocation in the parser.
+ */
+class DetCandidateArena {
+ public:
+  static const int kDefaultCapacity = 8192;
+
+  explicit DetCandidateArena(int capacity = kDefaultCapacity);
+
+  // reserve storage for capacity candidates, models call it with their anchor count once the
+  // output shapes are known
+  void setCapacity(int capacity);
+
+  void reset() {
+    engine_.clear();
+    dropped_ = 0;
+    scanned_ = 0;
+    early_rejected_ = 0;
+  }
+
+  // returns false and counts the candidate as dropped when the arena is full
+  bool push(float x1, float y1, float x2, float y2, float score, int label) {
+    if (static_cast<int>(engine_.size()) >= capacity_) {
+      dropped_++;
+      return false;
+    }
+    engine_.push(x1, y1, x2, y2, score, label);
+    return true;
+  }
+
+  int size() const { return static_cast<int>(engine_.size()); }
+  int capacity() const { return capacity_; }
+  int dropped() const { return dropped_; }
+
+  // anchor statistics of the current frame, filled by DetDecoder
+  void addScanned(int scanned, int early_rejected) {
+    scanned_ += scanned;
+    early_rejected_ += early_rejected;
+  }
+  int scanned() const { return scanned_; }
+  int earlyRejected() const { return early_rejected_; }
+
+  // per-anchor scratch flags reused across frames
+  uint8_t *scratchMask(int n) {
+    if (static_cast<int>(mask_.size()) < n) mask_.resize(n);
+    return mask_.data();
+  }
+
+  // run nms, the kept indices are returned sorted by descending score
+  const std::vector<int> &nms(float iou_threshold);
+  const std::vector<int> &nms(const NmsConfig &cfg);
+  // top max_det candidates by score without suppression (yolov10)
+  const std::vector<int> &topk(uint32_t max_det);
+
+  /**
+   * Fill obj with the kept candidates in nn input coordinates. obj->width/height are set to
+   * the given input size, the caller rescales to frame size afterwards.
+   */
+  void exportObjects(const std::vector<int> &keep, cvtdl_object_t *obj, int im_height,
+                     int im_width) const;
+
+  const NmsEngine &engine() const { return engine_; }
+
+ private:
+  NmsEngine engine_;
+  NmsConfig cfg_;
+  std::vector<int> keep_;
+  std::vector<uint8_t> mask_;
+  int capacity_;
+  int dropped_ = 0;
+  int scanned_ = 0;
+  int early_rejected_ = 0;
+};
+
+}  // namespace cvitdl
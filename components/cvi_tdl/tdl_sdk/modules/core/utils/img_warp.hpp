@@ -3,6 +3,12 @@
 
 namespace cvitdl {
 int get_face_transform(const float* landmark_pts, const int width, float* transform);
+
+/**
+ * Bilinear affine warp of packed RGB (or BGR) with a black border, fM is the 2x3 forward
+ * transform from source to destination as get_face_transform gives. Output matches
+ * cv::warpAffine(INTER_LINEAR, BORDER_CONSTANT) bit for bit.
+ */
 void warp_affine(const unsigned char* src_data, unsigned int src_step, int src_width,
                  int src_height, unsigned char* dst_data, unsigned int dst_step, int dst_width,
                  int dst_height, float* fM);
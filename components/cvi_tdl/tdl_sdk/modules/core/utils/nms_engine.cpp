@@ -0,0 +1,262 @@
+#include "nms_engine.hpp"
+
+#include <math.h>
+#include <algorithm>
+#include <numeric>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NMS_USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define NMS_USE_SSE
+#endif
+
+namespace cvitdl {
+
+// labels are class ids in practice, beyond this range fall back to a comparison sort
+static const int kMaxDirectLabelRange = 4096;
+
+void nms_suppress_row(float x1, float y1, float x2, float y2, float area, const float *bx1,
+                      const float *by1, const float *bx2, const float *by2, const float *barea,
+                      int n, float iou_threshold, uint32_t *suppressed) {
+  int j = 0;
+#if defined(NMS_USE_NEON)
+  float32x4_t vx1 = vdupq_n_f32(x1);
+  float32x4_t vy1 = vdupq_n_f32(y1);
+  float32x4_t vx2 = vdupq_n_f32(x2);
+  float32x4_t vy2 = vdupq_n_f32(y2);
+  float32x4_t varea = vdupq_n_f32(area);
+  float32x4_t vth = vdupq_n_f32(iou_threshold);
+  float32x4_t vzero = vdupq_n_f32(0.f);
+  for (; j + 4 <= n; j += 4) {
+    float32x4_t xx1 = vmaxq_f32(vx1, vld1q_f32(bx1 + j));
+    float32x4_t yy1 = vmaxq_f32(vy1, vld1q_f32(by1 + j));
+    float32x4_t xx2 = vminq_f32(vx2, vld1q_f32(bx2 + j));
+    float32x4_t yy2 = vminq_f32(vy2, vld1q_f32(by2 + j));
+    float32x4_t w = vmaxq_f32(vzero, vsubq_f32(xx2, xx1));
+    float32x4_t h = vmaxq_f32(vzero, vsubq_f32(yy2, yy1));
+    float32x4_t inter = vmulq_f32(w, h);
+    float32x4_t uni = vsubq_f32(vaddq_f32(varea, vld1q_f32(barea + j)), inter);
+    uint32x4_t mask = vcgtq_f32(inter, vmulq_f32(vth, uni));
+    vst1q_u32(suppressed + j, vorrq_u32(vld1q_u32(suppressed + j), mask));
+  }
+#elif defined(NMS_USE_SSE)
+  __m128 vx1 = _mm_set1_ps(x1);
+  __m128 vy1 = _mm_set1_ps(y1);
+  __m128 vx2 = _mm_set1_ps(x2);
+  __m128 vy2 = _mm_set1_ps(y2);
+  __m128 varea = _mm_set1_ps(area);
+  __m128 vth = _mm_set1_ps(iou_threshold);
+  __m128 vzero = _mm_setzero_ps();
+  for (; j + 4 <= n; j += 4) {
+    __m128 xx1 = _mm_max_ps(vx1, _mm_loadu_ps(bx1 + j));
+    __m128 yy1 = _mm_max_ps(vy1, _mm_loadu_ps(by1 + j));
+    __m128 xx2 = _mm_min_ps(vx2, _mm_loadu_ps(bx2 + j));
+    __m128 yy2 = _mm_min_ps(vy2, _mm_loadu_ps(by2 + j));
+    __m128 w = _mm_max_ps(vzero, _mm_sub_ps(xx2, xx1));
+    __m128 h = _mm_max_ps(vzero, _mm_sub_ps(yy2, yy1));
+    __m128 inter = _mm_mul_ps(w, h);
+    __m128 uni = _mm_sub_ps(_mm_add_ps(varea, _mm_loadu_ps(barea + j)), inter);
+    __m128i mask = _mm_castps_si128(_mm_cmpgt_ps(inter, _mm_mul_ps(vth, uni)));
+    __m128i *p = reinterpret_cast<__m128i *>(suppressed + j);
+    _mm_storeu_si128(p, _mm_or_si128(_mm_loadu_si128(p), mask));
+  }
+#endif
+  for (; j < n; j++) {
+    float w = std::max(0.0f, std::min(x2, bx2[j]) - std::max(x1, bx1[j]));
+    float h = std::max(0.0f, std::min(y2, by2[j]) - std::max(y1, by1[j]));
+    float inter = w * h;
+    float uni = area + barea[j] - inter;
+    if (inter > iou_threshold * uni) suppressed[j] = 0xFFFFFFFFu;
+  }
+}
+
+void NmsEngine::reserve(size_t num_boxes) {
+  x1_.reserve(num_boxes);
+  y1_.reserve(num_boxes);
+  x2_.reserve(num_boxes);
+  y2_.reserve(num_boxes);
+  score_.reserve(num_boxes);
+  label_.reserve(num_boxes);
+  bucket_items_.reserve(num_boxes);
+}
+
+void NmsEngine::clear() {
+  x1_.clear();
+  y1_.clear();
+  x2_.clear();
+  y2_.clear();
+  score_.clear();
+  label_.clear();
+}
+
+void NmsEngine::buildBuckets(bool class_agnostic) {
+  int n = static_cast<int>(score_.size());
+  bucket_items_.resize(n);
+  bucket_offsets_.clear();
+  if (n == 0) return;
+
+  if (class_agnostic) {
+    std::iota(bucket_items_.begin(), bucket_items_.end(), 0);
+    bucket_offsets_.push_back(0);
+    bucket_offsets_.push_back(n);
+    return;
+  }
+
+  auto mm = std::minmax_element(label_.begin(), label_.end());
+  int min_label = *mm.first;
+  int64_t range = static_cast<int64_t>(*mm.second) - min_label + 1;
+  if (range <= kMaxDirectLabelRange) {
+    // counting sort by label, empty buckets are skipped by run()
+    label_slot_.assign(range + 1, 0);
+    for (int i = 0; i < n; i++) label_slot_[label_[i] - min_label + 1]++;
+    for (int64_t b = 0; b < range; b++) label_slot_[b + 1] += label_slot_[b];
+    bucket_offsets_.assign(label_slot_.begin(), label_slot_.end());
+    for (int i = 0; i < n; i++) bucket_items_[label_slot_[label_[i] - min_label]++] = i;
+    return;
+  }
+
+  std::iota(bucket_items_.begin(), bucket_items_.end(), 0);
+  const std::vector<int> &labels = label_;
+  std::stable_sort(bucket_items_.begin(), bucket_items_.end(),
+                   [&labels](int a, int b) { return labels[a] < labels[b]; });
+  bucket_offsets_.push_back(0);
+  for (int i = 1; i < n; i++) {
+    if (labels[bucket_items_[i]] != labels[bucket_items_[i - 1]]) bucket_offsets_.push_back(i);
+  }
+  bucket_offsets_.push_back(n);
+}
+
+int NmsEngine::sortBucket(int *first, int *last, uint32_t topk) const {
+  const float *scores = score_.data();
+  auto cmp = [scores](int a, int b) {
+    return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+  };
+  int n = static_cast<int>(last - first);
+  if (topk != 0 && topk < static_cast<uint32_t>(n)) {
+    std::partial_sort(first, first + topk, last, cmp);
+    return static_cast<int>(topk);
+  }
+  std::sort(first, last, cmp);
+  return n;
+}
+
+void NmsEngine::gather(const int *idx, int n) {
+  bx1_.resize(n);
+  by1_.resize(n);
+  bx2_.resize(n);
+  by2_.resize(n);
+  barea_.resize(n);
+  bscore_.resize(n);
+  for (int k = 0; k < n; k++) {
+    int i = idx[k];
+    bx1_[k] = x1_[i];
+    by1_[k] = y1_[i];
+    bx2_[k] = x2_[i];
+    by2_[k] = y2_[i];
+    barea_[k] = (x2_[i] - x1_[i]) * (y2_[i] - y1_[i]);
+    bscore_[k] = score_[i];
+  }
+  suppressed_.assign(n, 0);
+}
+
+void NmsEngine::hardBucket(const int *idx, int n, float iou_threshold, bool diou,
+                           std::vector<int> &keep) {
+  gather(idx, n);
+  const float *bx1 = bx1_.data();
+  const float *by1 = by1_.data();
+  const float *bx2 = bx2_.data();
+  const float *by2 = by2_.data();
+  const float *barea = barea_.data();
+  uint32_t *suppressed = suppressed_.data();
+
+  for (int i = 0; i < n; i++) {
+    if (suppressed[i]) continue;
+    keep.push_back(idx[i]);
+    if (!diou) {
+      nms_suppress_row(bx1[i], by1[i], bx2[i], by2[i], barea[i], bx1 + i + 1, by1 + i + 1,
+                       bx2 + i + 1, by2 + i + 1, barea + i + 1, n - i - 1, iou_threshold,
+                       suppressed + i + 1);
+      continue;
+    }
+    float icx = (bx1[i] + bx2[i]) * 0.5f;
+    float icy = (by1[i] + by2[i]) * 0.5f;
+    for (int j = i + 1; j < n; j++) {
+      if (suppressed[j]) continue;
+      float w = std::max(0.0f, std::min(bx2[i], bx2[j]) - std::max(bx1[i], bx1[j]));
+      float h = std::max(0.0f, std::min(by2[i], by2[j]) - std::max(by1[i], by1[j]));
+      float inter = w * h;
+      float uni = barea[i] + barea[j] - inter;
+      float iou = uni > 0 ? inter / uni : 0.f;
+      float cw = std::max(bx2[i], bx2[j]) - std::min(bx1[i], bx1[j]);
+      float ch = std::max(by2[i], by2[j]) - std::min(by1[i], by1[j]);
+      float diag = cw * cw + ch * ch;
+      float dx = (bx1[j] + bx2[j]) * 0.5f - icx;
+      float dy = (by1[j] + by2[j]) * 0.5f - icy;
+      float penalty = diag > 0 ? (dx * dx + dy * dy) / diag : 0.f;
+      if (iou - penalty > iou_threshold) suppressed[j] = 1;
+    }
+  }
+}
+
+void NmsEngine::softBucket(const int *idx, int n, const NmsConfig &cfg, std::vector<int> &keep) {
+  gather(idx, n);
+  float *bscore = bscore_.data();
+  uint32_t *removed = suppressed_.data();
+  bool gaussian = cfg.mode == NmsMode::SOFT_GAUSSIAN;
+
+  for (int iter = 0; iter < n; iter++) {
+    int best = -1;
+    for (int j = 0; j < n; j++) {
+      if (!removed[j] && (best < 0 || bscore[j] > bscore[best])) best = j;
+    }
+    if (best < 0 || bscore[best] < cfg.soft_score_threshold) break;
+    removed[best] = 1;
+    keep.push_back(idx[best]);
+
+    for (int j = 0; j < n; j++) {
+      if (removed[j]) continue;
+      float w = std::max(0.0f, std::min(bx2_[best], bx2_[j]) - std::max(bx1_[best], bx1_[j]));
+      float h = std::max(0.0f, std::min(by2_[best], by2_[j]) - std::max(by1_[best], by1_[j]));
+      float inter = w * h;
+      float uni = barea_[best] + barea_[j] - inter;
+      float iou = uni > 0 ? inter / uni : 0.f;
+      float weight = 1.f;
+      if (gaussian) {
+        weight = expf(-(iou * iou) / cfg.soft_sigma);
+      } else if (iou > cfg.iou_threshold) {
+        weight = 1.f - iou;
+      }
+      bscore[j] *= weight;
+      if (bscore[j] < cfg.soft_score_threshold) removed[j] = 1;
+    }
+  }
+  for (int k = 0; k < n; k++) score_[idx[k]] = bscore[k];
+}
+
+void NmsEngine::run(const NmsConfig &cfg, std::vector<int> &keep) {
+  keep.clear();
+  buildBuckets(cfg.class_agnostic);
+
+  bool soft = cfg.mode == NmsMode::SOFT_LINEAR || cfg.mode == NmsMode::SOFT_GAUSSIAN;
+  for (size_t b = 0; b + 1 < bucket_offsets_.size(); b++) {
+    int *first = bucket_items_.data() + bucket_offsets_[b];
+    int *last = bucket_items_.data() + bucket_offsets_[b + 1];
+    if (first == last) continue;
+    int n = sortBucket(first, last, cfg.topk_per_class);
+    if (soft) {
+      softBucket(first, n, cfg, keep);
+    } else {
+      hardBucket(first, n, cfg.iou_threshold, cfg.mode == NmsMode::DIOU, keep);
+    }
+  }
+
+  const float *scores = score_.data();
+  std::sort(keep.begin(), keep.end(), [scores](int a, int b) {
+    return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+  });
+  if (cfg.max_det != 0 && keep.size() > cfg.max_det) keep.resize(cfg.max_det);
+}
+
+}  // namespace cvitdl
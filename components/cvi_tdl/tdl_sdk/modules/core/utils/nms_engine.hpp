@@ -0,0 +1,101 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace cvitdl {
+
+enum class NmsMode {
+  HARD = 0,       // classic greedy suppression
+  SOFT_LINEAR,    // score *= (1 - iou) when iou > threshold
+  SOFT_GAUSSIAN,  // score *= exp(-iou^2 / sigma)
+  DIOU,           // suppress when iou - center_dist^2 / enclose_diag^2 > threshold
+};
+
+struct NmsConfig {
+  float iou_threshold = 0.5f;
+  NmsMode mode = NmsMode::HARD;
+  float soft_sigma = 0.5f;
+  // soft-nms drops candidates whose decayed score falls below this value
+  float soft_score_threshold = 0.001f;
+  // keep at most topk_per_class candidates per class before suppression, 0 means all
+  uint32_t topk_per_class = 0;
+  // truncate the merged result, 0 means unlimited
+  uint32_t max_det = 0;
+  // treat all labels as one class
+  bool class_agnostic = false;
+};
+
+/**
+ * NMS on a flat structure-of-arrays box buffer.
+ *
+ * Candidates are pushed once (x1,y1,x2,y2,score,label), bucketed per class and suppressed
+ * class by class, so boxes with different labels are never compared. Each bucket is gathered
+ * into contiguous scratch arrays and the IoU of the current box against the rest of the bucket
+ * is computed by a NEON/SSE kernel (plain loop elsewhere). All buffers are reused across calls,
+ * so an engine owned by a model performs no allocation once warmed up.
+ */
+class NmsEngine {
+ public:
+  NmsEngine() = default;
+
+  void reserve(size_t num_boxes);
+  void clear();
+  size_t size() const { return score_.size(); }
+
+  // returns the index of the candidate, which is what run() reports in keep
+  int push(float x1, float y1, float x2, float y2, float score, int label) {
+    x1_.push_back(x1);
+    y1_.push_back(y1);
+    x2_.push_back(x2);
+    y2_.push_back(y2);
+    score_.push_back(score);
+    label_.push_back(label);
+    return static_cast<int>(score_.size()) - 1;
+  }
+
+  /**
+   * Run suppression. keep receives the candidate indices that survive, ordered by descending
+   * score (ties by ascending index). With soft modes the decayed scores are available through
+   * score() afterwards.
+   */
+  void run(const NmsConfig &cfg, std::vector<int> &keep);
+
+  float x1(int idx) const { return x1_[idx]; }
+  float y1(int idx) const { return y1_[idx]; }
+  float x2(int idx) const { return x2_[idx]; }
+  float y2(int idx) const { return y2_[idx]; }
+  float score(int idx) const { return score_[idx]; }
+  int label(int idx) const { return label_[idx]; }
+  const float *scores() const { return score_.data(); }
+
+ private:
+  void buildBuckets(bool class_agnostic);
+  int sortBucket(int *first, int *last, uint32_t topk) const;
+  void gather(const int *idx, int n);
+  void hardBucket(const int *idx, int n, float iou_threshold, bool diou, std::vector<int> &keep);
+  void softBucket(const int *idx, int n, const NmsConfig &cfg, std::vector<int> &keep);
+
+  // candidate SoA
+  std::vector<float> x1_, y1_, x2_, y2_, score_;
+  std::vector<int> label_;
+
+  // class buckets, bucket b holds bucket_items_[bucket_offsets_[b], bucket_offsets_[b + 1])
+  std::vector<int> bucket_offsets_;
+  std::vector<int> bucket_items_;
+  std::vector<int> label_slot_;
+
+  // per-bucket gathered SoA scratch
+  std::vector<float> bx1_, by1_, bx2_, by2_, barea_, bscore_;
+  std::vector<uint32_t> suppressed_;
+};
+
+/**
+ * Computes iou of box (x1,y1,x2,y2,area) against n boxes and marks suppressed[j] when it exceeds
+ * iou_threshold. Entries already marked stay marked. Exposed for benchmarking.
+ */
+void nms_suppress_row(float x1, float y1, float x2, float y2, float area, const float *bx1,
+                      const float *by1, const float *bx2, const float *by2, const float *barea,
+                      int n, float iou_threshold, uint32_t *suppressed);
+
+}  // namespace cvitdl
@@ -1,6 +1,7 @@
 
 #include "object_utils.hpp"
 #include "core/object/cvtdl_object_types.h"
+#include "nms_engine.hpp"
 
 #include <math.h>
 #include <algorithm>
@@ -11,121 +12,55 @@ using namespace std;
 
 namespace cvitdl {
 
-static vector<size_t> sort_indexes(const Detections &v) {
-  // initialize original index locations
-  vector<size_t> idx(v.size());
-  iota(idx.begin(), idx.end(), 0);
-
-  // sort indexes based on comparing values in v
-  // using std::stable_sort instead of std::sort
-  // to avoid unnecessary index re-orderings
-  // when v contains elements of equal values
-  stable_sort(idx.begin(), idx.end(),
-              [&v](size_t i1, size_t i2) { return v[i1]->score > v[i2]->score; });
-  return idx;
-}
-
-static vector<size_t> calculate_area(const Detections &dets) {
-  vector<size_t> areas(dets.size());
-  for (size_t i = 0; i < dets.size(); i++) {
-    areas[i] = (dets[i]->x2 - dets[i]->x1) * (dets[i]->y2 - dets[i]->y1);
+static void nms_keep_indexes(const Detections &dets, float iou_threshold, vector<int> &order) {
+  // one engine per thread, its scratch buffers keep their capacity from frame to frame
+  thread_local NmsEngine engine;
+  engine.clear();
+  engine.reserve(dets.size());
+  for (const PtrDectRect &det : dets) {
+    engine.push(det->x1, det->y1, det->x2, det->y2, det->score, det->label);
   }
-  return areas;
+  NmsConfig cfg;
+  cfg.iou_threshold = iou_threshold;
+  engine.run(cfg, order);
 }
 
 Detections topk_dets(const Detections &dets, uint32_t max_det) {
-  vector<size_t> order = sort_indexes(dets);
+  vector<size_t> idx(dets.size());
+  iota(idx.begin(), idx.end(), 0);
 
-  uint32_t num_to_keep = dets.size() > max_det ? max_det : dets.size();
+  size_t num_to_keep = dets.size() > max_det ? max_det : dets.size();
+  partial_sort(idx.begin(), idx.begin() + num_to_keep, idx.end(), [&dets](size_t i1, size_t i2) {
+    return dets[i1]->score > dets[i2]->score || (dets[i1]->score == dets[i2]->score && i1 < i2);
+  });
   Detections final_dets(num_to_keep);
   for (size_t k = 0; k < num_to_keep; k++) {
-    final_dets[k] = dets[k];
+    final_dets[k] = dets[idx[k]];
   }
   return final_dets;
 }
 
 Detections nms_multi_class(const Detections &dets, float iou_threshold) {
-  vector<int> keep(dets.size(), 0);
-  vector<int> suppressed(dets.size(), 0);
-
-  size_t ndets = dets.size();
-  size_t num_to_keep = 0;
-
-  vector<size_t> order = sort_indexes(dets);
-  vector<size_t> areas = calculate_area(dets);
-
-  for (size_t _i = 0; _i < ndets; _i++) {
-    auto i = order[_i];
-    if (suppressed[i] == 1) continue;
-    keep[num_to_keep++] = i;
-    auto ix1 = dets[i]->x1;
-    auto iy1 = dets[i]->y1;
-    auto ix2 = dets[i]->x2;
-    auto iy2 = dets[i]->y2;
-    auto iarea = areas[i];
-
-    for (size_t _j = _i + 1; _j < ndets; _j++) {
-      auto j = order[_j];
-      if (suppressed[j] == 1) continue;
-      auto xx1 = std::max(ix1, dets[j]->x1);
-      auto yy1 = std::max(iy1, dets[j]->y1);
-      auto xx2 = std::min(ix2, dets[j]->x2);
-      auto yy2 = std::min(iy2, dets[j]->y2);
-
-      auto w = std::max(0.0f, xx2 - xx1);
-      auto h = std::max(0.0f, yy2 - yy1);
-      auto inter = w * h;
-      float ovr = static_cast<float>(inter) / (iarea + areas[j] - inter);
-      if (ovr > iou_threshold && dets[j]->label == dets[i]->label) suppressed[j] = 1;
-    }
-  }
+  vector<int> order;
+  nms_keep_indexes(dets, iou_threshold, order);
 
-  Detections final_dets(num_to_keep);
-  for (size_t k = 0; k < num_to_keep; k++) {
-    final_dets[k] = dets[keep[k]];
+  Detections final_dets(order.size());
+  for (size_t k = 0; k < order.size(); k++) {
+    final_dets[k] = dets[order[k]];
   }
   return final_dets;
 }
 
 Detections nms_multi_class_with_ids(const Detections &dets, float iou_threshold,
                                     vector<int> &keep) {
-  vector<int> suppressed(dets.size(), 0);
-
-  size_t ndets = dets.size();
-  size_t num_to_keep = 0;
-
-  vector<size_t> order = sort_indexes(dets);
-  vector<size_t> areas = calculate_area(dets);
-
-  for (size_t _i = 0; _i < ndets; _i++) {
-    auto i = order[_i];
-    if (suppressed[i] == 1) continue;
-    keep[num_to_keep++] = i;
-    auto ix1 = dets[i]->x1;
-    auto iy1 = dets[i]->y1;
-    auto ix2 = dets[i]->x2;
-    auto iy2 = dets[i]->y2;
-    auto iarea = areas[i];
-
-    for (size_t _j = _i + 1; _j < ndets; _j++) {
-      auto j = order[_j];
-      if (suppressed[j] == 1) continue;
-      auto xx1 = std::max(ix1, dets[j]->x1);
-      auto yy1 = std::max(iy1, dets[j]->y1);
-      auto xx2 = std::min(ix2, dets[j]->x2);
-      auto yy2 = std::min(iy2, dets[j]->y2);
-
-      auto w = std::max(0.0f, xx2 - xx1);
-      auto h = std::max(0.0f, yy2 - yy1);
-      auto inter = w * h;
-      float ovr = static_cast<float>(inter) / (iarea + areas[j] - inter);
-      if (ovr > iou_threshold && dets[j]->label == dets[i]->label) suppressed[j] = 1;
-    }
-  }
-
-  Detections final_dets(num_to_keep);
-  for (size_t k = 0; k < num_to_keep; k++) {
-    final_dets[k] = dets[keep[k]];
+  vector<int> order;
+  nms_keep_indexes(dets, iou_threshold, order);
+
+  if (keep.size() < order.size()) keep.resize(order.size());
+  Detections final_dets(order.size());
+  for (size_t k = 0; k < order.size(); k++) {
+    keep[k] = order[k];
+    final_dets[k] = dets[order[k]];
   }
   return final_dets;
 }
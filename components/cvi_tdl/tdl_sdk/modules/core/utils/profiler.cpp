@@ -132,3 +132,46 @@ void FpsProfiler::Summary() {
   cnts_ = 0;
   gettimeofday(&(start_), NULL);
 }
+
+/* =========================================== */
+/*                 RatioProfiler               */
+/* =========================================== */
+
+RatioProfiler::RatioProfiler(const std::string &name, int summary_cond_cnts)
+    : name_(name), summary_cond_cnts_(summary_cond_cnts) {}
+
+RatioProfiler::~RatioProfiler() {}
+
+void RatioProfiler::Add(uint64_t hits, uint64_t total) {
+  hits_ += hits;
+  total_ += total;
+  window_hits_ += hits;
+  window_total_ += total;
+  cnts_ += 1;
+  if (cnts_ >= summary_cond_cnts_) {
+    window_ratio_ = window_total_ > 0 ? float(window_hits_) / window_total_ : 0;
+#ifdef PERF_EVAL
+    std::cerr << "[" << name_ << "] ratio:" << window_ratio_ << ",total_ratio:" << Ratio()
+              << std::endl;
+#endif
+    cnts_ = 0;
+    window_hits_ = 0;
+    window_total_ = 0;
+  }
+}
+
+void RatioProfiler::Config(const std::string &name, int summary_cond_cnts) {
+  if (name.length() > 0) {
+    name_ = name;
+  }
+  summary_cond_cnts_ = summary_cond_cnts;
+}
+
+void RatioProfiler::Reset() {
+  cnts_ = 0;
+  hits_ = total_ = 0;
+  window_hits_ = window_total_ = 0;
+  window_ratio_ = 0;
+}
+
+float RatioProfiler::Ratio() const { return total_ > 0 ? float(hits_) / total_ : 0; }
@@ -1,5 +1,6 @@
 #pragma once
 #include <pthread.h>
+#include <stdint.h>
 #include <sys/time.h>
 #include <map>
 #include <string>
@@ -53,3 +54,28 @@ class FpsProfiler {
   float tmp_fps_ = 0;
   float average_fps_ = 0;
 };
+
+// accumulates hits / total, e.g. the share of detection anchors rejected before decoding
+class RatioProfiler {
+ public:
+  RatioProfiler(const std::string &name = "", int summary_cond_cnts = 100);
+  ~RatioProfiler();
+
+  void Add(uint64_t hits, uint64_t total);
+  void Config(const std::string &name, int summary_cond_cnts = 100);
+  void Reset();
+  // ratio over everything added since the last Reset, 0 when nothing was added
+  float Ratio() const;
+  // ratio of the last summary window
+  float WindowRatio() const { return window_ratio_; }
+
+ private:
+  std::string name_;
+  int summary_cond_cnts_;
+  int cnts_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t total_ = 0;
+  uint64_t window_hits_ = 0;
+  uint64_t window_total_ = 0;
+  float window_ratio_ = 0;
+};
@@ -8,6 +8,7 @@
 #include "cvi_tdl_core_internal.hpp"
 #include "digital_tracking/digital_tracking.hpp"
 #include "draw_rect/draw_rect.hpp"
+#include "scheduler/stage_scheduler.hpp"
 #ifndef NO_OPENCV
 #include "face_angle/face_angle.hpp"
 #endif
@@ -19,6 +20,7 @@ typedef struct {
 #endif
   cvitdl::service::DigitalTracking *m_dt = nullptr;
   cvitdl::service::IntrusionDetect *m_intrusion_det = nullptr;
+  cvitdl::service::StageScheduler *m_sched = nullptr;
 } cvitdl_service_context_t;
 
 CVI_S32 CVI_TDL_Service_CreateHandle(cvitdl_service_handle_t *handle, cvitdl_handle_t tdl_handle) {
@@ -38,6 +40,7 @@ CVI_S32 CVI_TDL_Service_DestroyHandle(cvitdl_service_handle_t handle) {
   delete ctx->m_fm;
 #endif
   delete ctx->m_dt;
+  delete ctx->m_sched;
   delete ctx;
   return CVI_TDL_SUCCESS;
 }
@@ -360,3 +363,64 @@ CVI_S32 CVI_TDL_Service_DrawHandKeypoint(cvitdl_service_handle_t handle, VIDEO_F
   LOGE("service handle is NULL\n");
   return CVI_TDL_FAILURE;
 }
+
+CVI_S32 CVI_TDL_Service_Scheduler_Init(cvitdl_service_handle_t handle, uint32_t num_workers,
+                                       int32_t essential_priority) {
+  cvitdl_service_context_t *ctx = static_cast<cvitdl_service_context_t *>(handle);
+  delete ctx->m_sched;
+  ctx->m_sched = new cvitdl::service::StageScheduler(num_workers, essential_priority);
+  return CVI_TDL_SUCCESS;
+}
+
+CVI_S32 CVI_TDL_Service_Scheduler_AddStage(cvitdl_service_handle_t handle,
+                                           const cvtdl_service_stage_t *stage,
+                                           uint32_t *stage_id) {
+  cvitdl_service_context_t *ctx = static_cast<cvitdl_service_context_t *>(handle);
+  if (ctx->m_sched == nullptr) {
+    LOGE("Please init scheduler first.\n");
+    return CVI_TDL_FAILURE;
+  }
+  if (stage->func == nullptr || (stage->num_deps > 0 && stage->deps == nullptr)) {
+    LOGE("invalid stage.\n");
+    return CVI_TDL_ERR_INVALID_ARGS;
+  }
+  cvtdl_service_stage_func func = stage->func;
+  void *user_data = stage->user_data;
+  std::vector<uint32_t> deps(stage->deps, stage->deps + stage->num_deps);
+  return ctx->m_sched->addStage(
+      stage->name ? stage->name : "", [func, user_data](VIDEO_FRAME_INFO_S *frame, void *data) {
+        return func(frame, data, user_data);
+      },
+      stage->priority, stage->deadline_us, deps, stage_id);
+}
+
+CVI_S32 CVI_TDL_Service_Scheduler_Run(cvitdl_service_handle_t handle, VIDEO_FRAME_INFO_S *frame,
+                                      void *frame_data, uint32_t budget_us,
+                                      cvtdl_service_stage_state_e *states, uint32_t *elapsed_us) {
+  cvitdl_service_context_t *ctx = static_cast<cvitdl_service_context_t *>(handle);
+  if (ctx->m_sched == nullptr) {
+    LOGE("Please init scheduler first.\n");
+    return CVI_TDL_FAILURE;
+  }
+  return ctx->m_sched->runFrame(frame, frame_data, budget_us, states, elapsed_us);
+}
+
+CVI_S32 CVI_TDL_Service_Scheduler_GetStageStats(cvitdl_service_handle_t handle, uint32_t stage_id,
+                                                cvtdl_service_stage_stats_t *stats) {
+  cvitdl_service_context_t *ctx = static_cast<cvitdl_service_context_t *>(handle);
+  if (ctx->m_sched == nullptr) {
+    LOGE("Please init scheduler first.\n");
+    return CVI_TDL_FAILURE;
+  }
+  return ctx->m_sched->getStats(stage_id, stats);
+}
+
+CVI_S32 CVI_TDL_Service_Scheduler_ResetStats(cvitdl_service_handle_t handle) {
+  cvitdl_service_context_t *ctx = static_cast<cvitdl_service_context_t *>(handle);
+  if (ctx->m_sched == nullptr) {
+    LOGE("Please init scheduler first.\n");
+    return CVI_TDL_FAILURE;
+  }
+  ctx->m_sched->resetStats();
+  return CVI_TDL_SUCCESS;
+}
@@ -0,0 +1,285 @@
+#include "stage_scheduler.hpp"
+
+#include <string.h>
+#include "core/core/cvtdl_errno.h"
+#include "cvi_tdl_log.hpp"
+
+namespace cvitdl {
+namespace service {
+
+void LatencyHistogram::reset() {
+  memset(buckets_, 0, sizeof(buckets_));
+  count_ = 0;
+  sum_ = 0;
+  max_ = 0;
+}
+
+int LatencyHistogram::bucketOf(uint32_t us) {
+  if (us < (1u << kSubBits)) {
+    return us;
+  }
+  int shift = 31 - __builtin_clz(us) - kSubBits;
+  return ((shift + 1) << kSubBits) + ((us >> shift) & ((1 << kSubBits) - 1));
+}
+
+uint32_t LatencyHistogram::bucketLow(int bucket) {
+  if (bucket < (1 << kSubBits)) {
+    return bucket;
+  }
+  int shift = (bucket >> kSubBits) - 1;
+  return ((1u << kSubBits) + (bucket & ((1 << kSubBits) - 1))) << shift;
+}
+
+void LatencyHistogram::add(uint32_t us) {
+  buckets_[bucketOf(us)]++;
+  count_++;
+  sum_ += us;
+  if (us > max_) max_ = us;
+}
+
+uint32_t LatencyHistogram::percentile(float p) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>(p * count_ + 0.5f);
+  if (rank < 1) rank = 1;
+  uint64_t seen = 0;
+  for (int b = 0; b < kNumBuckets; b++) {
+    seen += buckets_[b];
+    if (seen >= rank) {
+      uint32_t width = b < (1 << kSubBits) ? 1 : 1u << ((b >> kSubBits) - 1);
+      uint32_t mid = bucketLow(b) + (width - 1) / 2;
+      return mid < max_ ? mid : max_;
+    }
+  }
+  return max_;
+}
+
+void LatencyHistogram::octaves(uint32_t *bins, int num_bins) const {
+  memset(bins, 0, sizeof(uint32_t) * num_bins);
+  for (int b = 0; b < kNumBuckets; b++) {
+    uint32_t low = bucketLow(b);
+    int bin = low == 0 ? 0 : 31 - __builtin_clz(low);
+    bins[bin < num_bins ? bin : num_bins - 1] += buckets_[b];
+  }
+}
+
+StageScheduler::StageScheduler(uint32_t num_workers, int32_t essential_priority)
+    : essential_priority_(essential_priority), ready_(ReadyOrder{&stages_}) {
+  for (uint32_t i = 0; i < num_workers; i++) {
+    workers_.emplace_back(&StageScheduler::workerLoop, this);
+  }
+}
+
+StageScheduler::~StageScheduler() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+  for (std::thread &t : workers_) {
+    t.join();
+  }
+}
+
+int StageScheduler::addStage(const std::string &name, StageFunc func, int32_t priority,
+                             uint32_t deadline_us, const std::vector<uint32_t> &deps,
+                             uint32_t *stage_id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (running_) {
+    LOGE("cannot add stage %s while a frame is scheduled\n", name.c_str());
+    return CVI_TDL_ERR_INVALID_ARGS;
+  }
+  if (!func) {
+    LOGE("stage %s has no function\n", name.c_str());
+    return CVI_TDL_ERR_INVALID_ARGS;
+  }
+  uint32_t id = stages_.size();
+  for (uint32_t dep : deps) {
+    if (dep >= id) {
+      LOGE("stage %s depends on unknown stage %u\n", name.c_str(), dep);
+      return CVI_TDL_ERR_INVALID_ARGS;
+    }
+  }
+  Stage stage;
+  stage.name = name;
+  stage.func = func;
+  stage.priority = priority;
+  stage.deadline_us = deadline_us;
+  stage.deps = deps;
+  stages_.push_back(std::move(stage));
+  for (uint32_t dep : deps) {
+    stages_[dep].dependents.push_back(id);
+  }
+  if (stage_id) *stage_id = id;
+  return CVI_TDL_SUCCESS;
+}
+
+uint32_t StageScheduler::elapsedUs() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - frame_start_)
+      .count();
+}
+
+void StageScheduler::skipDependents(uint32_t stage_id) {
+  for (uint32_t d : stages_[stage_id].dependents) {
+    if (states_[d] == STAGE_NOT_RUN) {
+      finish(d, STAGE_SKIPPED_DEPENDENCY);
+    }
+  }
+}
+
+void StageScheduler::finish(uint32_t stage_id, cvtdl_service_stage_state_e state) {
+  Stage &stage = stages_[stage_id];
+  states_[stage_id] = state;
+  if (--remaining_ == 0) {
+    // a worker may skip the last stages while the calling thread sleeps
+    cond_.notify_all();
+  }
+  if (state == STAGE_DONE) {
+    for (uint32_t d : stage.dependents) {
+      if (--pending_deps_[d] == 0 && states_[d] == STAGE_NOT_RUN) {
+        ready_.push(d);
+      }
+    }
+  } else {
+    if (state == STAGE_FAILED) {
+      stage.failures++;
+    } else {
+      stage.skips++;
+    }
+    skipDependents(stage_id);
+  }
+}
+
+bool StageScheduler::popRunnable(uint32_t *stage_id) {
+  while (!ready_.empty()) {
+    uint32_t id = ready_.top();
+    ready_.pop();
+    Stage &stage = stages_[id];
+    if (stage.priority < essential_priority_) {
+      uint32_t expected_end = elapsedUs() + static_cast<uint32_t>(stage.expected_us);
+      bool over_budget = budget_us_ != 0 && expected_end > budget_us_;
+      if (over_budget || (stage.deadline_us != 0 && expected_end > stage.deadline_us)) {
+        // the estimate only moves when the stage runs, decay it on every skip so one slow run
+        // (cold start, a stall) does not keep the stage out for good
+        stage.expected_us *= 0.8f;
+        finish(id, over_budget ? STAGE_SKIPPED_BUDGET : STAGE_SKIPPED_DEADLINE);
+        continue;
+      }
+    }
+    *stage_id = id;
+    return true;
+  }
+  return false;
+}
+
+void StageScheduler::execute(std::unique_lock<std::mutex> &lock, uint32_t stage_id) {
+  Stage &stage = stages_[stage_id];
+  uint32_t start_us = elapsedUs();
+  lock.unlock();
+  int ret = stage.func(frame_, frame_data_);
+  lock.lock();
+  uint32_t end_us = elapsedUs();
+  uint32_t latency = end_us - start_us;
+
+  stage.hist.add(latency);
+  stage.expected_us =
+      stage.hist.count() == 1 ? latency : 0.8f * stage.expected_us + 0.2f * latency;
+  if (stage.deadline_us != 0 && end_us > stage.deadline_us) {
+    stage.deadline_misses++;
+  }
+  if (ret != CVI_TDL_SUCCESS) {
+    LOGW("stage %s failed with %#x\n", stage.name.c_str(), ret);
+  }
+  finish(stage_id, ret == CVI_TDL_SUCCESS ? STAGE_DONE : STAGE_FAILED);
+  cond_.notify_all();
+}
+
+void StageScheduler::workerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    uint32_t id;
+    if (running_ && popRunnable(&id)) {
+      execute(lock, id);
+    } else {
+      cond_.wait(lock);
+    }
+  }
+}
+
+int StageScheduler::runFrame(VIDEO_FRAME_INFO_S *frame, void *frame_data, uint32_t budget_us,
+                             cvtdl_service_stage_state_e *states, uint32_t *elapsed_us) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (running_) {
+    LOGE("a frame is already being scheduled\n");
+    return CVI_TDL_ERR_INVALID_ARGS;
+  }
+  frame_ = frame;
+  frame_data_ = frame_data;
+  budget_us_ = budget_us;
+  frame_start_ = Clock::now();
+  remaining_ = stages_.size();
+  states_.assign(stages_.size(), STAGE_NOT_RUN);
+  pending_deps_.resize(stages_.size());
+  for (uint32_t i = 0; i < stages_.size(); i++) {
+    pending_deps_[i] = stages_[i].deps.size();
+    if (pending_deps_[i] == 0) ready_.push(i);
+  }
+  running_ = true;
+  cond_.notify_all();
+
+  // the calling thread works along with the workers
+  while (remaining_ > 0) {
+    uint32_t id;
+    if (popRunnable(&id)) {
+      execute(lock, id);
+    } else if (remaining_ > 0) {
+      cond_.wait(lock);
+    }
+  }
+  running_ = false;
+
+  if (states) {
+    memcpy(states, states_.data(), sizeof(cvtdl_service_stage_state_e) * states_.size());
+  }
+  if (elapsed_us) *elapsed_us = elapsedUs();
+  for (cvtdl_service_stage_state_e state : states_) {
+    if (state == STAGE_FAILED) return CVI_TDL_FAILURE;
+  }
+  return CVI_TDL_SUCCESS;
+}
+
+int StageScheduler::getStats(uint32_t stage_id, cvtdl_service_stage_stats_t *stats) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (stage_id >= stages_.size()) {
+    LOGE("unknown stage %u\n", stage_id);
+    return CVI_TDL_ERR_INVALID_ARGS;
+  }
+  const Stage &stage = stages_[stage_id];
+  memset(stats, 0, sizeof(*stats));
+  stats->runs = stage.hist.count();
+  stats->failures = stage.failures;
+  stats->skips = stage.skips;
+  stats->deadline_misses = stage.deadline_misses;
+  stats->mean_us = stage.hist.mean();
+  stats->p50_us = stage.hist.percentile(0.5f);
+  stats->p90_us = stage.hist.percentile(0.9f);
+  stats->p99_us = stage.hist.percentile(0.99f);
+  stats->max_us = stage.hist.max();
+  stage.hist.octaves(stats->histogram, CVTDL_STAGE_HIST_BINS);
+  return CVI_TDL_SUCCESS;
+}
+
+void StageScheduler::resetStats() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (Stage &stage : stages_) {
+    stage.hist.reset();
+    stage.expected_us = 0.f;
+    stage.failures = 0;
+    stage.skips = 0;
+    stage.deadline_misses = 0;
+  }
+}
+
+}  // namespace service
+}  // namespace cvitdl
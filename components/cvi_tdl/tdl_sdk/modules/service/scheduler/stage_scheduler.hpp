@@ -0,0 +1,131 @@
+#pragma once
+#include "service/cvi_tdl_service_types.h"
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cvitdl {
+namespace service {
+
+/**
+ * Log-linear latency histogram in microseconds: values under 8 have a bucket each, above that
+ * every power of two is split into 8 buckets, so percentiles are within 12.5%.
+ */
+class LatencyHistogram {
+ public:
+  enum { kSubBits = 3, kNumBuckets = (32 - kSubBits + 1) << kSubBits };
+
+  LatencyHistogram() { reset(); }
+  void reset();
+  void add(uint32_t us);
+  // value below which a share p (0..1) of the samples lies
+  uint32_t percentile(float p) const;
+  // fold into power of two bins, bins[i] counts [2^i, 2^(i+1))
+  void octaves(uint32_t *bins, int num_bins) const;
+
+  uint64_t count() const { return count_; }
+  uint32_t max() const { return max_; }
+  float mean() const { return count_ ? static_cast<float>(sum_) / count_ : 0.f; }
+
+  static int bucketOf(uint32_t us);
+  static uint32_t bucketLow(int bucket);
+
+ private:
+  uint32_t buckets_[kNumBuckets];
+  uint64_t count_;
+  uint64_t sum_;
+  uint32_t max_;
+};
+
+/**
+ * Runs a DAG of stages for every frame, e.g. face detection -> landmarks -> recognition and
+ * liveness. Ready stages go highest priority first to the calling thread and num_workers extra
+ * threads. Stages below the essential priority are skipped once they are not expected (running
+ * average of their own latency) to finish within the frame budget or their deadline; a stage that
+ * fails or is skipped takes every stage depending on it along.
+ */
+class StageScheduler {
+ public:
+  typedef std::function<int(VIDEO_FRAME_INFO_S *frame, void *frame_data)> StageFunc;
+
+  StageScheduler(uint32_t num_workers, int32_t essential_priority);
+  ~StageScheduler();
+  StageScheduler(const StageScheduler &) = delete;
+  StageScheduler &operator=(const StageScheduler &) = delete;
+
+  // deps must be ids returned earlier, so the stages always form a DAG
+  int addStage(const std::string &name, StageFunc func, int32_t priority, uint32_t deadline_us,
+               const std::vector<uint32_t> &deps, uint32_t *stage_id);
+
+  /**
+   * Run all stages for one frame and return when every stage is done or skipped. budget_us 0
+   * disables budget skipping. states (one entry per stage) and elapsed_us may be null.
+   */
+  int runFrame(VIDEO_FRAME_INFO_S *frame, void *frame_data, uint32_t budget_us,
+               cvtdl_service_stage_state_e *states, uint32_t *elapsed_us);
+
+  int getStats(uint32_t stage_id, cvtdl_service_stage_stats_t *stats);
+  void resetStats();
+  size_t numStages() const { return stages_.size(); }
+
+ private:
+  struct Stage {
+    std::string name;
+    StageFunc func;
+    int32_t priority;
+    uint32_t deadline_us;
+    std::vector<uint32_t> deps;
+    std::vector<uint32_t> dependents;
+
+    // running average of the latency, 0 until the first run, decays while the stage is skipped
+    float expected_us = 0.f;
+    LatencyHistogram hist;
+    uint64_t failures = 0;
+    uint64_t skips = 0;
+    uint64_t deadline_misses = 0;
+  };
+  struct ReadyOrder {
+    const std::vector<Stage> *stages;
+    bool operator()(uint32_t a, uint32_t b) const {
+      const Stage &sa = (*stages)[a], &sb = (*stages)[b];
+      return sa.priority != sb.priority ? sa.priority < sb.priority : a > b;
+    }
+  };
+  typedef std::chrono::steady_clock Clock;
+
+  uint32_t elapsedUs() const;
+  // the following run with mutex_ held
+  bool popRunnable(uint32_t *stage_id);
+  void finish(uint32_t stage_id, cvtdl_service_stage_state_e state);
+  void skipDependents(uint32_t stage_id);
+  void execute(std::unique_lock<std::mutex> &lock, uint32_t stage_id);
+  void workerLoop();
+
+  int32_t essential_priority_;
+  std::vector<Stage> stages_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool stop_ = false;
+  bool running_ = false;
+
+  // state of the frame being scheduled
+  VIDEO_FRAME_INFO_S *frame_ = nullptr;
+  void *frame_data_ = nullptr;
+  uint32_t budget_us_ = 0;
+  Clock::time_point frame_start_;
+  size_t remaining_ = 0;
+  std::vector<uint32_t> pending_deps_;
+  std::vector<cvtdl_service_stage_state_e> states_;
+  std::priority_queue<uint32_t, std::vector<uint32_t>, ReadyOrder> ready_;
+};
+
+}  // namespace service
+}  // namespace cvitdl
@@ -0,0 +1,129 @@
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest.h>
+#include "deepsort/cvi_lapjv.hpp"
+#include "deepsort/cvi_munkres.hpp"
+
+// CVILapjv is checked against CVIMunkres on ungated problems and against an exhaustive search on
+// small gated problems, on random cost matrices only.
+
+namespace cvitdl {
+namespace unitest {
+
+static Eigen::MatrixXf random_cost(int rows, int cols, std::mt19937 &rng) {
+  std::uniform_real_distribution<float> dist(0.f, 1.f);
+  Eigen::MatrixXf cost(rows, cols);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < cols; j++) cost(i, j) = dist(rng);
+  }
+  return cost;
+}
+
+// DeepSORT gating: infeasible pairs are set to the gate value
+static void apply_gate(Eigen::MatrixXf &cost, float gate, float infeasible_ratio,
+                       std::mt19937 &rng) {
+  std::uniform_real_distribution<float> dist(0.f, 1.f);
+  for (int i = 0; i < cost.rows(); i++) {
+    for (int j = 0; j < cost.cols(); j++) {
+      if (dist(rng) < infeasible_ratio) cost(i, j) = gate;
+    }
+  }
+}
+
+static int check_matching(const Eigen::MatrixXf &cost, float gate, const std::vector<int> &match,
+                          float *total) {
+  std::vector<bool> used(cost.cols(), false);
+  int matched = 0;
+  *total = 0;
+  for (int i = 0; i < cost.rows(); i++) {
+    int j = match[i];
+    if (j < 0) continue;
+    EXPECT_LT(j, cost.cols());
+    EXPECT_FALSE(used[j]);
+    EXPECT_LT(cost(i, j), gate);
+    used[j] = true;
+    matched++;
+    *total += cost(i, j);
+  }
+  return matched;
+}
+
+// min over matchings of sum(cost - gate) restricted to feasible pairs, exhaustive over columns
+static float brute_force(const Eigen::MatrixXf &cost, float gate, int row, uint32_t used) {
+  if (row == cost.rows()) return 0;
+  float best = brute_force(cost, gate, row + 1, used);
+  for (int j = 0; j < cost.cols(); j++) {
+    if ((used & (1u << j)) || cost(row, j) >= gate) continue;
+    best = std::min(best, cost(row, j) - gate + brute_force(cost, gate, row + 1, used | (1u << j)));
+  }
+  return best;
+}
+
+TEST(AssignmentTestSuite, lapjv_equals_munkres_ungated) {
+  std::mt19937 rng(5);
+  CVILapjv lapjv;
+  const int shapes[][2] = {{1, 1}, {5, 5}, {8, 3}, {3, 8}, {20, 20}, {25, 17}, {17, 25}};
+  for (auto &shape : shapes) {
+    for (int iter = 0; iter < 10; iter++) {
+      Eigen::MatrixXf cost = random_cost(shape[0], shape[1], rng);
+
+      CVIMunkres munkres(&cost);
+      ASSERT_EQ(munkres.solve(), MUNKRES_SUCCESS);
+      std::vector<int> ref(munkres.m_match_result, munkres.m_match_result + shape[0]);
+      float ref_total;
+      int ref_matched = check_matching(cost, FLT_MAX, ref, &ref_total);
+
+      std::vector<int> match;
+      ASSERT_TRUE(lapjv.solve(cost, FLT_MAX, match));
+      float total;
+      int matched = check_matching(cost, FLT_MAX, match, &total);
+
+      EXPECT_EQ(matched, std::min(shape[0], shape[1]));
+      EXPECT_EQ(matched, ref_matched);
+      EXPECT_NEAR(total, ref_total, 1e-4f);
+    }
+  }
+}
+
+TEST(AssignmentTestSuite, lapjv_gated_optimal) {
+  std::mt19937 rng(7);
+  CVILapjv lapjv;
+  const float gate = 0.6f;
+  const int shapes[][2] = {{4, 4}, {6, 3}, {3, 7}, {8, 8}, {7, 5}};
+  const float ratios[] = {0.f, 0.3f, 0.7f, 1.f};
+  for (auto &shape : shapes) {
+    for (float ratio : ratios) {
+      for (int iter = 0; iter < 5; iter++) {
+        Eigen::MatrixXf cost = random_cost(shape[0], shape[1], rng);
+        apply_gate(cost, gate, ratio, rng);
+
+        std::vector<int> match;
+        ASSERT_TRUE(lapjv.solve(cost, gate, match));
+        float total;
+        int matched = check_matching(cost, gate, match, &total);
+        EXPECT_NEAR(total - matched * gate, brute_force(cost, gate, 0, 0), 1e-4f);
+      }
+    }
+  }
+}
+
+TEST(AssignmentTestSuite, lapjv_empty_and_infeasible) {
+  CVILapjv lapjv;
+  std::vector<int> match;
+  Eigen::MatrixXf empty(0, 4);
+  ASSERT_TRUE(lapjv.solve(empty, 1.f, match));
+  EXPECT_TRUE(match.empty());
+
+  Eigen::MatrixXf gated = Eigen::MatrixXf::Constant(3, 4, 1.f);
+  gated(1, 2) = NAN;
+  ASSERT_TRUE(lapjv.solve(gated, 1.f, match));
+  ASSERT_EQ(match.size(), 3u);
+  for (int j : match) EXPECT_EQ(j, -1);
+}
+
+}  // namespace unitest
+}  // namespace cvitdl
@@ -0,0 +1,481 @@
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest.h>
+#include "utils/det_decoder.hpp"
+
+// Golden reference for the shared detection decoder. Each family is checked against the parser it
+// replaced (the per-model loops below are kept verbatim in behaviour), on synthetic int8 and float
+// heads, so no cvimodel or dataset is needed.
+
+namespace cvitdl {
+namespace unitest {
+
+struct RefDet {
+  float x1, y1, x2, y2, score;
+  int label;
+};
+
+static const float kScoreThreshold = 0.5f;
+static const int kNumCls = 80;
+static const int kInputW = 640;
+static const int kInputH = 384;
+
+// one synthetic head tensor, int8 storage is quantized from the same float logits
+struct HeadTensor {
+  std::vector<float> f32;
+  std::vector<int8_t> i8;
+  float qscale = 1.f;
+  bool is_int8 = false;
+
+  DetTensorView view(int channel, int feat_h, int feat_w) const {
+    DetTensorView v;
+    v.ptr = is_int8 ? static_cast<const void *>(i8.data()) : f32.data();
+    v.is_int8 = is_int8;
+    v.qscale = is_int8 ? qscale : 1.f;
+    v.channel = channel;
+    v.feat_h = feat_h;
+    v.feat_w = feat_w;
+    v.num_anchor = feat_h * feat_w;
+    return v;
+  }
+  float at(int idx) const { return is_int8 ? i8[idx] * qscale : f32[idx]; }
+};
+
+static HeadTensor make_tensor(const std::vector<float> &logits, bool is_int8, float qscale) {
+  HeadTensor t;
+  t.is_int8 = is_int8;
+  t.qscale = qscale;
+  if (is_int8) {
+    t.i8.resize(logits.size());
+    for (size_t i = 0; i < logits.size(); i++) {
+      float q = roundf(logits[i] / qscale);
+      t.i8[i] = static_cast<int8_t>(std::min(127.f, std::max(-128.f, q)));
+    }
+  } else {
+    t.f32 = logits;
+  }
+  return t;
+}
+
+// mostly background, a few anchors with one or two confident classes
+static std::vector<float> make_cls_logits(int num_anchor, int num_cls, bool planar,
+                                          std::mt19937 &rng) {
+  std::normal_distribution<float> bg(-6.f, 1.5f);
+  std::uniform_real_distribution<float> fg(-1.f, 4.f);
+  std::uniform_int_distribution<int> cls(0, num_cls - 1);
+  std::vector<float> out(num_anchor * num_cls);
+  for (float &v : out) v = bg(rng);
+  for (int a = 0; a < num_anchor; a++) {
+    if (rng() % 16 != 0) continue;
+    for (int k = 0; k < 2; k++) {
+      int c = cls(rng);
+      out[planar ? c * num_anchor + a : a * num_cls + c] = fg(rng);
+    }
+  }
+  return out;
+}
+
+static std::vector<float> make_values(int n, float lo, float hi, std::mt19937 &rng) {
+  std::uniform_real_distribution<float> dist(lo, hi);
+  std::vector<float> out(n);
+  for (float &v : out) v = dist(rng);
+  return out;
+}
+
+static float ref_sigmoid(float x) { return 1.0 / (1.0 + exp(-x)); }
+
+static void ref_clip(float w, float h, RefDet *d) {
+  if (d->x1 < 0) d->x1 = 0;
+  if (d->y1 < 0) d->y1 = 0;
+  if (d->x2 < 0) d->x2 = 0;
+  if (d->y2 < 0) d->y2 = 0;
+  if (d->x1 >= w) d->x1 = w - 1;
+  if (d->y1 >= h) d->y1 = h - 1;
+  if (d->x2 >= w) d->x2 = w - 1;
+  if (d->y2 >= h) d->y2 = h - 1;
+}
+
+static void push_clipped(RefDet d, std::vector<RefDet> *out) {
+  ref_clip(kInputW, kInputH, &d);
+  if (d.x2 - d.x1 > 1 && d.y2 - d.y1 > 1) out->push_back(d);
+}
+
+static std::vector<RefDet> collect(const DetCandidateArena &arena) {
+  std::vector<RefDet> out;
+  const NmsEngine &e = arena.engine();
+  for (int i = 0; i < arena.size(); i++) {
+    out.push_back({e.x1(i), e.y1(i), e.x2(i), e.y2(i), e.score(i), e.label(i)});
+  }
+  return out;
+}
+
+static void expect_same(std::vector<RefDet> golden, std::vector<RefDet> got) {
+  auto order = [](const RefDet &a, const RefDet &b) {
+    if (a.label != b.label) return a.label < b.label;
+    if (a.x1 != b.x1) return a.x1 < b.x1;
+    return a.y1 < b.y1;
+  };
+  std::sort(golden.begin(), golden.end(), order);
+  std::sort(got.begin(), got.end(), order);
+  ASSERT_GT(golden.size(), 0u);
+  ASSERT_EQ(golden.size(), got.size());
+  for (size_t i = 0; i < golden.size(); i++) {
+    EXPECT_EQ(golden[i].label, got[i].label);
+    EXPECT_NEAR(golden[i].x1, got[i].x1, 1e-2);
+    EXPECT_NEAR(golden[i].y1, got[i].y1, 1e-2);
+    EXPECT_NEAR(golden[i].x2, got[i].x2, 1e-2);
+    EXPECT_NEAR(golden[i].y2, got[i].y2, 1e-2);
+    EXPECT_NEAR(golden[i].score, got[i].score, 1e-5);
+  }
+}
+
+static DetDecodeParam make_param(int reg_max) {
+  DetDecodeParam param;
+  param.score_threshold = kScoreThreshold;
+  param.num_cls = kNumCls;
+  param.reg_max = reg_max;
+  param.clip_width = kInputW;
+  param.clip_height = kInputH;
+  return param;
+}
+
+class DetDecoderTestSuite : public testing::TestWithParam<bool> {
+ protected:
+  bool isInt8() const { return GetParam(); }
+};
+
+// yolov8/yolov10: planar class plane, 4 x reg_max DFL logits, optionally fused in one tensor
+static std::vector<RefDet> ref_yolov8(const HeadTensor &cls, int cls_offset, const HeadTensor &box,
+                                      int feat_h, int feat_w, int stride, int reg_max) {
+  std::vector<RefDet> out;
+  int num_anchor = feat_h * feat_w;
+  float inverse_th = std::log(kScoreThreshold / (1 - kScoreThreshold));
+  for (int j = 0; j < num_anchor; j++) {
+    int max_logit_c = -1;
+    float max_logit = -1000;
+    for (int c = 0; c < kNumCls; c++) {
+      float logit = cls.at((c + cls_offset) * num_anchor + j);
+      if (logit > max_logit) {
+        max_logit = logit;
+        max_logit_c = c;
+      }
+    }
+    if (max_logit < inverse_th) continue;
+    float box_vals[4];
+    for (int i = 0; i < 4; i++) {
+      float sum_softmax = 0;
+      float sum_val = 0;
+      for (int k = 0; k < reg_max; k++) {
+        float expv = exp(box.at((i * reg_max + k) * num_anchor + j));
+        sum_softmax += expv;
+        sum_val += expv * k;
+      }
+      box_vals[i] = sum_val / sum_softmax;
+    }
+    float grid_x = j % feat_w + 0.5;
+    float grid_y = j / feat_w + 0.5;
+    RefDet d = {(grid_x - box_vals[0]) * stride, (grid_y - box_vals[1]) * stride,
+                (grid_x + box_vals[2]) * stride, (grid_y + box_vals[3]) * stride,
+                ref_sigmoid(max_logit), max_logit_c};
+    push_clipped(d, &out);
+  }
+  return out;
+}
+
+TEST_P(DetDecoderTestSuite, yolov8_dfl_planar) {
+  typedef DetHeadConfig<DetLayout::PLANAR, DetBoxCoding::DFL_LTRB, DetScoring::CLS_SIGMOID,
+                        DetClip::CLIP_MIN_SIZE>
+      Config;
+  std::mt19937 rng(8);
+  const int reg_max = 16;
+  const int strides[] = {8, 16, 32};
+  std::vector<HeadTensor> storage;
+  std::vector<DetHeadBranch> branches;
+  std::vector<RefDet> golden;
+  storage.reserve(6);
+  for (int stride : strides) {
+    int fh = kInputH / stride, fw = kInputW / stride;
+    storage.push_back(make_tensor(make_cls_logits(fh * fw, kNumCls, true, rng), isInt8(), 0.08f));
+    const HeadTensor &cls = storage.back();
+    storage.push_back(make_tensor(make_values(4 * reg_max * fh * fw, -4.f, 4.f, rng), isInt8(),
+                                  0.04f));
+    const HeadTensor &box = storage.back();
+    DetHeadBranch branch;
+    branch.stride_x = branch.stride_y = stride;
+    branch.cls = cls.view(kNumCls, fh, fw);
+    branch.box = box.view(4 * reg_max, fh, fw);
+    branches.push_back(branch);
+    std::vector<RefDet> ref = ref_yolov8(cls, 0, box, fh, fw, stride, reg_max);
+    golden.insert(golden.end(), ref.begin(), ref.end());
+  }
+
+  DetCandidateArena arena;
+  arena.setCapacity(8192);
+  DetDecoder<Config>::decode(branches, make_param(reg_max), &arena);
+  expect_same(golden, collect(arena));
+}
+
+TEST_P(DetDecoderTestSuite, yolov8_dfl_fused_box_cls) {
+  typedef DetHeadConfig<DetLayout::PLANAR, DetBoxCoding::DFL_LTRB, DetScoring::CLS_SIGMOID,
+                        DetClip::CLIP_MIN_SIZE>
+      Config;
+  std::mt19937 rng(81);
+  const int reg_max = 16;
+  const int stride = 16;
+  int fh = kInputH / stride, fw = kInputW / stride;
+  int num_anchor = fh * fw;
+  // box channels first, then class channels, all planar
+  std::vector<float> logits = make_values(4 * reg_max * num_anchor, -4.f, 4.f, rng);
+  std::vector<float> cls_logits = make_cls_logits(num_anchor, kNumCls, true, rng);
+  logits.insert(logits.end(), cls_logits.begin(), cls_logits.end());
+  HeadTensor fused = make_tensor(logits, isInt8(), 0.06f);
+
+  DetHeadBranch branch;
+  branch.stride_x = branch.stride_y = stride;
+  branch.box = fused.view(4 * reg_max + kNumCls, fh, fw);
+  branch.cls = branch.box;
+  branch.cls_offset = 4 * reg_max;
+
+  DetCandidateArena arena;
+  arena.setCapacity(num_anchor);
+  DetDecoder<Config>::decode({branch}, make_param(reg_max), &arena);
+  expect_same(ref_yolov8(fused, 4 * reg_max, fused, fh, fw, stride, reg_max), collect(arena));
+}
+
+// yolov6/ppyoloe: channel last class scores, ltrb distances to the grid center
+static std::vector<RefDet> ref_ltrb(const HeadTensor &cls, const HeadTensor &box, int feat_h,
+                                    int feat_w, int stride, bool clip) {
+  std::vector<RefDet> out;
+  int pos = 0;
+  for (int g1 = 0; g1 < feat_h; g1++) {
+    for (int g0 = 0; g0 < feat_w; g0++, pos++) {
+      int label = 0;
+      for (int c = 1; c < kNumCls; c++) {
+        if (cls.at(pos * kNumCls + c) > cls.at(pos * kNumCls + label)) label = c;
+      }
+      float score = ref_sigmoid(cls.at(pos * kNumCls + label));
+      if (score < kScoreThreshold) continue;
+      RefDet d = {(-box.at(pos * 4 + 0) + g0 + 0.5f) * stride,
+                  (-box.at(pos * 4 + 1) + g1 + 0.5f) * stride,
+                  (box.at(pos * 4 + 2) + g0 + 0.5f) * stride,
+                  (box.at(pos * 4 + 3) + g1 + 0.5f) * stride, score, label};
+      if (clip) ref_clip(kInputW, kInputH, &d);
+      out.push_back(d);
+    }
+  }
+  return out;
+}
+
+template <DetClip kClip>
+static void run_ltrb_case(bool is_int8, unsigned seed) {
+  typedef DetHeadConfig<DetLayout::CHANNEL_LAST, DetBoxCoding::LTRB, DetScoring::CLS_SIGMOID,
+                        kClip>
+      Config;
+  std::mt19937 rng(seed);
+  const int strides[] = {8, 16, 32};
+  std::vector<HeadTensor> storage;
+  std::vector<DetHeadBranch> branches;
+  std::vector<RefDet> golden;
+  storage.reserve(6);
+  for (int stride : strides) {
+    int fh = kInputH / stride, fw = kInputW / stride;
+    storage.push_back(make_tensor(make_cls_logits(fh * fw, kNumCls, false, rng), is_int8, 0.08f));
+    const HeadTensor &cls = storage.back();
+    storage.push_back(make_tensor(make_values(4 * fh * fw, 0.f, 6.f, rng), is_int8, 0.05f));
+    const HeadTensor &box = storage.back();
+    DetHeadBranch branch;
+    branch.stride_x = branch.stride_y = stride;
+    branch.cls = cls.view(kNumCls, fh, fw);
+    branch.box = box.view(4, fh, fw);
+    branches.push_back(branch);
+    std::vector<RefDet> ref = ref_ltrb(cls, box, fh, fw, stride, kClip != DetClip::NONE);
+    golden.insert(golden.end(), ref.begin(), ref.end());
+  }
+
+  DetCandidateArena arena;
+  arena.setCapacity(8192);
+  DetDecoder<Config>::decode(branches, make_param(16), &arena);
+  expect_same(golden, collect(arena));
+}
+
+TEST_P(DetDecoderTestSuite, yolov6_ltrb) { run_ltrb_case<DetClip::NONE>(isInt8(), 6); }
+
+TEST_P(DetDecoderTestSuite, ppyoloe_ltrb) { run_ltrb_case<DetClip::CLIP>(isInt8(), 7); }
+
+// yolov5: objectness x class score, anchor boxes, 3 anchors per grid cell
+TEST_P(DetDecoderTestSuite, yolov5_anchor) {
+  typedef DetHeadConfig<DetLayout::CHANNEL_LAST, DetBoxCoding::XYWH_ANCHOR,
+                        DetScoring::OBJ_X_CLS_SIGMOID, DetClip::CLIP_MIN_SIZE>
+      Config;
+  std::mt19937 rng(5);
+  const uint32_t anchors[18] = {10, 13, 16,  30,  33, 23,  30,  61,  62,
+                                45, 59, 119, 116, 90, 156, 198, 373, 326};
+  const int strides[] = {8, 16, 32};
+  const int num_anchor_per_grid = 3;
+  std::vector<HeadTensor> storage;
+  std::vector<DetHeadBranch> branches;
+  std::vector<RefDet> golden;
+  storage.reserve(9);
+  int anchor_pos = 0;
+  for (int stride : strides) {
+    int fh = kInputH / stride, fw = kInputW / stride;
+    int n = num_anchor_per_grid * fh * fw;
+    storage.push_back(make_tensor(make_cls_logits(n, kNumCls, false, rng), isInt8(), 0.08f));
+    const HeadTensor &cls = storage.back();
+    storage.push_back(make_tensor(make_values(n, -4.f, 4.f, rng), isInt8(), 0.04f));
+    const HeadTensor &obj = storage.back();
+    storage.push_back(make_tensor(make_values(4 * n, -3.f, 3.f, rng), isInt8(), 0.03f));
+    const HeadTensor &box = storage.back();
+
+    DetHeadBranch branch;
+    branch.stride_x = branch.stride_y = stride;
+    branch.num_anchor_per_grid = num_anchor_per_grid;
+    branch.anchors = anchors + anchor_pos;
+    branch.cls = cls.view(kNumCls, fh, fw);
+    branch.obj = obj.view(1, fh, fw);
+    branch.box = box.view(4, fh, fw);
+    branches.push_back(branch);
+
+    int pos = 0;
+    for (int k = 0; k < num_anchor_per_grid; k++) {
+      float pw = anchors[anchor_pos + k * 2];
+      float ph = anchors[anchor_pos + k * 2 + 1];
+      for (int gy = 0; gy < fh; gy++) {
+        for (int gx = 0; gx < fw; gx++, pos++) {
+          int label = 0;
+          for (int c = 1; c < kNumCls; c++) {
+            if (cls.at(pos * kNumCls + c) > cls.at(pos * kNumCls + label)) label = c;
+          }
+          float box_prob = ref_sigmoid(obj.at(pos)) * ref_sigmoid(cls.at(pos * kNumCls + label));
+          if (box_prob < kScoreThreshold) continue;
+          float sx = ref_sigmoid(box.at(pos * 4)), sy = ref_sigmoid(box.at(pos * 4 + 1));
+          float sw = ref_sigmoid(box.at(pos * 4 + 2)), sh = ref_sigmoid(box.at(pos * 4 + 3));
+          float x = (2 * sx - 0.5 + gx) * stride;
+          float y = (2 * sy - 0.5 + gy) * stride;
+          float w = pow(sw * 2, 2) * pw;
+          float h = pow(sh * 2, 2) * ph;
+          push_clipped({x - w / 2, y - h / 2, x + w / 2, y + h / 2, box_prob, label}, &golden);
+        }
+      }
+    }
+    anchor_pos += num_anchor_per_grid * 2;
+  }
+
+  DetCandidateArena arena;
+  arena.setCapacity(8192);
+  DetDecoder<Config>::decode(branches, make_param(16), &arena);
+  expect_same(golden, collect(arena));
+}
+
+// yolox: objectness x class score, xy offset and exp(wh)
+TEST_P(DetDecoderTestSuite, yolox_xywh) {
+  typedef DetHeadConfig<DetLayout::CHANNEL_LAST, DetBoxCoding::XYWH_EXP,
+                        DetScoring::OBJ_X_CLS_SIGMOID, DetClip::CLIP_MIN_SIZE>
+      Config;
+  std::mt19937 rng(10);
+  const int strides[] = {8, 16, 32};
+  std::vector<HeadTensor> storage;
+  std::vector<DetHeadBranch> branches;
+  std::vector<RefDet> golden;
+  storage.reserve(9);
+  for (int stride : strides) {
+    int fh = kInputH / stride, fw = kInputW / stride;
+    int n = fh * fw;
+    storage.push_back(make_tensor(make_cls_logits(n, kNumCls, false, rng), isInt8(), 0.08f));
+    const HeadTensor &cls = storage.back();
+    storage.push_back(make_tensor(make_values(n, -4.f, 4.f, rng), isInt8(), 0.04f));
+    const HeadTensor &obj = storage.back();
+    storage.push_back(make_tensor(make_values(4 * n, -1.f, 3.f, rng), isInt8(), 0.03f));
+    const HeadTensor &box = storage.back();
+
+    DetHeadBranch branch;
+    branch.stride_x = branch.stride_y = stride;
+    branch.cls = cls.view(kNumCls, fh, fw);
+    branch.obj = obj.view(1, fh, fw);
+    branch.box = box.view(4, fh, fw);
+    branches.push_back(branch);
+
+    int pos = 0;
+    for (int g1 = 0; g1 < fh; g1++) {
+      for (int g0 = 0; g0 < fw; g0++, pos++) {
+        int label = 0;
+        for (int c = 1; c < kNumCls; c++) {
+          if (cls.at(pos * kNumCls + c) > cls.at(pos * kNumCls + label)) label = c;
+        }
+        float box_prob = ref_sigmoid(obj.at(pos)) * ref_sigmoid(cls.at(pos * kNumCls + label));
+        if (box_prob < kScoreThreshold) continue;
+        float x_center = (box.at(pos * 4) + g0) * stride;
+        float y_center = (box.at(pos * 4 + 1) + g1) * stride;
+        float w = std::exp(box.at(pos * 4 + 2)) * stride;
+        float h = std::exp(box.at(pos * 4 + 3)) * stride;
+        float x0 = x_center - w * 0.5f;
+        float y0 = y_center - h * 0.5f;
+        push_clipped({x0, y0, x0 + w, y0 + h, box_prob, label}, &golden);
+      }
+    }
+  }
+
+  DetCandidateArena arena;
+  arena.setCapacity(8192);
+  DetDecoder<Config>::decode(branches, make_param(16), &arena);
+  expect_same(golden, collect(arena));
+}
+
+// the int8 prefilter must not change the result, only skip background anchors
+template <typename Config>
+static void run_early_exit_case(bool planar, bool with_obj, unsigned seed) {
+  std::mt19937 rng(seed);
+  const int stride = 8;
+  int fh = kInputH / stride, fw = kInputW / stride;
+  int n = fh * fw;
+  HeadTensor cls = make_tensor(make_cls_logits(n, kNumCls, planar, rng), true, 0.08f);
+  HeadTensor obj = make_tensor(make_values(n, -6.f, 3.f, rng), true, 0.05f);
+  int box_channel = planar ? 64 : 4;
+  HeadTensor box = make_tensor(make_values(box_channel * n, 0.f, 4.f, rng), true, 0.04f);
+
+  DetHeadBranch branch;
+  branch.stride_x = branch.stride_y = stride;
+  branch.cls = cls.view(kNumCls, fh, fw);
+  branch.box = box.view(box_channel, fh, fw);
+  if (with_obj) branch.obj = obj.view(1, fh, fw);
+
+  DetDecodeParam param = make_param(16);
+  DetCandidateArena full, fast;
+  full.setCapacity(n);
+  fast.setCapacity(n);
+  param.int8_early_exit = false;
+  DetDecoder<Config>::decode({branch}, param, &full);
+  param.int8_early_exit = true;
+  DetDecoder<Config>::decode({branch}, param, &fast);
+
+  expect_same(collect(full), collect(fast));
+  EXPECT_EQ(full.earlyRejected(), 0);
+  EXPECT_EQ(fast.scanned(), n);
+  // roughly one anchor in sixteen has a foreground class
+  EXPECT_GT(fast.earlyRejected(), n * 3 / 4);
+}
+
+TEST(DetDecoderEarlyExitTestSuite, planar_cls) {
+  run_early_exit_case<DetHeadConfig<DetLayout::PLANAR, DetBoxCoding::DFL_LTRB,
+                                    DetScoring::CLS_SIGMOID, DetClip::CLIP_MIN_SIZE>>(true, false,
+                                                                                      21);
+}
+
+TEST(DetDecoderEarlyExitTestSuite, channel_last_cls) {
+  run_early_exit_case<DetHeadConfig<DetLayout::CHANNEL_LAST, DetBoxCoding::LTRB,
+                                    DetScoring::CLS_SIGMOID, DetClip::NONE>>(false, false, 22);
+}
+
+TEST(DetDecoderEarlyExitTestSuite, channel_last_obj_x_cls) {
+  run_early_exit_case<DetHeadConfig<DetLayout::CHANNEL_LAST, DetBoxCoding::XYWH_EXP,
+                                    DetScoring::OBJ_X_CLS_SIGMOID, DetClip::CLIP_MIN_SIZE>>(
+      false, true, 23);
+}
+
+INSTANTIATE_TEST_CASE_P(DetDecoder, DetDecoderTestSuite, testing::Values(false, true));
+
+}  // namespace unitest
+}  // namespace cvitdl
@@ -0,0 +1,169 @@
+#include <math.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+#include <gtest.h>
+#include "deepsort/cvi_deepsort_utils.hpp"
+#include "deepsort/cvi_kalman_batch.hpp"
+
+// KalmanBatch is checked against the per-tracker KalmanFilter path on random tracks, including
+// trackers that went through updates so that P is a full covariance.
+
+namespace cvitdl {
+namespace unitest {
+
+static cvtdl_deepsort_config_t make_config(bool constraint) {
+  cvtdl_deepsort_config_t conf;
+  memset(&conf, 0, sizeof(conf));
+  const int p_idx[DIM_X] = {3, 3, -1, 3, 3, 3, -1, 3};
+  for (int i = 0; i < DIM_X; i++) {
+    bool is_pos = i < DIM_Z;
+    conf.ktracker_conf.P_x_idx[i] = p_idx[i];
+    conf.ktracker_conf.P_alpha[i] = p_idx[i] == -1 ? 0.f : (is_pos ? 0.1f : 0.0625f);
+    conf.ktracker_conf.P_beta[i] = p_idx[i] == -1 ? 0.01f : 0.f;
+    conf.kfilter_conf.Q_x_idx[i] = p_idx[i];
+    conf.kfilter_conf.Q_alpha[i] = p_idx[i] == -1 ? 0.f : (is_pos ? 0.05f : 0.00625f);
+    conf.kfilter_conf.Q_beta[i] = p_idx[i] == -1 ? 0.01f : 0.f;
+    conf.kfilter_conf.X_constraint_min[i] = is_pos ? 0.f : -2.f;
+    conf.kfilter_conf.X_constraint_max[i] = is_pos ? 2000.f : 2.f;
+  }
+  for (int i = 0; i < DIM_Z; i++) {
+    conf.kfilter_conf.R_x_idx[i] = p_idx[i];
+    conf.kfilter_conf.R_alpha[i] = p_idx[i] == -1 ? 0.f : 0.05f;
+    conf.kfilter_conf.R_beta[i] = p_idx[i] == -1 ? 0.1f : 0.f;
+  }
+  conf.kfilter_conf.enable_X_constraint_0 = constraint;
+  conf.kfilter_conf.enable_X_constraint_1 = constraint;
+  conf.kfilter_conf.chi2_threshold = chi2_050[4];
+  conf.ktracker_conf.max_unmatched_num = 40;
+  conf.ktracker_conf.accreditation_threshold = 3;
+  return conf;
+}
+
+static BBOX random_box(std::mt19937 &rng) {
+  std::uniform_real_distribution<float> pos(0.f, 1800.f);
+  std::uniform_real_distribution<float> size(20.f, 300.f);
+  BBOX box;
+  box << pos(rng), pos(rng), size(rng), size(rng);
+  return box;
+}
+
+// a set of trackers, half of them moved through a few predict / update rounds
+static std::vector<KalmanTracker> make_trackers(int n, cvtdl_deepsort_config_t *conf,
+                                                std::mt19937 &rng) {
+  KalmanFilter kf;
+  std::vector<KalmanTracker> trackers;
+  FEATURE empty;
+  for (int i = 0; i < n; i++) {
+    BBOX box = random_box(rng);
+    trackers.emplace_back(i, 0, box, empty, conf->ktracker_conf);
+    if (i % 2) continue;
+    std::normal_distribution<float> jitter(0.f, 4.f);
+    for (int round = 0; round < 3; round++) {
+      trackers.back().predict(kf, conf);
+      BBOX moved = box;
+      moved(0) += 6 * round + jitter(rng);
+      moved(1) += 3 * round + jitter(rng);
+      stRect rect(moved(0), moved(1), moved(2), moved(3));
+      trackers.back().update(kf, &rect, conf);
+    }
+  }
+  return trackers;
+}
+
+static void expect_near_rel(float a, float b, float rel) {
+  EXPECT_NEAR(a, b, rel * std::max(1.f, fabsf(b)));
+}
+
+TEST(KalmanBatchTestSuite, predict_matches_kalman_filter) {
+  std::mt19937 rng(11);
+  KalmanFilter kf;
+  KalmanBatch batch;
+  for (bool constraint : {false, true}) {
+    cvtdl_deepsort_config_t conf = make_config(constraint);
+    for (int n : {1, 3, 8, 37}) {
+      std::vector<KalmanTracker> ref = make_trackers(n, &conf, rng);
+      std::vector<KalmanTracker> batched = ref;
+      // the second round predicts from the PREDICTED state, both paths must refuse it alike
+      for (int round = 0; round < 2; round++) {
+        for (KalmanTracker &t : ref) t.predict(kf, &conf);
+        batch.predict(batched, &conf);
+        for (int i = 0; i < n; i++) {
+          EXPECT_EQ(batched[i].kalman_state, ref[i].kalman_state);
+          EXPECT_EQ(batched[i].unmatched_times, ref[i].unmatched_times);
+          EXPECT_EQ(batched[i].ages_, ref[i].ages_);
+          for (int k = 0; k < DIM_X; k++) expect_near_rel(batched[i].x(k), ref[i].x(k), 1e-6f);
+          for (int r = 0; r < DIM_X; r++) {
+            for (int c = 0; c < DIM_X; c++) {
+              expect_near_rel(batched[i].P(r, c), ref[i].P(r, c), 1e-5f);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(KalmanBatchTestSuite, predict_subset) {
+  std::mt19937 rng(12);
+  KalmanFilter kf;
+  KalmanBatch batch;
+  cvtdl_deepsort_config_t conf = make_config(false);
+  std::vector<KalmanTracker> ref = make_trackers(10, &conf, rng);
+  std::vector<KalmanTracker> batched = ref;
+  std::vector<int> idxes = {1, 4, 5, 9};
+  for (int i : idxes) ref[i].predict(kf, &conf);
+  batch.predict(batched, idxes, &conf);
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(batched[i].kalman_state, ref[i].kalman_state);
+    for (int k = 0; k < DIM_X; k++) expect_near_rel(batched[i].x(k), ref[i].x(k), 1e-6f);
+  }
+}
+
+TEST(KalmanBatchTestSuite, mahalanobis_matches_kalman_filter) {
+  std::mt19937 rng(13);
+  KalmanFilter kf;
+  KalmanBatch batch;
+  cvtdl_deepsort_config_t conf = make_config(false);
+  std::vector<KalmanTracker> trackers = make_trackers(23, &conf, rng);
+  batch.predict(trackers, &conf);
+
+  for (int m : {1, 4, 7, 50}) {
+    std::vector<BBOX> boxes;
+    std::vector<int> box_idxes;
+    for (int j = 0; j < m; j++) {
+      // half of the detections close to a track so that the gate is exercised on both sides
+      BBOX box = (j % 2) ? random_box(rng) : trackers[j % trackers.size()].getBBox_TLWH();
+      if (j % 2 == 0) box(0) += j;
+      boxes.push_back(box);
+      box_idxes.push_back(j);
+    }
+    std::vector<int> tracker_idxes;
+    for (size_t i = 0; i < trackers.size(); i += 2) tracker_idxes.push_back(i);
+
+    COST_MATRIX maha;
+    batch.mahalanobis(trackers, tracker_idxes, boxes, box_idxes, conf.kfilter_conf, maha);
+    ASSERT_EQ(maha.rows(), static_cast<int>(tracker_idxes.size()));
+    ASSERT_EQ(maha.cols(), m);
+
+    BBOXES measurements(m, 4);
+    for (int j = 0; j < m; j++) measurements.row(j) = bbox_tlwh2xyah(boxes[j]);
+    for (size_t i = 0; i < tracker_idxes.size(); i++) {
+      const KalmanTracker &t = trackers[tracker_idxes[i]];
+      ROW_VECTOR ref = kf.mahalanobis(t.kalman_state, t.x, t.P, measurements, conf.kfilter_conf);
+      for (int j = 0; j < m; j++) expect_near_rel(maha(i, j), ref(0, j), 1e-3f);
+    }
+
+    COST_MATRIX cost = batch.getCostMatrix(trackers, boxes, tracker_idxes, box_idxes,
+                                           conf.kfilter_conf, 20.f);
+    COST_MATRIX ref_cost = KalmanTracker::getCostMatrix_Mahalanobis(
+        kf, trackers, boxes, tracker_idxes, box_idxes, conf.kfilter_conf, 20.f);
+    for (int i = 0; i < cost.rows(); i++) {
+      for (int j = 0; j < m; j++) expect_near_rel(cost(i, j), ref_cost(i, j), 1e-3f);
+    }
+  }
+}
+
+}  // namespace unitest
+}  // namespace cvitdl
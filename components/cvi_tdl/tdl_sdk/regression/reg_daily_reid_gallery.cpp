@@ -0,0 +1,170 @@
+#include <math.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+#include <gtest.h>
+#include "deepsort/cvi_kalman_tracker.hpp"
+#include "deepsort/cvi_reid_gallery.hpp"
+
+// ReidGallery is checked against the float cosine distance of KalmanTracker::getCostMatrix_Feature
+// (up to int8 quantization error) and for id recovery on random features.
+
+namespace cvitdl {
+namespace unitest {
+
+static FEATURE random_feature(int dim, std::mt19937 &rng) {
+  std::normal_distribution<float> dist(0.f, 1.f);
+  FEATURE f(dim);
+  for (int d = 0; d < dim; d++) f(d) = dist(rng);
+  return f;
+}
+
+// f plus gaussian noise of relative strength sigma
+static FEATURE jitter(const FEATURE &f, float sigma, std::mt19937 &rng) {
+  std::normal_distribution<float> dist(0.f, sigma * f.norm() / sqrtf(f.cols()));
+  FEATURE out = f;
+  for (int d = 0; d < f.cols(); d++) out(d) += dist(rng);
+  return out;
+}
+
+TEST(ReidGalleryTestSuite, int8_dot_batch) {
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<int> dist(-127, 127);
+  for (int dim : {1, 7, 16, 17, 128, 257}) {
+    const int n = 9;
+    std::vector<int8_t> query(dim), base(n * dim);
+    for (auto &v : query) v = dist(rng);
+    for (auto &v : base) v = dist(rng);
+    std::vector<int32_t> dots(n);
+    int8_dot_batch(query.data(), base.data(), n, dim, dots.data());
+    for (int i = 0; i < n; i++) {
+      int32_t ref = 0;
+      for (int d = 0; d < dim; d++) ref += query[d] * base[i * dim + d];
+      EXPECT_EQ(dots[i], ref);
+    }
+  }
+}
+
+TEST(ReidGalleryTestSuite, cost_matches_float_features) {
+  std::mt19937 rng(4);
+  const int dim = 128;
+  const int budget = 4;
+  cvtdl_kalman_tracker_config_t ktracker_conf;
+  memset(&ktracker_conf, 0, sizeof(ktracker_conf));
+  ReidGallery gallery;
+
+  std::vector<KalmanTracker> trackers;
+  std::vector<FEATURE> identities;
+  BBOX box;
+  box << 10, 10, 50, 100;
+  for (int i = 0; i < 6; i++) {
+    identities.push_back(random_feature(dim, rng));
+    trackers.emplace_back(i + 1, 0, box, identities.back(), ktracker_conf);
+  }
+  std::vector<int> tracker_idxes = {0, 1, 2, 3, 4, 5};
+
+  for (int frame = 0; frame < 7; frame++) {
+    // tracker i sees a new sample of its identity every i + 1 frames
+    for (size_t i = 0; i < trackers.size(); i++) {
+      if (frame % (i + 1) == 0) {
+        trackers[i].update_feature(jitter(identities[i], 0.3f, rng), budget, 1);
+      }
+    }
+    std::vector<FEATURE> detections;
+    std::vector<int> bbox_idxes;
+    for (int j = 0; j < 5; j++) {
+      detections.push_back(j < 4 ? jitter(identities[j], 0.3f, rng) : random_feature(dim, rng));
+      bbox_idxes.push_back(j);
+    }
+
+    std::vector<uint64_t> ids;
+    std::vector<int> class_ids;
+    for (const KalmanTracker &t : trackers) {
+      gallery.syncTrack(t.id, t.class_id, t.features, t.features_version);
+      ids.push_back(t.id);
+      class_ids.push_back(t.class_id);
+    }
+    COST_MATRIX cost;
+    gallery.costMatrix(ids, class_ids, detections, bbox_idxes, cost);
+    std::vector<BBOX> boxes(detections.size(), box);
+    COST_MATRIX ref = KalmanTracker::getCostMatrix_Feature(trackers, boxes, detections,
+                                                           tracker_idxes, bbox_idxes);
+    ASSERT_EQ(cost.rows(), ref.rows());
+    ASSERT_EQ(cost.cols(), ref.cols());
+    for (int i = 0; i < ref.rows(); i++) {
+      for (int j = 0; j < ref.cols(); j++) EXPECT_NEAR(cost(i, j), ref(i, j), 5e-3f);
+    }
+  }
+  EXPECT_EQ(gallery.numActive(), trackers.size());
+}
+
+TEST(ReidGalleryTestSuite, recover_inactive) {
+  std::mt19937 rng(5);
+  const int dim = 64;
+  ReidGallery gallery;
+  gallery.setInactiveCapacity(3);
+  std::vector<FEATURE> identities;
+  for (int i = 0; i < 4; i++) {
+    identities.push_back(random_feature(dim, rng));
+    for (int s = 0; s < 3; s++) gallery.addSample(i + 1, 0, jitter(identities[i], 0.2f, rng));
+  }
+  gallery.addSample(9, 1, identities[0]);
+  EXPECT_EQ(gallery.numActive(), 5u);
+
+  for (int i = 0; i < 4; i++) gallery.retireTrack(i + 1, 0);
+  // the oldest one (id 1) went out of the capacity
+  EXPECT_EQ(gallery.numActive(), 1u);
+  EXPECT_EQ(gallery.numInactive(), 3u);
+
+  ReidMatch match;
+  for (int i = 1; i < 4; i++) {
+    ASSERT_TRUE(gallery.searchInactive(jitter(identities[i], 0.2f, rng), 0, &match));
+    EXPECT_EQ(match.id, static_cast<uint64_t>(i + 1));
+    EXPECT_LT(match.distance, 0.1f);
+  }
+  // class 1 has nothing inactive
+  EXPECT_FALSE(gallery.searchInactive(identities[0], 1, &match));
+
+  gallery.removeInactive(3, 0);
+  ASSERT_TRUE(gallery.searchInactive(identities[2], 0, &match));
+  EXPECT_NE(match.id, 3u);
+  EXPECT_GT(match.distance, 0.3f);
+}
+
+TEST(ReidGalleryTestSuite, ivf_index_recall) {
+  std::mt19937 rng(6);
+  const int dim = 128;
+  const int num = 2000;
+  ReidGallery gallery;
+  gallery.setInactiveCapacity(num);
+  gallery.setIndex(16, 4);
+  std::vector<FEATURE> identities;
+  for (int i = 0; i < num; i++) {
+    identities.push_back(random_feature(dim, rng));
+    gallery.addSample(i + 1, 0, identities.back());
+    gallery.retireTrack(i + 1, 0);
+  }
+  EXPECT_TRUE(gallery.indexed());
+  EXPECT_EQ(gallery.numInactive(), static_cast<size_t>(num));
+
+  int hits = 0;
+  const int queries = 200;
+  for (int q = 0; q < queries; q++) {
+    int i = (q * 37) % num;
+    ReidMatch match;
+    ASSERT_TRUE(gallery.searchInactive(jitter(identities[i], 0.2f, rng), 0, &match));
+    if (match.id == static_cast<uint64_t>(i + 1)) hits++;
+  }
+  EXPECT_GE(hits, queries * 9 / 10);
+
+  // dropping the index keeps every entry reachable
+  gallery.setIndex(0, 1);
+  EXPECT_FALSE(gallery.indexed());
+  ReidMatch match;
+  ASSERT_TRUE(gallery.searchInactive(identities[1234], 0, &match));
+  EXPECT_EQ(match.id, 1235u);
+}
+
+}  // namespace unitest
+}  // namespace cvitdl
@@ -0,0 +1,195 @@
+#include <unistd.h>
+#include <atomic>
+#include <vector>
+
+#include <gtest.h>
+#include "core/core/cvtdl_errno.h"
+#include "scheduler/stage_scheduler.hpp"
+
+// StageScheduler is checked with sleeping stages standing in for model calls: dependency order,
+// budget / deadline skipping, recovery of a skipped stage and the latency histogram.
+
+namespace cvitdl {
+namespace unitest {
+
+using service::LatencyHistogram;
+using service::StageScheduler;
+
+static StageScheduler::StageFunc sleep_stage(uint32_t us, std::atomic<int> *counter = nullptr,
+                                             int *order = nullptr, int ret = CVI_TDL_SUCCESS) {
+  return [=](VIDEO_FRAME_INFO_S *, void *) {
+    usleep(us);
+    if (counter && order) *order = (*counter)++;
+    return ret;
+  };
+}
+
+TEST(StageSchedulerTestSuite, dependency_order) {
+  for (uint32_t workers : {0u, 1u, 3u}) {
+    StageScheduler sched(workers, 0);
+    std::atomic<int> counter(0);
+    int order[5];
+    uint32_t det, lm, fr, live, fuse;
+    ASSERT_EQ(sched.addStage("det", sleep_stage(500, &counter, &order[0]), 0, 0, {}, &det),
+              CVI_TDL_SUCCESS);
+    ASSERT_EQ(sched.addStage("lm", sleep_stage(300, &counter, &order[1]), 0, 0, {det}, &lm),
+              CVI_TDL_SUCCESS);
+    ASSERT_EQ(sched.addStage("fr", sleep_stage(800, &counter, &order[2]), 0, 0, {lm}, &fr),
+              CVI_TDL_SUCCESS);
+    ASSERT_EQ(sched.addStage("live", sleep_stage(200, &counter, &order[3]), 0, 0, {lm}, &live),
+              CVI_TDL_SUCCESS);
+    ASSERT_EQ(
+        sched.addStage("fuse", sleep_stage(100, &counter, &order[4]), 0, 0, {fr, live}, &fuse),
+        CVI_TDL_SUCCESS);
+
+    for (int frame = 0; frame < 3; frame++) {
+      counter = 0;
+      std::vector<cvtdl_service_stage_state_e> states(sched.numStages());
+      ASSERT_EQ(sched.runFrame(nullptr, nullptr, 0, states.data(), nullptr), CVI_TDL_SUCCESS);
+      for (auto state : states) EXPECT_EQ(state, STAGE_DONE);
+      EXPECT_LT(order[det], order[lm]);
+      EXPECT_LT(order[lm], order[fr]);
+      EXPECT_LT(order[lm], order[live]);
+      EXPECT_EQ(order[fuse], 4);
+    }
+    cvtdl_service_stage_stats_t stats;
+    ASSERT_EQ(sched.getStats(fr, &stats), CVI_TDL_SUCCESS);
+    EXPECT_EQ(stats.runs, 3u);
+    EXPECT_GE(stats.p50_us, 700u);
+  }
+}
+
+TEST(StageSchedulerTestSuite, independent_stages_overlap) {
+  StageScheduler sched(1, 0);
+  ASSERT_EQ(sched.addStage("a", sleep_stage(20000), 0, 0, {}, nullptr), CVI_TDL_SUCCESS);
+  ASSERT_EQ(sched.addStage("b", sleep_stage(20000), 0, 0, {}, nullptr), CVI_TDL_SUCCESS);
+  uint32_t elapsed_us;
+  ASSERT_EQ(sched.runFrame(nullptr, nullptr, 0, nullptr, &elapsed_us), CVI_TDL_SUCCESS);
+  EXPECT_LT(elapsed_us, 35000u);
+}
+
+TEST(StageSchedulerTestSuite, skip_over_budget) {
+  const int32_t essential = 10;
+  StageScheduler sched(0, essential);
+  uint32_t det, lm, fr, fr_post;
+  sched.addStage("det", sleep_stage(2000), essential, 0, {}, &det);
+  sched.addStage("lm", sleep_stage(2000), 5, 0, {det}, &lm);
+  sched.addStage("fr", sleep_stage(20000), 1, 0, {lm}, &fr);
+  sched.addStage("fr_post", sleep_stage(100), 1, 0, {fr}, &fr_post);
+
+  // no budget: everything runs and the latency estimates get filled
+  std::vector<cvtdl_service_stage_state_e> states(sched.numStages());
+  ASSERT_EQ(sched.runFrame(nullptr, nullptr, 0, states.data(), nullptr), CVI_TDL_SUCCESS);
+  for (auto state : states) EXPECT_EQ(state, STAGE_DONE);
+
+  // det + lm fit in 12ms, fr does not
+  ASSERT_EQ(sched.runFrame(nullptr, nullptr, 12000, states.data(), nullptr), CVI_TDL_SUCCESS);
+  EXPECT_EQ(states[det], STAGE_DONE);
+  EXPECT_EQ(states[lm], STAGE_DONE);
+  EXPECT_EQ(states[fr], STAGE_SKIPPED_BUDGET);
+  EXPECT_EQ(states[fr_post], STAGE_SKIPPED_DEPENDENCY);
+
+  // an essential stage runs whatever the budget
+  ASSERT_EQ(sched.runFrame(nullptr, nullptr, 1, states.data(), nullptr), CVI_TDL_SUCCESS);
+  EXPECT_EQ(states[det], STAGE_DONE);
+  EXPECT_EQ(states[lm], STAGE_SKIPPED_BUDGET);
+
+  cvtdl_service_stage_stats_t stats;
+  sched.getStats(fr, &stats);
+  EXPECT_EQ(stats.runs, 1u);
+  EXPECT_EQ(stats.skips, 2u);
+  sched.getStats(fr_post, &stats);
+  EXPECT_EQ(stats.skips, 2u);
+}
+
+TEST(StageSchedulerTestSuite, recover_after_slow_run) {
+  const int32_t essential = 10;
+  StageScheduler sched(0, essential);
+  std::atomic<uint32_t> fr_us(60000);
+  uint32_t det, fr;
+  sched.addStage("det", sleep_stage(1000), essential, 0, {}, &det);
+  sched.addStage("fr",
+                 [&](VIDEO_FRAME_INFO_S *, void *) {
+                   usleep(fr_us);
+                   return CVI_TDL_SUCCESS;
+                 },
+                 1, 0, {det}, &fr);
+
+  // a cold first run pushes the estimate far over the budget
+  std::vector<cvtdl_service_stage_state_e> states(sched.numStages());
+  ASSERT_EQ(sched.runFrame(nullptr, nullptr, 0, states.data(), nullptr), CVI_TDL_SUCCESS);
+  EXPECT_EQ(states[fr], STAGE_DONE);
+  fr_us = 1000;
+
+  // skipped for a while, then probed again as the estimate decays
+  int skipped = 0;
+  for (; skipped < 30; skipped++) {
+    ASSERT_EQ(sched.runFrame(nullptr, nullptr, 15000, states.data(), nullptr), CVI_TDL_SUCCESS);
+    if (states[fr] == STAGE_DONE) break;
+    EXPECT_EQ(states[fr], STAGE_SKIPPED_BUDGET);
+  }
+  EXPECT_GT(skipped, 0);
+  EXPECT_LT(skipped, 30);
+
+  // fast runs keep it in
+  for (int frame = 0; frame < 5; frame++) {
+    ASSERT_EQ(sched.runFrame(nullptr, nullptr, 15000, states.data(), nullptr), CVI_TDL_SUCCESS);
+    EXPECT_EQ(states[fr], STAGE_DONE);
+  }
+}
+
+TEST(StageSchedulerTestSuite, deadline_and_failure) {
+  StageScheduler sched(2, 10);
+  uint32_t det, late, bad, after_bad, ok;
+  sched.addStage("det", sleep_stage(5000), 10, 0, {}, &det);
+  // cannot start before its deadline
+  sched.addStage("late", sleep_stage(100), 0, 1000, {det}, &late);
+  sched.addStage("bad", sleep_stage(100, nullptr, nullptr, CVI_TDL_FAILURE), 10, 0, {det}, &bad);
+  sched.addStage("after_bad", sleep_stage(100), 10, 0, {bad}, &after_bad);
+  sched.addStage("ok", sleep_stage(100), 10, 0, {det}, &ok);
+
+  std::vector<cvtdl_service_stage_state_e> states(sched.numStages());
+  EXPECT_EQ(sched.runFrame(nullptr, nullptr, 0, states.data(), nullptr), CVI_TDL_FAILURE);
+  EXPECT_EQ(states[det], STAGE_DONE);
+  EXPECT_EQ(states[late], STAGE_SKIPPED_DEADLINE);
+  EXPECT_EQ(states[bad], STAGE_FAILED);
+  EXPECT_EQ(states[after_bad], STAGE_SKIPPED_DEPENDENCY);
+  EXPECT_EQ(states[ok], STAGE_DONE);
+
+  cvtdl_service_stage_stats_t stats;
+  sched.getStats(bad, &stats);
+  EXPECT_EQ(stats.failures, 1u);
+  EXPECT_EQ(sched.addStage("cycle", sleep_stage(1), 0, 0, {7}, nullptr),
+            CVI_TDL_ERR_INVALID_ARGS);
+  EXPECT_EQ(sched.getStats(42, &stats), CVI_TDL_ERR_INVALID_ARGS);
+}
+
+TEST(StageSchedulerTestSuite, latency_histogram) {
+  for (uint32_t v = 0; v < 100000; v += 7) {
+    int b = LatencyHistogram::bucketOf(v);
+    ASSERT_LE(LatencyHistogram::bucketLow(b), v);
+    ASSERT_GT(LatencyHistogram::bucketLow(b + 1), v);
+  }
+  EXPECT_LT(LatencyHistogram::bucketOf(0xffffffffu), LatencyHistogram::kNumBuckets);
+
+  LatencyHistogram hist;
+  for (uint32_t v = 1; v <= 1000; v++) hist.add(v);
+  EXPECT_EQ(hist.count(), 1000u);
+  EXPECT_EQ(hist.max(), 1000u);
+  EXPECT_NEAR(hist.mean(), 500.5f, 1e-3f);
+  EXPECT_NEAR(hist.percentile(0.5f), 500.f, 500 * 0.125f);
+  EXPECT_NEAR(hist.percentile(0.99f), 990.f, 990 * 0.125f);
+  EXPECT_GE(hist.percentile(1.f), 960u);
+  EXPECT_LE(hist.percentile(1.f), 1000u);
+
+  uint32_t bins[CVTDL_STAGE_HIST_BINS];
+  hist.octaves(bins, CVTDL_STAGE_HIST_BINS);
+  uint32_t total = 0;
+  for (int i = 0; i < CVTDL_STAGE_HIST_BINS; i++) total += bins[i];
+  EXPECT_EQ(total, 1000u);
+  EXPECT_EQ(bins[0], 1u);
+  EXPECT_EQ(bins[9], 1000u - 511u);
+}
+
+}  // namespace unitest
+}  // namespace cvitdl
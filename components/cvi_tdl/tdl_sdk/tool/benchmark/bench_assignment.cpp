@@ -0,0 +1,80 @@
+// Compares CVIMunkres against CVILapjv (DeepSORT assignment backends) on random cost matrices,
+// dense and with most pairs gated out as after the Mahalanobis / IoU gating of DeepSORT::match.
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "cvi_lapjv.hpp"
+#include "cvi_munkres.hpp"
+
+static Eigen::MatrixXf make_cost(int rows, int cols, float gate, float infeasible_ratio,
+                                 std::mt19937 &rng) {
+  std::uniform_real_distribution<float> dist(0.f, 1.f);
+  Eigen::MatrixXf cost(rows, cols);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < cols; j++) {
+      cost(i, j) = dist(rng) < infeasible_ratio ? gate : dist(rng) * gate;
+    }
+  }
+  return cost;
+}
+
+static float matched_cost(const Eigen::MatrixXf &cost, float gate, const int *match, int *num) {
+  float total = 0;
+  *num = 0;
+  for (int i = 0; i < cost.rows(); i++) {
+    if (match[i] >= 0 && cost(i, match[i]) < gate) {
+      total += cost(i, match[i]);
+      (*num)++;
+    }
+  }
+  return total;
+}
+
+int main(int argc, char **argv) {
+  int max_size = argc > 1 ? atoi(argv[1]) : 500;
+  const int sizes[] = {10, 25, 50, 100, 200, 500};
+  const float ratios[] = {0.f, 0.9f};
+  const float gate = 0.7f;
+  std::mt19937 rng(2024);
+  CVILapjv lapjv;
+  std::vector<int> match;
+
+  printf("%6s %10s %14s %14s %8s %10s %10s\n", "size", "gated", "munkres(us)", "lapjv(us)",
+         "speedup", "munk_cost", "lap_cost");
+  for (int n : sizes) {
+    if (n > max_size) break;
+    for (float ratio : ratios) {
+      Eigen::MatrixXf cost = make_cost(n, n, gate, ratio, rng);
+      int iters = n <= 50 ? 50 : (n <= 200 ? 5 : 1);
+
+      bool munkres_ok = true;
+      float munkres_cost = 0;
+      int munkres_num = 0;
+      double t_munkres = bench::time_us(iters, [&]() {
+        Eigen::MatrixXf m = cost;
+        CVIMunkres solver(&m);
+        munkres_ok = solver.solve() == MUNKRES_SUCCESS;
+        if (munkres_ok) {
+          munkres_cost = matched_cost(cost, gate, solver.m_match_result, &munkres_num);
+        }
+      });
+      double t_lapjv = bench::time_us(iters, [&]() { lapjv.solve(cost, gate, match); });
+      int lap_num = 0;
+      float lap_cost = matched_cost(cost, gate, match.data(), &lap_num);
+
+      if (munkres_ok) {
+        printf("%6d %9.0f%% %14.1f %14.1f %7.1fx %6.2f/%-3d %6.2f/%-3d\n", n, ratio * 100,
+               t_munkres, t_lapjv, t_munkres / t_lapjv, munkres_cost, munkres_num, lap_cost,
+               lap_num);
+      } else {
+        printf("%6d %9.0f%% %14s %14.1f %8s %10s %6.2f/%-3d\n", n, ratio * 100, "failed", t_lapjv,
+               "-", "-", lap_cost, lap_num);
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,272 @@
+// Compares the motion detection connected components as they shipped (pixel labels in 8 bits,
+// capped at 200, one level equivalence array, quadratic inside-box filter) against the run based
+// union-find CCLEngine with a grid filter. Masks are synthetic frame differences: a sparse scene
+// of separated blobs, where both must return the same boxes, and a busy scene beyond the old
+// label cap, where only the box counts are reported.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "ccl.hpp"
+
+namespace legacy {
+
+#define CC_MAX_NUM_LABELS 200
+#define MAX_CC_OBJECTS 200
+
+// extract_connected_component as it was, the instance is a plain struct of buffers
+struct CCL {
+  int w = 0, h = 0;
+  std::vector<unsigned char> map, fg, eq;
+  std::vector<int> boxes_tmp, boxes;
+};
+
+static bool cluster_box(int *p_boxes, int ci, int i) {
+  int inter_R0 = std::max(p_boxes[5 * i + 1], p_boxes[5 * ci + 1]);
+  int inter_C0 = std::max(p_boxes[5 * i + 2], p_boxes[5 * ci + 2]);
+  int inter_R1 = std::min(p_boxes[5 * i + 3], p_boxes[5 * ci + 3]);
+  int inter_C1 = std::min(p_boxes[5 * i + 4], p_boxes[5 * ci + 4]);
+  if (inter_C1 - inter_C0 <= 0 || inter_R1 - inter_R0 <= 0) return false;
+  p_boxes[5 * ci + 1] = std::min(p_boxes[5 * i + 1], p_boxes[5 * ci + 1]);
+  p_boxes[5 * ci + 2] = std::min(p_boxes[5 * i + 2], p_boxes[5 * ci + 2]);
+  p_boxes[5 * ci + 3] = std::max(p_boxes[5 * i + 3], p_boxes[5 * ci + 3]);
+  p_boxes[5 * ci + 4] = std::max(p_boxes[5 * i + 4], p_boxes[5 * ci + 4]);
+  return true;
+}
+
+static int filter_inside_boxes(int *p_boxes, int num_src) {
+  std::vector<std::pair<int, int>> box_areas;
+  for (int i = 0; i < num_src; i++) {
+    int area =
+        (p_boxes[5 * i + 3] - p_boxes[5 * i + 1]) * (p_boxes[5 * i + 4] - p_boxes[5 * i + 2]);
+    box_areas.push_back({area, i});
+  }
+  std::sort(box_areas.begin(), box_areas.end(),
+            [](const std::pair<int, int> &a, const std::pair<int, int> &b) {
+              return a.first > b.first;
+            });
+  for (size_t i = 1; i < box_areas.size(); i++) {
+    int indi = box_areas[i].second;
+    for (size_t c = 0; c < i; c++) {
+      int indc = box_areas[c].second;
+      if (p_boxes[5 * indc] < 0) continue;
+      if (cluster_box(p_boxes, indc, indi)) {
+        p_boxes[5 * indi] = -1;
+        break;
+      }
+    }
+  }
+  int ctFinal = 0;
+  for (int i = 0; i < num_src; i++) {
+    if (p_boxes[5 * i] > 0) {
+      memcpy(p_boxes + 5 * ctFinal, p_boxes + 5 * i, 5 * sizeof(int));
+      ctFinal++;
+    }
+  }
+  return ctFinal;
+}
+
+static int *extract(unsigned char *p_fg_mask, int width, int height, int wstride,
+                    int area_thresh, CCL *inst, int *p_num_boxes) {
+  if (inst->w != width || inst->h != height) {
+    inst->w = width;
+    inst->h = height;
+    inst->map.resize((width / 2) * (height / 2));
+    inst->fg.resize((width / 2) * (height / 2));
+    inst->eq.resize(CC_MAX_NUM_LABELS + 1);
+    inst->boxes_tmp.resize(MAX_CC_OBJECTS * 5);
+    inst->boxes.resize(MAX_CC_OBJECTS * 5);
+  }
+  int W = width / 2, H = height / 2;
+  unsigned char *map = inst->map.data(), *fg = inst->fg.data(), *eq = inst->eq.data();
+  memset(map, 0, W * H);
+  memset(fg, 0, W * H);
+  for (int i = 0; i < CC_MAX_NUM_LABELS + 1; i++) eq[i] = i;
+
+  for (int rBlk = 0; rBlk < H; rBlk++) {
+    for (int cBlk = 0; cBlk < W; cBlk++) {
+      unsigned char *p = p_fg_mask + rBlk * 2 * wstride + cBlk * 2;
+      int sum = 0;
+      for (int r = 0; r < 2; r++) {
+        for (int c = 0; c < 2; c++) sum += p[r * wstride + c] > 0;
+      }
+      fg[rBlk * W + cBlk] = sum;
+    }
+  }
+  for (int r = 0; r < H - 2; r++) {
+    for (int c = 0; c < W - 2; c++) {
+      int ct = fg[r * W + c] + fg[r * W + c + 1] + fg[(r + 1) * W + c] + fg[(r + 1) * W + c + 1];
+      if (ct > 3) {
+        map[r * W + c] = map[r * W + c + 1] = 255;
+        map[(r + 1) * W + c] = map[(r + 1) * W + c + 1] = 255;
+      }
+    }
+  }
+
+  int currLabel = 1, tmpMaxLabel = 0;
+  memset(fg, 0, W * H);
+  unsigned char *lab = fg;
+  for (int r = 1; r < H; r++) {
+    for (int c = 1; c < W; c++) {
+      unsigned char *pl = lab + r * W + c;
+      if (map[r * W + c] == 0) continue;
+      int xA = *(pl - 1), xB = *(pl - 1 - W), xC = *(pl - W), xD = *(pl - W + 1);
+      int lbVal = CC_MAX_NUM_LABELS;
+      if (xA > 0) lbVal = xA;
+      if (xB > 0 && xB < lbVal) lbVal = xB;
+      if (xC > 0 && xC < lbVal) lbVal = xC;
+      if (xD > 0 && xD < lbVal) lbVal = xD;
+      if (lbVal < CC_MAX_NUM_LABELS) {
+        if (xA > lbVal) eq[xA] = eq[lbVal];
+        if (xB > lbVal) eq[xB] = eq[lbVal];
+        if (xC > lbVal) eq[xC] = eq[lbVal];
+        if (xD > lbVal) eq[xD] = eq[lbVal];
+      } else {
+        lbVal = currLabel;
+        if (currLabel < CC_MAX_NUM_LABELS - 1) currLabel++;
+      }
+      *pl = lbVal;
+    }
+  }
+  for (int r = 1; r < H; r++) {
+    for (int c = 1; c < W; c++) {
+      int lbVal = lab[r * W + c];
+      if (lbVal > 0) {
+        lbVal = eq[lbVal];
+        lab[r * W + c] = lbVal;
+        tmpMaxLabel = std::max(tmpMaxLabel, lbVal);
+        map[r * W + c] = lbVal;
+      }
+    }
+  }
+
+  int *bb = inst->boxes_tmp.data();
+  for (int i = 0; i <= tmpMaxLabel; i++) {
+    bb[5 * i + 0] = 0;
+    bb[5 * i + 1] = 10000;
+    bb[5 * i + 2] = 10000;
+    bb[5 * i + 3] = -10000;
+    bb[5 * i + 4] = -10000;
+  }
+  for (int r = 1; r < H; r++) {
+    for (int c = 1; c < W; c++) {
+      int lbVal = map[r * W + c];
+      if (lbVal < 1) continue;
+      if (lbVal > CC_MAX_NUM_LABELS - 1) lbVal = CC_MAX_NUM_LABELS - 1;
+      lbVal -= 1;
+      bb[5 * lbVal]++;
+      bb[5 * lbVal + 1] = std::min(bb[5 * lbVal + 1], r);
+      bb[5 * lbVal + 2] = std::min(bb[5 * lbVal + 2], c);
+      bb[5 * lbVal + 3] = std::max(bb[5 * lbVal + 3], r);
+      bb[5 * lbVal + 4] = std::max(bb[5 * lbVal + 4], c);
+    }
+  }
+
+  int *out = inst->boxes.data();
+  int ctFinal = 0;
+  int area_super_thresh = area_thresh / 4;
+  for (int i = 0; i < tmpMaxLabel; i++) {
+    if (bb[5 * i] > area_super_thresh) {
+      int R0 = bb[5 * i + 1] * 2, C0 = bb[5 * i + 2] * 2;
+      int R1 = bb[5 * i + 3] * 2, C1 = bb[5 * i + 4] * 2;
+      if ((C1 - C0) * (R1 - R0) < area_thresh) continue;
+      out[5 * ctFinal + 0] = bb[5 * i];
+      out[5 * ctFinal + 1] = R0;
+      out[5 * ctFinal + 2] = C0;
+      out[5 * ctFinal + 3] = R1;
+      out[5 * ctFinal + 4] = C1;
+      ctFinal++;
+    }
+  }
+  ctFinal = filter_inside_boxes(out, ctFinal);
+  ctFinal = filter_inside_boxes(out, ctFinal);
+  *p_num_boxes = ctFinal;
+  return out;
+}
+
+}  // namespace legacy
+
+typedef std::array<int, 5> Box;
+
+static std::vector<Box> sorted_boxes(const int *p_boxes, int num) {
+  std::vector<Box> boxes(num);
+  for (int i = 0; i < num; i++) std::copy(p_boxes + 5 * i, p_boxes + 5 * i + 5, boxes[i].begin());
+  std::sort(boxes.begin(), boxes.end());
+  return boxes;
+}
+
+// frame difference with num_blobs filled rectangles of side min_side ~ max_side, non overlapping
+// with a margin when separated is set
+static std::vector<unsigned char> make_mask(int w, int h, int num_blobs, int min_side,
+                                            int max_side, bool separated, std::mt19937 &rng) {
+  std::vector<unsigned char> mask(w * h, 0);
+  std::vector<Box> placed;
+  std::uniform_int_distribution<int> side(min_side, max_side);
+  const int margin = 16;
+  for (int n = 0, tries = 0; n < num_blobs && tries < num_blobs * 100; tries++) {
+    int bw = side(rng), bh = side(rng);
+    int x = std::uniform_int_distribution<int>(8, w - bw - 8)(rng);
+    int y = std::uniform_int_distribution<int>(8, h - bh - 8)(rng);
+    if (separated) {
+      bool clash = false;
+      for (const Box &b : placed) {
+        if (x < b[2] + margin && b[0] < x + bw + margin && y < b[3] + margin &&
+            b[1] < y + bh + margin) {
+          clash = true;
+          break;
+        }
+      }
+      if (clash) continue;
+    }
+    placed.push_back({x, y, x + bw, y + bh, 0});
+    for (int r = y; r < y + bh; r++) memset(&mask[r * w + x], 255, bw);
+    n++;
+  }
+  // salt noise, mostly filtered out by the super pixel threshold
+  std::uniform_int_distribution<int> pix(0, w * h - 1);
+  for (int i = 0; i < w * h / 200; i++) mask[pix(rng)] = 255;
+  return mask;
+}
+
+static void run_scene(const char *name, int w, int h, int num_blobs, int min_side, int max_side,
+                      bool separated, int iters) {
+  std::mt19937 rng(1234);
+  std::vector<unsigned char> mask = make_mask(w, h, num_blobs, min_side, max_side, separated, rng);
+  const int area_thresh = 64;
+
+  legacy::CCL old_inst;
+  void *new_inst = create_connect_instance();
+  int num_old = 0, num_new = 0;
+  int *p_old = nullptr, *p_new = nullptr;
+  double t_old = bench::time_us(iters, [&]() {
+    p_old = legacy::extract(mask.data(), w, h, w, area_thresh, &old_inst, &num_old);
+  });
+  double t_new = bench::time_us(iters, [&]() {
+    p_new = extract_connected_component(mask.data(), w, h, w, area_thresh, new_inst, &num_new);
+  });
+
+  // the old labels saturate past CC_MAX_NUM_LABELS, boxes only match below it
+  const char *check = "-";
+  if (separated && num_blobs < CC_MAX_NUM_LABELS / 2) {
+    check = sorted_boxes(p_old, num_old) == sorted_boxes(p_new, num_new) ? "same" : "DIFF";
+  }
+  printf("%-7s %4dx%-4d blobs %4d | legacy %8.1f us %4d boxes | engine %8.1f us %4d boxes | %.2fx "
+         "%s\n",
+         name, w, h, num_blobs, t_old, num_old, t_new, num_new, t_old / t_new, check);
+  destroy_connected_component(new_inst);
+}
+
+int main(int argc, char **argv) {
+  int iters = argc > 1 ? atoi(argv[1]) : 200;
+  run_scene("sparse", 640, 360, 12, 12, 40, true, iters);
+  run_scene("sparse", 1280, 720, 30, 12, 60, true, iters);
+  run_scene("busy", 640, 360, 300, 8, 14, true, iters);
+  run_scene("busy", 1280, 720, 1000, 8, 20, true, iters / 4 + 1);
+  run_scene("crowded", 1280, 720, 800, 8, 48, false, iters / 4 + 1);
+  return 0;
+}
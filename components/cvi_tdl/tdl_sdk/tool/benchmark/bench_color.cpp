@@ -0,0 +1,185 @@
+// Compares the YUV420 to RGB conversion as it shipped in utils/cv/color.cpp (scalar, two pixels
+// per step) against the SIMD row kernels of color_kernels.cpp on a 1080p NV21 and I420 frame,
+// outputs checked bit exact. Then the software preprocessing fallback, convert to a full RGB
+// frame, bilinear resize to the model size and quantize to planar int8 as three passes, against
+// yuv420_resize_to_int8 doing all of it in one pass.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "color_kernels.hpp"
+
+namespace legacy {
+
+const int ITUR_BT_601_CY = 1220542;
+const int ITUR_BT_601_CUB = 2116026;
+const int ITUR_BT_601_CUG = -409993;
+const int ITUR_BT_601_CVG = -852492;
+const int ITUR_BT_601_CVR = 1673527;
+const int ITUR_BT_601_SHIFT = 20;
+
+static uint8_t saturate_cast_uchar(int v) {
+  return (uint8_t)((unsigned)v <= 255 ? v : v > 0 ? 255 : 0);
+}
+
+// YUV420sp2RGB888Invoker / YUV420p2RGB888Invoker inner loop, chroma read through u/v + step
+template <int bIdx>
+void yuv420_to_rgb(const cvitdl::Yuv420Image &src, uint8_t *dst, int dst_step) {
+  for (int j = 0; j < src.height; j += 2) {
+    const uint8_t *y1 = src.y + j * src.y_stride, *y2 = y1 + src.y_stride;
+    const uint8_t *pu = src.u + j / 2 * src.uv_stride, *pv = src.v + j / 2 * src.uv_stride;
+    uint8_t *row1 = dst + dst_step * j, *row2 = row1 + dst_step;
+    for (int i = 0; i < src.width; i += 2, row1 += 6, row2 += 6) {
+      int u = int(pu[i / 2 * src.uv_step]) - 128;
+      int v = int(pv[i / 2 * src.uv_step]) - 128;
+
+      int ruv = (1 << (ITUR_BT_601_SHIFT - 1)) + ITUR_BT_601_CVR * v;
+      int guv = (1 << (ITUR_BT_601_SHIFT - 1)) + ITUR_BT_601_CVG * v + ITUR_BT_601_CUG * u;
+      int buv = (1 << (ITUR_BT_601_SHIFT - 1)) + ITUR_BT_601_CUB * u;
+
+      int y00 = std::max(0, int(y1[i]) - 16) * ITUR_BT_601_CY;
+      row1[2 - bIdx] = saturate_cast_uchar((y00 + ruv) >> ITUR_BT_601_SHIFT);
+      row1[1] = saturate_cast_uchar((y00 + guv) >> ITUR_BT_601_SHIFT);
+      row1[bIdx] = saturate_cast_uchar((y00 + buv) >> ITUR_BT_601_SHIFT);
+
+      int y01 = std::max(0, int(y1[i + 1]) - 16) * ITUR_BT_601_CY;
+      row1[5 - bIdx] = saturate_cast_uchar((y01 + ruv) >> ITUR_BT_601_SHIFT);
+      row1[4] = saturate_cast_uchar((y01 + guv) >> ITUR_BT_601_SHIFT);
+      row1[3 + bIdx] = saturate_cast_uchar((y01 + buv) >> ITUR_BT_601_SHIFT);
+
+      int y10 = std::max(0, int(y2[i]) - 16) * ITUR_BT_601_CY;
+      row2[2 - bIdx] = saturate_cast_uchar((y10 + ruv) >> ITUR_BT_601_SHIFT);
+      row2[1] = saturate_cast_uchar((y10 + guv) >> ITUR_BT_601_SHIFT);
+      row2[bIdx] = saturate_cast_uchar((y10 + buv) >> ITUR_BT_601_SHIFT);
+
+      int y11 = std::max(0, int(y2[i + 1]) - 16) * ITUR_BT_601_CY;
+      row2[5 - bIdx] = saturate_cast_uchar((y11 + ruv) >> ITUR_BT_601_SHIFT);
+      row2[4] = saturate_cast_uchar((y11 + guv) >> ITUR_BT_601_SHIFT);
+      row2[3 + bIdx] = saturate_cast_uchar((y11 + buv) >> ITUR_BT_601_SHIFT);
+    }
+  }
+}
+
+// cv::resize INTER_LINEAR on packed 8-bit RGB, 11-bit coefficients, two passes per row
+void resize_rgb(const uint8_t *src, int sw, int sh, uint8_t *dst, int dw, int dh) {
+  std::vector<int> xofs(dw), xa(dw);
+  for (int dx = 0; dx < dw; dx++) {
+    double fx = (dx + 0.5) * sw / dw - 0.5;
+    int sx = (int)floor(fx);
+    fx -= sx;
+    if (sx < 0) sx = 0, fx = 0;
+    if (sx >= sw - 1) sx = sw - 1, fx = 0;
+    xofs[dx] = sx;
+    xa[dx] = (int)lrint(fx * 2048);
+  }
+  for (int dy = 0; dy < dh; dy++) {
+    double fy = (dy + 0.5) * sh / dh - 0.5;
+    int sy = (int)floor(fy);
+    fy -= sy;
+    if (sy < 0) sy = 0, fy = 0;
+    if (sy >= sh - 1) sy = sh - 1, fy = 0;
+    int b = (int)lrint(fy * 2048);
+    const uint8_t *r0 = src + sy * sw * 3, *r1 = src + std::min(sy + 1, sh - 1) * sw * 3;
+    for (int dx = 0; dx < dw; dx++) {
+      int x0 = xofs[dx] * 3, x1 = std::min(xofs[dx] + 1, sw - 1) * 3, a = xa[dx];
+      for (int c = 0; c < 3; c++) {
+        int h0 = r0[x0 + c] * (2048 - a) + r0[x1 + c] * a;
+        int h1 = r1[x0 + c] * (2048 - a) + r1[x1 + c] * a;
+        dst[(dy * dw + dx) * 3 + c] = (uint8_t)((h0 * (2048 - b) + h1 * b + (1 << 21)) >> 22);
+      }
+    }
+  }
+}
+
+// packed RGB to planar int8 with the quantized factor / mean of InputPreParam
+void normalize(const uint8_t *src, int w, int h, const float *factor, const float *mean,
+               int8_t *dst) {
+  for (int c = 0; c < 3; c++) {
+    for (int i = 0; i < w * h; i++) {
+      int q = (int)lrintf(src[i * 3 + c] * factor[c] - mean[c]);
+      dst[c * w * h + i] = (int8_t)std::min(127, std::max(-128, q));
+    }
+  }
+}
+
+}  // namespace legacy
+
+int main(int argc, char **argv) {
+  int dw = argc > 1 ? atoi(argv[1]) : 640;
+  int dh = argc > 2 ? atoi(argv[2]) : 384;
+  const int w = 1920, h = 1080;
+  std::mt19937 rng(11);
+  std::vector<uint8_t> yuv(w * h * 3 / 2);
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) yuv[y * w + x] = (uint8_t)((x + 2 * y) ^ (rng() & 31));
+  }
+  for (size_t i = w * h; i < yuv.size(); i++) yuv[i] = (uint8_t)rng();
+
+  const uint8_t *y = yuv.data(), *c = yuv.data() + w * h;
+  cvitdl::Yuv420Image nv21 = {y, c + 1, c, w, w, 2, w, h};
+  cvitdl::Yuv420Image i420 = {y, c, c + w * h / 4, w, w / 2, 1, w, h};
+
+  std::vector<uint8_t> out_old(w * h * 3), out_new(w * h * 3);
+  const struct {
+    const char *name;
+    cvitdl::Yuv420Image img;
+  } formats[] = {{"nv21", nv21}, {"i420", i420}};
+  for (const auto &f : formats) {
+    for (int bgr = 0; bgr < 2; bgr++) {
+      double t_old = bench::time_us(10, [&]() {
+        if (bgr)
+          legacy::yuv420_to_rgb<0>(f.img, out_old.data(), w * 3);
+        else
+          legacy::yuv420_to_rgb<2>(f.img, out_old.data(), w * 3);
+      });
+      double t_new =
+          bench::time_us(10, [&]() { cvitdl::yuv420_to_rgb(f.img, out_new.data(), w * 3, bgr); });
+      printf("%s->%s %dx%d | legacy %8.1f us | yuv420_to_rgb %8.1f us | %.2fx %s\n", f.name,
+             bgr ? "bgr" : "rgb", w, h, t_old, t_new, t_old / t_new,
+             out_old == out_new ? "same" : "DIFF");
+    }
+  }
+
+  // planar output must hold the same bytes as the packed one
+  std::vector<uint8_t> planar(w * h * 3);
+  uint8_t *planes[3] = {&planar[0], &planar[w * h], &planar[2 * w * h]};
+  const int strides[3] = {w, w, w};
+  double t_planar =
+      bench::time_us(10, [&]() { cvitdl::yuv420_to_rgb_planar(nv21, planes, strides, false); });
+  cvitdl::yuv420_to_rgb(nv21, out_new.data(), w * 3, false);
+  bool planar_same = true;
+  for (int i = 0; i < w * h; i++) {
+    for (int ch = 0; ch < 3; ch++) planar_same &= planes[ch][i] == out_new[i * 3 + ch];
+  }
+  printf("nv21->rgb planar | yuv420_to_rgb_planar %8.1f us | %s\n", t_planar,
+         planar_same ? "same" : "DIFF");
+
+  // model input: mean 0.5, scale 1/128 folded into the int8 quant scale
+  const float factor[3] = {0.5f, 0.5f, 0.5f}, mean[3] = {64.f, 64.f, 64.f};
+  std::vector<uint8_t> rgb(w * h * 3), small(dw * dh * 3);
+  std::vector<int8_t> in_old(dw * dh * 3), in_new(dw * dh * 3);
+  double t_sep = bench::time_us(10, [&]() {
+    legacy::yuv420_to_rgb<2>(nv21, rgb.data(), w * 3);
+    legacy::resize_rgb(rgb.data(), w, h, small.data(), dw, dh);
+    legacy::normalize(small.data(), dw, dh, factor, mean, in_old.data());
+  });
+  int8_t *in_planes[3] = {&in_new[0], &in_new[dw * dh], &in_new[2 * dw * dh]};
+  double t_fused = bench::time_us(10, [&]() {
+    cvitdl::yuv420_resize_to_int8(nv21, in_planes, dw, dh, dw, factor, mean, false);
+  });
+  int max_diff = 0;
+  for (size_t i = 0; i < in_old.size(); i++) {
+    max_diff = std::max(max_diff, abs(in_old[i] - in_new[i]));
+  }
+  size_t mem_sep = rgb.size() + small.size();
+  size_t mem_fused = w * 3 * 2 + dw * 3 * 2 * sizeof(int) + dw * 2 * sizeof(int) + dw * 4;
+  printf("nv21->%dx%d int8 | convert+resize+normalize %8.1f us, %zu KB scratch | fused %8.1f us, "
+         "%zu KB scratch | %.2fx, max diff %d\n",
+         dw, dh, t_sep, mem_sep / 1024, t_fused, mem_fused / 1024, t_sep / t_fused, max_diff);
+  return 0;
+}
@@ -0,0 +1,526 @@
+// Compares the cvi_runtime cpu detection ops as they shipped against detection_kernels.cpp.
+// SSD: the neon_run path of SSDDetectionFunc (std::map of score/index pair vectors per class,
+// partial_sort, one BBox_l vector of num_priors per label, ApplyNMSFast), its NEON decode
+// written out in scalar so it runs here, against SsdDetector. YOLO: process_feature + the all
+// pairs nms against yolo_decode_feature + yolo_nms. Inputs are synthetic SSD300 / yolov3 416
+// outputs; the op outputs are checked equal.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "cpu_function/detection_kernels.hpp"
+
+namespace legacy {
+
+class BBox_l {
+ public:
+  float num;
+  float label;
+  float score;
+  union {
+    struct {
+      float xmin;
+      float ymin;
+      float xmax;
+      float ymax;
+    } s;
+    float b[4];
+  } xy;
+  float size;
+
+  void CalcSize() {
+    if (xy.s.xmax < xy.s.xmin || xy.s.ymax < xy.s.ymin) {
+      size = 0;
+    } else {
+      float width = xy.s.xmax - xy.s.xmin;
+      float height = xy.s.ymax - xy.s.ymin;
+      size = width * height;
+    }
+  }
+};
+typedef std::map<int, std::vector<BBox_l> > LabelBBox_l;
+typedef std::map<int, std::pair<std::vector<std::pair<float, int> >, std::vector<BBox_l> *> >
+    ConfMap;
+
+static bool SortScoreCmp0(const std::pair<float, int> &pair1,
+                          const std::pair<float, int> &pair2) {
+  return pair1.first > pair2.first;
+}
+
+static const float __expf_rng[2] = {1.442695041f, 0.693147180f};
+static const float __expf_lut[8] = {0.9999999916728642,    0.04165989275009526,
+                                    0.5000006143673624,    0.0014122663401803872,
+                                    1.000000059694879,     0.008336936973260111,
+                                    0.16666570253074878,   0.00019578093328483123};
+
+static float expf_c(float x) {
+  float a, b, c, d, xx;
+  int m;
+  union {
+    float f;
+    int i;
+  } r;
+  m = (int)(x * __expf_rng[0]);
+  x = x - ((float)m) * __expf_rng[1];
+  a = (__expf_lut[4] * x) + (__expf_lut[0]);
+  b = (__expf_lut[6] * x) + (__expf_lut[2]);
+  c = (__expf_lut[5] * x) + (__expf_lut[1]);
+  d = (__expf_lut[7] * x) + (__expf_lut[3]);
+  xx = x * x;
+  a = a + b * xx;
+  c = c + d * xx;
+  xx = xx * xx;
+  r.f = a + c * xx;
+  m = m << 23;
+  r.i = r.i + m;
+  return r.f;
+}
+
+struct SsdParam {
+  int num_classes, num_priors, background_label_id, top_k, keep_topk;
+  bool share_location;
+  float nms_threshold, obj_threshold;
+};
+
+static void GetConfidenceScores(const float *conf_data, int num, const SsdParam &p,
+                                std::vector<ConfMap> *conf_preds) {
+  union {
+    float f;
+    int i;
+  } t, v;
+  t.f = p.obj_threshold;
+  int all = p.num_priors * p.num_classes;
+  for (int i = 0; i < num; i++) {
+    ConfMap &label_scores = (*conf_preds)[i];
+    for (int j = 0; j < all; j++) {
+      v.f = conf_data[j];
+      if (v.i > t.i) {
+        int c = j % p.num_classes;
+        if ((c - p.background_label_id) || !p.share_location)
+          label_scores[c].first.emplace_back(std::make_pair(v.f, j));
+      }
+    }
+    conf_data += all;
+  }
+}
+
+// GetLocBBox_opt with the float32x4_t lanes written out
+static void GetLocBBox(std::vector<ConfMap> *all_conf_scores, const float *loc_data,
+                       const float *prior_data, int num, const SsdParam &p,
+                       std::vector<LabelBBox_l> *all_decode_bboxes) {
+  int num_loc_classes = p.share_location ? 1 : p.num_classes;
+  for (int i = 0; i < num; ++i) {
+    LabelBBox_l &decode_bboxes = (*all_decode_bboxes)[i];
+    std::vector<int> decode_keep_index((*all_conf_scores)[i].size() * p.top_k);
+    int cnt = 0;
+    for (auto it = (*all_conf_scores)[i].begin(); it != (*all_conf_scores)[i].end(); it++) {
+      std::vector<std::pair<float, int> > &scores = it->second.first;
+      if (!p.share_location && it->first == p.background_label_id) continue;
+      it->second.second = &(decode_bboxes[-1]);
+      if (p.top_k < (int)scores.size()) {
+        std::partial_sort(scores.begin(), scores.begin() + p.top_k, scores.end(), SortScoreCmp0);
+      } else {
+        std::sort(scores.begin(), scores.end(), SortScoreCmp0);
+      }
+      int length = std::min(p.top_k, (int)scores.size());
+      for (int k = 0; k < length; ++k) {
+        scores[k].second /= p.num_classes;
+        decode_keep_index[cnt++] = scores[k].second;
+      }
+    }
+    for (int c = 0; c < num_loc_classes; ++c) {
+      int label = c;
+      std::vector<BBox_l> *bb = &(decode_bboxes[label]);
+      if (p.share_location) {
+        label = -1;
+        bb = &(decode_bboxes[label]);
+      } else {
+        if (label == p.background_label_id) continue;
+        auto found = (*all_conf_scores)[i].find(c);
+        if (found == (*all_conf_scores)[i].end()) continue;
+        found->second.second = bb;
+      }
+      bb->resize(p.num_priors);
+      for (int q = 0; q < cnt; q++) {
+        int k = decode_keep_index[q];
+        const float *p0 = prior_data + k * 4;
+        const float *p1 = prior_data + k * 4 + 4 * p.num_priors;
+        float prod[4] = {(p0[2] + -p0[0]) * 1, (p0[3] + -p0[1]) * 1, (p0[0] + p0[2]) * 0.5f,
+                         (p0[1] + p0[3]) * 0.5f};
+        int shift = k * num_loc_classes * 4 + c * 4;
+        float xmin = p1[0] * loc_data[shift];
+        float ymin = p1[1] * loc_data[shift + 1];
+        float w = expf_c(p1[2] * loc_data[shift + 2]);
+        float h = expf_c(p1[3] * loc_data[shift + 3]);
+        float acc[4] = {prod[2] + xmin * prod[0], prod[3] + ymin * prod[1], 0 + w * prod[0],
+                        0 + h * prod[1]};
+        BBox_l &d = (*bb)[k];
+        d.xy.b[0] = acc[0] + -acc[2] * 0.5f;
+        d.xy.b[1] = acc[1] + -acc[3] * 0.5f;
+        d.xy.b[2] = acc[0] + acc[2] * 0.5f;
+        d.xy.b[3] = acc[1] + acc[3] * 0.5f;
+        d.CalcSize();
+      }
+    }
+    loc_data += p.num_priors * num_loc_classes * 4;
+  }
+}
+
+typedef std::pair<float, std::tuple<int, int, std::vector<BBox_l> *> > Kept;
+
+static void ApplyNMSFast(std::vector<BBox_l> *bboxes,
+                         const std::vector<std::pair<float, int> > &conf_score,
+                         float nms_threshold, int top_k, int label,
+                         std::vector<Kept> &score_index_pairs, int *det_num) {
+  int indices_sz = 0;
+  int offset = score_index_pairs.size();
+  int length = (top_k < (int)conf_score.size()) ? top_k : conf_score.size();
+  for (int i = 0; i < length; i++) {
+    bool keep = true;
+    for (int k = 0; k < indices_sz && keep; ++k) {
+      int kept_idx = std::get<1>(score_index_pairs[k + offset].second);
+      const BBox_l &b1 = (*bboxes)[conf_score[i].second];
+      const BBox_l &b2 = (*bboxes)[kept_idx];
+      if (b2.xy.s.xmin > b1.xy.s.xmax || b2.xy.s.xmax < b1.xy.s.xmin ||
+          b2.xy.s.ymin > b1.xy.s.ymax || b2.xy.s.ymax < b1.xy.s.ymin) {
+        keep = true;
+      } else {
+        const float inter_width =
+            std::min(b1.xy.s.xmax, b2.xy.s.xmax) - std::max(b1.xy.s.xmin, b2.xy.s.xmin);
+        const float inter_height =
+            std::min(b1.xy.s.ymax, b2.xy.s.ymax) - std::max(b1.xy.s.ymin, b2.xy.s.ymin);
+        const float inter_size = inter_width * inter_height;
+        const float total_size = b1.size + b2.size;
+        keep = inter_size * (nms_threshold + 1) <= total_size * nms_threshold;
+      }
+    }
+    if (keep) {
+      score_index_pairs.emplace_back(std::make_pair(
+          conf_score[i].first, std::make_tuple(label, conf_score[i].second, bboxes)));
+      indices_sz++;
+    }
+  }
+  *det_num = indices_sz;
+}
+
+static void ssd_run(const SsdParam &p, const float *loc_data, const float *conf_data,
+                    const float *prior_data, int num, float *top_data) {
+  std::vector<ConfMap> all_conf_scores(num);
+  GetConfidenceScores(conf_data, num, p, &all_conf_scores);
+  std::vector<LabelBBox_l> all_decode_bboxes(num);
+  GetLocBBox(&all_conf_scores, loc_data, prior_data, num, p, &all_decode_bboxes);
+
+  int num_shift = 0;
+  for (int i = 0; i < num; ++i) {
+    std::vector<Kept> score_index_pairs;
+    std::map<int, std::pair<int, int> > new_indices_cnt;
+    for (auto it = all_conf_scores[i].begin(); it != all_conf_scores[i].end(); it++) {
+      int c = it->first;
+      if (!p.share_location && c == p.background_label_id) continue;
+      ApplyNMSFast(it->second.second, it->second.first, p.nms_threshold, p.top_k, c,
+                   score_index_pairs, &new_indices_cnt[c].first);
+    }
+    int num_det = score_index_pairs.size();
+    int sz = num_det;
+    if (p.keep_topk > -1 && num_det > p.keep_topk) {
+      std::sort(score_index_pairs.begin(), score_index_pairs.end(),
+                [](const Kept &a, const Kept &b) { return a.first > b.first; });
+      sz = p.keep_topk;
+      for (auto it = new_indices_cnt.begin(); it != new_indices_cnt.end(); it++) {
+        it->second.first = 0;
+      }
+      for (int j = 0; j < sz; ++j) {
+        new_indices_cnt[std::get<0>(score_index_pairs[j].second)].first++;
+      }
+    }
+    auto it = new_indices_cnt.begin();
+    if (it != new_indices_cnt.end()) {
+      int first_cnt = it->second.first;
+      it->second.first = 0;
+      for (++it; it != new_indices_cnt.end(); ++it) {
+        int curr = it->second.first;
+        it->second.first = first_cnt;
+        first_cnt += curr;
+      }
+    }
+    for (int j = 0; j < sz; ++j) {
+      int label = std::get<0>(score_index_pairs[j].second);
+      int idx = std::get<1>(score_index_pairs[j].second);
+      std::vector<BBox_l> *bboxes = std::get<2>(score_index_pairs[j].second);
+      int cnt = (new_indices_cnt[label].first + new_indices_cnt[label].second + num_shift) * 7;
+      (*bboxes)[idx].num = i;
+      (*bboxes)[idx].label = label;
+      (*bboxes)[idx].score = score_index_pairs[j].first;
+      memcpy(&top_data[cnt], &((*bboxes)[idx]), sizeof(float) * 7);
+      new_indices_cnt[label].second++;
+    }
+    num_shift += sz;
+  }
+  for (int i = num_shift * 7; i < num * p.keep_topk * 7; ++i) {
+    top_data[i] = -1;
+  }
+}
+
+// yolo_detection.cpp
+struct box {
+  float x, y, w, h;
+};
+struct detection {
+  box bbox;
+  int cls;
+  float score;
+};
+
+static float _sigmoid(float x) { return 1.0f / (1.0f + std::exp(-x)); }
+
+static float _softmax(float *probs, const float *data, int input_stride, int num_of_class,
+                      int *max_cls) {
+  std::vector<float> x(num_of_class), exp_x(num_of_class);
+  float max_x = -INFINITY;
+  float min_x = INFINITY;
+  for (int i = 0; i < num_of_class; i++) {
+    x[i] = data[i * input_stride];
+    if (x[i] > max_x) max_x = x[i];
+    if (x[i] < min_x) min_x = x[i];
+  }
+  const float t = -100.0f;
+  float sum = 0;
+  for (int i = 0; i < num_of_class; i++) {
+    x[i] = x[i] - max_x;
+    if (min_x < t) x[i] = x[i] / min_x * t;
+    exp_x[i] = std::exp(x[i]);
+    sum += exp_x[i];
+  }
+  float max_prob = 0;
+  for (int i = 0; i < num_of_class; i++) {
+    probs[i] = exp_x[i] / sum;
+    if (probs[i] > max_prob) {
+      max_prob = probs[i];
+      *max_cls = i;
+    }
+  }
+  return max_prob;
+}
+
+#define GET_INDEX(cell_idx, box_idx_in_cell, data_idx, num_cell, class_num) \
+  (box_idx_in_cell * (class_num + 5) * num_cell + data_idx * num_cell + cell_idx)
+
+static void process_feature(detection *det, int *det_idx, const float *feature, int grid_h,
+                            int grid_w, const float *anchor, int yolo_h, int yolo_w,
+                            int num_of_class, float obj_threshold) {
+  int num_cell = grid_h * grid_w;
+  int idx = *det_idx;
+  std::vector<float> box_class_probs(num_of_class);
+  for (int i = 0; i < num_cell; i++) {
+    for (int j = 0; j < 3; j++) {
+      float box_confidence = _sigmoid(feature[GET_INDEX(i, j, 4, num_cell, num_of_class)]);
+      if (box_confidence < obj_threshold) continue;
+      int box_max_cls = -1;
+      float box_max_prob =
+          _softmax(box_class_probs.data(), &feature[GET_INDEX(i, j, 5, num_cell, num_of_class)],
+                   num_cell, num_of_class, &box_max_cls);
+      float box_max_score = box_confidence * box_max_prob;
+      if (box_max_score < obj_threshold) continue;
+      int grid_x = i % grid_w;
+      int grid_y = i / grid_w;
+      float box_x = _sigmoid(feature[GET_INDEX(i, j, 0, num_cell, num_of_class)]);
+      box_x += grid_x;
+      box_x /= grid_w;
+      float box_y = _sigmoid(feature[GET_INDEX(i, j, 1, num_cell, num_of_class)]);
+      box_y += grid_y;
+      box_y /= grid_h;
+      float box_w = std::exp(feature[GET_INDEX(i, j, 2, num_cell, num_of_class)]);
+      box_w *= anchor[j * 2];
+      box_w /= yolo_w;
+      float box_h = std::exp(feature[GET_INDEX(i, j, 3, num_cell, num_of_class)]);
+      box_h *= anchor[j * 2 + 1];
+      box_h /= yolo_h;
+      det[idx].bbox = box{box_x, box_y, box_w, box_h};
+      det[idx].score = box_max_score;
+      det[idx].cls = box_max_cls;
+      idx++;
+    }
+  }
+  *det_idx = idx;
+}
+
+static float overlap(float x1, float w1, float x2, float w2) {
+  float l1 = x1 - w1 / 2;
+  float l2 = x2 - w2 / 2;
+  float left = l1 > l2 ? l1 : l2;
+  float r1 = x1 + w1 / 2;
+  float r2 = x2 + w2 / 2;
+  float right = r1 < r2 ? r1 : r2;
+  return right - left;
+}
+
+static float box_iou(box a, box b) {
+  float w = overlap(a.x, a.w, b.x, b.w);
+  float h = overlap(a.y, a.h, b.y, b.h);
+  float i = (w < 0 || h < 0) ? 0 : w * h;
+  return i / (a.w * a.h + b.w * b.h - i);
+}
+
+static void nms(detection *det, int num, float nms_threshold) {
+  for (int i = 0; i < num; i++) {
+    if (det[i].score == 0) continue;
+    for (int j = i + 1; j < num; j++) {
+      if (det[j].score == 0) continue;
+      if (det[i].cls != det[j].cls) continue;
+      if (box_iou(det[i].bbox, det[j].bbox) > nms_threshold) {
+        if (det[i].score < det[j].score) {
+          det[i].score = 0;
+        } else {
+          det[j].score = 0;
+        }
+      }
+    }
+  }
+}
+
+}  // namespace legacy
+
+// SSD300 layout: priors [2][num_priors * 4] (boxes then variances), softmaxed scores
+static void make_ssd(std::mt19937 &rng, int num, int num_priors, int num_classes,
+                     int num_loc_classes, std::vector<float> &loc, std::vector<float> &conf,
+                     std::vector<float> &prior) {
+  std::uniform_real_distribution<float> u01(0.f, 1.f);
+  std::normal_distribution<float> n01(0.f, 1.f);
+  prior.resize(num_priors * 8);
+  for (int k = 0; k < num_priors; k++) {
+    float cx = u01(rng), cy = u01(rng), w = 0.05f + 0.5f * u01(rng), h = 0.05f + 0.5f * u01(rng);
+    float *p = &prior[k * 4];
+    p[0] = cx - w / 2, p[1] = cy - h / 2, p[2] = cx + w / 2, p[3] = cy + h / 2;
+    float *v = &prior[num_priors * 4 + k * 4];
+    v[0] = v[1] = 0.1f, v[2] = v[3] = 0.2f;
+  }
+  loc.resize(num * num_priors * num_loc_classes * 4);
+  for (auto &x : loc) x = n01(rng) * 0.5f;
+  conf.resize(num * num_priors * num_classes);
+  std::vector<float> logit(num_classes);
+  for (int i = 0; i < num * num_priors; i++) {
+    float sum = 0;
+    for (int c = 0; c < num_classes; c++) {
+      logit[c] = n01(rng) * 1.5f + (c == 0 ? 6.f : 0.f);
+      sum += std::exp(logit[c]);
+    }
+    for (int c = 0; c < num_classes; c++) conf[i * num_classes + c] = std::exp(logit[c]) / sum;
+  }
+}
+
+static void bench_ssd(const char *name, int num, bool share_location, int iters) {
+  std::mt19937 rng(5);
+  cvi::runtime::SsdDetectionParam p;
+  p.num_classes = 21;
+  p.num_priors = 8732;
+  p.share_location = share_location;
+  p.background_label_id = 0;
+  p.top_k = 400;
+  p.nms_threshold = 0.45f;
+  p.confidence_threshold = 0.01f;
+  p.keep_top_k = 200;
+  p.variance_encoded_in_target = false;
+  legacy::SsdParam lp = {p.num_classes, p.num_priors, p.background_label_id, p.top_k,
+                         p.keep_top_k, p.share_location, p.nms_threshold,
+                         p.confidence_threshold};
+  std::vector<float> loc, conf, prior;
+  make_ssd(rng, num, p.num_priors, p.num_classes, share_location ? 1 : p.num_classes, loc, conf,
+           prior);
+
+  std::vector<float> out_old(num * p.keep_top_k * 7, 0), out_new(out_old.size(), 0);
+  double t_old = bench::time_us(iters, [&]() {
+    legacy::ssd_run(lp, loc.data(), conf.data(), prior.data(), num, out_old.data());
+  });
+  cvi::runtime::SsdDetector det;
+  int rows = 0;
+  double t_new = bench::time_us(iters, [&]() {
+    rows = det.run(p, loc.data(), conf.data(), prior.data(), num, out_new.data());
+  });
+  bool same = memcmp(out_old.data(), out_new.data(), out_old.size() * sizeof(float)) == 0;
+  printf("ssd %-22s | neon_run %8.1f us | SsdDetector %8.1f us | %.2fx | %d dets %s\n", name,
+         t_old, t_new, t_old / t_new, rows, same ? "same" : "DIFF");
+}
+
+static void bench_yolo(int class_num, float obj_threshold, int iters) {
+  std::mt19937 rng(9);
+  std::normal_distribution<float> n01(0.f, 1.f);
+  const int net = 416;
+  const int grids[3] = {52, 26, 13};
+  const float anchors[3][6] = {
+      {10, 13, 16, 30, 33, 23}, {30, 61, 62, 45, 59, 119}, {116, 90, 156, 198, 373, 326}};
+  std::vector<std::vector<float> > features(3);
+  for (int f = 0; f < 3; f++) {
+    int cells = grids[f] * grids[f];
+    features[f].resize(3 * (5 + class_num) * cells);
+    for (auto &x : features[f]) x = n01(rng) * 2.f;
+    // objectness is mostly low, as on a real frame
+    for (int j = 0; j < 3; j++) {
+      float *obj = &features[f][(j * (5 + class_num) + 4) * cells];
+      for (int i = 0; i < cells; i++) obj[i] = n01(rng) * 2.f - 8.f;
+    }
+    // objects: a few clusters of neighbouring cells agreeing on one class
+    for (int o = 0; o < 6; o++) {
+      int cls = rng() % class_num, gx = rng() % grids[f], gy = rng() % grids[f];
+      for (int k = 0; k < 9; k++) {
+        int i = std::min(grids[f] - 1, gy + k / 3) * grids[f] + std::min(grids[f] - 1, gx + k % 3);
+        int j = rng() % 3;
+        float *base = &features[f][j * (5 + class_num) * cells];
+        base[4 * cells + i] = 2.f + n01(rng);
+        base[(5 + cls) * cells + i] = 9.f + n01(rng);
+      }
+    }
+  }
+
+  const int kMaxDet = 200;
+  std::vector<legacy::detection> old_dets(500);
+  std::vector<cvi::runtime::YoloDetection> new_dets(500);
+  int n_old = 0, n_new = 0;
+  double t_old = bench::time_us(iters, [&]() {
+    n_old = 0;
+    for (int f = 0; f < 3; f++) {
+      legacy::process_feature(old_dets.data(), &n_old, features[f].data(), grids[f], grids[f],
+                              anchors[f], net, net, class_num, obj_threshold);
+    }
+    legacy::nms(old_dets.data(), n_old, 0.45f);
+  });
+  std::vector<float> scratch;
+  double t_new = bench::time_us(iters, [&]() {
+    n_new = 0;
+    for (int f = 0; f < 3; f++) {
+      n_new = cvi::runtime::yolo_decode_feature(features[f].data(), grids[f], grids[f],
+                                                anchors[f], net, net, class_num, obj_threshold,
+                                                new_dets.data(), n_new, kMaxDet, scratch);
+    }
+    cvi::runtime::yolo_nms(new_dets.data(), n_new, 0.45f);
+  });
+  bool same = n_old == n_new;
+  int kept = 0;
+  for (int i = 0; same && i < n_old; i++) {
+    const legacy::detection &a = old_dets[i];
+    const cvi::runtime::YoloDetection &b = new_dets[i];
+    same = a.bbox.x == b.x && a.bbox.y == b.y && a.bbox.w == b.w && a.bbox.h == b.h &&
+           a.cls == b.cls && a.score == b.score;
+    kept += a.score > 0;
+  }
+  printf("yolo %d classes thr %.2f | process_feature+nms %8.1f us | decode+nms %8.1f us | %.2fx "
+         "| %d raw, %d kept %s\n",
+         class_num, obj_threshold, t_old, t_new, t_old / t_new, n_old, kept,
+         same ? "same" : "DIFF");
+}
+
+int main(int argc, char **argv) {
+  int iters = argc > 1 ? atoi(argv[1]) : 20;
+  bench_ssd("share_location", 1, true, iters);
+  bench_ssd("share_location batch 2", 2, true, iters);
+  bench_ssd("per class location", 1, false, iters / 4 + 1);
+  bench_yolo(80, 0.5f, iters);
+  bench_yolo(80, 0.3f, iters);
+  return 0;
+}
@@ -0,0 +1,182 @@
+// Compares the log-mel front end of sound classification as it shipped (complex Eigen fft and
+// dense mel matrix per frame, whole window every call) against MelFeatureExtract on top of
+// MelStreamExtract: a full window, a window sliding by one pack through the pack api, and a bare
+// stream taking one hop at a time. Quantized outputs are checked against the old implementation.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "melspec.hpp"
+
+using melspec::Matrixf;
+using melspec::Vectorcf;
+using melspec::Vectorf;
+
+namespace legacy {
+
+// melspectrogram_optimze as it was, log mel or pcen
+class Mel {
+ public:
+  Mel(int sr, int n_fft, int n_hop, int n_mel)
+      : n_fft_(n_fft), n_hop_(n_hop), n_mel_(n_mel) {
+    window_ = 0.5 * (1.f - (Vectorf::LinSpaced(n_fft, 0.f, static_cast<float>(n_fft - 1)) * 2.f *
+                            M_PI / n_fft)
+                               .array()
+                               .cos());
+    mel_basis_ = melspec::melfilter(sr, n_fft, n_mel, 0, sr / 2, false);
+  }
+
+  void run(const short *p_data, int data_len, int8_t *p_dst, float q_scale, bool fix) {
+    const float eps = 1E-6, s = 0.025, alpha = 0.98, delta = 2, r = 0.5;
+    int pad_len = n_fft_ / 2;
+    int n_f = n_fft_ / 2 + 1;
+    int n_frames = 1 + (data_len + 2 * pad_len - n_fft_) / n_hop_;
+    Eigen::FFT<float> fft;
+    Vectorf segment(n_fft_);
+    Vectorf last_state(n_mel_);
+    for (int i = 0; i < n_frames; ++i) {
+      for (int j = 0; j < n_fft_; j++) {
+        int srcidx = i * n_hop_ + j - pad_len;
+        if (srcidx < 0) {
+          srcidx = -srcidx;
+        } else if (srcidx >= data_len) {
+          srcidx = data_len - (srcidx - data_len) - 2;
+        }
+        segment[j] = p_data[srcidx] * (1.0 / 32768.0);
+      }
+      Vectorf x_frame = window_.array() * segment.array();
+      Vectorcf spec_ri = fft.fwd(x_frame);
+      Vectorf specmag = spec_ri.leftCols(n_f).cwiseAbs().array().pow(2);
+      Vectorf rowv = specmag * mel_basis_;
+      int8_t *pdst_r = p_dst + i * n_mel_;
+      if (fix) {
+        last_state = i == 0 ? rowv : Vectorf((1 - s) * last_state + s * rowv);
+        Vectorf pcen_data =
+            (rowv.array() / (last_state.array() + eps).pow(alpha) + delta).pow(r) - pow(delta, r);
+        for (int n = 0; n < n_mel_; n++) pdst_r[n] = quant(pcen_data[n] * q_scale);
+      } else {
+        for (int n = 0; n < n_mel_; n++) {
+          float v = rowv[n] < 1.0e-6f ? 1.0e-6f : rowv[n];
+          pdst_r[n] = quant(10 * log10f(v) * q_scale);
+        }
+      }
+    }
+  }
+
+ private:
+  static int8_t quant(float v) {
+    int16_t q = v;
+    return q < -128 ? -128 : (q > 127 ? 127 : q);
+  }
+
+  int n_fft_, n_hop_, n_mel_;
+  Vectorf window_;
+  Matrixf mel_basis_;
+};
+
+}  // namespace legacy
+
+static int max_diff(const std::vector<int8_t> &a, const std::vector<int8_t> &b, int *count) {
+  int diff = 0;
+  *count = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    int d = abs(a[i] - b[i]);
+    if (d > diff) diff = d;
+    if (d) (*count)++;
+  }
+  return diff;
+}
+
+int main(int argc, char **argv) {
+  const int sr = 16000, n_fft = 1024, n_hop = 256, n_mel = 40, time_len = 3;
+  const int pack_len = n_hop * 8;
+  const float q_scale = 1.5f;
+  int wav_len = sr * time_len;
+  int n_frames = 1 + wav_len / n_hop;
+  int num_packs = argc > 1 ? atoi(argv[1]) : 64;
+
+  // a chirp over noise bursts, long enough to slide the window num_packs times
+  std::mt19937 rng(7);
+  std::normal_distribution<float> noise(0.f, 600.f);
+  std::vector<short> audio(wav_len + num_packs * pack_len);
+  for (size_t i = 0; i < audio.size(); i++) {
+    float t = (float)i / sr;
+    float v = 6000.f * sinf(2 * M_PI * (200.f + 900.f * t) * t) + noise(rng);
+    if ((i / 4000) % 5 == 0) v += noise(rng) * 8;
+    audio[i] = (short)std::max(-32768.f, std::min(32767.f, v));
+  }
+
+  legacy::Mel old_mel(sr, n_fft, n_hop, n_mel);
+  melspec::MelFeatureExtract new_mel(wav_len, sr, n_fft, n_hop, n_mel, 0, sr / 2, "reflect", false);
+  std::vector<int8_t> old_out(n_frames * n_mel), new_out(n_frames * n_mel),
+      pack_out(n_frames * n_mel);
+  short *window = audio.data();
+  bool ok = true;
+
+  printf("%d Hz, %d s window, n_fft %d, hop %d, %d mel, %d frames\n", sr, time_len, n_fft, n_hop,
+         n_mel, n_frames);
+  printf("%-22s %12s %12s %10s\n", "case", "legacy(us)", "new(us)", "max diff");
+  for (int fix = 0; fix < 2; fix++) {
+    int count;
+    double t_old = bench::time_us(
+        10, [&]() { old_mel.run(window, wav_len, old_out.data(), q_scale, fix); });
+    double t_new = bench::time_us(10, [&]() {
+      new_mel.melspectrogram_optimze(window, wav_len, new_out.data(), new_out.size(), q_scale,
+                                     fix);
+    });
+    int diff = max_diff(old_out, new_out, &count);
+    ok &= diff <= 1 && count * 100 < (int)old_out.size();
+    printf("%-22s %12.1f %12.1f %7d/%d\n", fix ? "window, pcen" : "window, log mel", t_old, t_new,
+           diff, count);
+  }
+
+  // the window slides one pack per call, the legacy path recomputes it all
+  for (int fix = 0; fix < 2; fix++) {
+    double t_old = 0, t_new = 0;
+    int diff = 0, count = 0;
+    for (int p = 0; p <= num_packs; p++) {
+      short *pack_window = audio.data() + p * pack_len;
+      double t0 = bench::now_us();
+      old_mel.run(pack_window, wav_len, old_out.data(), q_scale, fix);
+      double t1 = bench::now_us();
+      new_mel.melspectrogram_pack_optimize(pack_window, wav_len, pack_len, p, pack_out.data(),
+                                           pack_out.size(), q_scale, fix);
+      double t2 = bench::now_us();
+      if (p > 0) {
+        t_old += t1 - t0;
+        t_new += t2 - t1;
+      }
+      // same frames as computing the window from scratch, up to float summation order
+      new_mel.melspectrogram_optimze(pack_window, wav_len, new_out.data(), new_out.size(), q_scale,
+                                     fix);
+      int c;
+      diff = std::max(diff, max_diff(new_out, pack_out, &c));
+      count += c;
+      diff = std::max(diff, max_diff(old_out, pack_out, &c));
+    }
+    ok &= diff <= 1 && count == 0;
+    printf("%-22s %12.1f %12.1f %7d/%d\n", fix ? "slide 1 pack, pcen" : "slide 1 pack, log mel",
+           t_old / num_packs, t_new / num_packs, diff, count);
+  }
+
+  // always-on: one hop pushed per call, output only when asked
+  melspec::MelStreamExtract stream(sr, n_fft, n_hop, n_mel, 0, sr / 2, false, n_frames);
+  stream.push(audio.data(), n_fft - n_hop);
+  double t_hop = bench::time_us(1, [&]() {
+    for (size_t off = n_fft - n_hop; off + n_hop <= audio.size(); off += n_hop) {
+      stream.push(audio.data() + off, n_hop);
+    }
+  });
+  int hops = (audio.size() - (n_fft - n_hop)) / n_hop;
+  double t_out = bench::time_us(100, [&]() {
+    stream.output(new_out.data(), new_out.size(), q_scale);
+  });
+  printf("%-22s %12s %12.2f\n", "stream, per hop", "-", t_hop / hops);
+  printf("%-22s %12s %12.2f\n", "stream, output", "-", t_out);
+
+  printf("%s\n", ok ? "ok" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+// Replays a device memory alloc/free trace on cvi_runtime's mem_pool (TLSF) and on the previous
+// best-fit allocator (vector of free slots, linear search and neighbour lookup), checking that no
+// two live blocks overlap and reporting time per operation, failures and fragmentation.
+// The trace comes from a file or is generated: models with a weight, a neuron and several io /
+// cmdbuf buffers are loaded and unloaded at random while per-frame buffers come and go.
+//
+// trace file lines: "a <id> <size> <tag>" alloc, "f <id>" free, "u <tag>" free everything of tag
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "mmpool.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct Op {
+  char type;
+  uint32_t id;
+  uint64_t size;
+  uint32_t tag;
+};
+
+static const uint64_t kPoolSize = 256ull << 20;
+
+static std::vector<Op> synthetic_trace(int steps, uint32_t seed) {
+  std::mt19937 rng(seed);
+  auto uniform = [&](uint64_t lo, uint64_t hi) {
+    return std::uniform_int_distribution<uint64_t>(lo, hi)(rng);
+  };
+  std::vector<Op> ops;
+  std::vector<uint32_t> resident;
+  std::vector<uint32_t> frame_ids;
+  uint32_t next_id = 0, next_tag = 1;
+  for (int step = 0; step < steps; step++) {
+    if (resident.size() < 3 || (resident.size() < 7 && uniform(0, 1))) {
+      uint32_t tag = next_tag++;
+      ops.push_back({'a', next_id++, uniform(1 << 20, 12 << 20), tag});
+      ops.push_back({'a', next_id++, uniform(256 << 10, 6 << 20), tag});
+      for (int i = uniform(16, 96); i > 0; i--) {
+        ops.push_back({'a', next_id++, uniform(1 << 10, 512 << 10), tag});
+      }
+      resident.push_back(tag);
+    } else {
+      size_t victim = uniform(0, resident.size() - 1);
+      ops.push_back({'u', 0, 0, resident[victim]});
+      resident.erase(resident.begin() + victim);
+    }
+    for (int i = uniform(0, 16); i > 0; i--) {
+      if (frame_ids.size() > 48 || (!frame_ids.empty() && uniform(0, 1))) {
+        size_t k = uniform(0, frame_ids.size() - 1);
+        ops.push_back({'f', frame_ids[k], 0, 0});
+        frame_ids.erase(frame_ids.begin() + k);
+      } else {
+        frame_ids.push_back(next_id);
+        ops.push_back({'a', next_id++, uniform(4 << 10, 2 << 20), 0});
+      }
+    }
+  }
+  for (uint32_t id : frame_ids) ops.push_back({'f', id, 0, 0});
+  for (uint32_t tag : resident) ops.push_back({'u', 0, 0, tag});
+  return ops;
+}
+
+static bool load_trace(const char *path, std::vector<Op> *ops) {
+  FILE *fp = fopen(path, "r");
+  if (!fp) return false;
+  char type;
+  while (fscanf(fp, " %c", &type) == 1) {
+    Op op = {type, 0, 0, 0};
+    unsigned long long size = 0;
+    if ((type == 'a' && fscanf(fp, "%u %llu %u", &op.id, &size, &op.tag) != 3) ||
+        (type == 'f' && fscanf(fp, "%u", &op.id) != 1) ||
+        (type == 'u' && fscanf(fp, "%u", &op.tag) != 1)) {
+      fclose(fp);
+      return false;
+    }
+    op.size = size;
+    ops->push_back(op);
+  }
+  fclose(fp);
+  return true;
+}
+
+// the NAIVE_PLUS allocator as it was
+class LegacyPool {
+ public:
+  explicit LegacyPool(uint64_t size) { avail_.push_back({0, size}); }
+
+  bool alloc(uint64_t size, uint64_t *addr) {
+    size = (size + MIN_SLOT_SIZE - 1) / MIN_SLOT_SIZE * MIN_SLOT_SIZE;
+    auto best = avail_.end();
+    for (auto it = avail_.begin(); it != avail_.end(); ++it) {
+      if (it->second >= size && (best == avail_.end() || it->second < best->second)) best = it;
+    }
+    if (best == avail_.end()) return false;
+    *addr = best->first;
+    if (best->second == size) {
+      avail_.erase(best);
+    } else {
+      best->first += size;
+      best->second -= size;
+    }
+    in_use_[*addr] = size;
+    return true;
+  }
+  void free(uint64_t addr) {
+    uint64_t size = in_use_[addr];
+    in_use_.erase(addr);
+    auto prev = avail_.end(), next = avail_.end();
+    for (auto it = avail_.begin(); it != avail_.end(); ++it) {
+      if (it->first + it->second == addr) prev = it;
+    }
+    for (auto it = avail_.begin(); it != avail_.end(); ++it) {
+      if (it->first == addr + size) next = it;
+    }
+    if (prev == avail_.end() && next == avail_.end()) {
+      avail_.push_back({addr, size});
+    } else if (prev == avail_.end()) {
+      next->first = addr;
+      next->second += size;
+    } else if (next == avail_.end()) {
+      prev->second += size;
+    } else {
+      prev->second += size + next->second;
+      avail_.erase(next);
+    }
+  }
+  float fragmentation() const {
+    uint64_t total = 0, largest = 0;
+    for (auto &slot : avail_) {
+      total += slot.second;
+      if (slot.second > largest) largest = slot.second;
+    }
+    return total ? 1.f - (float)largest / total : 0.f;
+  }
+
+ private:
+  std::vector<std::pair<uint64_t, uint64_t>> avail_;
+  std::map<uint64_t, uint64_t> in_use_;
+};
+
+struct Replay {
+  double ns_per_op = 0;
+  uint64_t failed = 0;
+  float mean_frag = 0, max_frag = 0;
+  bool ok = true;
+};
+
+// live blocks by address, an alloc overlapping its neighbours is a bug
+static bool insert_live(std::map<uint64_t, uint64_t> *live, uint64_t addr, uint64_t size) {
+  auto next = live->lower_bound(addr);
+  if (next != live->end() && next->first < addr + size) return false;
+  if (next != live->begin() && std::prev(next)->second > addr) return false;
+  (*live)[addr] = addr + size;
+  return true;
+}
+
+template <typename Alloc, typename Free, typename Frag>
+static Replay replay(const std::vector<Op> &ops, Alloc alloc, Free free_fn, Frag frag) {
+  Replay r;
+  std::unordered_map<uint32_t, uint64_t> addr_of;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> ids_of_tag;
+  std::map<uint64_t, uint64_t> live;
+  double frag_sum = 0;
+  uint64_t samples = 0, num_ops = 0;
+  Clock::duration elapsed(0);
+  auto release = [&](uint32_t id) {
+    auto it = addr_of.find(id);
+    if (it == addr_of.end()) return;
+    auto t0 = Clock::now();
+    free_fn(it->second);
+    elapsed += Clock::now() - t0;
+    num_ops++;
+    live.erase(it->second);
+    addr_of.erase(it);
+  };
+  for (const Op &op : ops) {
+    if (op.type == 'a') {
+      uint64_t addr;
+      auto t0 = Clock::now();
+      bool ok = alloc(op.size, op.tag, &addr);
+      elapsed += Clock::now() - t0;
+      num_ops++;
+      if (!ok) {
+        r.failed++;
+        continue;
+      }
+      if (!insert_live(&live, addr, op.size)) r.ok = false;
+      addr_of[op.id] = addr;
+      ids_of_tag[op.tag].push_back(op.id);
+    } else if (op.type == 'f') {
+      release(op.id);
+    } else {
+      for (uint32_t id : ids_of_tag[op.tag]) release(id);
+      ids_of_tag.erase(op.tag);
+    }
+    float f = frag();
+    frag_sum += f;
+    samples++;
+    if (f > r.max_frag) r.max_frag = f;
+  }
+  r.ns_per_op = std::chrono::duration<double, std::nano>(elapsed).count() / num_ops;
+  r.mean_frag = samples ? frag_sum / samples : 0;
+  r.ok &= addr_of.empty();
+  return r;
+}
+
+int main(int argc, char **argv) {
+  std::vector<Op> ops;
+  if (argc > 1 && atoi(argv[1]) == 0) {
+    if (!load_trace(argv[1], &ops)) {
+      printf("cannot read trace %s\n", argv[1]);
+      return 1;
+    }
+  } else {
+    ops = synthetic_trace(argc > 1 ? atoi(argv[1]) : 5000, 42);
+  }
+  printf("%zu ops on a %llu MiB pool\n", ops.size(), (unsigned long long)(kPoolSize >> 20));
+
+  LegacyPool legacy(kPoolSize);
+  Replay old_r = replay(
+      ops, [&](uint64_t size, uint32_t, uint64_t *addr) { return legacy.alloc(size, addr); },
+      [&](uint64_t addr) { legacy.free(addr); }, [&]() { return legacy.fragmentation(); });
+
+  mem_pool_t *pool;
+  mem_pool_create(&pool, kPoolSize);
+  mem_pool_stats_t stats;
+  Replay new_r = replay(
+      ops,
+      [&](uint64_t size, uint32_t tag, uint64_t *addr) {
+        *addr = mem_pool_alloc_tagged(pool, size, tag);
+        return *addr != MEM_POOL_ADDR_INVALID;
+      },
+      [&](uint64_t addr) { mem_pool_free(pool, addr); },
+      [&]() {
+        mem_pool_get_stats(pool, &stats);
+        return stats.fragmentation;
+      });
+  new_r.ok &= pool->tlsf->check();
+  mem_pool_dump(pool);
+  mem_pool_get_stats(pool, &stats);
+  new_r.ok &= stats.used_blocks == 0 && stats.free_blocks == 1;
+  mem_pool_destroy(pool);
+
+  printf("%-10s %10s %8s %10s %10s %6s\n", "allocator", "ns/op", "failed", "mean frag", "max frag",
+         "check");
+  printf("%-10s %10.1f %8llu %9.1f%% %9.1f%% %6s\n", "best-fit", old_r.ns_per_op,
+         (unsigned long long)old_r.failed, old_r.mean_frag * 100, old_r.max_frag * 100,
+         old_r.ok ? "ok" : "FAIL");
+  printf("%-10s %10.1f %8llu %9.1f%% %9.1f%% %6s\n", "tlsf", new_r.ns_per_op,
+         (unsigned long long)new_r.failed, new_r.mean_frag * 100, new_r.max_frag * 100,
+         new_r.ok ? "ok" : "FAIL");
+  return old_r.ok && new_r.ok ? 0 : 1;
+}
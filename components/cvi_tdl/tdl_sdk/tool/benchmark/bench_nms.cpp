@@ -0,0 +1,183 @@
+// Compares the shared_ptr based nms_multi_class that shipped before NmsEngine against NmsEngine
+// on synthetic crowded-scene YOLO candidate sets.
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "nms_engine.hpp"
+
+namespace legacy {
+
+struct object_detect_rect_t {
+  float x1;
+  float y1;
+  float x2;
+  float y2;
+  float score;
+  int label;
+};
+typedef std::shared_ptr<object_detect_rect_t> PtrDectRect;
+typedef std::vector<PtrDectRect> Detections;
+
+static std::vector<size_t> sort_indexes(const Detections &v) {
+  std::vector<size_t> idx(v.size());
+  std::iota(idx.begin(), idx.end(), 0);
+  std::stable_sort(idx.begin(), idx.end(),
+                   [&v](size_t i1, size_t i2) { return v[i1]->score > v[i2]->score; });
+  return idx;
+}
+
+static std::vector<size_t> calculate_area(const Detections &dets) {
+  std::vector<size_t> areas(dets.size());
+  for (size_t i = 0; i < dets.size(); i++) {
+    areas[i] = (dets[i]->x2 - dets[i]->x1) * (dets[i]->y2 - dets[i]->y1);
+  }
+  return areas;
+}
+
+static Detections nms_multi_class(const Detections &dets, float iou_threshold) {
+  std::vector<int> keep(dets.size(), 0);
+  std::vector<int> suppressed(dets.size(), 0);
+  size_t ndets = dets.size();
+  size_t num_to_keep = 0;
+  std::vector<size_t> order = sort_indexes(dets);
+  std::vector<size_t> areas = calculate_area(dets);
+
+  for (size_t _i = 0; _i < ndets; _i++) {
+    auto i = order[_i];
+    if (suppressed[i] == 1) continue;
+    keep[num_to_keep++] = i;
+    auto ix1 = dets[i]->x1;
+    auto iy1 = dets[i]->y1;
+    auto ix2 = dets[i]->x2;
+    auto iy2 = dets[i]->y2;
+    auto iarea = areas[i];
+    for (size_t _j = _i + 1; _j < ndets; _j++) {
+      auto j = order[_j];
+      if (suppressed[j] == 1) continue;
+      auto xx1 = std::max(ix1, dets[j]->x1);
+      auto yy1 = std::max(iy1, dets[j]->y1);
+      auto xx2 = std::min(ix2, dets[j]->x2);
+      auto yy2 = std::min(iy2, dets[j]->y2);
+      auto w = std::max(0.0f, xx2 - xx1);
+      auto h = std::max(0.0f, yy2 - yy1);
+      auto inter = w * h;
+      float ovr = static_cast<float>(inter) / (iarea + areas[j] - inter);
+      if (ovr > iou_threshold && dets[j]->label == dets[i]->label) suppressed[j] = 1;
+    }
+  }
+  Detections final_dets(num_to_keep);
+  for (size_t k = 0; k < num_to_keep; k++) final_dets[k] = dets[keep[k]];
+  return final_dets;
+}
+
+}  // namespace legacy
+
+struct Candidate {
+  float x1, y1, x2, y2, score;
+  int label;
+};
+
+// objects are spread over a 640x640 input, each one produces a cluster of jittered candidates
+// like a YOLO head does around a true box
+static std::vector<Candidate> make_candidates(int num, int num_cls, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> pos(0.f, 600.f);
+  std::uniform_real_distribution<float> size(16.f, 120.f);
+  std::normal_distribution<float> jitter(0.f, 4.f);
+  std::uniform_real_distribution<float> score(0.25f, 0.95f);
+  // crowded scenes are dominated by a few classes (person, car)
+  std::discrete_distribution<int> cls_dist({60, 20, 10, 5, 5});
+
+  std::vector<Candidate> out;
+  out.reserve(num);
+  while (static_cast<int>(out.size()) < num) {
+    float cx = pos(rng), cy = pos(rng), w = size(rng), h = size(rng);
+    int label = std::min(cls_dist(rng), num_cls - 1);
+    int cluster = 4 + static_cast<int>(rng() % 12);
+    for (int k = 0; k < cluster && static_cast<int>(out.size()) < num; k++) {
+      Candidate c;
+      c.x1 = cx + jitter(rng);
+      c.y1 = cy + jitter(rng);
+      c.x2 = c.x1 + w + jitter(rng);
+      c.y2 = c.y1 + h + jitter(rng);
+      c.score = score(rng);
+      c.label = label;
+      out.push_back(c);
+    }
+  }
+  return out;
+}
+
+int main(int argc, char **argv) {
+  int iters = argc > 1 ? atoi(argv[1]) : 20;
+  const float iou_threshold = 0.5f;
+  const int sizes[] = {500, 1000, 2000, 3000, 5000};
+
+  printf("%8s %14s %14s %14s %8s %8s\n", "boxes", "legacy(us)", "engine(us)", "engine+ptr(us)",
+         "speedup", "kept");
+  for (int num : sizes) {
+    std::vector<Candidate> cands = make_candidates(num, 80, 1234 + num);
+
+    // legacy input is what the parsers build today, one shared_ptr per candidate
+    legacy::Detections dets;
+    for (const Candidate &c : cands) {
+      auto det = std::make_shared<legacy::object_detect_rect_t>();
+      *det = {c.x1, c.y1, c.x2, c.y2, c.score, c.label};
+      dets.push_back(det);
+    }
+
+    size_t legacy_kept = 0;
+    double t_legacy = bench::time_us(iters, [&]() {
+      legacy_kept = legacy::nms_multi_class(dets, iou_threshold).size();
+    });
+
+    cvitdl::NmsEngine engine;
+    cvitdl::NmsConfig cfg;
+    cfg.iou_threshold = iou_threshold;
+    std::vector<int> keep;
+    double t_engine = bench::time_us(iters, [&]() {
+      engine.clear();
+      for (const Candidate &c : cands) engine.push(c.x1, c.y1, c.x2, c.y2, c.score, c.label);
+      engine.run(cfg, keep);
+    });
+
+    // same as nms_multi_class now does: read from the Detections vector, fresh engine per call
+    double t_wrapped = bench::time_us(iters, [&]() {
+      cvitdl::NmsEngine local;
+      local.reserve(dets.size());
+      for (const auto &d : dets) local.push(d->x1, d->y1, d->x2, d->y2, d->score, d->label);
+      std::vector<int> order;
+      local.run(cfg, order);
+    });
+
+    printf("%8d %14.1f %14.1f %14.1f %7.1fx %4zu/%zu\n", num, t_legacy, t_engine, t_wrapped,
+           t_legacy / t_engine, keep.size(), legacy_kept);
+  }
+
+  // soft / diou modes for reference
+  std::vector<Candidate> cands = make_candidates(2000, 80, 99);
+  const char *names[] = {"hard", "soft_linear", "soft_gaussian", "diou"};
+  const cvitdl::NmsMode modes[] = {cvitdl::NmsMode::HARD, cvitdl::NmsMode::SOFT_LINEAR,
+                                   cvitdl::NmsMode::SOFT_GAUSSIAN, cvitdl::NmsMode::DIOU};
+  printf("\n2000 boxes by mode:\n");
+  for (int m = 0; m < 4; m++) {
+    cvitdl::NmsEngine engine;
+    cvitdl::NmsConfig cfg;
+    cfg.mode = modes[m];
+    cfg.soft_score_threshold = 0.25f;
+    std::vector<int> keep;
+    double t = bench::time_us(iters, [&]() {
+      engine.clear();
+      for (const Candidate &c : cands) engine.push(c.x1, c.y1, c.x2, c.y2, c.score, c.label);
+      engine.run(cfg, keep);
+    });
+    printf("%14s %10.1f us  kept %zu\n", names[m], t, keep.size());
+  }
+  return 0;
+}
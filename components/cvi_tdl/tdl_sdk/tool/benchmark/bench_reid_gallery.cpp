@@ -0,0 +1,83 @@
+// Inactive identity lookup of the DeepSORT ReID gallery: float brute force (cosine_distance over
+// every stored feature) against the int8 gallery, flat and IVF indexed, on random 128-d features.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "cvi_reid_gallery.hpp"
+
+static FEATURE random_feature(int dim, std::mt19937 &rng) {
+  std::normal_distribution<float> dist(0.f, 1.f);
+  FEATURE f(dim);
+  for (int d = 0; d < dim; d++) f(d) = dist(rng);
+  normalize_feature(f);
+  return f;
+}
+
+static FEATURE jitter(const FEATURE &f, float sigma, std::mt19937 &rng) {
+  std::normal_distribution<float> dist(0.f, sigma / sqrtf(f.cols()));
+  FEATURE out = f;
+  for (int d = 0; d < f.cols(); d++) out(d) += dist(rng);
+  return out;
+}
+
+int main(int argc, char **argv) {
+  int max_size = argc > 1 ? atoi(argv[1]) : 8000;
+  const int dim = 128;
+  const int sizes[] = {500, 1000, 2000, 4000, 8000};
+  const int queries = 100;
+  std::mt19937 rng(2024);
+
+  printf("%6s %14s %14s %14s %10s\n", "size", "float(us)", "int8(us)", "ivf(us)", "ivf_recall");
+  for (int n : sizes) {
+    if (n > max_size) break;
+    std::vector<FEATURE> identities;
+    FEATURES stored(n, dim);
+    ReidGallery flat, ivf;
+    flat.setInactiveCapacity(n);
+    ivf.setInactiveCapacity(n);
+    ivf.setIndex(static_cast<int>(sqrtf(n)), 4);
+    for (int i = 0; i < n; i++) {
+      identities.push_back(random_feature(dim, rng));
+      stored.row(i) = identities.back();
+      flat.addSample(i + 1, 0, identities.back());
+      flat.retireTrack(i + 1, 0);
+      ivf.addSample(i + 1, 0, identities.back());
+      ivf.retireTrack(i + 1, 0);
+    }
+    std::vector<FEATURE> probes;
+    FEATURES probes_m(queries, dim);
+    for (int q = 0; q < queries; q++) {
+      FEATURE f = jitter(identities[(q * 97) % n], 0.3f, rng);
+      normalize_feature(f);
+      probes.push_back(f);
+      probes_m.row(q) = f;
+    }
+
+    double t_float = bench::time_us(1, [&]() {
+      COST_MATRIX d = cosine_distance(stored, probes_m);
+      volatile float best = get_min_colwise(d).sum();
+      (void)best;
+    });
+    ReidMatch match;
+    double t_flat = bench::time_us(1, [&]() {
+      for (const FEATURE &f : probes) flat.searchInactive(f, 0, &match);
+    });
+    int hits = 0;
+    double t_ivf = bench::time_us(1, [&]() {
+      hits = 0;
+      for (int q = 0; q < queries; q++) {
+        if (ivf.searchInactive(probes[q], 0, &match) &&
+            match.id == static_cast<uint64_t>((q * 97) % n + 1)) {
+          hits++;
+        }
+      }
+    });
+    printf("%6d %14.1f %14.1f %14.1f %9.0f%%\n", n, t_float / queries, t_flat / queries,
+           t_ivf / queries, 100.f * hits / queries);
+  }
+  return 0;
+}
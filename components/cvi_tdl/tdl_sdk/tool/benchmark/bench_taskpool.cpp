@@ -0,0 +1,200 @@
+// Async forward submission latency of cvi_runtime's TaskPool under 1 ~ 16 concurrent submitters:
+// the previous pool (one mutex guarded ring, every completion broadcast to every waiter) against
+// the per-worker lock-free queues with per-task completions. Each submitter stands for one model
+// and keeps one forward in flight; a forward is a short busy wait.
+//
+// Then a park stress: submitters pause between empty forwards so workers keep parking just as
+// tasks arrive. A missed wakeup leaves a task queued with every worker asleep, which the
+// watchdog reports as a stall.
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "runtime/taskpool.hpp"
+
+using cvi::runtime::Task;
+using cvi::runtime::TaskPool;
+typedef std::chrono::steady_clock Clock;
+
+static const int kWorkers = 2;
+static int g_forward_us = 20;
+
+static bool fake_forward(Task *) {
+  auto end = Clock::now() + std::chrono::microseconds(g_forward_us);
+  while (Clock::now() < end) {
+  }
+  return true;
+}
+
+// the pool as it was: one queue under one mutex, completion polled under a shared condition
+class LegacyPool {
+ public:
+  struct Job {
+    bool done = false;
+  };
+
+  LegacyPool() {
+    for (int i = 0; i < kWorkers; i++) threads_.emplace_back(&LegacyPool::work, this);
+  }
+  ~LegacyPool() {
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      stop_ = true;
+    }
+    busy_.notify_all();
+    for (auto &t : threads_) t.join();
+  }
+  void submit(Job *job) {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    queue_.push_back(job);
+    busy_.notify_one();
+  }
+  void wait(Job *job) {
+    std::unique_lock<std::mutex> lock(feedback_mutex_);
+    while (!job->done) feedback_.wait(lock);
+  }
+
+ private:
+  void work() {
+    for (;;) {
+      Job *job;
+      {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        while (queue_.empty() && !stop_) busy_.wait(lock);
+        if (queue_.empty()) return;
+        job = queue_.front();
+        queue_.erase(queue_.begin());
+      }
+      fake_forward(nullptr);
+      std::unique_lock<std::mutex> lock(feedback_mutex_);
+      job->done = true;
+      feedback_.notify_all();
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::vector<Job *> queue_;
+  std::mutex queue_mutex_, feedback_mutex_;
+  std::condition_variable busy_, feedback_;
+  bool stop_ = false;
+};
+
+struct Result {
+  double p50, p99, p999, max, throughput;
+};
+
+template <typename Submit>
+static Result run(int submitters, int per_submitter, Submit submit) {
+  std::vector<std::vector<float>> lat(submitters);
+  std::vector<std::thread> threads;
+  std::atomic<int> ready(0);
+  auto t0 = Clock::now();
+  for (int s = 0; s < submitters; s++) {
+    threads.emplace_back([&, s]() {
+      ready++;
+      while (ready < submitters) {
+      }
+      lat[s].reserve(per_submitter);
+      for (int i = 0; i < per_submitter; i++) {
+        auto start = Clock::now();
+        submit(s);
+        lat[s].push_back(std::chrono::duration<float, std::micro>(Clock::now() - start).count());
+      }
+    });
+  }
+  for (auto &t : threads) t.join();
+  double total_s = std::chrono::duration<double>(Clock::now() - t0).count();
+  std::vector<float> all;
+  for (auto &v : lat) all.insert(all.end(), v.begin(), v.end());
+  std::sort(all.begin(), all.end());
+  auto pct = [&](double p) { return all[std::min(all.size() - 1, size_t(p * all.size()))]; };
+  return {pct(0.5), pct(0.99), pct(0.999), all.back(), all.size() / total_s};
+}
+
+static bool empty_forward(Task *) { return true; }
+
+// exits with 1 when no forward completes for two seconds
+static void park_stress(int submitters, int rounds) {
+  TaskPool pool(kWorkers);
+  pool.startPool();
+  std::atomic<long> progress(0);
+  std::atomic<bool> finished(false);
+  std::vector<std::thread> threads;
+  for (int s = 0; s < submitters; s++) {
+    threads.emplace_back([&, s]() {
+      std::mt19937 rng(s);
+      for (int i = 0; i < rounds; i++) {
+        Task task(&pool, nullptr, nullptr, 0, nullptr, 0, empty_forward, -1);
+        pool.waitTask(&task);
+        progress++;
+        // long enough for the workers to run dry and park
+        if (rng() & 1) std::this_thread::sleep_for(std::chrono::microseconds(rng() % 50));
+      }
+    });
+  }
+  std::thread watchdog([&]() {
+    long last = -1;
+    while (!finished) {
+      std::this_thread::sleep_for(std::chrono::seconds(2));
+      long now = progress;
+      if (now == last && !finished) {
+        printf("park stress, %d submitters: STALL after %ld forwards\n", submitters, now);
+        fflush(stdout);
+        _exit(1);
+      }
+      last = now;
+    }
+  });
+  for (auto &t : threads) t.join();
+  finished = true;
+  watchdog.join();
+}
+
+int main(int argc, char **argv) {
+  int per_submitter = argc > 1 ? atoi(argv[1]) : 2000;
+  if (argc > 2) g_forward_us = atoi(argv[2]);
+  int park_rounds = argc > 3 ? atoi(argv[3]) : 20000;
+  printf("%d workers, %d us forwards, %d forwards per submitter, latency in us\n", kWorkers,
+         g_forward_us, per_submitter);
+  printf("%5s | %8s %8s %8s %8s %9s | %8s %8s %8s %8s %9s\n", "subs", "old p50", "p99", "p99.9",
+         "max", "fwd/s", "new p50", "p99", "p99.9", "max", "fwd/s");
+  for (int submitters : {1, 2, 4, 8, 16}) {
+    Result old_r;
+    {
+      LegacyPool legacy;
+      old_r = run(submitters, per_submitter, [&](int) {
+        LegacyPool::Job job;
+        legacy.submit(&job);
+        legacy.wait(&job);
+      });
+    }
+    Result new_r;
+    {
+      TaskPool pool(kWorkers);
+      pool.startPool();
+      std::vector<int> affinity(submitters);
+      for (int &a : affinity) a = pool.assignAffinity();
+      new_r = run(submitters, per_submitter, [&](int s) {
+        Task *task = new Task(&pool, nullptr, nullptr, 0, nullptr, 0, fake_forward, affinity[s]);
+        pool.waitTask(task);
+        delete task;
+      });
+    }
+    printf("%5d | %8.1f %8.1f %8.1f %8.1f %9.0f | %8.1f %8.1f %8.1f %8.1f %9.0f\n", submitters,
+           old_r.p50, old_r.p99, old_r.p999, old_r.max, old_r.throughput, new_r.p50, new_r.p99,
+           new_r.p999, new_r.max, new_r.throughput);
+  }
+  for (int submitters : {1, 2, 4}) {
+    park_stress(submitters, park_rounds);
+    printf("park stress, %d submitters: %d rounds ok\n", submitters, park_rounds);
+  }
+  return 0;
+}
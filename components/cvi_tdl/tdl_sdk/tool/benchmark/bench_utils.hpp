@@ -0,0 +1,23 @@
+#pragma once
+#include <stdio.h>
+#include <chrono>
+#include <random>
+
+namespace bench {
+
+inline double now_us() {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// returns the average time in microseconds of fn() over iters runs, after one warm-up run
+template <typename F>
+double time_us(int iters, F fn) {
+  fn();
+  double start = now_us();
+  for (int i = 0; i < iters; i++) fn();
+  return (now_us() - start) / iters;
+}
+
+}  // namespace bench
@@ -0,0 +1,219 @@
+// Compares face alignment warps as they shipped (scalar port of cv::warpAffine: XY and weight
+// index buffers per 64x64 block, a remap pass over them through a 32x32 weight table, a heap
+// buffer per block) against the fixed-point single pass kernel of img_warp.cpp. Faces are
+// random similarity transforms into 112x112 crops of a 1920x1080 packed RGB frame, some reaching
+// over the frame border; outputs are checked bit exact against the old warp.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "img_warp.hpp"
+
+namespace legacy {
+
+const int INTER_BITS = 5;
+const int INTER_TAB_SIZE = 1 << INTER_BITS;
+const int INTER_TAB_SIZE2 = INTER_TAB_SIZE * INTER_TAB_SIZE;
+const int INTER_REMAP_COEF_BITS = 15;
+const int AB_BITS = 10;
+const int AB_SCALE = 1 << AB_BITS;
+
+static short BilinearTab_i[INTER_TAB_SIZE2][2][2];
+
+static short saturate_cast_short(int v) {
+  return (short)((unsigned)(v + 32768) <= 65535u ? v : v > 0 ? 32767 : -32768);
+}
+static short saturate_cast_short(float v) { return saturate_cast_short((int)lrintf(v)); }
+static uint8_t saturate_cast_uchar(int v) {
+  return (uint8_t)((unsigned)v <= 255 ? v : v > 0 ? 255 : 0);
+}
+static int cv_round(double value) { return (int)(value + (value >= 0 ? 0.5 : -0.5)); }
+
+// initInterTab2D(INTER_LINEAR, true), sum correction included
+static void init_tab() {
+  static bool inited = false;
+  if (inited) return;
+  short *itab = BilinearTab_i[0][0];
+  for (int i = 0; i < INTER_TAB_SIZE; i++) {
+    for (int j = 0; j < INTER_TAB_SIZE; j++, itab += 4) {
+      float ty[2] = {1.f - i * (1.f / INTER_TAB_SIZE), i * (1.f / INTER_TAB_SIZE)};
+      float tx[2] = {1.f - j * (1.f / INTER_TAB_SIZE), j * (1.f / INTER_TAB_SIZE)};
+      int isum = 0;
+      for (int k1 = 0; k1 < 2; k1++) {
+        for (int k2 = 0; k2 < 2; k2++) {
+          isum += itab[k1 * 2 + k2] =
+              saturate_cast_short(ty[k1] * tx[k2] * (1 << INTER_REMAP_COEF_BITS));
+        }
+      }
+      int diff = isum - (1 << INTER_REMAP_COEF_BITS);
+      if (diff != 0) {
+        // the search runs over itab[3..6], into the next entry, as in the original
+        int Mk = 3, mk = 3;
+        for (int k = 3; k < 7; k++) {
+          if (itab[k] < itab[mk]) {
+            mk = k;
+          } else if (itab[k] > itab[Mk]) {
+            Mk = k;
+          }
+        }
+        if (diff < 0) {
+          itab[Mk] = (short)(itab[Mk] - diff);
+        } else {
+          itab[mk] = (short)(itab[mk] - diff);
+        }
+      }
+    }
+  }
+  inited = true;
+}
+
+static int border(int p, int len) { return (unsigned)p < (unsigned)len ? p : -1; }
+
+static void remap_block(const uint8_t *S0, int sw, int sh, int sstep, uint8_t *dst, int bw, int bh,
+                        int dstep, const short *XY, const uint16_t *FXY) {
+  const short *wtab = BilinearTab_i[0][0];
+  const uint8_t cval[3] = {0, 0, 0};
+  unsigned width1 = std::max(sw - 1, 0), height1 = std::max(sh - 1, 0);
+  for (int dy = 0; dy < bh; dy++) {
+    uint8_t *D = dst + dy * dstep;
+    const short *xy = XY + dy * bw * 2;
+    const uint16_t *fxy = FXY + dy * bw;
+    for (int dx = 0; dx < bw; dx++, D += 3) {
+      int sx = xy[dx * 2], sy = xy[dx * 2 + 1];
+      const short *w = wtab + fxy[dx] * 4;
+      if ((unsigned)sx < width1 && (unsigned)sy < height1) {
+        const uint8_t *S = S0 + sy * sstep + sx * 3;
+        for (int k = 0; k < 3; k++) {
+          int t = S[k] * w[0] + S[k + 3] * w[1] + S[sstep + k] * w[2] + S[sstep + k + 3] * w[3];
+          D[k] = saturate_cast_uchar((t + (1 << 14)) >> 15);
+        }
+      } else if (sx >= sw || sx + 1 < 0 || sy >= sh || sy + 1 < 0) {
+        D[0] = D[1] = D[2] = 0;
+      } else {
+        int sx0 = border(sx, sw), sx1 = border(sx + 1, sw);
+        int sy0 = border(sy, sh), sy1 = border(sy + 1, sh);
+        const uint8_t *v0 = sx0 >= 0 && sy0 >= 0 ? S0 + sy0 * sstep + sx0 * 3 : cval;
+        const uint8_t *v1 = sx1 >= 0 && sy0 >= 0 ? S0 + sy0 * sstep + sx1 * 3 : cval;
+        const uint8_t *v2 = sx0 >= 0 && sy1 >= 0 ? S0 + sy1 * sstep + sx0 * 3 : cval;
+        const uint8_t *v3 = sx1 >= 0 && sy1 >= 0 ? S0 + sy1 * sstep + sx1 * 3 : cval;
+        for (int k = 0; k < 3; k++) {
+          int t = v0[k] * w[0] + v1[k] * w[1] + v2[k] * w[2] + v3[k] * w[3];
+          D[k] = saturate_cast_uchar((t + (1 << 14)) >> 15);
+        }
+      }
+    }
+  }
+}
+
+// cvitdl::warp_affine as it was, minus the leak of the per block weight buffer
+static void warp_affine(const uint8_t *src, int sstep, int sw, int sh, uint8_t *dst, int dstep,
+                        int dw, int dh, const float *fM) {
+  init_tab();
+  double M[6];
+  for (int i = 0; i < 6; i++) M[i] = fM[i];
+  double D = M[0] * M[4] - M[1] * M[3];
+  D = D != 0 ? 1. / D : 0;
+  double A11 = M[4] * D, A22 = M[0] * D;
+  M[0] = A11;
+  M[1] *= -D;
+  M[3] *= -D;
+  M[4] = A22;
+  double b1 = -M[0] * M[2] - M[1] * M[5];
+  double b2 = -M[3] * M[2] - M[4] * M[5];
+  M[2] = b1;
+  M[5] = b2;
+
+  int *abdelta = new int[dw * 2];
+  int *adelta = abdelta, *bdelta = abdelta + dw;
+  for (int x = 0; x < dw; x++) {
+    adelta[x] = cv_round(M[0] * x * AB_SCALE);
+    bdelta[x] = cv_round(M[3] * x * AB_SCALE);
+  }
+  const int BLOCK_SZ = 64;
+  short XY[BLOCK_SZ * BLOCK_SZ * 2], A[BLOCK_SZ * BLOCK_SZ];
+  int round_delta = AB_SCALE / INTER_TAB_SIZE / 2;
+  int bh0 = std::min(BLOCK_SZ / 2, dw);
+  int bw0 = std::min(BLOCK_SZ * BLOCK_SZ / bh0, dw);
+  bh0 = std::min(BLOCK_SZ * BLOCK_SZ / bw0, dh);
+  for (int y = 0; y < dh; y += bh0) {
+    for (int x = 0; x < dw; x += bw0) {
+      int bw = std::min(bw0, dw - x), bh = std::min(bh0, dh - y);
+      for (int y1 = 0; y1 < bh; y1++) {
+        short *xy = XY + y1 * bw * 2;
+        short *alpha = A + y1 * bw;
+        int X0 = cv_round((M[1] * (y + y1) + M[2]) * AB_SCALE) + round_delta;
+        int Y0 = cv_round((M[4] * (y + y1) + M[5]) * AB_SCALE) + round_delta;
+        for (int x1 = 0; x1 < bw; x1++) {
+          int X = (X0 + adelta[x + x1]) >> (AB_BITS - INTER_BITS);
+          int Y = (Y0 + bdelta[x + x1]) >> (AB_BITS - INTER_BITS);
+          xy[x1 * 2] = saturate_cast_short(X >> INTER_BITS);
+          xy[x1 * 2 + 1] = saturate_cast_short(Y >> INTER_BITS);
+          alpha[x1] =
+              (short)((Y & (INTER_TAB_SIZE - 1)) * INTER_TAB_SIZE + (X & (INTER_TAB_SIZE - 1)));
+        }
+      }
+      // remap_bilinear copied the weight indices into a fresh heap buffer per block
+      uint16_t *bufa = new uint16_t[bh * bw];
+      for (int i = 0; i < bh * bw; i++) bufa[i] = (uint16_t)(A[i] & (INTER_TAB_SIZE2 - 1));
+      remap_block(src, sw, sh, sstep, dst + y * dstep + x * 3, bw, bh, dstep, XY, bufa);
+      delete[] bufa;
+    }
+  }
+  delete[] abdelta;
+}
+
+}  // namespace legacy
+
+// similarity transform mapping a face of size ~face_px centred at (cx, cy) onto a 112 crop
+static void random_face(std::mt19937 &rng, int w, int h, float *M) {
+  std::uniform_real_distribution<float> u(0.f, 1.f);
+  float face_px = 40 + u(rng) * 260;
+  float angle = (u(rng) - 0.5f) * 1.0f;
+  // a few faces sit on the frame border
+  float cx = -20 + u(rng) * (w + 40), cy = -20 + u(rng) * (h + 40);
+  float s = 112.f / face_px;
+  M[0] = s * cosf(angle);
+  M[1] = s * sinf(angle);
+  M[3] = -M[1];
+  M[4] = M[0];
+  M[2] = 56 - (M[0] * cx + M[1] * cy);
+  M[5] = 56 - (M[3] * cx + M[4] * cy);
+}
+
+int main(int argc, char **argv) {
+  int num_faces = argc > 1 ? atoi(argv[1]) : 32;
+  const int w = 1920, h = 1080, dw = 112, dh = 112;
+  std::mt19937 rng(7);
+  std::vector<uint8_t> frame(w * h * 3);
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w * 3; x++) {
+      frame[y * w * 3 + x] = (uint8_t)((x * 7 + y * 3) ^ (rng() & 15));
+    }
+  }
+  std::vector<float> transforms(num_faces * 6);
+  for (int i = 0; i < num_faces; i++) random_face(rng, w, h, &transforms[i * 6]);
+
+  const int dstep = dw * 3;
+  std::vector<uint8_t> out_old(num_faces * dh * dstep), out_new(out_old.size());
+  double t_old = bench::time_us(20, [&]() {
+    for (int i = 0; i < num_faces; i++) {
+      legacy::warp_affine(frame.data(), w * 3, w, h, &out_old[i * dh * dstep], dstep, dw, dh,
+                          &transforms[i * 6]);
+    }
+  });
+  double t_new = bench::time_us(20, [&]() {
+    for (int i = 0; i < num_faces; i++) {
+      cvitdl::warp_affine(frame.data(), w * 3, w, h, &out_new[i * dh * dstep], dstep, dw, dh,
+                          &transforms[i * 6]);
+    }
+  });
+  bool same = out_old == out_new;
+  printf("rgb888  %d faces | legacy %8.1f us | warp_affine %8.1f us | %.2fx %s\n", num_faces,
+         t_old, t_new, t_old / t_new, same ? "same" : "DIFF");
+  return 0;
+}
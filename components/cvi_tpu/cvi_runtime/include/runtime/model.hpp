@@ -52,7 +52,8 @@ private:
   ~CviModel();
 
   CVI_RC parse(BaseStream *stream);
-  CVI_RC loadWeight(BaseStream *stream, size_t offset, size_t size);
+  CVI_RC loadWeight(BaseStream *stream, size_t offset, size_t size,
+                    bool shareable);
   CVI_RC loadDmabuf(BaseStream *stream, size_t offset, size_t size, const cvi::model::Section *section);
   CVI_RC loadCmdbuf(BaseStream *stream, size_t offset, size_t size, const cvi::model::Section *section);
   CVI_RC extractSections(BaseStream *stream, size_t bin_offset);
@@ -68,6 +69,8 @@ private:
   TaskPool *_pool = nullptr;
   cvi::model::Model *_fb_model;
   uint8_t *_model_body = nullptr;
+  uint64_t _body_hash = 0;
+  // shared by every model registered from the same cvimodel
   CVI_RT_MEM _weight_mem = nullptr;
   //CustomFunctionSection _custom_section;
   std::vector<CpuRuntimeFunction *> _cpu_functions;
@@ -45,6 +45,8 @@ public:
                      CVI_TENSOR *outputs, int output_num);
 
   CVI_RC forwardWait(void *task);
+  // Task::RunFunc of forwardAsync
+  static bool runTask(Task *task);
 
   const tensor_list_t &input_tensors() { return in_tensors; }
   const tensor_list_t &output_tensors() { return out_tensors; }
@@ -78,6 +80,9 @@ private:
   bool _export_all_tensors;
   bool _skip_preprocess;
   TaskPool *_pool = nullptr;
+  int _affinity = -1;
+  // a stolen task may run on another worker than the home one of the program
+  std::mutex _forward_mutex;
   CVI_RT_MEM private_mem = nullptr;
   CVI_RT_MEM shared_mem = nullptr;
   std::list<std::shared_ptr<Routine>> _routines;
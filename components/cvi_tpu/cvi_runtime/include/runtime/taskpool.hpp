@@ -7,11 +7,9 @@
 
 //#include <future>
 #include <atomic>
-#include <deque>
+#include <memory>
+#include <thread>
 #include <vector>
-#include <utility>
-#include <chrono>
-#include <list>
 #include <mutex>
 #include <condition_variable>
 #include "cviruntime.h"
@@ -21,90 +19,109 @@ namespace runtime {
 
 class TaskPool;
 
+// one-shot event, signal() wakes the waiters of this event only
+class Completion {
+public:
+  void signal() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _done = true;
+    _cond.notify_all();
+  }
+
+  void wait() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_done)
+      _cond.wait(lock);
+  }
+
+private:
+  bool _done = false;
+  std::mutex _mutex;
+  std::condition_variable _cond;
+};
+
 class Task {
 public:
+  typedef bool (*RunFunc)(Task *task);
+
+  // queued right away on the home worker of affinity, any worker for -1
   Task(TaskPool *pool, void *program, CVI_TENSOR *inputs, int input_num,
-       CVI_TENSOR *outputs, int output_num);
+       CVI_TENSOR *outputs, int output_num, RunFunc run, int affinity = -1);
 
   void *program;
   int input_num;
   int output_num;
   CVI_TENSOR *inputs;
   CVI_TENSOR *outputs;
+  RunFunc run;
+  int affinity;
   CVI_RC retCode = CVI_RC_UNINIT;
+  Completion done;
 };
 
-class RingQueue {
+// bounded lock-free multi producer / multi consumer queue (Vyukov),
+// capacity is rounded up to a power of two
+class MpmcQueue {
 public:
-  RingQueue(int capacity) : _capacity(capacity) { _queue.resize(_capacity); }
+  explicit MpmcQueue(uint32_t capacity);
 
-  ~RingQueue() {}
-
-  void put(Task *task) {
-    std::unique_lock<std::mutex> lock(_mutex);
-    while (_capacity - _length <= 1) {
-      _cond_idel.wait(lock);
-    }
-    _queue[_tail] = task;
-    move(_tail);
-    _length++;
-    _cond_busy.notify_one();
-  }
-
-  Task *get() {
-    std::unique_lock<std::mutex> lock(_mutex);
-    while (_length == 0) {
-      _cond_busy.wait(lock);
-    }
-    if (_capacity - _length == 1) {
-      _cond_idel.notify_one();
-    }
-    auto task = _queue[_head];
-    move(_head);
-    _length--;
-    return task;
-  }
-
-  inline uint32_t move(uint32_t &index) {
-    ++index;
-    index %= _capacity;
-    return index;
-  }
+  // false when full / empty
+  bool push(Task *task);
+  bool pop(Task **task);
 
 private:
-  uint32_t _capacity;
-  uint32_t _head = 0;
-  uint32_t _tail = 0;
-  uint32_t _length = 0;
-  std::vector<Task *> _queue;
-  std::mutex _mutex;
-  std::condition_variable _cond_busy;
-  std::condition_variable _cond_idel;
+  struct Cell {
+    std::atomic<size_t> seq;
+    Task *task;
+  };
+  std::unique_ptr<Cell[]> _cells;
+  size_t _mask;
+  alignas(64) std::atomic<size_t> _enqueue_pos;
+  alignas(64) std::atomic<size_t> _dequeue_pos;
 };
 
+/*
+ * Every worker owns a submission queue. A task goes to the queue of its home worker
+ * (affinity % pool_size), so the forwards of one program stay on one thread, and idle
+ * workers steal from the other queues. Parked workers are woken one at a time and
+ * each task has its own completion, so nothing is broadcast.
+ */
 class TaskPool {
 public:
-  TaskPool(int pool_size)
-      : _pool_size(pool_size), _queue(pool_size * 4),
-        _started(false), _done(false) {}
+  TaskPool(int pool_size, uint32_t queue_capacity = 64);
   ~TaskPool();
 
+  // pool shared by all models, TASKPOOL_SHARED_WORKERS workers
+  static TaskPool *shared();
+
   void startPool();
-  void addTask(Task *task) { _queue.put(task); }
-  void waitTask(Task *task);
-  void workFunc();
+  void addTask(Task *task);
+  void waitTask(Task *task) { task->done.wait(); }
+  // home worker for a new program, round robin
+  int assignAffinity() { return _next_affinity++; }
+  int size() const { return _pool_size; }
 
 private:
-  void addTerminateTask() { _queue.put(nullptr); }
-  static void run(TaskPool *pool) { pool->workFunc(); }
+  struct Worker {
+    explicit Worker(uint32_t capacity) : queue(capacity) {}
+    MpmcQueue queue;
+    std::atomic<bool> parked{false};
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::thread thread;
+  };
+
+  void workFunc(int index);
+  bool fetch(int index, Task **task);
+  void wake(Worker &worker);
 
   int _pool_size;
-  RingQueue _queue;
+  std::vector<std::unique_ptr<Worker>> _workers;
+  std::atomic<int> _next_affinity;
+  std::atomic<uint32_t> _next_queue;
   std::atomic<bool> _started;
   std::atomic<bool> _done;
   std::mutex _mutex;
-  std::vector<std::thread> _threads;
-  std::condition_variable _cond_feedback;
 };
 
 }
@@ -0,0 +1,30 @@
+#ifndef RUNTIME_WEIGHT_CACHE_H
+#define RUNTIME_WEIGHT_CACHE_H
+
+#include <stdint.h>
+#include <cviruntime_context.h>
+
+namespace cvi {
+namespace runtime {
+
+// 64bit hash over 8 byte words, chunks other than the last must be a
+// multiple of 8 bytes to chain hash states
+uint64_t hashContent(uint64_t seed, const uint8_t *data, size_t size);
+
+// models registered from the same cvimodel share one weight buffer, keyed by
+// the hash of the model body and of the weight section itself
+bool hasCachedWeight(uint64_t body_hash, size_t size);
+// take a reference on matching weights, null if there are none
+CVI_RT_MEM acquireCachedWeight(uint64_t body_hash, uint64_t content_hash,
+                               size_t size);
+// publish weights the caller has just loaded, it holds the first reference
+void cacheWeight(CVI_RT_MEM mem, uint64_t body_hash, uint64_t content_hash,
+                 size_t size);
+// drop a reference, the last one frees the memory; weights that were
+// never cached are freed at once
+void releaseWeight(CVI_RT_HANDLE ctx, CVI_RT_MEM mem);
+
+} // namespace runtime
+} // namespace cvi
+
+#endif
@@ -0,0 +1,509 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <cmath>
+#include <algorithm>
+#include <cpu_function/detection_kernels.hpp>
+
+#ifdef __ARM_NEON
+#include "arm_neon.h"
+#define DET_USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define DET_USE_SSE
+#endif
+
+namespace cvi {
+namespace runtime {
+
+static const float __expf_rng[2] = {
+  1.442695041f,
+  0.693147180f
+};
+
+static const float __expf_lut[8] = {
+  0.9999999916728642,    //p0
+  0.04165989275009526,   //p4
+  0.5000006143673624,    //p2
+  0.0014122663401803872, //p6
+  1.000000059694879,     //p1
+  0.008336936973260111,  //p5
+  0.16666570253074878,   //p3
+  0.00019578093328483123 //p7
+};
+
+// exp by range reduction and a degree 7 polynomial, the one the neon path of
+// the ssd op always used for the box size
+static inline float expf_c(float x) {
+  float a, b, c, d, xx;
+  int m;
+
+  union {
+    float f;
+    int i;
+  } r;
+
+  m = (int)(x * __expf_rng[0]);
+  x = x - ((float)m) * __expf_rng[1];
+
+  a = (__expf_lut[4] * x) + (__expf_lut[0]);
+  b = (__expf_lut[6] * x) + (__expf_lut[2]);
+  c = (__expf_lut[5] * x) + (__expf_lut[1]);
+  d = (__expf_lut[7] * x) + (__expf_lut[3]);
+  xx = x * x;
+  a = a + b * xx;
+  c = c + d * xx;
+  xx = xx * xx;
+  r.f = a + c * xx;
+
+  m = m << 23;
+  r.i = r.i + m;
+  return r.f;
+}
+
+void SsdDetector::collect(const SsdDetectionParam &param, const float *conf, int top_k) {
+  const int num_classes = param.num_classes;
+  const int total = param.num_priors * num_classes;
+  std::fill(_heap_len.begin(), _heap_len.end(), 0);
+
+  // scores are compared as integers, which orders positive floats like floats
+  union {
+    float f;
+    int32_t i;
+  } t;
+  t.f = param.confidence_threshold;
+  const int32_t *bits = reinterpret_cast<const int32_t *>(conf);
+
+  // score j is prior j / num_classes of class j % num_classes
+  auto push = [&](int j, int p, int c) {
+    if (bits[j] <= t.i || c == param.background_label_id)
+      return;
+    ScoredIndex v = {conf[j], p};
+    ScoredIndex *heap = &_heaps[c * top_k];
+    int &len = _heap_len[c];
+    // the heap keeps its worst entry on top
+    if (len < top_k) {
+      heap[len++] = v;
+      std::push_heap(heap, heap + len, score_greater);
+    } else if (score_greater(v, heap[0])) {
+      std::pop_heap(heap, heap + len, score_greater);
+      heap[len - 1] = v;
+      std::push_heap(heap, heap + len, score_greater);
+    }
+  };
+#if defined(DET_USE_NEON) || defined(DET_USE_SSE)
+  auto push4 = [&](int j) {
+    int p = j / num_classes, c = j - p * num_classes;
+    for (int k = j; k < j + 4; k++) {
+      push(k, p, c);
+      if (++c == num_classes) {
+        c = 0;
+        p++;
+      }
+    }
+  };
+#endif
+
+  int j = 0;
+#if defined(DET_USE_NEON)
+  const int32x4_t vt = vdupq_n_s32(t.i);
+  for (; j + 4 <= total; j += 4) {
+    uint32x4_t gt = vcgtq_s32(vld1q_s32(bits + j), vt);
+    uint32x2_t any = vorr_u32(vget_low_u32(gt), vget_high_u32(gt));
+    if (vget_lane_u64(vreinterpret_u64_u32(any), 0) == 0)
+      continue;
+    push4(j);
+  }
+#elif defined(DET_USE_SSE)
+  const __m128i vt = _mm_set1_epi32(t.i);
+  for (; j + 4 <= total; j += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bits + j));
+    if (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, vt))) == 0)
+      continue;
+    push4(j);
+  }
+#endif
+  for (; j < total; j++)
+    push(j, j / num_classes, j % num_classes);
+}
+
+void SsdDetector::decode(const SsdDetectionParam &param, const float *loc, const float *prior,
+                         const ScoredIndex *cands, int n, int label) {
+  const int num_loc_classes = param.share_location ? 1 : param.num_classes;
+  const int loc_class = param.share_location ? 0 : label;
+  _cand.resize(n);
+  for (int i = 0; i < n; i++) {
+    const int k = cands[i].index;
+    const float *p0 = prior + k * 4;
+    const float *p1 = prior + param.num_priors * 4 + k * 4;
+    const float *l = loc + (k * num_loc_classes + loc_class) * 4;
+    float var[4] = {p1[0], p1[1], p1[2], p1[3]};
+    if (param.variance_encoded_in_target) {
+      var[0] = var[1] = var[2] = var[3] = 1;
+    }
+
+    float prior_w = p0[2] - p0[0];
+    float prior_h = p0[3] - p0[1];
+    float prior_cx = (p0[0] + p0[2]) * 0.5f;
+    float prior_cy = (p0[1] + p0[3]) * 0.5f;
+    assert(prior_w > 0 && prior_h > 0);
+
+    float cx = prior_cx + var[0] * l[0] * prior_w;
+    float cy = prior_cy + var[1] * l[1] * prior_h;
+    float w = expf_c(var[2] * l[2]) * prior_w;
+    float h = expf_c(var[3] * l[3]) * prior_h;
+
+    float x1 = cx - w * 0.5f, y1 = cy - h * 0.5f;
+    float x2 = cx + w * 0.5f, y2 = cy + h * 0.5f;
+    _cand.x1[i] = x1;
+    _cand.y1[i] = y1;
+    _cand.x2[i] = x2;
+    _cand.y2[i] = y2;
+    _cand.size[i] = (x2 < x1 || y2 < y1) ? 0 : (x2 - x1) * (y2 - y1);
+  }
+}
+
+// whether box i of cand overlaps one of the first m kept boxes by more than the threshold,
+// iou > threshold tested as inter * (threshold + 1) > (size_a + size_b) * threshold
+template <typename Soa>
+static bool suppressed(const Soa &kept, int m, const Soa &cand, int i, float threshold) {
+  const float bx1 = cand.x1[i], by1 = cand.y1[i], bx2 = cand.x2[i], by2 = cand.y2[i];
+  const float bsize = cand.size[i];
+  const float thr1 = threshold + 1;
+  int j = 0;
+#if defined(DET_USE_NEON)
+  const float32x4_t vx1 = vdupq_n_f32(bx1), vy1 = vdupq_n_f32(by1);
+  const float32x4_t vx2 = vdupq_n_f32(bx2), vy2 = vdupq_n_f32(by2);
+  for (; j + 4 <= m; j += 4) {
+    float32x4_t kx1 = vld1q_f32(&kept.x1[j]), ky1 = vld1q_f32(&kept.y1[j]);
+    float32x4_t kx2 = vld1q_f32(&kept.x2[j]), ky2 = vld1q_f32(&kept.y2[j]);
+    uint32x4_t disjoint = vorrq_u32(vorrq_u32(vcgtq_f32(kx1, vx2), vcltq_f32(kx2, vx1)),
+                                    vorrq_u32(vcgtq_f32(ky1, vy2), vcltq_f32(ky2, vy1)));
+    float32x4_t iw = vsubq_f32(vminq_f32(vx2, kx2), vmaxq_f32(vx1, kx1));
+    float32x4_t ih = vsubq_f32(vminq_f32(vy2, ky2), vmaxq_f32(vy1, ky1));
+    float32x4_t total = vaddq_f32(vdupq_n_f32(bsize), vld1q_f32(&kept.size[j]));
+    uint32x4_t over = vcgtq_f32(vmulq_n_f32(vmulq_f32(iw, ih), thr1),
+                                vmulq_n_f32(total, threshold));
+    uint32x4_t hit = vbicq_u32(over, disjoint);
+    uint32x2_t any = vorr_u32(vget_low_u32(hit), vget_high_u32(hit));
+    if (vget_lane_u64(vreinterpret_u64_u32(any), 0))
+      return true;
+  }
+#elif defined(DET_USE_SSE)
+  const __m128 vx1 = _mm_set1_ps(bx1), vy1 = _mm_set1_ps(by1);
+  const __m128 vx2 = _mm_set1_ps(bx2), vy2 = _mm_set1_ps(by2);
+  for (; j + 4 <= m; j += 4) {
+    __m128 kx1 = _mm_loadu_ps(&kept.x1[j]), ky1 = _mm_loadu_ps(&kept.y1[j]);
+    __m128 kx2 = _mm_loadu_ps(&kept.x2[j]), ky2 = _mm_loadu_ps(&kept.y2[j]);
+    __m128 disjoint = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(kx1, vx2), _mm_cmplt_ps(kx2, vx1)),
+                                _mm_or_ps(_mm_cmpgt_ps(ky1, vy2), _mm_cmplt_ps(ky2, vy1)));
+    __m128 iw = _mm_sub_ps(_mm_min_ps(vx2, kx2), _mm_max_ps(vx1, kx1));
+    __m128 ih = _mm_sub_ps(_mm_min_ps(vy2, ky2), _mm_max_ps(vy1, ky1));
+    __m128 total = _mm_add_ps(_mm_set1_ps(bsize), _mm_loadu_ps(&kept.size[j]));
+    __m128 over = _mm_cmpgt_ps(_mm_mul_ps(_mm_mul_ps(iw, ih), _mm_set1_ps(thr1)),
+                               _mm_mul_ps(total, _mm_set1_ps(threshold)));
+    if (_mm_movemask_ps(_mm_andnot_ps(disjoint, over)))
+      return true;
+  }
+#endif
+  for (; j < m; j++) {
+    if (kept.x1[j] > bx2 || kept.x2[j] < bx1 || kept.y1[j] > by2 || kept.y2[j] < by1)
+      continue;
+    float iw = std::min(bx2, kept.x2[j]) - std::max(bx1, kept.x1[j]);
+    float ih = std::min(by2, kept.y2[j]) - std::max(by1, kept.y1[j]);
+    if (iw * ih * thr1 > (bsize + kept.size[j]) * threshold)
+      return true;
+  }
+  return false;
+}
+
+void SsdDetector::nms(const SsdDetectionParam &param, const ScoredIndex *cands, int n,
+                      int label, int image) {
+  _kept.resize(n);
+  int m = 0;
+  for (int i = 0; i < n; i++) {
+    if (suppressed(_kept, m, _cand, i, param.nms_threshold))
+      continue;
+    _kept.x1[m] = _cand.x1[i];
+    _kept.y1[m] = _cand.y1[i];
+    _kept.x2[m] = _cand.x2[i];
+    _kept.y2[m] = _cand.y2[i];
+    _kept.size[m] = _cand.size[i];
+    m++;
+    const float row[7] = {(float)image, (float)label, cands[i].score,
+                          _cand.x1[i], _cand.y1[i], _cand.x2[i], _cand.y2[i]};
+    _det.insert(_det.end(), row, row + 7);
+  }
+}
+
+int SsdDetector::run(const SsdDetectionParam &param, const float *loc, const float *conf,
+                     const float *prior, int num, float *top) {
+  assert(param.confidence_threshold > 0);
+  const int num_priors = param.num_priors;
+  const int num_loc_classes = param.share_location ? 1 : param.num_classes;
+  const int top_k = param.top_k > 0 ? std::min(param.top_k, num_priors) : num_priors;
+  _heaps.resize(param.num_classes * top_k);
+  _heap_len.resize(param.num_classes);
+
+  int rows = 0;
+  for (int b = 0; b < num; b++) {
+    collect(param, conf + b * num_priors * param.num_classes, top_k);
+    const float *loc_b = loc + b * num_priors * num_loc_classes * 4;
+
+    _det.clear();
+    for (int c = 0; c < param.num_classes; c++) {
+      int n = _heap_len[c];
+      if (c == param.background_label_id || n == 0)
+        continue;
+      ScoredIndex *cands = &_heaps[c * top_k];
+      std::sort_heap(cands, cands + n, score_greater);
+      decode(param, loc_b, prior, cands, n, c);
+      nms(param, cands, n, c, b);
+    }
+
+    // keep_top_k picks the best scores of the image, the rows stay grouped by label
+    int num_det = _det.size() / 7;
+    _selected.assign(num_det, 1);
+    if (param.keep_top_k > -1 && num_det > param.keep_top_k) {
+      _order.resize(num_det);
+      for (int i = 0; i < num_det; i++) {
+        _order[i] = {_det[i * 7 + 2], i};
+      }
+      std::nth_element(_order.begin(), _order.begin() + param.keep_top_k, _order.end(),
+                       score_greater);
+      _selected.assign(num_det, 0);
+      for (int i = 0; i < param.keep_top_k; i++) {
+        _selected[_order[i].index] = 1;
+      }
+    }
+    for (int i = 0; i < num_det; i++) {
+      if (_selected[i]) {
+        memcpy(top + rows * 7, &_det[i * 7], sizeof(float) * 7);
+        rows++;
+      }
+    }
+  }
+
+  // fill dummy to end for align cmodel
+  for (int i = rows * 7; i < num * param.keep_top_k * 7; i++) {
+    top[i] = -1;
+  }
+  return rows;
+}
+
+static inline float sigmoid(float x) {
+  return 1.0f / (1.0f + std::exp(-x));
+}
+
+// feature in shape [3][5+class_num][grid_h][grid_w]
+#define GET_INDEX(cell_idx, box_idx_in_cell, data_idx, num_cell, class_num) \
+  (box_idx_in_cell * (class_num + 5) * num_cell + data_idx * num_cell + cell_idx)
+
+// softmax over the strided class scores, returns the top probability and its class
+static float softmax_max(const float *data, int stride, int num_of_class, float *x,
+                         int *max_cls) {
+  float max_x = -INFINITY;
+  float min_x = INFINITY;
+  for (int i = 0; i < num_of_class; i++) {
+    x[i] = data[i * stride];
+    if (x[i] > max_x) {
+      max_x = x[i];
+    }
+    if (x[i] < min_x) {
+      min_x = x[i];
+    }
+  }
+  const float t = -100.0f;
+  float sum = 0;
+  for (int i = 0; i < num_of_class; i++) {
+    x[i] = x[i] - max_x;
+    if (min_x < t)
+      x[i] = x[i] / min_x * t;
+    x[i] = std::exp(x[i]);
+    sum += x[i];
+  }
+  float max_prob = 0;
+  for (int i = 0; i < num_of_class; i++) {
+    float prob = x[i] / sum;
+    if (prob > max_prob) {
+      max_prob = prob;
+      *max_cls = i;
+    }
+  }
+  return max_prob;
+}
+
+int yolo_decode_feature(const float *feature, int grid_h, int grid_w, const float *anchor,
+                        int net_h, int net_w, int class_num, float obj_threshold,
+                        YoloDetection *dets, int num_dets, int max_dets,
+                        std::vector<float> &scratch) {
+  const int num_cell = grid_h * grid_w;
+  const int num_boxes_per_cell = 3;
+  scratch.resize(class_num);
+
+  // sigmoid(x) < obj_threshold for every logit below this, the margin covers the
+  // rounding of the float sigmoid so no cell that could pass is skipped
+  float limit = -INFINITY;
+  if (obj_threshold > 0 && obj_threshold < 1) {
+    limit = (float)std::log((double)obj_threshold / (1 - (double)obj_threshold)) - 1e-2f;
+  }
+  const float *conf[3];
+  for (int j = 0; j < num_boxes_per_cell; j++) {
+    conf[j] = feature + GET_INDEX(0, j, 4, num_cell, class_num);
+  }
+
+  int idx = num_dets;
+  auto decode_cell = [&](int i) {
+    for (int j = 0; j < num_boxes_per_cell && idx < max_dets; j++) {
+      if (conf[j][i] < limit)
+        continue;
+      float box_confidence = sigmoid(conf[j][i]);
+      if (box_confidence < obj_threshold)
+        continue;
+      int box_max_cls = -1;
+      float box_max_prob = softmax_max(&feature[GET_INDEX(i, j, 5, num_cell, class_num)],
+                                       num_cell, class_num, scratch.data(), &box_max_cls);
+      float box_max_score = box_confidence * box_max_prob;
+      if (box_max_score < obj_threshold)
+        continue;
+      int grid_x = i % grid_w;
+      int grid_y = i / grid_w;
+      float box_x = sigmoid(feature[GET_INDEX(i, j, 0, num_cell, class_num)]);
+      box_x += grid_x;
+      box_x /= grid_w;
+      float box_y = sigmoid(feature[GET_INDEX(i, j, 1, num_cell, class_num)]);
+      box_y += grid_y;
+      box_y /= grid_h;
+      // anchor is in shape [3][2]
+      float box_w = std::exp(feature[GET_INDEX(i, j, 2, num_cell, class_num)]);
+      box_w *= anchor[j * 2];
+      box_w /= net_w;
+      float box_h = std::exp(feature[GET_INDEX(i, j, 3, num_cell, class_num)]);
+      box_h *= anchor[j * 2 + 1];
+      box_h /= net_h;
+      dets[idx].x = box_x;
+      dets[idx].y = box_y;
+      dets[idx].w = box_w;
+      dets[idx].h = box_h;
+      dets[idx].score = box_max_score;
+      dets[idx].cls = box_max_cls;
+      idx++;
+    }
+  };
+
+  int i = 0;
+#if defined(DET_USE_NEON)
+  const float32x4_t vlimit = vdupq_n_f32(limit);
+  for (; i + 4 <= num_cell && idx < max_dets; i += 4) {
+    uint32x4_t pass = vorrq_u32(vcgeq_f32(vld1q_f32(conf[0] + i), vlimit),
+                                vorrq_u32(vcgeq_f32(vld1q_f32(conf[1] + i), vlimit),
+                                          vcgeq_f32(vld1q_f32(conf[2] + i), vlimit)));
+    uint32x2_t any = vorr_u32(vget_low_u32(pass), vget_high_u32(pass));
+    if (vget_lane_u64(vreinterpret_u64_u32(any), 0) == 0)
+      continue;
+    for (int k = i; k < i + 4; k++)
+      decode_cell(k);
+  }
+#elif defined(DET_USE_SSE)
+  const __m128 vlimit = _mm_set1_ps(limit);
+  for (; i + 4 <= num_cell && idx < max_dets; i += 4) {
+    __m128 pass = _mm_or_ps(_mm_cmpge_ps(_mm_loadu_ps(conf[0] + i), vlimit),
+                            _mm_or_ps(_mm_cmpge_ps(_mm_loadu_ps(conf[1] + i), vlimit),
+                                      _mm_cmpge_ps(_mm_loadu_ps(conf[2] + i), vlimit)));
+    if (_mm_movemask_ps(pass) == 0)
+      continue;
+    for (int k = i; k < i + 4; k++)
+      decode_cell(k);
+  }
+#endif
+  for (; i < num_cell && idx < max_dets; i++)
+    decode_cell(i);
+  return idx;
+}
+
+void yolo_nms(YoloDetection *dets, int num, float nms_threshold) {
+  // boxes of one class in their original order, as edges and areas
+  std::vector<int> order(num);
+  for (int i = 0; i < num; i++)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(),
+                   [dets](int a, int b) { return dets[a].cls < dets[b].cls; });
+  std::vector<float> l(num), r(num), t(num), b(num), area(num);
+  for (int k = 0; k < num; k++) {
+    const YoloDetection &d = dets[order[k]];
+    l[k] = d.x - d.w / 2;
+    r[k] = d.x + d.w / 2;
+    t[k] = d.y - d.h / 2;
+    b[k] = d.y + d.h / 2;
+    area[k] = d.w * d.h;
+  }
+  std::vector<char> over(num);
+
+  for (int begin = 0; begin < num;) {
+    int end = begin + 1;
+    while (end < num && dets[order[end]].cls == dets[order[begin]].cls)
+      end++;
+
+    for (int a = begin; a < end; a++) {
+      YoloDetection &di = dets[order[a]];
+      if (di.score == 0)
+        continue;
+      // iou of a against the rest of the class, then the erase decisions in order
+      int k = a + 1;
+#if (defined(DET_USE_NEON) && defined(__aarch64__)) || defined(DET_USE_SSE)
+      for (; k + 4 <= end; k += 4) {
+#if defined(DET_USE_NEON)
+        float32x4_t iw = vsubq_f32(vminq_f32(vdupq_n_f32(r[a]), vld1q_f32(&r[k])),
+                                   vmaxq_f32(vdupq_n_f32(l[a]), vld1q_f32(&l[k])));
+        float32x4_t ih = vsubq_f32(vminq_f32(vdupq_n_f32(b[a]), vld1q_f32(&b[k])),
+                                   vmaxq_f32(vdupq_n_f32(t[a]), vld1q_f32(&t[k])));
+        uint32x4_t valid = vandq_u32(vcgeq_f32(iw, vdupq_n_f32(0)), vcgeq_f32(ih, vdupq_n_f32(0)));
+        float32x4_t inter = vreinterpretq_f32_u32(
+            vandq_u32(valid, vreinterpretq_u32_f32(vmulq_f32(iw, ih))));
+        float32x4_t uni = vsubq_f32(vaddq_f32(vdupq_n_f32(area[a]), vld1q_f32(&area[k])), inter);
+        uint32x4_t gt = vcgtq_f32(vdivq_f32(inter, uni), vdupq_n_f32(nms_threshold));
+        uint32_t lanes[4];
+        vst1q_u32(lanes, gt);
+        for (int q = 0; q < 4; q++)
+          over[k + q] = lanes[q] != 0;
+#else
+        __m128 iw = _mm_sub_ps(_mm_min_ps(_mm_set1_ps(r[a]), _mm_loadu_ps(&r[k])),
+                               _mm_max_ps(_mm_set1_ps(l[a]), _mm_loadu_ps(&l[k])));
+        __m128 ih = _mm_sub_ps(_mm_min_ps(_mm_set1_ps(b[a]), _mm_loadu_ps(&b[k])),
+                               _mm_max_ps(_mm_set1_ps(t[a]), _mm_loadu_ps(&t[k])));
+        __m128 valid = _mm_and_ps(_mm_cmpge_ps(iw, _mm_setzero_ps()),
+                                  _mm_cmpge_ps(ih, _mm_setzero_ps()));
+        __m128 inter = _mm_and_ps(valid, _mm_mul_ps(iw, ih));
+        __m128 uni = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(area[a]), _mm_loadu_ps(&area[k])), inter);
+        int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_div_ps(inter, uni),
+                                                _mm_set1_ps(nms_threshold)));
+        for (int q = 0; q < 4; q++)
+          over[k + q] = (mask >> q) & 1;
+#endif
+      }
+#endif
+      for (; k < end; k++) {
+        float iw = std::min(r[a], r[k]) - std::max(l[a], l[k]);
+        float ih = std::min(b[a], b[k]) - std::max(t[a], t[k]);
+        float inter = (iw < 0 || ih < 0) ? 0 : iw * ih;
+        over[k] = inter / (area[a] + area[k] - inter) > nms_threshold;
+      }
+
+      for (k = a + 1; k < end; k++) {
+        YoloDetection &dj = dets[order[k]];
+        if (dj.score == 0 || !over[k])
+          continue;
+        // overlapped, select one to erase
+        if (di.score < dj.score) {
+          di.score = 0;
+          break;
+        }
+        dj.score = 0;
+      }
+    }
+    begin = end;
+  }
+}
+
+}  // namespace runtime
+}  // namespace cvi
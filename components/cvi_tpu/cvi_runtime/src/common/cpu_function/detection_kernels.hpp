@@ -0,0 +1,102 @@
+#ifndef RUNTIME_DETECTION_KERNELS_H
+#define RUNTIME_DETECTION_KERNELS_H
+
+#include <vector>
+
+namespace cvi {
+namespace runtime {
+
+struct ScoredIndex {
+  float score;
+  int index;
+};
+
+// higher score first, equal scores keep the lower index first
+static inline bool score_greater(const ScoredIndex &a, const ScoredIndex &b) {
+  return a.score > b.score || (a.score == b.score && a.index < b.index);
+}
+
+struct SsdDetectionParam {
+  int num_classes;
+  int num_priors;
+  bool share_location;
+  int background_label_id;
+  int top_k;  // candidates per class entering nms
+  float nms_threshold;
+  float confidence_threshold;
+  int keep_top_k;  // detections per image, -1 for all
+  bool variance_encoded_in_target;
+};
+
+/*
+ * DetectionOutput of caffe SSD for CENTER_SIZE coded priors. Writes rows of
+ * [image, label, score, xmin, ymin, xmax, ymax] grouped by label and packed over
+ * the batch, then fills up to num * keep_top_k rows with -1.
+ *
+ * Scores above the threshold go into a bounded heap of top_k per class, so the
+ * candidates are never sorted as a whole; only the survivors are decoded, into
+ * structure-of-arrays buffers that the IoU test runs over four boxes at a time.
+ * The scratch buffers live in the object and are reused between calls.
+ */
+class SsdDetector {
+public:
+  // returns the number of detections written
+  int run(const SsdDetectionParam &param, const float *loc, const float *conf,
+          const float *prior, int num, float *top);
+
+private:
+  struct BoxSoA {
+    std::vector<float> x1, y1, x2, y2, size;
+    void resize(size_t n) {
+      x1.resize(n);
+      y1.resize(n);
+      x2.resize(n);
+      y2.resize(n);
+      size.resize(n);
+    }
+  };
+
+  void collect(const SsdDetectionParam &param, const float *conf, int top_k);
+  void decode(const SsdDetectionParam &param, const float *loc, const float *prior,
+              const ScoredIndex *cands, int n, int label);
+  void nms(const SsdDetectionParam &param, const ScoredIndex *cands, int n, int label,
+           int image);
+
+  std::vector<ScoredIndex> _heaps;  // num_classes heaps of top_k entries
+  std::vector<int> _heap_len;
+  BoxSoA _cand;   // decoded candidates of the current class
+  BoxSoA _kept;   // survivors of the current class
+  std::vector<float> _det;  // rows of the current image, 7 floats each
+  std::vector<ScoredIndex> _order;
+  std::vector<char> _selected;
+};
+
+struct YoloDetection {
+  float x, y, w, h;
+  int cls;
+  float score;
+};
+
+/*
+ * Decodes one yolo feature map laid out as [3][5 + class_num][grid_h][grid_w] and
+ * appends the boxes whose objectness * class probability reach obj_threshold, in
+ * cell then anchor order. Cells are skipped on the raw objectness logit, so the
+ * sigmoid and softmax only run on the few cells that can pass. Stops once dets
+ * holds max_dets boxes, returns the new number of detections.
+ */
+int yolo_decode_feature(const float *feature, int grid_h, int grid_w, const float *anchor,
+                        int net_h, int net_w, int class_num, float obj_threshold,
+                        YoloDetection *dets, int num_dets, int max_dets,
+                        std::vector<float> &scratch);
+
+/*
+ * Pairwise nms of the yolo op: for every pair of the same class with IoU above
+ * the threshold the lower scored one gets score 0. Pairs are visited class by
+ * class in the original order, so the result is the same as comparing all pairs.
+ */
+void yolo_nms(YoloDetection *dets, int num, float nms_threshold);
+
+}  // namespace runtime
+}  // namespace cvi
+
+#endif
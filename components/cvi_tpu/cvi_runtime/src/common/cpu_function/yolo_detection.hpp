@@ -4,6 +4,7 @@
 #include <unordered_map>
 #include <runtime/neuron.hpp>
 #include <runtime/cpu_function.hpp>
+#include <cpu_function/detection_kernels.hpp>
 
 
 namespace cvi {
@@ -38,6 +39,7 @@ private:
   bool _spp_net = false;
   int _class_num = 80;
   std::vector<float> _anchors;
+  std::vector<float> _scratch;
 };
 
 }
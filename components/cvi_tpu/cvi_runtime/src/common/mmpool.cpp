@@ -915,3 +915,143 @@ pool_addr_t mem_pool_alloc_in_bank(mem_pool_t *pool, pool_size_t size)
 }
 
 #endif /* MEM_POOL_NAIVE_PLUS */
+
+#ifdef MEM_POOL_TLSF
+/* drop every allocation, the pool is one free block again */
+void mem_pool_cleanup(mem_pool_t *pool)
+{
+  POOL_LOCK(pool);
+  delete pool->tlsf;
+  pool->tlsf = new cvi::runtime::TlsfPool(pool->total_size, MIN_SLOT_SIZE);
+  POOL_UNLOCK(pool);
+}
+
+pool_addr_t mem_pool_alloc_tagged(mem_pool_t *pool, pool_size_t size,
+                                  pool_tag_t tag)
+{
+  uint64_t addr;
+  POOL_LOCK(pool);
+  bool ok = pool->tlsf->alloc(size, tag, &addr);
+  POOL_UNLOCK(pool);
+  if (!ok) {
+    printf("mem_pool: cannot alloc size %llu for tag %u\n",
+           (unsigned long long)size, tag);
+    return MEM_POOL_ADDR_INVALID;
+  }
+#ifdef MEM_POOL_DEBUG
+  printf("mem_pool: alloc addr 0x%llx size %llu tag %u\n",
+         (unsigned long long)addr, (unsigned long long)size, tag);
+#endif
+  return addr;
+}
+
+pool_addr_t mem_pool_alloc(mem_pool_t *pool, pool_size_t size)
+{
+  return mem_pool_alloc_tagged(pool, size, 0);
+}
+
+pool_addr_t mem_pool_alloc_in_bank_tagged(mem_pool_t *pool, pool_size_t size,
+                                          pool_tag_t tag)
+{
+  uint64_t addr;
+  POOL_LOCK(pool);
+  bool ok = pool->tlsf->allocInBank(size, BANK_SIZE, tag, &addr);
+  POOL_UNLOCK(pool);
+  if (!ok) {
+    printf("mem_pool: cannot alloc size %llu in bank for tag %u\n",
+           (unsigned long long)size, tag);
+    return MEM_POOL_ADDR_INVALID;
+  }
+  return addr;
+}
+
+pool_addr_t mem_pool_alloc_in_bank(mem_pool_t *pool, pool_size_t size)
+{
+  return mem_pool_alloc_in_bank_tagged(pool, size, 0);
+}
+
+void mem_pool_free(mem_pool_t *pool, pool_addr_t addr)
+{
+  POOL_LOCK(pool);
+  /* unknown addresses and double frees are caught by the lookup */
+  bool ok = pool->tlsf->free(addr);
+#ifdef DEBUG
+  assert(pool->tlsf->check());
+#endif
+  POOL_UNLOCK(pool);
+  if (!ok) {
+    printf("mem_pool: free of unknown addr 0x%llx\n", (unsigned long long)addr);
+    assert(0);
+  }
+}
+
+int mem_pool_free_tag(mem_pool_t *pool, pool_tag_t tag)
+{
+  POOL_LOCK(pool);
+  int num = pool->tlsf->freeTag(tag);
+  POOL_UNLOCK(pool);
+  return num;
+}
+
+void mem_pool_get_stats(mem_pool_t *pool, mem_pool_stats_t *stats)
+{
+  POOL_LOCK(pool);
+  pool->tlsf->getStats(stats);
+  POOL_UNLOCK(pool);
+}
+
+int mem_pool_get_tag_stats(mem_pool_t *pool, pool_tag_t tag,
+                           mem_pool_tag_stats_t *stats)
+{
+  POOL_LOCK(pool);
+  bool found = pool->tlsf->getTagStats(tag, stats);
+  POOL_UNLOCK(pool);
+  return found ? 0 : -1;
+}
+
+void mem_pool_dump(mem_pool_t *pool)
+{
+  mem_pool_stats_t s;
+  mem_pool_get_stats(pool, &s);
+  printf("mem_pool: total %llu, used %llu (peak %llu) in %u blocks\n",
+         (unsigned long long)s.total_size, (unsigned long long)s.used_size,
+         (unsigned long long)s.peak_used_size, s.used_blocks);
+  printf("mem_pool: free %llu in %u blocks, largest %llu, fragmentation %.1f%%\n",
+         (unsigned long long)s.free_size, s.free_blocks,
+         (unsigned long long)s.largest_free, s.fragmentation * 100.f);
+  printf("mem_pool: %llu allocs, %llu frees, %llu failed\n",
+         (unsigned long long)s.alloc_count, (unsigned long long)s.free_count,
+         (unsigned long long)s.failed_count);
+}
+
+void mem_pool_create(mem_pool_t **pool, u64 total_size)
+{
+  mem_pool_t *tpool = new mem_pool_t;
+  POOL_LOCK_INIT(tpool);
+
+  tpool->total_size = total_size;
+  tpool->tlsf = new cvi::runtime::TlsfPool(total_size, MIN_SLOT_SIZE);
+
+  *pool = tpool;
+
+#ifdef MEM_POOL_DEBUG
+  printf("mem_pool: create\n");
+#endif
+}
+
+void mem_pool_destroy(mem_pool_t *pool)
+{
+  mem_pool_stats_t s;
+  pool->tlsf->getStats(&s);
+  /* sanity checking */
+  if (s.used_blocks) {
+    printf("mem_pool: destroy pool with %u blocks left\n", s.used_blocks);
+  }
+  assert(s.used_blocks == 0);
+
+  delete pool->tlsf;
+  POOL_LOCK_DEINIT(pool);
+
+  delete pool;
+}
+#endif /* MEM_POOL_TLSF */
@@ -24,7 +24,8 @@ using namespace std;
 
 //#define MEM_POOL_NAIVE
 //#define MEM_POOL_ZEPHRE
-#define MEM_POOL_NAIVE_PLUS
+//#define MEM_POOL_NAIVE_PLUS
+#define MEM_POOL_TLSF
 
 #define MEM_POOL_ADDR_INVALID   (GLOBAL_MEM_ADDR_NULL)
 #define MEM_POOL_SLOT_NUM       (2048 * 8)
@@ -109,6 +110,19 @@ struct pool_struct {
 
 #endif /* MEM_POOL_NAIVE_PLUS */
 
+#ifdef MEM_POOL_TLSF
+#include "tlsf_pool.h"
+
+#define MIN_SLOT_SIZE (4 * 1024)
+
+typedef u64 pool_addr_t;
+typedef u64 pool_size_t;
+/* tag 0 is for untagged allocations, use one tag per model */
+typedef u32 pool_tag_t;
+typedef cvi::runtime::TlsfPool::Stats mem_pool_stats_t;
+typedef cvi::runtime::TlsfPool::TagStats mem_pool_tag_stats_t;
+#endif /* MEM_POOL_TLSF */
+
 typedef struct mem_pool {
   u64                           total_size;
 #ifdef MEM_POOL_NAIVE
@@ -133,6 +147,9 @@ typedef struct mem_pool {
   int                           slot_size[MEM_POOL_SLOT_NUM];
   int                           slot_used;
 #endif /* MEM_POOL_ZEPHRE */
+#ifdef MEM_POOL_TLSF
+  cvi::runtime::TlsfPool        *tlsf;
+#endif /* MEM_POOL_TLSF */
 #ifdef POOL_USE_PTHREAD
   pthread_mutex_t               lock;
 #define POOL_LOCK_INIT(pool)    pthread_mutex_init(&pool->lock, NULL)
@@ -147,14 +164,28 @@ typedef struct mem_pool {
 #endif
 } mem_pool_t;
 
-#ifdef MEM_POOL_NAIVE_PLUS
+#if defined(MEM_POOL_NAIVE_PLUS) || defined(MEM_POOL_TLSF)
 void mem_pool_cleanup(mem_pool_t *pool);
 pool_addr_t mem_pool_alloc(mem_pool_t *pool, pool_size_t size);
 void mem_pool_free(mem_pool_t *pool, pool_addr_t addr);
 void mem_pool_create(mem_pool_t **pool, u64 total_size);
 void mem_pool_destroy(mem_pool_t *pool);
 pool_addr_t mem_pool_alloc_in_bank(mem_pool_t *pool, pool_size_t size);
-#else
+#endif
+#ifdef MEM_POOL_TLSF
+pool_addr_t mem_pool_alloc_tagged(mem_pool_t *pool, pool_size_t size,
+                                  pool_tag_t tag);
+pool_addr_t mem_pool_alloc_in_bank_tagged(mem_pool_t *pool, pool_size_t size,
+                                          pool_tag_t tag);
+/* free everything a model left in the pool, returns the number of blocks */
+int mem_pool_free_tag(mem_pool_t *pool, pool_tag_t tag);
+void mem_pool_get_stats(mem_pool_t *pool, mem_pool_stats_t *stats);
+int mem_pool_get_tag_stats(mem_pool_t *pool, pool_tag_t tag,
+                           mem_pool_tag_stats_t *stats);
+/* print usage, high-water mark and fragmentation */
+void mem_pool_dump(mem_pool_t *pool);
+#endif
+#if !defined(MEM_POOL_NAIVE_PLUS) && !defined(MEM_POOL_TLSF)
 void mem_pool_cleanup(mem_pool_t *pool);
 u64 mem_pool_alloc(mem_pool_t *pool, u64 size);
 void mem_pool_free(mem_pool_t *pool, u64 addr);
@@ -1,9 +1,11 @@
 //#include <sys/mman.h>
 #include <unistd.h>
 //#include <dlfcn.h>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <mutex>
+#include <vector>
 #include <runtime/model.hpp>
 #include <runtime/stream.hpp>
 #include <runtime/debug.h>
@@ -12,6 +14,7 @@
 #include <cpu_function/ssd_detection.hpp>
 #include <cpu_function/yolo_detection.hpp>
 #include <cpu_function/embedding.hpp>
+#include <runtime/weight_cache.hpp>
 #include <alloc.h>
 
 namespace cvi {
@@ -19,9 +22,36 @@ namespace runtime {
 
 std::string CviModel::targetChipType = "";
 
+// sections are read in chunks straight into device memory, each chunk is
+// hashed while it is still in cache
+#define SECTION_CHUNK_SIZE (1024 * 1024)
+// weights that only get hashed go through a small scratch buffer
+#define HASH_CHUNK_SIZE (64 * 1024)
+
+static bool streamSection(BaseStream *stream, uint8_t *dst, size_t offset,
+                          size_t size, uint64_t *hash) {
+  std::vector<uint8_t> scratch(dst ? 0 : HASH_CHUNK_SIZE);
+  size_t chunk_size = dst ? SECTION_CHUNK_SIZE : HASH_CHUNK_SIZE;
+  uint64_t h = size;
+  for (size_t pos = 0; pos < size; pos += chunk_size) {
+    size_t len = std::min(chunk_size, size - pos);
+    uint8_t *buf = dst ? dst + pos : scratch.data();
+    if (stream->read(buf, offset + pos, len) == 0) {
+      return false;
+    }
+    if (hash) {
+      h = hashContent(h, buf, len);
+    }
+  }
+  if (hash) {
+    *hash = h;
+  }
+  return true;
+}
+
 CviModel::CviModel(CVI_RT_HANDLE ctx, int count)
     : _ctx(ctx), ref(1), _count(count), _max_shared_mem_size(0) {
-  _pool = new TaskPool(1);
+  _pool = TaskPool::shared();
 
   _cpu_functions.push_back(new CpuRuntimeFunction("quant", QuantFunc::open));
   _cpu_functions.push_back(
@@ -34,10 +64,8 @@ CviModel::CviModel(CVI_RT_HANDLE ctx, int count)
 CviModel::~CviModel() {
   if (_model_body)
     delete[] _model_body;
-  if (_pool)
-    delete _pool;
   if (_weight_mem)
-    cviMemFree(_ctx, _weight_mem);
+    releaseWeight(_ctx, _weight_mem);
 
   for (auto func : _cpu_functions) {
     delete func;
@@ -158,6 +186,14 @@ CVI_RC CviModel::extractSections(BaseStream *stream, size_t bin_offset) {
   auto &sections = *_fb_model->sections();
   std::vector<const cvi::model::Section*> cmdbuf_sections;
   CVI_RC ret;
+  // TPU_DISABLE_WEIGHT_SHARE turns the weight cache off, weights of
+  // encrypted models go to the TEE and are never shared
+  bool shareable = !std::getenv("TPU_DISABLE_WEIGHT_SHARE");
+  for (auto s : sections) {
+    if (s->encrypt()) {
+      shareable = false;
+    }
+  }
   for (auto s : sections) {
 #if __aarch64__
     if (s->type() == cvi::model::SectionType_FUNC_AARCH64) {
@@ -171,7 +207,7 @@ CVI_RC CviModel::extractSections(BaseStream *stream, size_t bin_offset) {
       //  return CVI_RC_FAILURE;
       //}
     } else if (s->type() == cvi::model::SectionType_WEIGHT) {
-      ret = loadWeight(stream, s->offset() + bin_offset, s->size());
+      ret = loadWeight(stream, s->offset() + bin_offset, s->size(), shareable);
       if (ret != CVI_RC_SUCCESS) {
         return ret;
       }
@@ -202,9 +238,9 @@ CVI_RC CviModel::loadDmabuf(BaseStream *stream, size_t offset, size_t size, cons
     TPU_LOG_ERROR("alloc memory for dmabuf failed, size:%zu\n", size);
     return CVI_RC_NOMEM;
   }
-  size_t read_size = stream->read(CVI_RT_MemGetVAddr(buf), offset, size);
-  if (read_size == 0) {
+  if (!streamSection(stream, CVI_RT_MemGetVAddr(buf), offset, size, nullptr)) {
     TPU_LOG_ERROR("Error, invalid cvimodel file\n");
+    cviMemFree(_ctx, buf);
     return CVI_RC_INVALID_ARG;
   }
   size_t length = size;
@@ -273,22 +309,40 @@ CVI_RC CviModel::loadCmdbuf(BaseStream *stream, size_t offset, size_t size, cons
   return ret;
 }
 
-CVI_RC CviModel::loadWeight(BaseStream *stream, size_t offset, size_t size) {
+CVI_RC CviModel::loadWeight(BaseStream *stream, size_t offset, size_t size,
+                            bool shareable) {
   /// debug
   if (size == 0) {
     return CVI_RC_SUCCESS;
   }
+  uint64_t content_hash = 0;
+  // only hash the section when a model with the same body is loaded,
+  // otherwise the hash comes with the load below
+  if (shareable && hasCachedWeight(_body_hash, size)) {
+    if (!streamSection(stream, nullptr, offset, size, &content_hash)) {
+      TPU_LOG_ERROR("Error, invalid cvimodel file\n");
+      return CVI_RC_INVALID_ARG;
+    }
+    _weight_mem = acquireCachedWeight(_body_hash, content_hash, size);
+    if (_weight_mem) {
+      TPU_LOG_INFO("%s shares weight, size:%zu\n", _model_name.c_str(), size);
+      return CVI_RC_SUCCESS;
+    }
+  }
   _weight_mem = cviMemAlloc(_ctx, size, CVI_ALLOC_WEIGHT, _model_name.c_str());
   if (!_weight_mem) {
     TPU_LOG_ERROR("alloc memory for weight failed, size:%zu\n", size);
     return CVI_RC_NOMEM;
   }
-  size_t read_size = stream->read(CVI_RT_MemGetVAddr(_weight_mem), offset, size);
-  if (read_size == 0) {
+  if (!streamSection(stream, CVI_RT_MemGetVAddr(_weight_mem), offset, size,
+                     shareable ? &content_hash : nullptr)) {
     TPU_LOG_ERROR("Error, invalid cvimodel file\n");
     return CVI_RC_INVALID_ARG;
   }
   CVI_RT_MemFlush(_ctx, _weight_mem);
+  if (shareable) {
+    cacheWeight(_weight_mem, _body_hash, content_hash, size);
+  }
   return CVI_RC_SUCCESS;
 }
 
@@ -327,6 +381,7 @@ CVI_RC CviModel::parse(BaseStream *stream) {
   }
 
   _fb_model = (cvi::model::Model *)cvi::model::GetModel(_model_body);
+  _body_hash = hashContent(payload_size, _model_body, payload_size);
   ret = showAndCheckVersion();
   if (ret != CVI_RC_SUCCESS) {
     return ret;
@@ -31,6 +31,9 @@ Program::Program(CVI_RT_HANDLE ctx, TaskPool *pool,
       cpu_functions(functions),
       _ctx(ctx), _pool(pool),
       _max_shared_mem_size(max_shared_mem_size) {
+  if (_pool) {
+    _affinity = _pool->assignAffinity();
+  }
 
   _cvk = CVI_RT_RegisterKernel(ctx, 1024);
   for (int i = 0; i < 8; ++i) {
@@ -336,13 +339,23 @@ bool Program::forward(CVI_TENSOR *inputs, int input_num,
 void *Program::forwardAsync(CVI_TENSOR *inputs, int input_num, CVI_TENSOR *outputs,
                             int output_num) {
   _pool->startPool();
-  return new Task(_pool, (void *)this, inputs, input_num, outputs, output_num);
+  return new Task(_pool, (void *)this, inputs, input_num, outputs, output_num,
+                  &Program::runTask, _affinity);
+}
+
+bool Program::runTask(Task *task) {
+  auto program = (Program *)task->program;
+  std::lock_guard<std::mutex> lock(program->_forward_mutex);
+  return program->forward(task->inputs, task->input_num, task->outputs,
+                          task->output_num);
 }
 
 CVI_RC Program::forwardWait(void *task) {
   auto *myTask = (Task *)task;
   _pool->waitTask(myTask);
-  return myTask->retCode;
+  CVI_RC ret = myTask->retCode;
+  delete myTask;
+  return ret;
 }
 
 bool Program::run() {
@@ -1,66 +1,189 @@
-//#include <sys/mman.h>
-#include <unistd.h>
-#include <posix/timer.h>
-#include <iostream>
-#include <mutex>
 #include <runtime/taskpool.hpp>
-#include <runtime/model.hpp>
+
+#ifndef TASKPOOL_SHARED_WORKERS
+#define TASKPOOL_SHARED_WORKERS 2
+#endif
 
 namespace cvi {
 namespace runtime {
 
 Task::Task(TaskPool *pool, void *program, CVI_TENSOR *inputs,
-           int input_num, CVI_TENSOR *outputs, int output_num)
+           int input_num, CVI_TENSOR *outputs, int output_num,
+           RunFunc run, int affinity)
     : program(program), input_num(input_num), output_num(output_num),
-      inputs(inputs), outputs(outputs) {
+      inputs(inputs), outputs(outputs), run(run), affinity(affinity) {
   pool->addTask(this);
 }
 
+MpmcQueue::MpmcQueue(uint32_t capacity) {
+  size_t size = 2;
+  while (size < capacity)
+    size <<= 1;
+  _cells.reset(new Cell[size]);
+  for (size_t i = 0; i < size; ++i) {
+    _cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+  _mask = size - 1;
+  _enqueue_pos.store(0, std::memory_order_relaxed);
+  _dequeue_pos.store(0, std::memory_order_relaxed);
+}
+
+bool MpmcQueue::push(Task *task) {
+  size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    Cell &cell = _cells[pos & _mask];
+    size_t seq = cell.seq.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+    if (diff == 0) {
+      if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        cell.task = task;
+        cell.seq.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = _enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool MpmcQueue::pop(Task **task) {
+  size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    Cell &cell = _cells[pos & _mask];
+    size_t seq = cell.seq.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+    if (diff == 0) {
+      if (_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        *task = cell.task;
+        cell.seq.store(pos + _mask + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = _dequeue_pos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+TaskPool::TaskPool(int pool_size, uint32_t queue_capacity)
+    : _pool_size(pool_size > 0 ? pool_size : 1), _next_affinity(0),
+      _next_queue(0), _started(false), _done(false) {
+  for (int i = 0; i < _pool_size; ++i) {
+    _workers.emplace_back(new Worker(queue_capacity));
+  }
+}
+
 TaskPool::~TaskPool() {
   if (_started) {
+    // workers drain their queues before leaving
     _done = true;
-    for (int i = 0; i < _pool_size; ++i) {
-      addTerminateTask();
+    for (auto &worker : _workers) {
+      wake(*worker);
     }
-    for (auto &thread : _threads) {
-      if (thread.joinable()) {
-        thread.join();
+    for (auto &worker : _workers) {
+      if (worker->thread.joinable()) {
+        worker->thread.join();
       }
     }
   }
 }
 
+TaskPool *TaskPool::shared() {
+  static TaskPool pool(TASKPOOL_SHARED_WORKERS);
+  return &pool;
+}
+
 void TaskPool::startPool() {
   if (_started) {
     return;
   }
   std::unique_lock<std::mutex> lock(_mutex);
+  if (_started) {
+    return;
+  }
   for (int i = 0; i < _pool_size; ++i) {
-    _threads.push_back(std::thread(run, this));
+    _workers[i]->thread = std::thread(&TaskPool::workFunc, this, i);
   }
-  while (!_started) {
-    usleep(10);
+  _started = true;
+}
+
+void TaskPool::wake(Worker &worker) {
+  if (worker.parked.exchange(false)) {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.cond.notify_one();
   }
 }
 
-void TaskPool::workFunc() {
-  _started = true;
-  while (!_done) {
-    auto task = _queue.get();
-    if (task == nullptr)
-      continue;
-    auto program = (Program *)task->program;
-    task->retCode = (CVI_RC)program->forward(task->inputs, task->input_num, task->outputs,
-                                     task->output_num);
-    std::unique_lock<std::mutex> lock(_mutex);
-    _cond_feedback.notify_all();
+void TaskPool::addTask(Task *task) {
+  int home = task->affinity >= 0 ? task->affinity % _pool_size
+                                 : (int)(_next_queue++ % _pool_size);
+  // only full with more than queue_capacity forwards in flight on one worker
+  while (!_workers[home]->queue.push(task)) {
+    std::this_thread::yield();
+  }
+  // pairs with the fence in workFunc: the release store of the cell and the
+  // load of parked below must not be reordered, or both sides can miss
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (_workers[home]->parked) {
+    wake(*_workers[home]);
+    return;
+  }
+  // home worker is busy, let an idle one steal the task
+  for (auto &worker : _workers) {
+    if (worker->parked) {
+      wake(*worker);
+      return;
+    }
   }
 }
 
-void TaskPool::waitTask(Task *task) {
-  std::unique_lock<std::mutex> lock(_mutex);
-  while (task->retCode == CVI_RC_UNINIT)
-    _cond_feedback.wait(lock);
+static void runTask(Task *task) {
+  // forward() returns true on success
+  task->retCode = task->run(task) ? CVI_RC_SUCCESS : CVI_RC_FAILURE;
+  task->done.signal();
+}
+
+bool TaskPool::fetch(int index, Task **task) {
+  if (_workers[index]->queue.pop(task)) {
+    return true;
+  }
+  for (int i = 1; i < _pool_size; ++i) {
+    if (_workers[(index + i) % _pool_size]->queue.pop(task)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void TaskPool::workFunc(int index) {
+  Worker &self = *_workers[index];
+  for (;;) {
+    Task *task = nullptr;
+    if (fetch(index, &task)) {
+      runTask(task);
+      continue;
+    }
+    if (_done) {
+      break;
+    }
+    // announce parking before the last look, a submitter either sees
+    // parked or we see its task
+    self.parked = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (fetch(index, &task)) {
+      self.parked = false;
+      runTask(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(self.mutex);
+    while (self.parked && !_done) {
+      self.cond.wait(lock);
+    }
+    self.parked = false;
+  }
 }
 
 }
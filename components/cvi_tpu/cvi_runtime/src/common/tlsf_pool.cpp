@@ -0,0 +1,375 @@
+#include "tlsf_pool.h"
+#include <string.h>
+
+namespace cvi {
+namespace runtime {
+
+static inline int msb64(uint64_t v) {
+  return 63 - __builtin_clzll(v);
+}
+
+TlsfPool::TlsfPool(uint64_t size, uint64_t granule)
+    : _size(size / granule * granule), _granule(granule), _fl_bitmap(0),
+      _used_size(0), _peak_used_size(0), _free_blocks(0), _alloc_count(0),
+      _free_count(0), _failed_count(0) {
+  memset(_heads, 0xff, sizeof(_heads));
+  memset(_sl_bitmap, 0, sizeof(_sl_bitmap));
+  if (_size == 0) {
+    return;
+  }
+  int32_t idx = newBlock();
+  Block &b = _blocks[idx];
+  b.addr = 0;
+  b.size = _size;
+  b.prev_phys = -1;
+  b.next_phys = -1;
+  b.used = false;
+  b.tag = 0;
+  insertFree(idx);
+}
+
+void TlsfPool::mapping(uint64_t units, int *fl, int *sl) {
+  if (units < SL_COUNT) {
+    *fl = 0;
+    *sl = (int)units;
+  } else {
+    int m = msb64(units);
+    *fl = m - SL_LOG2 + 1;
+    *sl = (int)(units >> (m - SL_LOG2)) - SL_COUNT;
+  }
+}
+
+int32_t TlsfPool::newBlock() {
+  if (!_spare.empty()) {
+    int32_t idx = _spare.back();
+    _spare.pop_back();
+    return idx;
+  }
+  _blocks.push_back(Block());
+  return (int32_t)_blocks.size() - 1;
+}
+
+void TlsfPool::insertFree(int32_t idx) {
+  int fl, sl;
+  mapping(_blocks[idx].size / _granule, &fl, &sl);
+  Block &b = _blocks[idx];
+  b.used = false;
+  b.prev_free = -1;
+  b.next_free = _heads[fl][sl];
+  if (b.next_free >= 0) {
+    _blocks[b.next_free].prev_free = idx;
+  }
+  _heads[fl][sl] = idx;
+  _fl_bitmap |= 1ULL << fl;
+  _sl_bitmap[fl] |= 1U << sl;
+  _free_blocks++;
+}
+
+void TlsfPool::removeFree(int32_t idx) {
+  int fl, sl;
+  mapping(_blocks[idx].size / _granule, &fl, &sl);
+  Block &b = _blocks[idx];
+  if (b.prev_free >= 0) {
+    _blocks[b.prev_free].next_free = b.next_free;
+  } else {
+    _heads[fl][sl] = b.next_free;
+    if (b.next_free < 0) {
+      _sl_bitmap[fl] &= ~(1U << sl);
+      if (!_sl_bitmap[fl]) {
+        _fl_bitmap &= ~(1ULL << fl);
+      }
+    }
+  }
+  if (b.next_free >= 0) {
+    _blocks[b.next_free].prev_free = b.prev_free;
+  }
+  _free_blocks--;
+}
+
+int32_t TlsfPool::findFree(uint64_t units) {
+  // round up to the next list boundary, every block there fits
+  if (units >= SL_COUNT) {
+    units += (1ULL << (msb64(units) - SL_LOG2)) - 1;
+  }
+  int fl, sl;
+  mapping(units, &fl, &sl);
+  if (fl >= FL_COUNT) {
+    return -1;
+  }
+  uint32_t sl_map = _sl_bitmap[fl] & (~0U << sl);
+  if (!sl_map) {
+    uint64_t fl_map = fl + 1 < 64 ? _fl_bitmap & (~0ULL << (fl + 1)) : 0;
+    if (!fl_map) {
+      return -1;
+    }
+    fl = __builtin_ctzll(fl_map);
+    sl_map = _sl_bitmap[fl];
+  }
+  sl = __builtin_ctz(sl_map);
+  return _heads[fl][sl];
+}
+
+int32_t TlsfPool::split(int32_t idx, uint64_t size) {
+  // the tail of idx beyond size becomes a new block, returned unlinked
+  int32_t rest = newBlock();
+  Block &b = _blocks[idx];
+  Block &r = _blocks[rest];
+  r.addr = b.addr + size;
+  r.size = b.size - size;
+  r.prev_phys = idx;
+  r.next_phys = b.next_phys;
+  r.tag = 0;
+  r.used = false;
+  if (b.next_phys >= 0) {
+    _blocks[b.next_phys].prev_phys = rest;
+  }
+  b.next_phys = rest;
+  b.size = size;
+  return rest;
+}
+
+void TlsfPool::take(int32_t idx, uint64_t offset, uint64_t size,
+                    uint32_t tag) {
+  removeFree(idx);
+  if (offset) {
+    int32_t rest = split(idx, offset);
+    insertFree(idx);
+    idx = rest;
+  }
+  if (_blocks[idx].size > size) {
+    insertFree(split(idx, size));
+  }
+  Block &b = _blocks[idx];
+  b.used = true;
+  b.tag = tag;
+  _used[b.addr] = idx;
+
+  _used_size += size;
+  if (_used_size > _peak_used_size) {
+    _peak_used_size = _used_size;
+  }
+  TagStats &ts = _tags[tag];
+  ts.used_size += size;
+  ts.blocks++;
+  if (ts.used_size > ts.peak_used_size) {
+    ts.peak_used_size = ts.used_size;
+  }
+  _alloc_count++;
+}
+
+bool TlsfPool::alloc(uint64_t size, uint32_t tag, uint64_t *addr) {
+  uint64_t units = (size + _granule - 1) / _granule;
+  if (units == 0) {
+    units = 1;
+  }
+  int32_t idx = findFree(units);
+  if (idx < 0) {
+    _failed_count++;
+    return false;
+  }
+  *addr = _blocks[idx].addr;
+  take(idx, 0, units * _granule, tag);
+  return true;
+}
+
+bool TlsfPool::allocInBank(uint64_t size, uint64_t bank_size, uint32_t tag,
+                           uint64_t *addr) {
+  uint64_t units = (size + _granule - 1) / _granule;
+  if (units == 0) {
+    units = 1;
+  }
+  size = units * _granule;
+  if (size > bank_size) {
+    _failed_count++;
+    return false;
+  }
+  // walk the free lists from the size class of units upwards, a pool
+  // within one bank takes the first block that is large enough
+  int fl, sl;
+  mapping(units, &fl, &sl);
+  int32_t idx = _heads[fl][sl];
+  for (;;) {
+    for (; idx >= 0; idx = _blocks[idx].next_free) {
+      const Block &b = _blocks[idx];
+      if (b.size < size) {
+        continue;
+      }
+      uint64_t start = b.addr;
+      if (start % bank_size + size > bank_size) {
+        // move up to the next bank boundary inside the block
+        start = (start / bank_size + 1) * bank_size;
+      }
+      if (start + size <= b.addr + b.size) {
+        *addr = start;
+        take(idx, start - b.addr, size, tag);
+        return true;
+      }
+    }
+    if (++sl >= SL_COUNT) {
+      sl = 0;
+      fl++;
+    }
+    while (fl < FL_COUNT && !(_sl_bitmap[fl] & (~0U << sl))) {
+      fl++;
+      sl = 0;
+    }
+    if (fl >= FL_COUNT) {
+      break;
+    }
+    sl = __builtin_ctz(_sl_bitmap[fl] & (~0U << sl));
+    idx = _heads[fl][sl];
+  }
+  _failed_count++;
+  return false;
+}
+
+bool TlsfPool::free(uint64_t addr) {
+  auto it = _used.find(addr);
+  if (it == _used.end()) {
+    return false;
+  }
+  int32_t idx = it->second;
+  _used.erase(it);
+
+  Block &b = _blocks[idx];
+  _used_size -= b.size;
+  TagStats &ts = _tags[b.tag];
+  ts.used_size -= b.size;
+  ts.blocks--;
+  _free_count++;
+
+  int32_t next = b.next_phys;
+  if (next >= 0 && !_blocks[next].used) {
+    removeFree(next);
+    b.size += _blocks[next].size;
+    b.next_phys = _blocks[next].next_phys;
+    if (b.next_phys >= 0) {
+      _blocks[b.next_phys].prev_phys = idx;
+    }
+    _spare.push_back(next);
+  }
+  int32_t prev = b.prev_phys;
+  if (prev >= 0 && !_blocks[prev].used) {
+    removeFree(prev);
+    Block &p = _blocks[prev];
+    p.size += b.size;
+    p.next_phys = b.next_phys;
+    if (p.next_phys >= 0) {
+      _blocks[p.next_phys].prev_phys = prev;
+    }
+    _spare.push_back(idx);
+    idx = prev;
+  }
+  insertFree(idx);
+  return true;
+}
+
+int TlsfPool::freeTag(uint32_t tag) {
+  std::vector<uint64_t> addrs;
+  for (auto &kv : _used) {
+    if (_blocks[kv.second].tag == tag) {
+      addrs.push_back(kv.first);
+    }
+  }
+  for (uint64_t addr : addrs) {
+    free(addr);
+  }
+  return (int)addrs.size();
+}
+
+uint64_t TlsfPool::blockSize(uint64_t addr) const {
+  auto it = _used.find(addr);
+  return it == _used.end() ? 0 : _blocks[it->second].size;
+}
+
+void TlsfPool::getStats(Stats *stats) const {
+  memset(stats, 0, sizeof(*stats));
+  stats->total_size = _size;
+  stats->used_size = _used_size;
+  stats->peak_used_size = _peak_used_size;
+  stats->free_size = _size - _used_size;
+  stats->used_blocks = (uint32_t)_used.size();
+  stats->free_blocks = _free_blocks;
+  stats->alloc_count = _alloc_count;
+  stats->free_count = _free_count;
+  stats->failed_count = _failed_count;
+  if (_fl_bitmap) {
+    // the largest block sits in the highest non-empty list
+    int fl = msb64(_fl_bitmap);
+    int sl = 31 - __builtin_clz(_sl_bitmap[fl]);
+    for (int32_t i = _heads[fl][sl]; i >= 0; i = _blocks[i].next_free) {
+      if (_blocks[i].size > stats->largest_free) {
+        stats->largest_free = _blocks[i].size;
+      }
+    }
+  }
+  if (stats->free_size) {
+    stats->fragmentation =
+        1.0f - (float)stats->largest_free / (float)stats->free_size;
+  }
+}
+
+bool TlsfPool::getTagStats(uint32_t tag, TagStats *stats) const {
+  auto it = _tags.find(tag);
+  if (it == _tags.end()) {
+    return false;
+  }
+  *stats = it->second;
+  return true;
+}
+
+bool TlsfPool::check() const {
+  if (_size == 0) {
+    return _used.empty();
+  }
+  // physical chain from address 0 must tile the range
+  std::vector<bool> spare(_blocks.size(), false);
+  for (int32_t s : _spare) {
+    spare[s] = true;
+  }
+  int32_t idx = -1;
+  for (size_t i = 0; i < _blocks.size(); ++i) {
+    if (!spare[i] && _blocks[i].prev_phys < 0) {
+      if (idx >= 0) {
+        return false;
+      }
+      idx = (int32_t)i;
+    }
+  }
+  uint64_t addr = 0, used = 0;
+  uint32_t num_free = 0, num_used = 0;
+  bool prev_free = false;
+  for (; idx >= 0; idx = _blocks[idx].next_phys) {
+    const Block &b = _blocks[idx];
+    if (b.addr != addr || b.size == 0 || b.size % _granule) {
+      return false;
+    }
+    if (b.used) {
+      auto it = _used.find(b.addr);
+      if (it == _used.end() || it->second != idx) {
+        return false;
+      }
+      used += b.size;
+      num_used++;
+      prev_free = false;
+    } else {
+      // two free neighbours should have been coalesced
+      if (prev_free) {
+        return false;
+      }
+      int fl, sl;
+      mapping(b.size / _granule, &fl, &sl);
+      if (!(_sl_bitmap[fl] & (1U << sl))) {
+        return false;
+      }
+      num_free++;
+      prev_free = true;
+    }
+    addr += b.size;
+  }
+  return addr == _size && used == _used_size && num_used == _used.size() &&
+         num_free == _free_blocks;
+}
+
+} // namespace runtime
+} // namespace cvi
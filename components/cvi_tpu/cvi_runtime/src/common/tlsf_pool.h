@@ -0,0 +1,96 @@
+#pragma once
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace cvi {
+namespace runtime {
+
+// Two level segregated fit allocator over a device address range [0, size).
+// Device memory is not host mapped, so block headers live in a side table.
+// alloc and free are O(1): the first level indexes the power of two of the
+// size, the second level splits it in 16 lists, bitmaps give the first
+// non-empty list that fits and neighbours are coalesced on free.
+class TlsfPool {
+public:
+  struct Stats {
+    uint64_t total_size;
+    uint64_t used_size;
+    uint64_t peak_used_size;   // high-water mark
+    uint64_t free_size;
+    uint64_t largest_free;
+    uint32_t used_blocks;
+    uint32_t free_blocks;
+    uint64_t alloc_count;
+    uint64_t free_count;
+    uint64_t failed_count;
+    // 1 - largest_free / free_size, 0 when the free space is one block
+    float fragmentation;
+  };
+
+  struct TagStats {
+    uint64_t used_size;
+    uint64_t peak_used_size;
+    uint32_t blocks;
+  };
+
+  // granule is a power of two, sizes are rounded up to it
+  TlsfPool(uint64_t size, uint64_t granule);
+
+  bool alloc(uint64_t size, uint32_t tag, uint64_t *addr);
+  // like alloc, but the block does not cross a bank_size boundary
+  bool allocInBank(uint64_t size, uint64_t bank_size, uint32_t tag,
+                   uint64_t *addr);
+  bool free(uint64_t addr);
+  // free every block allocated with tag, returns the number of blocks
+  int freeTag(uint32_t tag);
+
+  uint64_t blockSize(uint64_t addr) const;
+  void getStats(Stats *stats) const;
+  bool getTagStats(uint32_t tag, TagStats *stats) const;
+  // walk the whole block table, for tests and debug builds
+  bool check() const;
+
+private:
+  enum { SL_LOG2 = 4, SL_COUNT = 1 << SL_LOG2, FL_COUNT = 64 - SL_LOG2 + 1 };
+
+  struct Block {
+    uint64_t addr;
+    uint64_t size;
+    int32_t prev_phys;
+    int32_t next_phys;
+    int32_t prev_free;
+    int32_t next_free;
+    uint32_t tag;
+    bool used;
+  };
+
+  static void mapping(uint64_t units, int *fl, int *sl);
+  int32_t findFree(uint64_t units);
+  int32_t newBlock();
+  void insertFree(int32_t idx);
+  void removeFree(int32_t idx);
+  // split [offset, offset + size) out of free block idx and mark it used
+  void take(int32_t idx, uint64_t offset, uint64_t size, uint32_t tag);
+  int32_t split(int32_t idx, uint64_t size);
+
+  uint64_t _size;
+  uint64_t _granule;
+  std::vector<Block> _blocks;
+  std::vector<int32_t> _spare;
+  int32_t _heads[FL_COUNT][SL_COUNT];
+  uint64_t _fl_bitmap;
+  uint32_t _sl_bitmap[FL_COUNT];
+  std::unordered_map<uint64_t, int32_t> _used;
+  std::unordered_map<uint32_t, TagStats> _tags;
+
+  uint64_t _used_size;
+  uint64_t _peak_used_size;
+  uint32_t _free_blocks;
+  uint64_t _alloc_count;
+  uint64_t _free_count;
+  uint64_t _failed_count;
+};
+
+} // namespace runtime
+} // namespace cvi
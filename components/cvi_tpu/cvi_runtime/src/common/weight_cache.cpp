@@ -0,0 +1,89 @@
+#include <string.h>
+#include <list>
+#include <mutex>
+#include <runtime/debug.h>
+#include <runtime/weight_cache.hpp>
+#include "alloc.h"
+
+namespace cvi {
+namespace runtime {
+
+struct WeightEntry {
+  CVI_RT_MEM mem;
+  uint64_t body_hash;
+  uint64_t content_hash;
+  size_t size;
+};
+
+static std::mutex gMutexLock;
+static std::list<WeightEntry> gWeightList;
+
+static inline uint64_t mix(uint64_t h, uint64_t v) {
+  h ^= v * 0x9E3779B97F4A7C15ULL;
+  h = (h << 31) | (h >> 33);
+  return h * 0xC2B2AE3D27D4EB4FULL;
+}
+
+uint64_t hashContent(uint64_t seed, const uint8_t *data, size_t size) {
+  uint64_t h = seed;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t v;
+    memcpy(&v, data + i, sizeof(v));
+    h = mix(h, v);
+  }
+  if (i < size) {
+    uint64_t v = 0;
+    memcpy(&v, data + i, size - i);
+    h = mix(h, v ^ (size - i));
+  }
+  return h;
+}
+
+bool hasCachedWeight(uint64_t body_hash, size_t size) {
+  const std::lock_guard<std::mutex> lock(gMutexLock);
+  for (auto &entry : gWeightList) {
+    if (entry.body_hash == body_hash && entry.size == size) {
+      return true;
+    }
+  }
+  return false;
+}
+
+CVI_RT_MEM acquireCachedWeight(uint64_t body_hash, uint64_t content_hash,
+                               size_t size) {
+  const std::lock_guard<std::mutex> lock(gMutexLock);
+  for (auto &entry : gWeightList) {
+    if (entry.body_hash == body_hash && entry.content_hash == content_hash &&
+        entry.size == size) {
+      CVI_RT_MemIncRef(entry.mem);
+      return entry.mem;
+    }
+  }
+  return nullptr;
+}
+
+void cacheWeight(CVI_RT_MEM mem, uint64_t body_hash, uint64_t content_hash,
+                 size_t size) {
+  const std::lock_guard<std::mutex> lock(gMutexLock);
+  CVI_RT_MemIncRef(mem);
+  gWeightList.push_back({mem, body_hash, content_hash, size});
+}
+
+void releaseWeight(CVI_RT_HANDLE ctx, CVI_RT_MEM mem) {
+  const std::lock_guard<std::mutex> lock(gMutexLock);
+  for (auto it = gWeightList.begin(); it != gWeightList.end(); ++it) {
+    if (it->mem == mem) {
+      if (CVI_RT_MemDecRef(mem) == 0) {
+        TPU_LOG_DEBUG("free shared weight, size:%zu\n", it->size);
+        gWeightList.erase(it);
+        cviMemFree(ctx, mem);
+      }
+      return;
+    }
+  }
+  cviMemFree(ctx, mem);
+}
+
+} // namespace runtime
+} // namespace cvi
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2021-2022 Alibaba Group Holding Limited
+ */
+
+// Per frame metadata cost of cx::Buffer on the voice graph pattern: one plugin
+// creates a buffer and sets its meta, three downstream plugins read it. The
+// std::map<std::string> buffer as it was against the slot buffer, reached by
+// string keys and by MetaKey. A serialize / parse round trip checks the wire
+// format is unchanged.
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cxvision/plugin/buffer.h"
+#include "cxvision/proto/voice.h"
+
+using SspOutMessageT = thead::voice::proto::SspOutMsg;
+using DataInputMessageT = thead::voice::proto::DataInputMsg;
+
+// the few posto symbols the headers pull in, the library is target only
+namespace posto {
+namespace base {
+mutex::mutex() {}
+mutex::~mutex() {}
+void mutex::lock() {}
+void mutex::unlock() {}
+}  // namespace base
+namespace transport {
+IoBlock::~IoBlock() {}
+}  // namespace transport
+}  // namespace posto
+
+// ulog for the LOGE of debug builds
+extern "C" int ulog(const unsigned char s, const char* mod, const char* f,
+                    const unsigned long l, const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  printf("[%s] ", mod);
+  vprintf(fmt, args);
+  printf("\n");
+  va_end(args);
+  return 0;
+}
+
+namespace legacy {
+
+// cx::Buffer metadata as it was
+class Buffer {
+public:
+  bool SetMetadata(const std::string& key, std::shared_ptr<void> meta) {
+    metas_[key].object = meta;
+    return true;
+  }
+
+  template <typename T>
+  std::shared_ptr<T> GetMetadata(const std::string& key) {
+    const auto& it = metas_.find(key);
+    if (it != metas_.end()) {
+      auto& meta = it->second;
+      if (meta.object) {
+        return std::static_pointer_cast<T>(meta.object);
+      } else if (!meta.view.empty()) {
+        auto obj = std::make_shared<T>();
+        obj->ParseFromArray(meta.view.data(), meta.view.size());
+        meta.object = obj;
+        return obj;
+      }
+    }
+    return nullptr;
+  }
+
+private:
+  struct MetaValue {
+    std::shared_ptr<void> object;
+    std::string view;
+  };
+
+  std::map<std::string, MetaValue> metas_;
+};
+
+}  // namespace legacy
+
+static double now_ns() {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static const cx::MetaKey<SspOutMessageT> kSspParam("ssp_param");
+static const cx::MetaKey<DataInputMessageT> kAlsaParam("alsa_param");
+
+static volatile int32_t g_sink;
+
+template <typename BufferT, typename Fn>
+static double frame_ns(int frames, Fn fn) {
+  auto meta = std::make_shared<SspOutMessageT>();
+  meta->set_frame(160);
+  double start = now_ns();
+  for (int i = 0; i < frames; ++i) {
+    auto buffer = std::make_shared<BufferT>();
+    fn(*buffer, meta);
+  }
+  return (now_ns() - start) / frames;
+}
+
+int main(int argc, char** argv) {
+  int frames = argc > 1 ? atoi(argv[1]) : 1000000;
+  bool ok = true;
+
+  double t_legacy = frame_ns<legacy::Buffer>(
+      frames, [](legacy::Buffer& b, const std::shared_ptr<SspOutMessageT>& meta) {
+        b.SetMetadata("ssp_param", meta);
+        for (int i = 0; i < 3; ++i) {
+          g_sink = b.GetMetadata<SspOutMessageT>("ssp_param")->frame();
+        }
+      });
+  double t_string = frame_ns<cx::Buffer>(
+      frames, [](cx::Buffer& b, const std::shared_ptr<SspOutMessageT>& meta) {
+        b.SetMetadata("ssp_param", meta);
+        for (int i = 0; i < 3; ++i) {
+          g_sink = b.GetMetadata<SspOutMessageT>("ssp_param")->frame();
+        }
+      });
+  double t_key = frame_ns<cx::Buffer>(
+      frames, [](cx::Buffer& b, const std::shared_ptr<SspOutMessageT>& meta) {
+        b.SetMetadata(kSspParam, meta);
+        for (int i = 0; i < 3; ++i) {
+          g_sink = b.GetMetadata(kSspParam)->frame();
+        }
+      });
+  double t_empty = frame_ns<cx::Buffer>(
+      frames, [](cx::Buffer& b, const std::shared_ptr<SspOutMessageT>& meta) {});
+
+  printf("buffer + 1 set + 3 get, %d frames, ns per frame\n", frames);
+  printf("%-26s %8.1f\n", "new buffer only", t_empty);
+  printf("%-26s %8.1f\n", "std::map, string key", t_legacy);
+  printf("%-26s %8.1f\n", "slots, string key", t_string);
+  printf("%-26s %8.1f\n", "slots, MetaKey", t_key);
+
+  // round trip, a string key and a MetaKey of the same name reach one slot
+  cx::Buffer src, dst;
+  auto ssp = std::make_shared<SspOutMessageT>();
+  ssp->set_vad_res(5);
+  ssp->set_frame(160);
+  auto alsa = std::make_shared<DataInputMessageT>();
+  alsa->set_chn_num(3);
+  src.SetMetadata(kSspParam, ssp);
+  src.SetMetadata("alsa_param", alsa);
+  for (int i = 0; i < 6; ++i) {
+    src.SetMetadata("extra_" + std::to_string(i), ssp);
+  }
+  std::vector<char> wire(src._ByteSizeLong());
+  src._SerializeToArray(wire.data(), wire.size());
+  dst._ParseFromArray(wire.data(), wire.size());
+  ok &= dst.GetMetadata<SspOutMessageT>("ssp_param")->vad_res() == 5;
+  ok &= dst.GetMetadata(kSspParam)->frame() == 160;
+  ok &= dst.GetMetadata(kAlsaParam)->chn_num() == 3;
+  ok &= dst.GetMetadata<SspOutMessageT>("extra_5")->frame() == 160;
+  ok &= dst.GetMetadata<SspOutMessageT>("missing") == nullptr;
+  printf("round trip %s\n", ok ? "ok" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -6,6 +6,8 @@
 #define CXVISION_BASE_MEMORY_H_
 
 #include <cstddef>
+#include <memory>
+#include <vector>
 
 #include <posto/posto.h>
 
@@ -13,12 +15,70 @@ namespace cx {
 
 using MemoryPtr = posto::transport::IoBlockPtr;
 
+class MemoryPool;
+using MemoryPoolPtr = std::shared_ptr<MemoryPool>;
+
 class MemoryHelper {
 public:
   static MemoryPtr Malloc(size_t size);
   static MemoryPtr MallocAndCopy(const void* data, size_t size);
+
+  // Pool of block_num blocks of block_size bytes, see MemoryPool
+  static MemoryPoolPtr CreatePool(size_t block_size, size_t block_num);
+};
+
+// Fixed-size blocks allocated once, for plugins that send a frame of the same
+// size on every Process(). A block is handed out again once every Buffer and
+// plugin holding it has released it, so a steady pipeline makes no heap calls.
+// When all blocks are still in use Malloc() falls back to the heap.
+//
+// Only the local references are seen: do not send pooled memory to a node on
+// another device_id, give it a MemoryHelper::MallocAndCopy() block instead.
+// Malloc() must be called from one thread, usually the plugin's own.
+class MemoryPool final {
+public:
+  MemoryPool(size_t block_size, size_t block_num)
+      : block_size_(block_size), next_(0), misses_(0) {
+    blocks_.reserve(block_num);
+    for (size_t i = 0; i < block_num; ++i) {
+      blocks_.emplace_back(posto::transport::IoBlock::New(block_size));
+    }
+  }
+
+  MemoryPtr Malloc() {
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+      const auto& block = blocks_[next_];
+      next_ = next_ + 1 < blocks_.size() ? next_ + 1 : 0;
+      // the pool holds the only reference, nobody else can take one meanwhile
+      if (block && block.use_count() == 1) {
+        return block;
+      }
+    }
+    ++misses_;
+    return posto::transport::IoBlock::New(block_size_);
+  }
+
+  size_t block_size() const { return block_size_; }
+  size_t block_num() const { return blocks_.size(); }
+  // count of Malloc() served by the heap
+  size_t misses() const { return misses_; }
+
+private:
+  MemoryPool(const MemoryPool&) = delete;
+  MemoryPool& operator=(const MemoryPool&) = delete;
+
+  size_t block_size_;
+  size_t next_;
+  size_t misses_;
+  std::vector<MemoryPtr> blocks_;
 };
 
+// static
+inline MemoryPoolPtr MemoryHelper::CreatePool(size_t block_size,
+                                              size_t block_num) {
+  return std::make_shared<MemoryPool>(block_size, block_num);
+}
+
 } // namespace cx
 
 #endif  // CXVISION_BASE_MEMORY_H_
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2021-2022 Alibaba Group Holding Limited
+ */
+
+#ifndef CXVISION_BASE_PCM_H_
+#define CXVISION_BASE_PCM_H_
+
+#include <cstdint>
+
+namespace cx {
+namespace pcm {
+
+namespace internal {
+
+// With the channel count a constant the inner loop unrolls and the compiler
+// emits segment (strided) vector loads / stores where the target has them.
+template <int ChnNum>
+inline void Deinterleave(const int16_t* __restrict src,
+                         int16_t* __restrict dst, int frames) {
+  for (int j = 0; j < frames; ++j) {
+    for (int i = 0; i < ChnNum; ++i) {
+      dst[frames * i + j] = src[ChnNum * j + i];
+    }
+  }
+}
+
+template <int ChnNum>
+inline void Interleave(const int16_t* __restrict src,
+                       int16_t* __restrict dst, int frames) {
+  for (int j = 0; j < frames; ++j) {
+    for (int i = 0; i < ChnNum; ++i) {
+      dst[ChnNum * j + i] = src[frames * i + j];
+    }
+  }
+}
+
+}  // namespace internal
+
+// Interleaved src (chn_num samples per frame) to planar dst (chn_num planes of
+// frames samples). src and dst must not overlap.
+inline void Deinterleave(const int16_t* src, int16_t* dst, int frames,
+                         int chn_num) {
+  switch (chn_num) {
+    case 1: internal::Deinterleave<1>(src, dst, frames); break;
+    case 2: internal::Deinterleave<2>(src, dst, frames); break;
+    case 3: internal::Deinterleave<3>(src, dst, frames); break;
+    case 4: internal::Deinterleave<4>(src, dst, frames); break;
+    case 5: internal::Deinterleave<5>(src, dst, frames); break;
+    case 6: internal::Deinterleave<6>(src, dst, frames); break;
+    case 7: internal::Deinterleave<7>(src, dst, frames); break;
+    case 8: internal::Deinterleave<8>(src, dst, frames); break;
+    default:
+      for (int j = 0; j < frames; ++j) {
+        for (int i = 0; i < chn_num; ++i) {
+          dst[frames * i + j] = src[chn_num * j + i];
+        }
+      }
+      break;
+  }
+}
+
+// Planar src to interleaved dst, the inverse of Deinterleave().
+inline void Interleave(const int16_t* src, int16_t* dst, int frames,
+                       int chn_num) {
+  switch (chn_num) {
+    case 1: internal::Interleave<1>(src, dst, frames); break;
+    case 2: internal::Interleave<2>(src, dst, frames); break;
+    case 3: internal::Interleave<3>(src, dst, frames); break;
+    case 4: internal::Interleave<4>(src, dst, frames); break;
+    case 5: internal::Interleave<5>(src, dst, frames); break;
+    case 6: internal::Interleave<6>(src, dst, frames); break;
+    case 7: internal::Interleave<7>(src, dst, frames); break;
+    case 8: internal::Interleave<8>(src, dst, frames); break;
+    default:
+      for (int j = 0; j < frames; ++j) {
+        for (int i = 0; i < chn_num; ++i) {
+          dst[chn_num * j + i] = src[frames * i + j];
+        }
+      }
+      break;
+  }
+}
+
+}  // namespace pcm
+}  // namespace cx
+
+#endif  // CXVISION_BASE_PCM_H_
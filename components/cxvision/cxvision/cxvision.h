@@ -5,6 +5,7 @@
 #ifndef CXVISION_CXVISION_H_
 #define CXVISION_CXVISION_H_
 
+#include "cxvision/base/pcm.h"
 #include "cxvision/graph/graph_manager.h"
 #include "cxvision/plugin/plugin.h"
 #ifdef CXVISION_USE_PROTOBUF
@@ -14,39 +14,52 @@
 
 namespace cx {
 
+template <typename Fn>
+void Buffer::ForEachMeta(Fn fn) const {
+  for (int i = 0; i < slot_num_; ++i) {
+    fn(slots_[i]);
+  }
+  for (const auto& slot : extra_slots_) {
+    fn(slot);
+  }
+}
+
 size_t Buffer::_ByteSizeLong() const {
+  auto& registry = internal::MetaKeyRegistry::Instance();
   // metas' size
   size_t size = 4;
-  for (const auto& meta : metas_) {
+  ForEachMeta([&](const MetaSlot& meta) {
     // key
     size += 4;
-    size += _ALIGN_4(meta.first.size());
+    size += _ALIGN_4(registry.Name(meta.id).size());
 
     // value
     size += 4;
 #ifndef CXVISION_USE_PROTOBUF
-    auto obj = std::static_pointer_cast<posto::Serializable>(meta.second.object);
+    auto obj = std::static_pointer_cast<posto::Serializable>(meta.value.object);
     size = _ALIGN_8(size);
     size += _ALIGN_4(obj->ByteSizeLong());
 #endif
-  }
+  });
   return size;
 }
 
 bool Buffer::_SerializeToArray(void* data, size_t size) const {
+  auto& registry = internal::MetaKeyRegistry::Instance();
   auto ptr = (char*)data;
-  *(uint32_t*)ptr = metas_.size();
+  *(uint32_t*)ptr = slot_num_ + extra_slots_.size();
   ptr += 4;
-  for (const auto& meta : metas_) {
+  ForEachMeta([&](const MetaSlot& meta) {
     // key
-    *(uint32_t*)ptr = meta.first.size();
+    auto key = registry.Name(meta.id);
+    *(uint32_t*)ptr = key.size();
     ptr += 4;
-    std::memcpy(ptr, meta.first.data(), meta.first.size());
-    ptr += _ALIGN_4(meta.first.size());
+    std::memcpy(ptr, key.data(), key.size());
+    ptr += _ALIGN_4(key.size());
 
     // value
 #ifndef CXVISION_USE_PROTOBUF
-    auto obj = std::static_pointer_cast<posto::Serializable>(meta.second.object);
+    auto obj = std::static_pointer_cast<posto::Serializable>(meta.value.object);
     auto obj_size = obj->ByteSizeLong();
     *(uint32_t*)ptr = obj_size;
     ptr += 4;
@@ -54,11 +67,12 @@ bool Buffer::_SerializeToArray(void* data, size_t size) const {
     obj->SerializeToArray(ptr, obj_size);
     ptr += _ALIGN_4(obj_size);
 #endif
-  }
+  });
   return true;
 }
 
 bool Buffer::_ParseFromArray(const void* data, size_t size) {
+  auto& registry = internal::MetaKeyRegistry::Instance();
   auto ptr = (char*)data;
   auto meta_size = *(uint32_t*)ptr;
   ptr += 4;
@@ -76,7 +90,7 @@ bool Buffer::_ParseFromArray(const void* data, size_t size) {
     std::string value(ptr, value_size);
     ptr += _ALIGN_4(value_size);
 
-    metas_[key].view = std::move(value);
+    Slot(registry.Intern(key, nullptr)).view = std::move(value);
   }
   return true;
 }
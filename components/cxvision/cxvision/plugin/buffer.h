@@ -8,10 +8,12 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <posto/posto.h>
 
 #include "cxvision/base/memory.h"
+#include "cxvision/plugin/meta_key.h"
 
 namespace cx {
 
@@ -31,26 +33,27 @@ public:
     return nullptr;
   }
 
+  template <typename T>
+  bool SetMetadata(const MetaKey<T>& key, std::shared_ptr<T> meta) {
+    Slot(key.id()).object = std::move(meta);
+    return true;
+  }
+
+  template <typename T>
+  std::shared_ptr<T> GetMetadata(const MetaKey<T>& key) {
+    return GetMetadataById<T>(key.id());
+  }
+
+  // String keys, interned on every call: prefer a MetaKey on the data path
   bool SetMetadata(const std::string& key, std::shared_ptr<void> meta) {
-    metas_[key].object = meta;
+    Slot(internal::MetaKeyRegistry::Instance().Intern(key, nullptr)).object =
+        std::move(meta);
     return true;
   }
 
   template <typename T>
   std::shared_ptr<T> GetMetadata(const std::string& key) {
-    const auto& it = metas_.find(key);
-    if (it != metas_.end()) {
-      auto& meta = it->second;
-      if (meta.object) {
-        return std::static_pointer_cast<T>(meta.object);
-      } else if (!meta.view.empty()) {
-        auto obj = std::make_shared<T>();
-        obj->ParseFromArray(meta.view.data(), meta.view.size());
-        meta.object = obj;
-        return obj;
-      }
-    }
-    return nullptr;
+    return GetMetadataById<T>(internal::MetaKeyRegistry::Instance().Find(key));
   }
 
   size_t _ByteSizeLong() const override;
@@ -63,7 +66,63 @@ private:
     std::string view;
   };
 
-  std::map<std::string, MetaValue> metas_;
+  struct MetaSlot {
+    int id;
+    MetaValue value;
+  };
+
+  // a buffer carries one or two metas, more go to extra_slots_
+  static constexpr int kInlineSlots = 4;
+
+  MetaValue* FindSlot(int id) {
+    for (int i = 0; i < slot_num_; ++i) {
+      if (slots_[i].id == id) {
+        return &slots_[i].value;
+      }
+    }
+    for (auto& slot : extra_slots_) {
+      if (slot.id == id) {
+        return &slot.value;
+      }
+    }
+    return nullptr;
+  }
+
+  MetaValue& Slot(int id) {
+    auto value = FindSlot(id);
+    if (value) {
+      return *value;
+    }
+    if (slot_num_ < kInlineSlots) {
+      slots_[slot_num_].id = id;
+      return slots_[slot_num_++].value;
+    }
+    extra_slots_.push_back({id, MetaValue()});
+    return extra_slots_.back().value;
+  }
+
+  template <typename T>
+  std::shared_ptr<T> GetMetadataById(int id) {
+    auto meta = id < 0 ? nullptr : FindSlot(id);
+    if (meta) {
+      if (meta->object) {
+        return std::static_pointer_cast<T>(meta->object);
+      } else if (!meta->view.empty()) {
+        auto obj = std::make_shared<T>();
+        obj->ParseFromArray(meta->view.data(), meta->view.size());
+        meta->object = obj;
+        return obj;
+      }
+    }
+    return nullptr;
+  }
+
+  template <typename Fn>
+  void ForEachMeta(Fn fn) const;
+
+  int slot_num_ = 0;
+  MetaSlot slots_[kInlineSlots];
+  std::vector<MetaSlot> extra_slots_;
 };
 
 }  // namespace cx
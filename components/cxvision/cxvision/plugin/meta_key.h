@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021-2022 Alibaba Group Holding Limited
+ */
+
+#ifndef CXVISION_PLUGIN_META_KEY_H_
+#define CXVISION_PLUGIN_META_KEY_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <posto/base/mutex.h>
+#include <ulog/ulog.h>
+
+namespace cx {
+
+namespace internal {
+
+// Metadata key names interned to small integer ids. An id keeps the type the
+// key was first registered with, string keys register with no type.
+class MetaKeyRegistry final {
+public:
+  static MetaKeyRegistry& Instance() {
+    static MetaKeyRegistry registry;
+    return registry;
+  }
+
+  int Intern(const std::string& name, const void* type) {
+    posto::base::lock_guard<posto::base::mutex> lock(mutex_);
+    auto it = ids_.find(name);
+    if (it == ids_.end()) {
+      it = ids_.emplace(name, (int)entries_.size()).first;
+      entries_.push_back({name, type});
+    } else if (type) {
+      auto& entry = entries_[it->second];
+      if (!entry.type) {
+        entry.type = type;
+      } else if (entry.type != type) {
+        LOGE("cxvision", "metadata key \"%s\" registered with two types",
+             name.c_str());
+      }
+    }
+    return it->second;
+  }
+
+  // -1 if the name was never interned
+  int Find(const std::string& name) {
+    posto::base::lock_guard<posto::base::mutex> lock(mutex_);
+    auto it = ids_.find(name);
+    return it == ids_.end() ? -1 : it->second;
+  }
+
+  std::string Name(int id) {
+    posto::base::lock_guard<posto::base::mutex> lock(mutex_);
+    return id >= 0 && id < (int)entries_.size() ? entries_[id].name
+                                                 : std::string();
+  }
+
+private:
+  struct Entry {
+    std::string name;
+    const void* type;
+  };
+
+  MetaKeyRegistry() = default;
+
+  posto::base::mutex mutex_;
+  std::map<std::string, int> ids_;
+  std::vector<Entry> entries_;
+};
+
+template <typename T>
+struct MetaType {
+  static const void* Tag() {
+    static const char tag = 0;
+    return &tag;
+  }
+};
+
+}  // namespace internal
+
+// Typed metadata key, interned once so Buffer looks it up by id:
+//   static const cx::MetaKey<SspOutMessageT> kSspParam("ssp_param");
+//   output->SetMetadata(kSspParam, oMeta);
+//   auto iMeta = input->GetMetadata(kSspParam);
+// Keys of the same name in different plugins share the id, and the string
+// key overloads of Buffer still reach them.
+template <typename T>
+class MetaKey final {
+public:
+  explicit MetaKey(const char* name)
+      : id_(internal::MetaKeyRegistry::Instance().Intern(
+            name, internal::MetaType<T>::Tag())) {}
+
+  int id() const { return id_; }
+
+private:
+  int id_;
+};
+
+}  // namespace cx
+
+#endif  // CXVISION_PLUGIN_META_KEY_H_
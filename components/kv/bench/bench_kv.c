@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2018-2022 Alibaba Group Holding Limited
+ */
+
+/*
+ * Mount time and kv_get / kv_set latency against the key count, on a flash kept in ram.
+ * Built once per lookup mode (see CMakeLists.txt). Before each mount some keys are
+ * written again to another block without deleting the old node, as a power loss in
+ * kv_set leaves them, so the verify at mount has conflicts to resolve; every key is
+ * read back after the mounts and the run fails on a wrong or a deleted value.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "kv_cache.h"
+#include "kvset.h"
+#include "block.h"
+
+#define BLOCK_SIZE 4096
+#define VALUE_SIZE 16
+
+#ifndef BENCH_MODE
+#define BENCH_MODE "scan"
+#endif
+
+/* the few aos symbols pulled in by aos/hash.c and block.c */
+void *aos_zalloc(size_t size)
+{
+    return calloc(1, size);
+}
+
+void aos_free(void *mem)
+{
+    free(mem);
+}
+
+int ulog(const unsigned char s, const char *mod, const char *f, const unsigned long l, const char *fmt, ...)
+{
+    return 0;
+}
+
+void aos_except_process(int err, const char *file, int line, const char *func_name, void *caller)
+{
+    printf("except %d at %s:%d\n", err, file, line);
+    abort();
+}
+
+static uint8_t *g_flash;
+
+static int ram_erase(kv_t *kv, int pos, int size)
+{
+    memset(g_flash + pos, 0xff, size);
+    return 0;
+}
+
+static int ram_write(kv_t *kv, int pos, void *data, int size)
+{
+    memcpy(g_flash + pos, data, size);
+    return 0;
+}
+
+static int ram_read(kv_t *kv, int pos, void *data, int size)
+{
+    memcpy(data, g_flash + pos, size);
+    return 0;
+}
+
+static flash_ops_t g_ops = {ram_erase, ram_write, ram_read};
+
+static double now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void make_value(char *value, int key, int round)
+{
+    snprintf(value, VALUE_SIZE, "v%07d_%06d", key, round);
+}
+
+static int mount(kv_t *kv, int block_num)
+{
+    memset(kv, 0, sizeof(kv_t));
+    kv->ops = &g_ops;
+    return kv_init(kv, g_flash, block_num, BLOCK_SIZE);
+}
+
+static void umount(kv_t *kv)
+{
+#if CONFIG_KV_ENABLE_INDEX
+    kv_index_uninit(kv);
+#elif CONFIG_KV_ENABLE_CACHE
+    hash_uninit(&kv->map);
+    free(kv->nodes);
+#endif
+    free(kv->blocks);
+}
+
+/* write the key once more in another block and keep the old node, as a power loss does */
+static int write_twice(kv_t *kv, const char *key, const char *value)
+{
+    kvnode_t node;
+
+    if (kv_find(kv, key, &node) != 0)
+        return -1;
+
+    for (int i = 0; i < kv->num; i++) {
+        kvblock_t *block = &kv->blocks[(node.block->id + 1 + i) % kv->num];
+        if (block != node.block && block->id != kv->gc_bid && block->ro_count == 0 &&
+            kvblock_set(block, key, (void *)value, VALUE_SIZE, node.version == 255 ? 1 : node.version + 1) >= 0)
+            return 0;
+    }
+
+    return -1;
+}
+
+static int run(int keys)
+{
+    int block_num = keys / 64 + 4;
+    int *round, *order, bad = 0;
+    char key[32], value[VALUE_SIZE], buf[VALUE_SIZE];
+    double t0, mount_ms, get_us, set_us;
+    kv_t kv;
+
+    g_flash = malloc(block_num * BLOCK_SIZE);
+    round   = calloc(keys, sizeof(int));
+    order   = malloc(keys * sizeof(int));
+    memset(g_flash, 0xff, block_num * BLOCK_SIZE);
+    srand(keys);
+    for (int i = 0; i < keys; i++) {
+        int j = rand() % (i + 1);
+        order[i] = order[j];
+        order[j] = i;
+    }
+
+    mount(&kv, block_num);
+    for (int i = 0; i < keys; i++) {
+        snprintf(key, sizeof(key), "bench_key_%06d", i);
+        make_value(value, i, 0);
+        if (kv_set(&kv, key, value, VALUE_SIZE) != VALUE_SIZE)
+            bad++;
+    }
+    for (int i = 0; i < keys; i += 32) {
+        snprintf(key, sizeof(key), "bench_key_%06d", i);
+        make_value(value, i, ++round[i]);
+        if (write_twice(&kv, key, value) != 0)
+            round[i]--;
+    }
+    umount(&kv);
+
+    t0 = now_us();
+    mount(&kv, block_num);
+    mount_ms = (now_us() - t0) / 1e3;
+
+    t0 = now_us();
+    for (int i = 0; i < keys; i++) {
+        int k = order[i];
+        snprintf(key, sizeof(key), "bench_key_%06d", k);
+        make_value(value, k, round[k]);
+        if (kv_get(&kv, key, buf, VALUE_SIZE) != VALUE_SIZE || memcmp(buf, value, VALUE_SIZE) != 0)
+            bad++;
+    }
+    get_us = (now_us() - t0) / keys;
+
+    t0 = now_us();
+    for (int i = 0; i < keys; i++) {
+        int k = order[i];
+        snprintf(key, sizeof(key), "bench_key_%06d", k);
+        make_value(value, k, ++round[k]);
+        if (kv_set(&kv, key, value, VALUE_SIZE) != VALUE_SIZE)
+            bad++;
+    }
+    set_us = (now_us() - t0) / keys;
+
+    for (int i = 3; i < keys; i += 7) {
+        snprintf(key, sizeof(key), "bench_key_%06d", i);
+        if (kv_rm(&kv, key) != 0 || kv_get(&kv, key, buf, VALUE_SIZE) >= 0)
+            bad++;
+    }
+
+    /* all the updates, and the gc they caused, must survive a mount */
+    umount(&kv);
+    mount(&kv, block_num);
+    for (int i = 0; i < keys; i++) {
+        int removed = i % 7 == 3;
+        snprintf(key, sizeof(key), "bench_key_%06d", i);
+        make_value(value, i, round[i]);
+        if (removed ? kv_get(&kv, key, buf, VALUE_SIZE) >= 0 :
+            kv_get(&kv, key, buf, VALUE_SIZE) != VALUE_SIZE || memcmp(buf, value, VALUE_SIZE) != 0)
+            bad++;
+    }
+    umount(&kv);
+
+    printf("%-9s %6d %7d %11.2f %9.2f %9.2f %6s\n", BENCH_MODE, keys, block_num, mount_ms, get_us, set_us,
+           bad ? "FAIL" : "ok");
+
+    free(order);
+    free(round);
+    free(g_flash);
+    return bad;
+}
+
+int main(int argc, char **argv)
+{
+    int counts[] = {250, 500, 1000, 2000, 4000};
+    int n = sizeof(counts) / sizeof(counts[0]), bad = 0;
+
+    if (argc > 1) {
+        n = argc - 1 < n ? argc - 1 : n;
+        for (int i = 0; i < n; i++)
+            counts[i] = atoi(argv[i + 1]);
+    }
+
+    printf("%-9s %6s %7s %11s %9s %9s %6s\n", "mode", "keys", "blocks", "mount(ms)", "get(us)", "set(us)",
+           "check");
+    for (int i = 0; i < n; i++)
+        bad += run(counts[i]);
+
+    return bad ? 1 : 0;
+}
@@ -465,7 +465,9 @@ static int _iter_calc(kvnode_t *node, void *i)
         node->block->count++;
         if (node->rw == 0)
             node->block->ro_count++;
-#if (CONFIG_KV_ENABLE_CACHE || CONFIG_KV_START_OPT)
+#if CONFIG_KV_ENABLE_INDEX
+        kv_index_add(node->block->kv, node);
+#elif (CONFIG_KV_ENABLE_CACHE || CONFIG_KV_START_OPT)
         {
             long idx;
             int valid = 0;
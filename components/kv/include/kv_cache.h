@@ -22,6 +22,13 @@ extern "C" {
  */
 void kv_cache_nodes_init(kv_t *kv, size_t num);
 
+/**
+ * @brief  mark all the cache nodes unused
+ * @param  [in] kv
+ * @return
+ */
+void kv_cache_nodes_reset(kv_t *kv);
+
 /**
  * @brief  reset the cache node
  * @param  [in] node
@@ -36,6 +43,14 @@ void kv_cache_node_reset(cache_node_t *node);
  */
 int kv_cache_node_get(kv_t *kv);
 
+/**
+ * @brief  give back the cache node index got by kv_cache_node_get
+ * @param  [in] kv
+ * @param  [in] idx
+ * @return
+ */
+void kv_cache_node_put(kv_t *kv, int idx);
+
 /**
  * @brief  put the key with other params to the inner-hash_map of the kv
  * @param  [in] kv
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2018-2022 Alibaba Group Holding Limited
+ */
+
+#if CONFIG_KV_ENABLE_INDEX
+#ifndef __KV_INDEX_H__
+#define __KV_INDEX_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_KV_LARGE_NODE
+#define INDEX_INVALID_VAL (0xFFFFFFFF)
+#else
+#define INDEX_INVALID_VAL (0xFFFF)
+#endif
+
+typedef struct kv_index_entry {
+    uint32_t           hash;     ///< hash of the key string
+#if CONFIG_KV_LARGE_NODE
+    uint32_t           block_id;
+    uint32_t           offset;
+#else
+    uint16_t           block_id;
+    uint16_t           offset;   ///< head_offset of the node in the block
+#endif
+} kv_index_entry_t;
+
+/* entries sorted by (hash, block_id, offset), one per valid key */
+typedef struct kv_index {
+    kv_index_entry_t   *entries;
+    uint32_t           count;
+    uint32_t           capacity;
+} kv_index_t;
+
+#include "kvset.h"
+
+/**
+ * @brief  malloc the index table of the kv
+ * @param  [in] kv
+ * @param  [in] num : initial count of entries
+ * @return 0/-1
+ */
+int kv_index_init(kv_t *kv, size_t num);
+
+/**
+ * @brief  free the index table of the kv
+ * @param  [in] kv
+ * @return
+ */
+void kv_index_uninit(kv_t *kv);
+
+/**
+ * @brief  append a node found while scanning the blocks, kv_index_build must be
+ *         called before any lookup
+ * @param  [in] kv
+ * @param  [in] node
+ * @return
+ */
+void kv_index_add(kv_t *kv, kvnode_t *node);
+
+/**
+ * @brief  sort the appended nodes and delete the old one of the same key
+ * @param  [in] kv
+ * @return
+ */
+void kv_index_build(kv_t *kv);
+
+/**
+ * @brief  drop the index and build it again from all the blocks
+ * @param  [in] kv
+ * @return
+ */
+void kv_index_rebuild(kv_t *kv);
+
+/**
+ * @brief  find the kvnode by key
+ * @param  [in] kv
+ * @param  [in] key
+ * @param  [in] node : used for store the result finding
+ * @return 0 if find
+ */
+int kv_index_find(kv_t *kv, const char *key, kvnode_t *node);
+
+/**
+ * @brief  point the key to the node just written
+ * @param  [in] kv
+ * @param  [in] key
+ * @param  [in] old      : node replaced by the write, NULL for a new key
+ * @param  [in] block_id
+ * @param  [in] offset   : head_offset of the new node in the block
+ * @return
+ */
+void kv_index_set(kv_t *kv, const char *key, kvnode_t *old, int block_id, uint32_t offset);
+
+/**
+ * @brief  remove the key from the index, a readonly node of the same key
+ *         takes its place
+ * @param  [in] kv
+ * @param  [in] key
+ * @param  [in] node : the node removed
+ * @return
+ */
+void kv_index_remove(kv_t *kv, const char *key, kvnode_t *node);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __KV_INDEX_H__ */
+#endif
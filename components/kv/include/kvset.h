@@ -16,6 +16,7 @@ typedef struct kvblock kvblock_t;
 typedef struct kvnode kvnode_t;
 #include "block.h"
 #include "kv_cache_typedef.h"
+#include "kv_index.h"
 
 struct flash_ops {
     int (*erase)(kv_t *kv, int pos, int size);
@@ -58,6 +59,10 @@ struct kvset {
     hash_t           map;
     cache_node_t     *nodes;
     size_t           node_nb;
+    size_t           node_free;     ///< head of the unused cache-nodes
+#endif
+#if CONFIG_KV_ENABLE_INDEX
+    kv_index_t       index;         ///< sorted key-hash table, instead of the cache
 #endif
 };
 
@@ -5,6 +5,18 @@
 #if (CONFIG_KV_ENABLE_CACHE || CONFIG_KV_START_OPT)
 #include "kv_cache.h"
 
+/* unused nodes are chained through the offset, the block_id stays invalid */
+static void _cache_nodes_chain(kv_t *kv, size_t start)
+{
+    size_t i;
+
+    for (i = start; i < kv->node_nb; i++) {
+        kv->nodes[i].block_id = CACHE_INVALID_VAL;
+        kv->nodes[i].offset   = i + 1 < kv->node_nb ? i + 1 : kv->node_free;
+    }
+    kv->node_free = start < kv->node_nb ? start : kv->node_free;
+}
+
 /**
  * @brief  malloc & init cache node for kv
  * @param  [in] kv
@@ -13,12 +25,25 @@
  */
 void kv_cache_nodes_init(kv_t *kv, size_t num)
 {
-    size_t size;
+    kv->node_nb   = num;
+    kv->node_free = CACHE_INVALID_VAL;
+    kv->nodes     = malloc(sizeof(cache_node_t) * num);
+    if (kv->nodes == NULL) {
+        kv->node_nb = 0;
+        return;
+    }
+    _cache_nodes_chain(kv, 0);
+}
 
-    size        = sizeof(cache_node_t) * num;
-    kv->node_nb = num;
-    kv->nodes   = malloc(size);
-    memset(kv->nodes, 0xff, size);
+/**
+ * @brief  mark all the cache nodes unused
+ * @param  [in] kv
+ * @return
+ */
+void kv_cache_nodes_reset(kv_t *kv)
+{
+    kv->node_free = CACHE_INVALID_VAL;
+    _cache_nodes_chain(kv, 0);
 }
 
 /**
@@ -40,25 +65,44 @@ void kv_cache_node_reset(cache_node_t *node)
 int kv_cache_node_get(kv_t *kv)
 {
     int i;
-    int inc = 32;
 
-    for (i = 0; i < kv->node_nb; i++) {
-        if (kv->nodes[i].block_id == CACHE_INVALID_VAL) {
-            return i;
+    if (kv->node_free == CACHE_INVALID_VAL) {
+        size_t num = kv->node_nb ? kv->node_nb * 2 : 16;
+        cache_node_t *nodes;
+
+        /* the free chain links by offset, keep the indexes below CACHE_INVALID_VAL */
+        if (num > CACHE_INVALID_VAL)
+            num = CACHE_INVALID_VAL;
+        nodes = num > kv->node_nb ? realloc(kv->nodes, num * sizeof(cache_node_t)) : NULL;
+        if (!nodes) {
+            printf("error happens, cache node get may be oom, node num = %lu!\n", (unsigned long)kv->node_nb);
+            return -1;
         }
-    }
 
-    kv->nodes = realloc(kv->nodes, (kv->node_nb + inc) * sizeof(cache_node_t));
-    if (!kv->nodes) {
-        printf("error happens, cache node get may be oom, node num = %lu!\n", (unsigned long)kv->node_nb);
-        return -1;
+        kv->nodes   = nodes;
+        i           = kv->node_nb;
+        kv->node_nb = num;
+        _cache_nodes_chain(kv, i);
     }
 
-    memset(&kv->nodes[kv->node_nb], 0xff, inc * sizeof(cache_node_t));
-    kv->node_nb += inc;
+    i             = kv->node_free;
+    kv->node_free = kv->nodes[i].offset;
     return i;
 }
 
+/**
+ * @brief  give back the cache node index got by kv_cache_node_get
+ * @param  [in] kv
+ * @param  [in] idx
+ * @return
+ */
+void kv_cache_node_put(kv_t *kv, int idx)
+{
+    kv->nodes[idx].block_id = CACHE_INVALID_VAL;
+    kv->nodes[idx].offset   = kv->node_free;
+    kv->node_free           = idx;
+}
+
 /**
  * @brief  put the key with other params to the inner-hash_map of the kv
  * @param  [in] kv
@@ -102,13 +146,11 @@ void kv_cache_node_out(kv_t *kv, const char *key)
 {
     long idx;
     int rc, valid = 0;
-    cache_node_t *cache;
 
     idx = (long)hash_get2(&kv->map, key, &valid);
     rc  = hash_del(&kv->map, key);
     if (valid && rc == 0) {
-        cache = &kv->nodes[idx];
-        kv_cache_node_reset(cache);
+        kv_cache_node_put(kv, idx);
     } else {
         printf("error happens in kv cache out, valid = %d, rc = %d, key = %s\n", valid, rc, key);
     }
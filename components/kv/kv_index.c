@@ -0,0 +1,348 @@
+/*
+ * Copyright (C) 2018-2022 Alibaba Group Holding Limited
+ */
+
+#if CONFIG_KV_ENABLE_INDEX
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "kv_index.h"
+#include "kvset.h"
+#include "block.h"
+
+/* fnv-1a, a readonly key ends at '=' so the length bounds it too */
+static uint32_t key_hash(const uint8_t *key, int n)
+{
+    uint32_t hash = 2166136261u;
+
+    while (n-- > 0 && *key) {
+        hash ^= *key++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static int node_key_len(kvnode_t *node)
+{
+    const uint8_t *head = KVNODE_OFFSET2CACHE(node, head_offset);
+    int n   = node->value_offset - node->head_offset - 1;
+    int len = 0;
+
+    while (len < n && head[len])
+        len++;
+
+    return len;
+}
+
+static int entry_cmp(const void *a, const void *b)
+{
+    const kv_index_entry_t *e1 = (const kv_index_entry_t *)a;
+    const kv_index_entry_t *e2 = (const kv_index_entry_t *)b;
+
+    if (e1->hash != e2->hash)
+        return e1->hash < e2->hash ? -1 : 1;
+    if (e1->block_id != e2->block_id)
+        return e1->block_id < e2->block_id ? -1 : 1;
+    if (e1->offset != e2->offset)
+        return e1->offset < e2->offset ? -1 : 1;
+
+    return 0;
+}
+
+static uint32_t lower_bound(kv_index_t *index, const kv_index_entry_t *e)
+{
+    uint32_t lo = 0, hi = index->count;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (entry_cmp(&index->entries[mid], e) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static int index_reserve(kv_index_t *index, uint32_t count)
+{
+    if (count > index->capacity) {
+        uint32_t capacity = index->capacity ? index->capacity * 2 : 16;
+        kv_index_entry_t *entries;
+
+        while (capacity < count)
+            capacity *= 2;
+        entries = realloc(index->entries, capacity * sizeof(kv_index_entry_t));
+        if (entries == NULL) {
+            printf("error: kv index may be oom, count = %u\n", (unsigned)index->count);
+            return -1;
+        }
+        index->entries  = entries;
+        index->capacity = capacity;
+    }
+
+    return 0;
+}
+
+static void index_insert(kv_index_t *index, const kv_index_entry_t *e)
+{
+    uint32_t i;
+
+    if (index_reserve(index, index->count + 1) < 0)
+        return;
+
+    i = lower_bound(index, e);
+    memmove(&index->entries[i + 1], &index->entries[i], (index->count - i) * sizeof(kv_index_entry_t));
+    index->entries[i] = *e;
+    index->count++;
+}
+
+static void index_erase(kv_index_t *index, const kv_index_entry_t *e)
+{
+    uint32_t i = lower_bound(index, e);
+
+    if (i < index->count && entry_cmp(&index->entries[i], e) == 0) {
+        memmove(&index->entries[i], &index->entries[i + 1], (index->count - i - 1) * sizeof(kv_index_entry_t));
+        index->count--;
+    }
+}
+
+/* read the node the entry points to, the caller frees the block cache on success */
+static int entry_load(kv_t *kv, const kv_index_entry_t *e, kvnode_t *node)
+{
+    kvblock_t *block = &kv->blocks[e->block_id];
+
+    kvblock_cache_malloc(block);
+    if (kvblock_search(block, block->mem_cache + e->offset, node) == 0 &&
+        node->head_offset == e->offset && NODE_VAILD(node))
+        return 0;
+    kvblock_cache_free(block);
+
+    return -1;
+}
+
+/* two entries of one hash, drop the one that is gone or older */
+static void entry_resolve(kv_t *kv, kv_index_entry_t *e1, kv_index_entry_t *e2)
+{
+    kvnode_t node_1, node_2, *del_node;
+    int len;
+
+    if (entry_load(kv, e1, &node_1) != 0) {
+        e1->block_id = INDEX_INVALID_VAL;
+        return;
+    }
+    if (entry_load(kv, e2, &node_2) != 0) {
+        kvblock_cache_free(node_1.block);
+        e2->block_id = INDEX_INVALID_VAL;
+        return;
+    }
+
+    len = node_key_len(&node_1);
+    if (len == node_key_len(&node_2) &&
+        memcmp(KVNODE_OFFSET2CACHE(&node_1, head_offset), KVNODE_OFFSET2CACHE(&node_2, head_offset), len) == 0) {
+        kv->had_conflict = 1;
+        /* a readonly node has version 0 and must be passed last for the key compare */
+        if (node_1.rw)
+            del_node = kvblock_check_version(&node_1, &node_2);
+        else
+            del_node = kvblock_check_version(&node_2, &node_1);
+        /* the same version, keep the first as kv_find without index does */
+        if (del_node == &node_1)
+            e1->block_id = INDEX_INVALID_VAL;
+        else
+            e2->block_id = INDEX_INVALID_VAL;
+    }
+
+    kvblock_cache_free(node_2.block);
+    kvblock_cache_free(node_1.block);
+}
+
+/**
+ * @brief  malloc the index table of the kv
+ * @param  [in] kv
+ * @param  [in] num : initial count of entries
+ * @return 0/-1
+ */
+int kv_index_init(kv_t *kv, size_t num)
+{
+    kv_index_t *index = &kv->index;
+
+    index->count    = 0;
+    index->capacity = num;
+    index->entries  = malloc(num * sizeof(kv_index_entry_t));
+
+    return index->entries ? 0 : -1;
+}
+
+/**
+ * @brief  free the index table of the kv
+ * @param  [in] kv
+ * @return
+ */
+void kv_index_uninit(kv_t *kv)
+{
+    free(kv->index.entries);
+    memset(&kv->index, 0, sizeof(kv_index_t));
+}
+
+/**
+ * @brief  append a node found while scanning the blocks, kv_index_build must be
+ *         called before any lookup
+ * @param  [in] kv
+ * @param  [in] node
+ * @return
+ */
+void kv_index_add(kv_t *kv, kvnode_t *node)
+{
+    kv_index_t *index = &kv->index;
+
+    if (index_reserve(index, index->count + 1) == 0) {
+        kv_index_entry_t *e = &index->entries[index->count++];
+
+        e->hash     = key_hash(KVNODE_OFFSET2CACHE(node, head_offset), node_key_len(node));
+        e->block_id = node->block->id;
+        e->offset   = node->head_offset;
+    }
+}
+
+/**
+ * @brief  sort the appended nodes and delete the old one of the same key
+ * @param  [in] kv
+ * @return
+ */
+void kv_index_build(kv_t *kv)
+{
+    kv_index_t *index = &kv->index;
+    kv_index_entry_t *e = index->entries;
+    uint32_t i, j, a, b, n = 0;
+
+    qsort(e, index->count, sizeof(kv_index_entry_t), entry_cmp);
+
+    /* nodes of one key share the hash, only the runs of equal hash are compared */
+    for (i = 0; i < index->count; i = j) {
+        for (j = i + 1; j < index->count && e[j].hash == e[i].hash; j++);
+
+        for (a = i; a < j; a++) {
+            for (b = a + 1; b < j && e[a].block_id != INDEX_INVALID_VAL; b++) {
+                if (e[b].block_id != INDEX_INVALID_VAL)
+                    entry_resolve(kv, &e[a], &e[b]);
+            }
+        }
+    }
+
+    for (i = 0; i < index->count; i++) {
+        if (e[i].block_id != INDEX_INVALID_VAL)
+            e[n++] = e[i];
+    }
+    index->count = n;
+}
+
+static int _iter_index_add(kvnode_t *node, void *p)
+{
+    kv_index_add((kv_t *)p, node);
+
+    return 0;
+}
+
+/**
+ * @brief  drop the index and build it again from all the blocks
+ * @param  [in] kv
+ * @return
+ */
+void kv_index_rebuild(kv_t *kv)
+{
+    kv->index.count = 0;
+    for (int i = 0; i < kv->num; i++)
+        kvblock_iter(kv->blocks + i, NODE_EXISTS, _iter_index_add, kv);
+
+    kv_index_build(kv);
+}
+
+/**
+ * @brief  find the kvnode by key
+ * @param  [in] kv
+ * @param  [in] key
+ * @param  [in] node : used for store the result finding
+ * @return 0 if find
+ */
+int kv_index_find(kv_t *kv, const char *key, kvnode_t *node)
+{
+    kv_index_t *index = &kv->index;
+    kv_index_entry_t e = {0};
+    uint32_t i;
+
+    e.hash = key_hash((const uint8_t *)key, strlen(key));
+    for (i = lower_bound(index, &e); i < index->count && index->entries[i].hash == e.hash; i++) {
+        if (entry_load(kv, &index->entries[i], node) == 0) {
+            int cmp_res = kvnode_cmp_name(node, key);
+            kvblock_cache_free(node->block);
+            if (cmp_res == 0)
+                return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief  point the key to the node just written
+ * @param  [in] kv
+ * @param  [in] key
+ * @param  [in] old      : node replaced by the write, NULL for a new key
+ * @param  [in] block_id
+ * @param  [in] offset   : head_offset of the new node in the block
+ * @return
+ */
+void kv_index_set(kv_t *kv, const char *key, kvnode_t *old, int block_id, uint32_t offset)
+{
+    kv_index_entry_t e;
+
+    e.hash = key_hash((const uint8_t *)key, strlen(key));
+    if (old) {
+        e.block_id = old->block->id;
+        e.offset   = old->head_offset;
+        index_erase(&kv->index, &e);
+    }
+
+    e.block_id = block_id;
+    e.offset   = offset;
+    index_insert(&kv->index, &e);
+}
+
+/**
+ * @brief  remove the key from the index, a readonly node of the same key
+ *         takes its place
+ * @param  [in] kv
+ * @param  [in] key
+ * @param  [in] node : the node removed
+ * @return
+ */
+void kv_index_remove(kv_t *kv, const char *key, kvnode_t *node)
+{
+    kv_index_entry_t e;
+    kvnode_t ro_node;
+
+    /* a readonly node is never deleted */
+    if (node->rw == 0)
+        return;
+
+    e.hash     = key_hash((const uint8_t *)key, strlen(key));
+    e.block_id = node->block->id;
+    e.offset   = node->head_offset;
+    index_erase(&kv->index, &e);
+
+    for (int i = 0; i < kv->num; i++) {
+        if (kv->blocks[i].ro_count > 0 && kvblock_find(kv->blocks + i, key, &ro_node) == 0 &&
+            ro_node.rw == 0) {
+            e.block_id = i;
+            e.offset   = ro_node.head_offset;
+            index_insert(&kv->index, &e);
+            break;
+        }
+    }
+}
+
+#endif
@@ -11,7 +11,13 @@
 #include "kvset.h"
 #include "block.h"
 
-#if (CONFIG_KV_ENABLE_CACHE || CONFIG_KV_START_OPT)
+#if CONFIG_KV_ENABLE_INDEX
+static void kv_verify(kv_t *kv)
+{
+    kv_index_build(kv);
+}
+
+#elif (CONFIG_KV_ENABLE_CACHE || CONFIG_KV_START_OPT)
 static void kv_verify(kv_t *kv)
 {
     if (!slist_empty(&kv->head)) {
@@ -122,7 +128,12 @@ int kv_init(kv_t *kv, uint8_t *mem, int block_num, int block_size)
     kv->bid    = 0;
     kv->gc_bid = -1;
 
-#if (CONFIG_KV_ENABLE_CACHE || CONFIG_KV_START_OPT)
+#if CONFIG_KV_ENABLE_INDEX
+    if (kv_index_init(kv, 16) < 0) {
+        free(kv->blocks);
+        return -1;
+    }
+#elif (CONFIG_KV_ENABLE_CACHE || CONFIG_KV_START_OPT)
     slist_init(&kv->head);
     hash_init(&kv->map, CONFIG_KV_HASH_BUCKET);
     kv_cache_nodes_init(kv, 16);
@@ -142,7 +153,7 @@ int kv_init(kv_t *kv, uint8_t *mem, int block_num, int block_size)
 
     kv_verify(kv);
 
-#if (!CONFIG_KV_ENABLE_CACHE && CONFIG_KV_START_OPT)
+#if (!CONFIG_KV_ENABLE_INDEX && !CONFIG_KV_ENABLE_CACHE && CONFIG_KV_START_OPT)
     hash_uninit(&kv->map);
     free(kv->nodes);
     kv->nodes = NULL;
@@ -181,7 +192,9 @@ int kv_find(kv_t *kv, const char *key, kvnode_t *node)
 {
     int found = -1;
 
-#if CONFIG_KV_ENABLE_CACHE
+#if CONFIG_KV_ENABLE_INDEX
+    found = kv_index_find(kv, key, node);
+#elif CONFIG_KV_ENABLE_CACHE
     long idx;
     int valid = 0;
     cache_node_t *cache;
@@ -223,7 +236,9 @@ static int _kvblock_deep_gc(kvnode_t *node, void *data)
 
         offset = kvblock_set(block, key, KVNODE_OFFSET2CACHE(node, value_offset), node->val_size, version);
         if (offset >= 0) {
-#if CONFIG_KV_ENABLE_CACHE
+#if CONFIG_KV_ENABLE_INDEX
+            kv_index_set(block->kv, key, node, block->id, offset);
+#elif CONFIG_KV_ENABLE_CACHE
             long idx;
             int valid = 0;
             cache_node_t *cache;
@@ -324,9 +339,12 @@ start2:
         if (kv->blocks[kv->bid].ro_count == 0 && kv->bid != kv->gc_bid) {
             int offset = kvblock_set(kv->blocks + kv->bid, key, value, size, version);
             if (offset >= 0) {
+#if CONFIG_KV_ENABLE_INDEX
+                kv_index_set(kv, key, kv_exist ? &node : NULL, kv->bid, offset);
+#endif
                 if (kv_exist) {
                     kvnode_rm(&node);
-#if CONFIG_KV_ENABLE_CACHE
+#if (CONFIG_KV_ENABLE_CACHE && !CONFIG_KV_ENABLE_INDEX)
                     kv_cache_node_out(kv, key);
                 }
                 kv_cache_node_in(kv, key, kv->bid, offset);
@@ -428,7 +446,9 @@ int kv_rm(kv_t *kv, const char *key)
     /* kvnode rm no mem opt, ignore call kvblock_cache_malloc */
     if (ret == 0) {
         kvnode_rm(&node);
-#if CONFIG_KV_ENABLE_CACHE
+#if CONFIG_KV_ENABLE_INDEX
+        kv_index_remove(kv, key, &node);
+#elif CONFIG_KV_ENABLE_CACHE
         kv_cache_node_out(kv, key);
 #endif
     }
@@ -445,8 +465,10 @@ int kv_reset(kv_t *kv)
 {
     for (int i = 0; i < kv->num; i++)
         kvblock_reset(kv->blocks + i);
-#if CONFIG_KV_ENABLE_CACHE
-    memset(kv->nodes, 0xff, kv->node_nb * sizeof(cache_node_t));
+#if CONFIG_KV_ENABLE_INDEX
+    kv_index_rebuild(kv);
+#elif CONFIG_KV_ENABLE_CACHE
+    kv_cache_nodes_reset(kv);
     hash_uninit(&kv->map);
     hash_init(&kv->map, CONFIG_KV_HASH_BUCKET);
 #endif
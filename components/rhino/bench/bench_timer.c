@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2015-2017 Alibaba Group Holding Limited
+ */
+
+/*
+ * The timer task of k_timer.c run on a simulated clock, built once per timer store (see
+ * CMakeLists.txt):
+ *   list:  the timers sorted in g_timer_head, a walk of the list per start
+ *   wheel: RHINO_CONFIG_TIMER_WHEEL, the hierarchical timer wheel
+ * The message queue and the tick are stubs: when the task would block, the clock jumps to
+ * its timeout or to the next tick of the scenario, whichever comes first. <timers> timers
+ * with timeouts of 1 to 4000 ticks are started, half of them periodic, then on each of
+ * <ticks> ticks <restarts> timers picked at random are stopped and started again, as
+ * watchdogs and retransmission timers are; after that the periodic ones run on their own
+ * for another 5000 ticks. The clock starts shortly before the span of the wheel so timers
+ * also pass through its overflow list.
+ * Reports the cpu time of the timer task per tick and per event, a command or an expiry,
+ * and checks every timer expires on the tick it is due. Without restarts the sum over the
+ * expiries of (timer, tick) is the same for both stores; with them the list may count a
+ * few less, its walk steps over the timers due after a periodic one put back, and a stop
+ * coming in the same tick drops them.
+ */
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "k_api.h"
+
+#ifndef BENCH_MODE
+#define BENCH_MODE "list"
+#endif
+
+#define IDLE_TICKS 5000u
+
+/* the globals of k_obj.c the timer task uses */
+klist_t          g_timer_head;
+tick_t           g_timer_count;
+ktask_t          g_timer_task;
+cpu_stack_t      g_timer_task_stack[RHINO_CONFIG_TIMER_TASK_STACK_SIZE];
+kbuf_queue_t     g_timer_queue;
+k_timer_queue_cb timer_queue_cb[RHINO_CONFIG_TIMER_MSG_NUM];
+#if (RHINO_CONFIG_TIMER_WHEEL > 0)
+ktimer_wheel_t   g_timer_wheel;
+#endif
+
+static task_entry_t      timer_entry;
+static jmp_buf           sim_done;
+static tick_t            sim_now;
+static tick_t            sim_next;      /* next tick of the scenario */
+static tick_t            sim_last;      /* last tick of the scenario */
+static tick_t            sim_end;
+static k_timer_queue_cb *msgs;
+static size_t            msg_head, msg_tail, msg_size;
+
+static ktimer_t         *timers;
+static uint32_t          timer_num, restarts;
+static unsigned long     commands, expiries, late;
+static uint64_t          sum;
+static long long         scenario_ns;
+
+static long long cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static uint32_t rand_state = 1;
+
+static uint32_t bench_rand(void)
+{
+    rand_state = rand_state * 1103515245u + 12345u;
+    return rand_state >> 8;
+}
+
+tick_t krhino_sys_tick_get(void)
+{
+    return sim_now;
+}
+
+void k_err_proc_debug(kstat_t err, char *file, int line)
+{
+    printf("kernel error %d at %s:%d\n", err, file, line);
+    abort();
+}
+
+kstat_t krhino_task_create(ktask_t *task, const name_t *name, void *arg,
+                           uint8_t prio, tick_t ticks, cpu_stack_t *stack_buf,
+                           size_t stack_size, task_entry_t entry, uint8_t autorun)
+{
+    timer_entry = entry;
+    return RHINO_SUCCESS;
+}
+
+kstat_t krhino_fix_buf_queue_create(kbuf_queue_t *queue, const name_t *name,
+                                    void *buf, size_t msg_size, size_t msg_num)
+{
+    return RHINO_SUCCESS;
+}
+
+/* unbounded, the scenario sends a burst of commands at once */
+kstat_t krhino_buf_queue_send(kbuf_queue_t *queue, void *msg, size_t size)
+{
+    if (msg_tail == msg_size) {
+        msg_size = msg_size ? msg_size * 2 : 1024;
+        msgs     = realloc(msgs, msg_size * sizeof(k_timer_queue_cb));
+    }
+    msgs[msg_tail++] = *(k_timer_queue_cb *)msg;
+    commands++;
+
+    return RHINO_SUCCESS;
+}
+
+static void scenario_tick(void)
+{
+    long long t0 = cpu_ns();
+    uint32_t  i;
+
+    if (msg_head == msg_tail) {
+        msg_head = msg_tail = 0;
+    }
+
+    for (i = 0; i < restarts; i++) {
+        ktimer_t *timer = &timers[bench_rand() % timer_num];
+        krhino_timer_stop(timer);
+        krhino_timer_start(timer);
+    }
+
+    scenario_ns += cpu_ns() - t0;
+}
+
+kstat_t krhino_buf_queue_recv(kbuf_queue_t *queue, tick_t ticks, void *msg, size_t *size)
+{
+    tick_t wake = ticks > sim_end - sim_now ? sim_end : sim_now + ticks;
+
+    while (msg_head == msg_tail) {
+        if (sim_next <= sim_last && sim_next <= wake) {
+            sim_now = sim_next++;
+            scenario_tick();
+            continue;
+        }
+        if (wake >= sim_end) {
+            longjmp(sim_done, 1);
+        }
+        sim_now = wake;
+        return RHINO_BLK_TIMEOUT;
+    }
+
+    *(k_timer_queue_cb *)msg = msgs[msg_head++];
+    *size = sizeof(k_timer_queue_cb);
+
+    return RHINO_SUCCESS;
+}
+
+static void on_timer(void *arg, void *id)
+{
+    ktimer_t *timer = (ktimer_t *)arg;
+
+    /* match is the tick the timer was started for */
+    if (sim_now != timer->match) {
+        late++;
+    }
+    expiries++;
+    sum += ((uint64_t)(uintptr_t)id * 2654435761u) ^ sim_now;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t  ticks = argc > 2 ? atoi(argv[2]) : 20000;
+    tick_t    start;
+    long long t0, busy;
+    uint32_t  i;
+
+    timer_num = argc > 1 ? atoi(argv[1]) : 2000;
+    restarts  = argc > 3 ? atoi(argv[3]) : timer_num / 100;
+    timers    = calloc(timer_num, sizeof(ktimer_t));
+    if (timer_num == 0 || ticks == 0 || timers == NULL) {
+        fprintf(stderr, "usage: %s [timers] [ticks] [restarts]\n", argv[0]);
+        return 1;
+    }
+
+    /* the top level of the wheel wraps 2^24 ticks from zero */
+    start    = ((tick_t)1 << 24) - ticks / 2;
+    sim_now  = start;
+    sim_next = start + 1;
+    sim_last = start + ticks;
+    sim_end  = sim_last + IDLE_TICKS;
+
+    ktimer_init();
+    for (i = 0; i < timer_num; i++) {
+        tick_t first = 1 + bench_rand() % 4000;
+        krhino_timer_create(&timers[i], "bench", on_timer, first, (i & 1) ? first : 0,
+                            (void *)(uintptr_t)i, 0);
+        krhino_timer_start(&timers[i]);
+    }
+
+    t0 = cpu_ns();
+    if (setjmp(sim_done) == 0) {
+        timer_entry(NULL);
+    }
+    busy = cpu_ns() - t0 - scenario_ns;
+
+    printf("%-6s timers %6u  restarts/tick %4u  task %8.1f ns/tick  %6.1f ns/event  "
+           "commands %8lu  expiries %8lu  sum %016llx  %s\n",
+           BENCH_MODE, timer_num, restarts, (double)busy / (ticks + IDLE_TICKS),
+           (double)busy / (commands + expiries), commands, expiries, (unsigned long long)sum,
+           late ? "LATE" : "ok");
+
+    free(timers);
+    free(msgs);
+
+    return late ? 1 : 0;
+}
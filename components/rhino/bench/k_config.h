@@ -0,0 +1,11 @@
+/*
+ * Copyright (C) 2015-2017 Alibaba Group Holding Limited
+ */
+
+/* the kernel configuration of the host build of k_timer.c, the rest comes from k_default_config.h */
+#ifndef K_CONFIG_H
+#define K_CONFIG_H
+
+#define RHINO_CONFIG_MM_TLF_BLK_SIZE    32
+
+#endif /* K_CONFIG_H */
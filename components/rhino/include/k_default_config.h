@@ -60,6 +60,11 @@
 #define RHINO_CONFIG_TIMER_MSG_NUM           20
 #endif
 
+/* O(1) timer start/stop on a timer wheel instead of a sorted list */
+#ifndef RHINO_CONFIG_TIMER_WHEEL
+#define RHINO_CONFIG_TIMER_WHEEL             0
+#endif
+
 #endif /* RHINO_CONFIG_TIMER */
 
 #ifndef RHINO_CONFIG_WORKQUEUE
@@ -55,6 +55,9 @@ extern ktask_t          g_timer_task;
 extern cpu_stack_t      g_timer_task_stack[RHINO_CONFIG_TIMER_TASK_STACK_SIZE];
 extern kbuf_queue_t     g_timer_queue;
 extern k_timer_queue_cb timer_queue_cb[RHINO_CONFIG_TIMER_MSG_NUM];
+#if (RHINO_CONFIG_TIMER_WHEEL > 0)
+extern ktimer_wheel_t   g_timer_wheel;
+#endif
 #endif
 
 #if (RHINO_CONFIG_SYS_STATS > 0)
@@ -40,10 +40,11 @@ typedef void (*timer_cb_t)(void *timer, void *arg);
 typedef struct {
     /**<
      *  When the timer is active, timer_list is linked from g_timer_head,
-     *  and sort by 'match'(timeout time).
+     *  and sort by 'match'(timeout time), or from the slot of the timer
+     *  wheel its 'match' falls in when RHINO_CONFIG_TIMER_WHEEL is enabled.
      */
     klist_t       timer_list;
-    klist_t      *to_head;
+    klist_t      *to_head;      /**< list the timer is linked in, NULL if none */
     const name_t *name;
     timer_cb_t    cb;
     void         *timer_cb_arg;
@@ -76,6 +77,26 @@ typedef enum {
     TIMER_ACTIVE
 } k_timer_state_t;
 
+#if (RHINO_CONFIG_TIMER_WHEEL > 0)
+#define TIMER_WHEEL_LEVELS  4u
+#define TIMER_WHEEL_BITS    6u
+#define TIMER_WHEEL_SLOTS   (1u << TIMER_WHEEL_BITS)
+
+/**
+ * Hierarchical timer wheel. Slot i of level n holds the timers whose 'match'
+ * has i in bits [6n, 6n + 6) and equals 'base' above them; when 'base' gets
+ * to the start of a slot above level 0 its timers are moved down a level,
+ * the timers of a level 0 slot expire when 'base' gets to it.
+ */
+typedef struct {
+    klist_t  slot[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint32_t map[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS / 32]; /**< non empty slots */
+    klist_t  overflow;      /**< timers beyond the reach of the top level */
+    tick_t   base;          /**< next tick to expire, all before it are done */
+    uint32_t count;         /**< timers in the wheel */
+} ktimer_wheel_t;
+#endif
+
 /**
  * Create a timer.
  *
@@ -43,6 +43,9 @@ ktask_t          g_timer_task;
 cpu_stack_t      g_timer_task_stack[RHINO_CONFIG_TIMER_TASK_STACK_SIZE];
 kbuf_queue_t     g_timer_queue;
 k_timer_queue_cb timer_queue_cb[RHINO_CONFIG_TIMER_MSG_NUM];
+#if (RHINO_CONFIG_TIMER_WHEEL > 0)
+ktimer_wheel_t   g_timer_wheel;
+#endif
 #endif
 
 #if (RHINO_CONFIG_SYS_STATS > 0)
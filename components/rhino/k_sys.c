@@ -320,6 +320,9 @@ size_t krhino_global_space_get(void)
     mem += sizeof(g_timer_head) + sizeof(g_timer_count)
            + sizeof(g_timer_task) + sizeof(g_timer_task_stack)
            + sizeof(g_timer_queue) + sizeof(timer_queue_cb);
+#if (RHINO_CONFIG_TIMER_WHEEL > 0)
+    mem += sizeof(g_timer_wheel);
+#endif
 #endif
 
 #if (RHINO_CONFIG_KOBJ_LIST > 0)
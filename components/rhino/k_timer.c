@@ -5,6 +5,61 @@
 #include "k_api.h"
 
 #if (RHINO_CONFIG_TIMER > 0)
+#if (RHINO_CONFIG_TIMER_WHEEL > 0)
+#define WHEEL_MASK        (TIMER_WHEEL_SLOTS - 1u)
+#define WHEEL_SHIFT(lvl)  ((lvl) * TIMER_WHEEL_BITS)
+/* ticks reached by the wheel are those with the bits above it equal to base */
+#define WHEEL_SPAN        WHEEL_SHIFT(TIMER_WHEEL_LEVELS)
+
+/* first non empty slot of the level at or after 'from', TIMER_WHEEL_SLOTS if none */
+static uint32_t timer_wheel_first(uint32_t level, uint32_t from)
+{
+    uint32_t *map = &g_timer_wheel.map[level * TIMER_WHEEL_SLOTS / 32];
+    uint32_t  bits;
+
+    for (; from < TIMER_WHEEL_SLOTS; from = (from | 31u) + 1u) {
+        bits = map[from >> 5] & (0xFFFFFFFFu << (from & 31u));
+        if (bits != 0u) {
+            return (from & ~31u) + krhino_ctz32(bits);
+        }
+    }
+
+    return TIMER_WHEEL_SLOTS;
+}
+
+static void timer_wheel_insert(ktimer_t *timer)
+{
+    ktimer_wheel_t *wheel = &g_timer_wheel;
+    tick_t          match;
+    tick_t          diff;
+    uint32_t        level = 0u;
+    uint32_t        idx;
+    klist_t        *head;
+
+    match = timer->match;
+    if ((tick_i_t)(match - wheel->base) < 0) {
+        /* already due, expire with the next tick */
+        match = wheel->base;
+    }
+
+    /* the level is that of the highest bits where match and base differ */
+    diff = match ^ wheel->base;
+    if ((diff >> WHEEL_SPAN) != 0u) {
+        head = &wheel->overflow;
+    } else {
+        while ((diff >> WHEEL_SHIFT(level + 1u)) != 0u) {
+            level++;
+        }
+        idx  = level * TIMER_WHEEL_SLOTS + (uint32_t)((match >> WHEEL_SHIFT(level)) & WHEEL_MASK);
+        head = &wheel->slot[0][0] + idx;
+        wheel->map[idx >> 5] |= 1u << (idx & 31u);
+    }
+
+    timer->to_head = head;
+    klist_insert(head, &timer->timer_list);
+    wheel->count++;
+}
+#else
 static void timer_list_pri_insert(klist_t *head, ktimer_t *timer)
 {
     tick_t    val;
@@ -27,6 +82,22 @@ static void timer_list_pri_insert(klist_t *head, ktimer_t *timer)
 
     klist_insert(q, &timer->timer_list);
 }
+#endif
+
+static void timer_insert(ktimer_t *timer)
+{
+#if (RHINO_CONFIG_TIMER_WHEEL > 0)
+    if (g_timer_wheel.count == 0u) {
+        /* base stood still while the wheel was empty, start it from now */
+        g_timer_wheel.base = g_timer_count;
+    }
+    timer_wheel_insert(timer);
+#else
+    /* used by timer delete */
+    timer->to_head = &g_timer_head;
+    timer_list_pri_insert(&g_timer_head, timer);
+#endif
+}
 
 static void timer_list_rm(ktimer_t *timer)
 {
@@ -36,7 +107,145 @@ static void timer_list_rm(ktimer_t *timer)
     if (head != NULL) {
         klist_rm(&timer->timer_list);
         timer->to_head = NULL;
+#if (RHINO_CONFIG_TIMER_WHEEL > 0)
+        g_timer_wheel.count--;
+        if (head != &g_timer_wheel.overflow && is_klist_empty(head)) {
+            uint32_t idx = (uint32_t)(head - &g_timer_wheel.slot[0][0]);
+            g_timer_wheel.map[idx >> 5] &= ~(1u << (idx & 31u));
+        }
+#endif
+    }
+}
+
+#if (RHINO_CONFIG_TIMER_WHEEL > 0)
+/* move the timers of a list to a local one, they are handled from there */
+static void timer_wheel_take(klist_t *head, klist_t *list)
+{
+    klist_init(list);
+    if (!is_klist_empty(head)) {
+        list->next       = head->next;
+        list->prev       = head->prev;
+        list->next->prev = list;
+        list->prev->next = list;
+        klist_init(head);
+    }
+}
+
+/* put the timers of a slot again, base is at its start now so they go lower */
+static void timer_wheel_cascade(klist_t *head)
+{
+    klist_t   list;
+    ktimer_t *timer;
+
+    timer_wheel_take(head, &list);
+    while (!is_klist_empty(&list)) {
+        timer = krhino_list_entry(list.next, ktimer_t, timer_list);
+        timer_list_rm(timer);
+        timer_wheel_insert(timer);
+    }
+}
+
+/* the next tick with work for the wheel, a slot to expire or to cascade */
+static uint8_t timer_wheel_next(tick_t *next)
+{
+    ktimer_wheel_t *wheel = &g_timer_wheel;
+    uint32_t        level;
+    uint32_t        idx;
+    tick_t          cur;
+
+    if (wheel->count == 0u) {
+        return RHINO_FALSE;
+    }
+
+    /*
+     * base may have been moved to the start of a slot without a step there, the
+     * cascade of the slot is then still to do and comes before anything else
+     */
+    if ((wheel->base & (((tick_t)1u << WHEEL_SPAN) - 1u)) == 0u &&
+        !is_klist_empty(&wheel->overflow)) {
+        *next = wheel->base;
+        return RHINO_TRUE;
+    }
+
+    for (level = 1u; level < TIMER_WHEEL_LEVELS; level++) {
+        if ((wheel->base & (((tick_t)1u << WHEEL_SHIFT(level)) - 1u)) != 0u) {
+            break;
+        }
+        idx = (uint32_t)((wheel->base >> WHEEL_SHIFT(level)) & WHEEL_MASK);
+        if (!is_klist_empty(&wheel->slot[level][idx])) {
+            *next = wheel->base;
+            return RHINO_TRUE;
+        }
     }
+
+    for (level = 0u; level < TIMER_WHEEL_LEVELS; level++) {
+        cur = wheel->base >> WHEEL_SHIFT(level);
+        /* above level 0 the current slot was cascaded when base got to it */
+        idx = timer_wheel_first(level, (uint32_t)(cur & WHEEL_MASK) + (level > 0u ? 1u : 0u));
+        if (idx < TIMER_WHEEL_SLOTS) {
+            *next = ((cur & ~(tick_t)WHEEL_MASK) | idx) << WHEEL_SHIFT(level);
+            return RHINO_TRUE;
+        }
+    }
+
+    /* only overflow timers left, they are put in when base crosses the span */
+    *next = ((wheel->base >> WHEEL_SPAN) + 1u) << WHEEL_SPAN;
+
+    return RHINO_TRUE;
+}
+
+/* the work of one tick: cascade the slots starting there, expire the level 0 one */
+static void timer_wheel_step(void)
+{
+    ktimer_wheel_t *wheel = &g_timer_wheel;
+    tick_t          base  = wheel->base;
+    uint32_t        level;
+    klist_t         list;
+    ktimer_t       *timer;
+
+    if ((base & (((tick_t)1u << WHEEL_SPAN) - 1u)) == 0u) {
+        timer_wheel_cascade(&wheel->overflow);
+    }
+
+    for (level = TIMER_WHEEL_LEVELS - 1u; level > 0u; level--) {
+        if ((base & (((tick_t)1u << WHEEL_SHIFT(level)) - 1u)) == 0u) {
+            timer_wheel_cascade(&wheel->slot[level][(base >> WHEEL_SHIFT(level)) & WHEEL_MASK]);
+        }
+    }
+
+    /* timers started again by the callbacks are put after this tick */
+    timer_wheel_take(&wheel->slot[0][base & WHEEL_MASK], &list);
+    wheel->base = base + 1u;
+
+    while (!is_klist_empty(&list)) {
+        timer = krhino_list_entry(list.next, ktimer_t, timer_list);
+        timer_list_rm(timer);
+        timer->cb(timer, timer->timer_cb_arg);
+
+        if (timer->round_ticks > 0u) {
+            timer->remain = timer->round_ticks;
+            timer->match  = g_timer_count + timer->remain;
+            timer_wheel_insert(timer);
+        } else {
+            timer->timer_state = TIMER_DEACTIVE;
+        }
+    }
+}
+#endif
+
+static uint8_t timer_next(tick_t *match)
+{
+#if (RHINO_CONFIG_TIMER_WHEEL > 0)
+    return timer_wheel_next(match);
+#else
+    if (is_klist_empty(&g_timer_head)) {
+        return RHINO_FALSE;
+    }
+
+    *match = krhino_list_entry(g_timer_head.next, ktimer_t, timer_list)->match;
+
+    return RHINO_TRUE;
+#endif
 }
 
 static kstat_t timer_create(ktimer_t *timer, const name_t *name, timer_cb_t cb, tick_t first,
@@ -216,6 +425,22 @@ kstat_t krhino_timer_arg_change_auto(ktimer_t *timer, void *arg)
     return krhino_buf_queue_send(&g_timer_queue, &cb, sizeof(k_timer_queue_cb));
 }
 
+#if (RHINO_CONFIG_TIMER_WHEEL > 0)
+static void timer_cb_proc(void)
+{
+    tick_t next;
+
+    /* skip the ticks without work, there is nothing to do at them */
+    while (timer_wheel_next(&next) && (tick_i_t)(next - g_timer_count) <= 0) {
+        g_timer_wheel.base = next;
+        timer_wheel_step();
+    }
+
+    if ((tick_i_t)(g_timer_count - g_timer_wheel.base) >= 0) {
+        g_timer_wheel.base = g_timer_count + 1u;
+    }
+}
+#else
 static void timer_cb_proc(void)
 {
     klist_t  *q;
@@ -238,8 +463,7 @@ static void timer_cb_proc(void)
             if (timer->round_ticks > 0u) {
                 timer->remain  =  timer->round_ticks;
                 timer->match   =  g_timer_count + timer->remain;
-                timer->to_head = &g_timer_head;
-                timer_list_pri_insert(&g_timer_head, timer);
+                timer_insert(timer);
             } else {
                 timer->timer_state = TIMER_DEACTIVE;
             }
@@ -248,6 +472,7 @@ static void timer_cb_proc(void)
         }
     }
 }
+#endif
 
 static void cmd_proc(k_timer_queue_cb *cb, uint8_t cmd)
 {
@@ -266,9 +491,7 @@ static void cmd_proc(k_timer_queue_cb *cb, uint8_t cmd)
             timer->match   =  g_timer_count + timer->init_count;
             /* sort by remain time */
             timer->remain  =  timer->init_count;
-            /* used by timer delete */
-            timer->to_head = &g_timer_head;
-            timer_list_pri_insert(&g_timer_head, timer);
+            timer_insert(timer);
             timer->timer_state = TIMER_ACTIVE;
             break;
         case TIMER_CMD_STOP:
@@ -345,9 +568,9 @@ static void timer_cmd_proc(k_timer_queue_cb *cb)
 
 static void timer_task(void *pa)
 {
-    ktimer_t         *timer;
     k_timer_queue_cb  cb_msg;
     kstat_t           err;
+    tick_t            match;
     tick_t            tick_start;
     tick_t            tick_end;
     tick_i_t          delta;
@@ -367,10 +590,9 @@ static void timer_task(void *pa)
 
         timer_cmd_proc(&cb_msg);
 
-        while (!is_klist_empty(&g_timer_head)) {
-            timer = krhino_list_entry(g_timer_head.next, ktimer_t, timer_list);
+        while (timer_next(&match)) {
             tick_start = krhino_sys_tick_get();
-            delta = (tick_i_t)timer->match - (tick_i_t)tick_start;
+            delta = (tick_i_t)match - (tick_i_t)tick_start;
             if (delta > 0) {
                 err = krhino_buf_queue_recv(&g_timer_queue, (tick_t)delta, &cb_msg, &msg_size);
                 tick_end = krhino_sys_tick_get();
@@ -394,6 +616,12 @@ static void timer_task(void *pa)
 void ktimer_init(void)
 {
     klist_init(&g_timer_head);
+#if (RHINO_CONFIG_TIMER_WHEEL > 0)
+    for (uint32_t i = 0u; i < TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS; i++) {
+        klist_init(&g_timer_wheel.slot[0][0] + i);
+    }
+    klist_init(&g_timer_wheel.overflow);
+#endif
 
     krhino_fix_buf_queue_create(&g_timer_queue, "timer_queue", timer_queue_cb,
                                 sizeof(k_timer_queue_cb), RHINO_CONFIG_TIMER_MSG_NUM);
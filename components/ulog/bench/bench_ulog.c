@@ -0,0 +1,395 @@
+/*
+ * Copyright (C) 2015-2019 Alibaba Group Holding Limited
+ */
+
+/*
+ * Log throughput with several tasks logging at once, on Linux threads. Built once per
+ * implementation (see CMakeLists.txt):
+ *   linux:  ulog_linux.c, printf of every line in the calling task
+ *   legacy: the async path as it was, a line formatted into a static buffer under the log
+ *           mutex, an aos_queue of text with the "<pri>" prefix, the log task taking one
+ *           line per wakeup, parsing the prefix back and puts() under the log mutex again
+ *   async:  ulog.c / ulog_async.c / ulog_ring_fifo.c of this component, default direction
+ *           in async mode
+ * Lines go to stdout, unbuffered, the results to stderr: run with stdout sent to a file.
+ * Each task logs its lines flat out, or in bursts with a 1 ms sleep in between. Reports the
+ * cpu time a call to ulog() costs the logging task, the cpu time of the log task per line
+ * written, the lines written and dropped on a full fifo, and the time until all are handled.
+ * Times are cpu times, so the numbers hold on a machine with fewer cores than tasks.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ulog/ulog.h>
+
+#ifndef BENCH_MODE
+#define BENCH_MODE "linux"
+#endif
+
+static long long clock_us(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static long long now_us(void)
+{
+    return clock_us(CLOCK_MONOTONIC);
+}
+
+/* the log task, 0 for the linux build that has none */
+static pthread_t log_task;
+
+#if defined(BENCH_ASYNC) || defined(BENCH_LEGACY)
+#include "aos/kernel.h"
+
+/* the aos symbols the async path needs, on pthreads */
+static __thread char task_name[16] = "main";
+
+long long aos_now_ms(void)
+{
+    return now_us() / 1000;
+}
+
+const char *aos_task_name(void)
+{
+    return task_name;
+}
+
+void *aos_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void *aos_zalloc(size_t size)
+{
+    return calloc(1, size);
+}
+
+void aos_free(void *mem)
+{
+    free(mem);
+}
+
+int aos_mutex_new(aos_mutex_t *mutex)
+{
+    pthread_mutex_t *m = malloc(sizeof(pthread_mutex_t));
+    pthread_mutex_init(m, NULL);
+    *mutex = m;
+    return 0;
+}
+
+int aos_mutex_lock(aos_mutex_t *mutex, unsigned int timeout)
+{
+    return pthread_mutex_lock(*mutex);
+}
+
+int aos_mutex_unlock(aos_mutex_t *mutex)
+{
+    return pthread_mutex_unlock(*mutex);
+}
+
+int aos_sem_new(aos_sem_t *sem, int count)
+{
+    sem_t *s = malloc(sizeof(sem_t));
+    sem_init(s, 0, count);
+    *sem = s;
+    return 0;
+}
+
+int aos_sem_wait(aos_sem_t *sem, unsigned int timeout)
+{
+    struct timespec ts;
+    if (timeout == AOS_WAIT_FOREVER) {
+        while (sem_wait(*sem) != 0 && errno == EINTR) {
+        }
+        return 0;
+    }
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout / 1000;
+    ts.tv_nsec += (timeout % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return sem_timedwait(*sem, &ts);
+}
+
+void aos_sem_signal(aos_sem_t *sem)
+{
+    sem_post(*sem);
+}
+
+typedef struct {
+    void (*fn)(void *);
+    void *arg;
+    const char *name;
+} task_start_t;
+
+static void *task_entry(void *p)
+{
+    task_start_t start = *(task_start_t *)p;
+    free(p);
+    snprintf(task_name, sizeof(task_name), "%s", start.name);
+    start.fn(start.arg);
+    return NULL;
+}
+
+int aos_task_new_ext(aos_task_t *task, const char *name, void (*fn)(void *), void *arg,
+                     int stack_size, int prio)
+{
+    pthread_t tid;
+    task_start_t *start = malloc(sizeof(task_start_t));
+    start->fn   = fn;
+    start->arg  = arg;
+    start->name = name;
+    pthread_create(&tid, NULL, task_entry, start);
+    pthread_detach(tid);
+    log_task = tid;
+    return 0;
+}
+#endif
+
+#ifdef BENCH_ASYNC
+#include "ulog_api.h"
+#include "ulog_ring_fifo.h"
+
+/* lines handled: written or dropped by the session, or dropped on push */
+static uint32_t lines_done(uint32_t *written, uint32_t *dropped)
+{
+    uring_fifo_stat_t fifo;
+    ulog_session_stat_t stat[ulog_session_size];
+    uring_fifo_stat(&fifo);
+    ulog_async_stat(stat);
+    *written = stat[ulog_session_std].written;
+    *dropped = fifo.dropped + stat[ulog_session_std].dropped;
+    return *written + *dropped;
+}
+#endif
+
+#ifdef BENCH_LEGACY
+/* ulog_ring_fifo.c: aos_queue of variable size messages, a length ahead of each */
+#define ULOG_SIZE              256
+#define DEFAULT_ASYNC_BUF_SIZE 6144
+#define LOG_PREFIX_LEN         5
+#define FACILITY_NORMAL_LOG    248
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    uint8_t         buf[DEFAULT_ASYNC_BUF_SIZE];
+    uint32_t        head, tail, used, count;
+} legacy_queue = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char            ulog_buf[ULOG_SIZE];
+static uint32_t        legacy_written, legacy_dropped;
+static uint8_t         stop_filter_std = LOG_NONE;
+
+static void queue_copy_in(const void *data, uint32_t len)
+{
+    uint32_t first = DEFAULT_ASYNC_BUF_SIZE - legacy_queue.tail;
+    first = first < len ? first : len;
+    memcpy(&legacy_queue.buf[legacy_queue.tail], data, first);
+    memcpy(legacy_queue.buf, (const uint8_t *)data + first, len - first);
+    legacy_queue.tail = (legacy_queue.tail + len) % DEFAULT_ASYNC_BUF_SIZE;
+}
+
+static void queue_copy_out(void *data, uint32_t len)
+{
+    uint32_t first = DEFAULT_ASYNC_BUF_SIZE - legacy_queue.head;
+    first = first < len ? first : len;
+    memcpy(data, &legacy_queue.buf[legacy_queue.head], first);
+    memcpy((uint8_t *)data + first, legacy_queue.buf, len - first);
+    legacy_queue.head = (legacy_queue.head + len) % DEFAULT_ASYNC_BUF_SIZE;
+}
+
+/* aos_queue_send: never waits, fails when full */
+static int uring_fifo_push_s(const void *buf, const uint16_t len)
+{
+    int rc = -1;
+    pthread_mutex_lock(&legacy_queue.lock);
+    if (legacy_queue.used + len + sizeof(uint16_t) <= DEFAULT_ASYNC_BUF_SIZE) {
+        queue_copy_in(&len, sizeof(len));
+        queue_copy_in(buf, len);
+        legacy_queue.used += len + sizeof(uint16_t);
+        legacy_queue.count++;
+        pthread_cond_signal(&legacy_queue.cond);
+        rc = 0;
+    }
+    pthread_mutex_unlock(&legacy_queue.lock);
+    return rc;
+}
+
+static void ulog_handler_normal(void *para, void *log_text, const uint16_t log_len)
+{
+    char *str = (char *)log_text;
+    char *text_info = NULL;
+    if ((str[0] == '<') && ((text_info = strchr(str, '>')) != NULL)) {
+        const uint32_t pri = strtoul(&str[1], NULL, 10);
+        const uint8_t severity = (pri & 0x7);
+        if (stop_filter_std > severity) {
+            pthread_mutex_lock(&log_mutex);
+            puts(&((char *)log_text)[LOG_PREFIX_LEN]);
+            pthread_mutex_unlock(&log_mutex);
+        }
+    }
+    __atomic_add_fetch(&legacy_written, 1, __ATOMIC_RELEASE);
+}
+
+static void log_routine(void *para)
+{
+    char tmp_buf[ULOG_SIZE];
+    uint16_t len;
+    while (1) {
+        pthread_mutex_lock(&legacy_queue.lock);
+        while (legacy_queue.count == 0) {
+            pthread_cond_wait(&legacy_queue.cond, &legacy_queue.lock);
+        }
+        queue_copy_out(&len, sizeof(len));
+        queue_copy_out(tmp_buf, len);
+        legacy_queue.used -= len + sizeof(uint16_t);
+        legacy_queue.count--;
+        pthread_mutex_unlock(&legacy_queue.lock);
+        ulog_handler_normal(NULL, tmp_buf, len);
+    }
+}
+
+static char serverity_name[LOG_NONE] = {'V', 'A', 'F', 'E', 'W', 'T', 'I', 'D'};
+
+int ulog(const unsigned char s, const char *mod, const char *f, const unsigned long l,
+         const char *fmt, ...)
+{
+    int rc = -1;
+    char log_time[24];
+    long long ms = aos_now_ms();
+    pthread_mutex_lock(&log_mutex);
+    snprintf(log_time, sizeof(log_time), "%4d.%03d", (int)(ms / 1000), (int)(ms % 1000));
+    snprintf(ulog_buf, 6, "<%03hhu>", s + (FACILITY_NORMAL_LOG & 0xF8));
+    snprintf(&ulog_buf[5], ULOG_SIZE - 5, "[%s]<%c>[%s]<%s>", log_time, serverity_name[s], mod,
+             aos_task_name());
+    va_list args;
+    va_start(args, fmt);
+    rc = vsnprintf(&ulog_buf[strlen(ulog_buf)], ULOG_SIZE - strlen(ulog_buf), fmt, args);
+    va_end(args);
+    if (0 != uring_fifo_push_s(ulog_buf, strlen(ulog_buf) + 1)) {
+        __atomic_add_fetch(&legacy_dropped, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&log_mutex);
+    return rc;
+}
+
+void ulog_init(void)
+{
+    aos_task_t task;
+    aos_task_new_ext(&task, "ulog", log_routine, NULL, 3072, AOS_MAX_APP_PRI);
+}
+
+static uint32_t lines_done(uint32_t *written, uint32_t *dropped)
+{
+    *written = __atomic_load_n(&legacy_written, __ATOMIC_ACQUIRE);
+    *dropped = __atomic_load_n(&legacy_dropped, __ATOMIC_ACQUIRE);
+    return *written + *dropped;
+}
+#endif
+
+typedef struct {
+    int       id;
+    int       lines;
+    int       burst;
+    long long cpu_us;
+} producer_t;
+
+static pthread_barrier_t start_barrier;
+
+static void *producer(void *p)
+{
+    producer_t *prod = (producer_t *)p;
+    const struct timespec pause = {0, 1000000};
+    long long t0;
+    int i;
+
+#if defined(BENCH_ASYNC) || defined(BENCH_LEGACY)
+    snprintf(task_name, sizeof(task_name), "cam%d", prod->id);
+#endif
+    pthread_barrier_wait(&start_barrier);
+    prod->cpu_us = 0;
+    for (i = 0; i < prod->lines; i++) {
+        if (prod->burst && i && i % prod->burst == 0) {
+            nanosleep(&pause, NULL);
+        }
+        t0 = clock_us(CLOCK_THREAD_CPUTIME_ID);
+        ulog(LOG_INFO, "bench", ULOG_TAG, "frame %d of stream %d, %d boxes, score %d.%02d",
+             i, prod->id, i % 7, 90 - i % 40, i % 100);
+        prod->cpu_us += clock_us(CLOCK_THREAD_CPUTIME_ID) - t0;
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    const int tasks = argc > 1 ? atoi(argv[1]) : 4;
+    const int lines = argc > 2 ? atoi(argv[2]) : 20000;
+    const int burst = argc > 3 ? atoi(argv[3]) : 0;
+    pthread_t tid[64];
+    producer_t prod[64];
+    long long t0, t_done, call_us = 0, task_us = 0;
+    uint32_t written = tasks * lines, dropped = 0;
+    int i;
+
+    if (tasks < 1 || tasks > 64 || lines < 1 || burst < 0) {
+        fprintf(stderr, "usage: %s [tasks 1~64] [lines per task] [burst, 0 for no pause]\n",
+                argv[0]);
+        return 1;
+    }
+
+    /* unbuffered as a uart console is, every write reaches the device */
+    setvbuf(stdout, NULL, _IONBF, 0);
+    ulog_init();
+#ifdef BENCH_ASYNC
+    aos_set_log_level(AOS_LL_DEBUG);
+#endif
+
+    pthread_barrier_init(&start_barrier, NULL, tasks + 1);
+    for (i = 0; i < tasks; i++) {
+        prod[i].id    = i;
+        prod[i].lines = lines;
+        prod[i].burst = burst;
+        pthread_create(&tid[i], NULL, producer, &prod[i]);
+    }
+    pthread_barrier_wait(&start_barrier);
+    t0 = now_us();
+    for (i = 0; i < tasks; i++) {
+        pthread_join(tid[i], NULL);
+        call_us += prod[i].cpu_us;
+    }
+
+#if defined(BENCH_ASYNC) || defined(BENCH_LEGACY)
+    while (lines_done(&written, &dropped) < (uint32_t)(tasks * lines)) {
+        struct timespec ts = {0, 100000};
+        nanosleep(&ts, NULL);
+    }
+#endif
+    t_done = now_us() - t0;
+    fflush(stdout);
+    if (log_task) {
+        clockid_t clock;
+        pthread_getcpuclockid(log_task, &clock);
+        task_us = clock_us(clock);
+    }
+
+    fprintf(stderr,
+            "%-6s %2d tasks x %5d lines, burst %3d | ulog() %5.2f us cpu/call | "
+            "log task %5.2f us cpu/line | written %6u dropped %6u | %7.1f ms\n",
+            BENCH_MODE, tasks, lines, burst, (double)call_us / tasks / lines,
+            written ? (double)task_us / written : 0.0, written, dropped, t_done / 1000.0);
+    return 0;
+}
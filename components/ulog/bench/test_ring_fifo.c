@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2015-2019 Alibaba Group Holding Limited
+ */
+
+/*
+ * Host check of ulog_ring_fifo.c, single threaded: rounds that push until the fifo is
+ * full, then peek and release all of it, with a reserved line committed short in
+ * between, and pairs of lines reserved at once and committed in either order, which
+ * must come out in reserve order. Exits with 1 on the first mismatch.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aos/kernel.h"
+#include "ulog_ring_fifo.h"
+
+#define MAX_RECS 256
+
+/* the aos symbols the fifo needs, the log task never waits here */
+void *aos_zalloc(size_t size)
+{
+    return calloc(1, size);
+}
+
+void aos_free(void *mem)
+{
+    free(mem);
+}
+
+int aos_sem_new(aos_sem_t *sem, int count)
+{
+    return 0;
+}
+
+int aos_sem_wait(aos_sem_t *sem, unsigned int timeout)
+{
+    return -1;
+}
+
+void aos_sem_signal(aos_sem_t *sem)
+{
+}
+
+long long aos_now_ms(void)
+{
+    return 0;
+}
+
+static const ulog_rec_t *recs[MAX_RECS];
+
+static int full_rounds(void)
+{
+    char text[48];
+    int round, i, n;
+
+    for (round = 0; round < 50; round++) {
+        for (i = 0; i < MAX_RECS; i++) {
+            snprintf(text, sizeof(text), "round %d, record %d of a full fifo", round, i);
+            if (uring_fifo_push(ulog_rec_log, 0, 0, text, strlen(text)) != 0) {
+                break;
+            }
+        }
+        if (i == 0 || i == MAX_RECS) {
+            printf("round %d: %d records fit, the fifo never filled\n", round, i);
+            return -1;
+        }
+        n = uring_fifo_peek(recs, MAX_RECS, 0);
+        if (n != i) {
+            printf("round %d: pushed %d, peeked %d\n", round, i, n);
+            return -1;
+        }
+        snprintf(text, sizeof(text), "round %d, record %d of a full fifo", round, n - 1);
+        if (strcmp(recs[n - 1]->text, text) != 0) {
+            printf("round %d: last record '%s', expected '%s'\n", round, recs[n - 1]->text, text);
+            return -1;
+        }
+        uring_fifo_release(n);
+
+        /* a full line claimed and committed short, the rest goes back */
+        uring_fifo_slot_t slot;
+        char *line = uring_fifo_reserve(&slot, 255);
+        if (line == NULL) {
+            printf("round %d: reserve failed on an empty fifo\n", round);
+            return -1;
+        }
+        strcpy(line, "short");
+        uring_fifo_commit(&slot, ulog_rec_log, 0, 0, 5);
+        n = uring_fifo_peek(recs, MAX_RECS, 0);
+        if (n != 1 || strcmp(recs[0]->text, "short") != 0) {
+            printf("round %d: %d records after the short line\n", round, n);
+            return -1;
+        }
+        uring_fifo_release(n);
+    }
+    printf("full fifo rounds: ok\n");
+    return 0;
+}
+
+static int out_of_order_commits(void)
+{
+    char expect_a[16], expect_b[16];
+    int round, n;
+
+    for (round = 0; round < 500; round++) {
+        uring_fifo_slot_t a, b;
+        char *text_a = uring_fifo_reserve(&a, 255);
+        char *text_b = uring_fifo_reserve(&b, 255);
+        if (text_a == NULL || text_b == NULL) {
+            printf("round %d: reserve failed\n", round);
+            return -1;
+        }
+        snprintf(expect_a, sizeof(expect_a), "A%d", round);
+        snprintf(expect_b, sizeof(expect_b), "B%d", round);
+        strcpy(text_a, expect_a);
+        strcpy(text_b, expect_b);
+        if (round & 1) {
+            uring_fifo_commit(&a, ulog_rec_log, 0, 0, strlen(expect_a));
+            uring_fifo_commit(&b, ulog_rec_log, 0, 0, strlen(expect_b));
+        } else {
+            uring_fifo_commit(&b, ulog_rec_log, 0, 0, strlen(expect_b));
+            uring_fifo_commit(&a, ulog_rec_log, 0, 0, strlen(expect_a));
+        }
+        n = uring_fifo_peek(recs, MAX_RECS, 0);
+        if (n != 2 || strcmp(recs[0]->text, expect_a) != 0 || strcmp(recs[1]->text, expect_b) != 0) {
+            printf("round %d: %d records, expected %s then %s\n", round, n, expect_a, expect_b);
+            return -1;
+        }
+        uring_fifo_release(n);
+    }
+    printf("out of order commits: ok\n");
+    return 0;
+}
+
+int main(void)
+{
+    if (uring_fifo_init() != 0) {
+        printf("fifo init failed\n");
+        return 1;
+    }
+    if (full_rounds() != 0 || out_of_order_commits() != 0) {
+        return 1;
+    }
+    return 0;
+}
@@ -13,6 +13,11 @@ extern "C" {
 
 extern bool log_init;
 
+typedef struct {
+    uint32_t written;   /* log lines the session took */
+    uint32_t dropped;   /* log lines the session failed on */
+} ulog_session_stat_t;
+
 bool log_get_mutex(void);
 
 void log_release_mutex(void);
@@ -34,11 +39,14 @@ bool check_pass_pop_out(const ulog_session_type_t session, const uint8_t level);
 
 void ulog_async_init();
 void ulog_async_flush();
+void ulog_async_stat(ulog_session_stat_t stat[ulog_session_size]);
 
 int32_t pop_out_on_udp(const char* data, const uint16_t len);
 
 int32_t pop_out_on_fs(const char* data, const uint16_t len);
 
+int32_t pop_out_on_fs_lines(const char* data, const uint16_t len);
+
 void on_show_ulog_file(void);
 
 void update_net_cli(const char cmd, const char* param);
@@ -51,6 +59,7 @@ void on_fs_record_pause(const uint32_t on, const uint32_t off);
 
 char* trim_file_path(const char* path);
 char *ulog_format_time(char *buffer, const int len);
+char *ulog_format_time_ms(char *buffer, const int len, const long long ms);
 
 int http_start(const char *url, const unsigned short idx);
 void on_fs_upload(const uint32_t idx, const uint32_t start);
@@ -24,14 +24,6 @@
 #define ULOG_POLICY_RQST   '?'
 #define ULOG_LEVEL_RSP     "{\"cloud log level\":%d}"
 
-/**
- * syslog management command mark
- * NOT RECOMMEND MODIFY THIS VALUE, READ ONLY!!
- */
-#define ULOG_CMD_PREFIX "#@"
-
-#define ULOG_HEADER_TYPE_LEN 5
-
 /**
  * syslog protocol, facility local use 0
  * NOT RECOMMEND MODIFY THIS VALUE, READ ONLY!!
@@ -59,9 +51,6 @@
 
 #define HTTP_UP_HDR_SIZE 64
 
-/* 5 is result of cost <%03d> */
-#define LOG_PREFIX_LEN 5
-
 typedef enum {
     http_upload_file_operate_fail = -4,
     http_upload_text_empty        = -3,
@@ -145,6 +134,22 @@ typedef enum {
 #define DEFAULT_ASYNC_BUF_SIZE    ULOG_CONFIG_ASYNC_BUF_SIZE
 #endif
 
+/**
+ * Bytes of log the log task takes out of the buffer queue at once. They are written
+ * to every session as one call per run of lines, and their room in the queue is
+ * given back before any session is written. At least one log line.
+ */
+#ifndef ULOG_CONFIG_ASYNC_BATCH_SIZE
+#define ASYNC_BATCH_SIZE   (ULOG_SIZE > 1024 ? ULOG_SIZE : 1024)
+#elif ULOG_CONFIG_ASYNC_BATCH_SIZE < ULOG_SIZE
+#define ASYNC_BATCH_SIZE   ULOG_SIZE
+#else
+#define ASYNC_BATCH_SIZE   ULOG_CONFIG_ASYNC_BATCH_SIZE
+#endif
+
+/* log lines in one batch at most */
+#define ASYNC_BATCH_LINES  32
+
 #ifndef ULOG_CONFIG_RESERVED_FS
 #define ULOG_RESERVED_FS   0
 #else
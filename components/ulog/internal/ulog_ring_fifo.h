@@ -9,16 +9,81 @@
 extern "C" {
 #endif
 
-typedef void (*pop_callback)(void*, void* src, const uint16_t len);
+typedef enum {
+    ulog_rec_log = 0,   /* text is a log line */
+    ulog_rec_cmd,       /* text is a ulog_man command */
+    ulog_rec_raw,       /* text written to stdout through vfs, goes out as it is */
+} ulog_rec_type_t;
 
-extern int uring_fifo_push_s(const void* buf, const uint16_t len);
+/**
+ * one record in the fifo. The producer fills the fields, so the log task never
+ * parses the text to route it
+ */
+typedef struct {
+    uint16_t len;       /* bytes of text, the terminating 0 not counted */
+    uint8_t  pri;       /* facility | severity, same as the syslog PRI */
+    uint8_t  type;      /* ulog_rec_type_t */
+    uint32_t ms;        /* aos_now_ms() when logged */
+    char     text[];
+} ulog_rec_t;
+
+typedef struct {
+    uint32_t pushed;
+    uint32_t dropped;    /* records refused because the fifo was full */
+    uint32_t high_water; /* most bytes ever waiting in the fifo */
+} uring_fifo_stat_t;
+
+/* room claimed by uring_fifo_reserve, published by uring_fifo_commit */
+typedef struct {
+    uint32_t pos;
+    uint32_t size;
+} uring_fifo_slot_t;
 
-extern int uring_fifo_pop_cb(pop_callback cb, void* cb_arg);
+typedef void (*pop_callback)(void*, const ulog_rec_t* rec);
 
 extern int uring_fifo_init(void);
 
+/**
+ * Lock free, may be called from any number of tasks at once. Never waits: when
+ * the fifo is full the record is dropped and counted.
+ *
+ * @return  0: success, -1: fifo full or not initialized.
+ */
+extern int uring_fifo_push(const uint8_t type, const uint8_t pri, const uint32_t ms,
+                           const char* text, const uint16_t len);
+
+/**
+ * Lock free like uring_fifo_push, for a producer that writes the text in place:
+ * claims room for up to len bytes of text and returns where it goes, NULL when
+ * the fifo is full (counted as a drop). The record reaches the log task, and
+ * blocks the ones claimed after it, until uring_fifo_commit, so write it
+ * straight away.
+ */
+extern char* uring_fifo_reserve(uring_fifo_slot_t* slot, const uint16_t len);
+
+/* publish the record of slot with len bytes of text, the room not used goes back */
+extern void uring_fifo_commit(const uring_fifo_slot_t* slot, const uint8_t type, const uint8_t pri,
+                              const uint32_t ms, const uint16_t len);
+
+/* stdout text of vfs as ulog_rec_raw records, split to fit; never waits */
+extern int uring_fifo_push_s(const void* buf, const uint16_t len);
+
+/**
+ * Log task only. Waits up to timeout ms for records and returns at most max of
+ * them in fifo order, in place. They stay valid until uring_fifo_release.
+ *
+ * @return  number of records, 0 on timeout.
+ */
+extern int uring_fifo_peek(const ulog_rec_t** recs, const int max, const unsigned int timeout);
+
+/* give the room of the first n records of the last peek back to the producers */
+extern void uring_fifo_release(const int n);
+
+/* flush ulog fifo when panic, no waiting */
 extern void uring_fifo_flush(pop_callback cb, void* cb_arg);
 
+extern void uring_fifo_stat(uring_fifo_stat_t* stat);
+
 #ifdef __cplusplus
 }
 #endif
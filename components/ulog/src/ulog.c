@@ -36,13 +36,6 @@ static uint8_t stop_filter_level[ulog_session_size] = {
 static uint8_t push_stop_filter_level = LOG_EMERG;
 
 
-/* Prefix <248>~<255> */
-/* using type char instead of int8_t which align with the prototype of string operation function */
-
-#ifdef ULOG_CONFIG_ASYNC
-static char ulog_buf[ULOG_SIZE];
-#endif
-
 bool check_pass_pop_out(const ulog_session_type_t session, const uint8_t level)
 {
     return (stop_filter_level[session]>level);
@@ -142,6 +135,32 @@ static char* log_col_def(const unsigned char level)
 
 #if defined(ULOG_CONFIG_ASYNC) && ULOG_CONFIG_ASYNC
 static uint8_t get_lowest_level(const ulog_session_type_t start);
+
+/* line buffer of the direct std output, under the log mutex */
+static char ulog_buf[ULOG_SIZE];
+
+/* formats a log line into buf of ULOG_SIZE bytes, returns the length */
+static int ulog_vformat(char *buf, const unsigned char s, const char *mod, const char *f,
+                        const unsigned long l, const long long now_ms, const char *fmt, va_list args)
+{
+    char log_time[24];
+    int rc;
+
+#if SYNC_LOG_DETAILS
+    snprintf(buf, ULOG_SIZE, "%s[%s]<%c>%s %s[%d]: ",
+             log_col_def(s),
+             ulog_format_time_ms(log_time, 24, now_ms), serverity_name[s],  mod,
+             trim_file_path(f),
+             (int)l);
+#else /* !SYNC_LOG_DETAILS */
+    snprintf(buf, ULOG_SIZE, "[%s]<%c>[%s]<%s>",
+             ulog_format_time_ms(log_time, 24, now_ms), serverity_name[s],  mod, aos_task_name());
+#endif
+
+    const size_t head_len = strlen(buf);
+    rc = vsnprintf(&buf[head_len], ULOG_SIZE-head_len, fmt, args);
+    return rc<0 ? (int)head_len : (head_len+rc<ULOG_SIZE-1 ? (int)(head_len+rc) : ULOG_SIZE-1);
+}
 #endif
 
 int ulog(const unsigned char s, const char *mod, const char *f, const unsigned long l, const char *fmt, ...)
@@ -149,52 +168,52 @@ int ulog(const unsigned char s, const char *mod, const char *f, const unsigned l
     int rc = -1;
     if (log_init &&
         (s < push_stop_filter_level) ) {
-        char log_time[24];
-        if (log_get_mutex()) {
-            const char* rpt_mod = NULL;
-            if ((mod == NULL) || (0 == strlen(mod))) {
-                rpt_mod = UNKNOWN_BUF;
-            } else {
-                rpt_mod = mod;
-            }
+        const char* rpt_mod = NULL;
+        if ((mod == NULL) || (0 == strlen(mod))) {
+            rpt_mod = UNKNOWN_BUF;
+        } else {
+            rpt_mod = mod;
+        }
 #if defined(ULOG_CONFIG_ASYNC) && ULOG_CONFIG_ASYNC
-            uint8_t facility = FACILITY_NORMAL_LOG;
-            if(strlen(rpt_mod)==0 || 0==strncmp("MQTT",rpt_mod, 4)) {
-                facility = FACILITY_NORMAL_LOG_NO_POP_CLOUD;
-            }
-
-            snprintf(ulog_buf,ULOG_HEADER_TYPE_LEN+1,"<%03hhu>",s+(facility&0xF8));
+        const long long now_ms = aos_now_ms();
+        uint8_t facility = FACILITY_NORMAL_LOG;
+        if(strlen(rpt_mod)==0 || 0==strncmp("MQTT",rpt_mod, 4)) {
+            facility = FACILITY_NORMAL_LOG_NO_POP_CLOUD;
+        }
 
-#if SYNC_LOG_DETAILS
-            snprintf(&ulog_buf[ULOG_HEADER_TYPE_LEN], ULOG_SIZE-ULOG_HEADER_TYPE_LEN, "%s[%s]<%c>%s %s[%d]: ",
-                     log_col_def(s),
-                     ulog_format_time(log_time, 24), serverity_name[s],  rpt_mod,
-                     trim_file_path(f),
-                     (int)l);
-#else /* !SYNC_LOG_DETAILS */
-            snprintf(&ulog_buf[ULOG_HEADER_TYPE_LEN], ULOG_SIZE-ULOG_HEADER_TYPE_LEN, "[%s]<%c>[%s]<%s>",
-                     ulog_format_time(log_time, 24), serverity_name[s],  rpt_mod, aos_task_name());
+        bool skip_session_std = false;
+#if !LOG_DIR_ASYNC
+        skip_session_std = s < stop_filter_level[ulog_session_std];
 #endif
+        const bool push = !skip_session_std || (s<get_lowest_level(ulog_session_std));
+        va_list args;
 
-            va_list args;
+        if (skip_session_std && log_get_mutex()) {
+            /* printed from the line buffer before it goes to the fifo, so no slot is
+               held open while the console is busy */
             va_start(args, fmt);
-            rc = vsnprintf(&ulog_buf[strlen(ulog_buf)], ULOG_SIZE-strlen(ulog_buf), fmt, args);
+            rc = ulog_vformat(ulog_buf, s, rpt_mod, f, l, now_ms, fmt, args);
             va_end(args);
-            rc = rc<ULOG_SIZE-1?rc:ULOG_SIZE-1;
-
-            bool skip_session_std = false;
-#if !LOG_DIR_ASYNC
-            if(s < stop_filter_level[ulog_session_std]) {
-                skip_session_std = true;
-                puts(&ulog_buf[LOG_PREFIX_LEN]);
+            puts(ulog_buf);
+            if (push) {
+                uring_fifo_push(ulog_rec_log, s+(facility&0xF8), (uint32_t)now_ms, ulog_buf, rc);
             }
-#endif
-            if(!skip_session_std || (s<get_lowest_level(ulog_session_std))) {
-                uring_fifo_push_s(ulog_buf, strlen(ulog_buf)+1);
+            log_release_mutex();
+        } else if (push) {
+            uring_fifo_slot_t slot;
+            char* text = uring_fifo_reserve(&slot, ULOG_SIZE-1);
+            if (text != NULL) {
+                /* formatted in place in the fifo, without a lock or a line buffer on the stack */
+                va_start(args, fmt);
+                rc = ulog_vformat(text, s, rpt_mod, f, l, now_ms, fmt, args);
+                va_end(args);
+                uring_fifo_commit(&slot, ulog_rec_log, s+(facility&0xF8), (uint32_t)now_ms, rc);
             }
+        }
 
 #else /* !ULOG_CONFIG_ASYNC */
-
+        char log_time[24];
+        if (log_get_mutex()) {
 #if SYNC_LOG_DETAILS
             printf("%s[%s]<%c>%s %s[%d]: ",
                    log_col_def(s),
@@ -213,9 +232,9 @@ int ulog(const unsigned char s, const char *mod, const char *f, const unsigned l
             va_end(args);
             fflush(stdout);
             printf("\r\n");
-#endif /* if def ULOG_CONFIG_ASYNC */
             log_release_mutex();
         }
+#endif /* if def ULOG_CONFIG_ASYNC */
     }
     return rc;
 }
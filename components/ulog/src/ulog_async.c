@@ -11,7 +11,6 @@
 #include "ulog_api.h"
 #include "ulog_ring_fifo.h"
 #include "aos/kernel.h"
-#include "k_config.h"
 // #include "uagent.h"
 
 #if defined (AOS_COMP_DEBUG) && AOS_COMP_DEBUG
@@ -43,59 +42,169 @@ const ulog_man_handler_service_t ulog_man_handler_service[] = {
 #endif
 };
 
-static void ulog_handler_normal(void* para, void* log_text, const uint16_t log_len)
+/* one log line copied out of the fifo, followed by '\n' in batch_buf (other records by '\0') */
+typedef struct {
+    uint16_t off;
+    uint16_t len;
+    uint8_t  pri;
+    uint8_t  type;
+} batch_line_t;
+
+typedef int32_t (*session_out_t)(const char* data, const uint16_t len);
+
+/* only the log task touches these */
+static char                batch_buf[ASYNC_BATCH_SIZE];
+static batch_line_t        batch_line[ASYNC_BATCH_LINES];
+static bool                session_failed[ulog_session_size];
+static ulog_session_stat_t session_stat[ulog_session_size];
+
+static void pop_out_raw(const char* data, const uint16_t len)
 {
-    if ((log_text != NULL) && log_len > 0) {
-        char *str = (char*)log_text;
-        char *text_info = NULL;
-        if ((str[0] == '<') && ((text_info = strchr(str, '>')) != NULL)) {
-            /* pri = facility*8+level */
-            const uint32_t pri = strtoul(&str[1], NULL, 10);
-            const uint8_t severity = (pri & 0x7);
+    if (log_get_mutex()) {
+        fwrite(data, 1, len, stdout);
+        fflush(stdout);
+        log_release_mutex();
+    }
+}
+
 #if LOG_DIR_ASYNC
-            if (check_pass_pop_out(ulog_session_std, severity)) {
-                if (log_get_mutex()) {
-                    puts(&((char*)log_text)[LOG_PREFIX_LEN]);
-                    log_release_mutex();
-                }
-            }
+static int32_t pop_out_on_std(const char* data, const uint16_t len)
+{
+    int32_t rc = -1;
+    if (log_get_mutex()) {
+        rc = fwrite(data, 1, len, stdout) == len ? 0 : -1;
+        fflush(stdout);
+        log_release_mutex();
+    }
+    return rc;
+}
+#endif
+
+#if ULOG_POP_CLOUD_ENABLE
+static int32_t pop_out_on_cloud(const char* data, const uint16_t len)
+{
+    return uagent_send(UAGENT_MOD_ULOG, ULOG_SHOW, len, data, 0);
+}
+#endif
+
+static bool line_pass(const ulog_session_type_t session, const batch_line_t* line)
+{
+#if ULOG_POP_CLOUD_ENABLE
+    if (session == ulog_session_cloud && FACILITY_NORMAL_LOG_NO_POP_CLOUD == (line->pri & 0xF8)) {
+        return false;
+    }
+#endif
+    /* pri = facility*8+level */
+    return check_pass_pop_out(session, line->pri & 0x7);
+}
+
+/*
+ * Hand the log lines [first, end) of the batch that pass the filter of the session to out,
+ * a run of neighbouring lines in one call if runs is set, or else line by line. After out
+ * fails once the session drops the rest of the batch, so a session that is stuck costs the
+ * others one failed call per batch at most.
+ */
+static void session_pop(const ulog_session_type_t session, int first, const int end,
+                        session_out_t out, const bool runs)
+{
+    ulog_session_stat_t* stat = &session_stat[session];
+    while (first < end) {
+        int last = first;
+        if (!line_pass(session, &batch_line[first])) {
+            first++;
+            continue;
+        }
+        while (runs && last + 1 < end && line_pass(session, &batch_line[last + 1])) {
+            last++;
+        }
+        if (!session_failed[session]) {
+            const uint16_t off = batch_line[first].off;
+            const uint16_t len = runs ? batch_line[last].off + batch_line[last].len + 1 - off
+                                      : batch_line[first].len;
+            session_failed[session] = out(&batch_buf[off], len) < 0;
+        }
+        if (session_failed[session]) {
+            stat->dropped += last - first + 1;
+        } else {
+            stat->written += last - first + 1;
+        }
+        first = last + 1;
+    }
+}
+
+/* copy records out of the fifo and give their room back at once, returns the lines copied */
+static int batch_fill(void)
+{
+    const ulog_rec_t* recs[ASYNC_BATCH_LINES];
+    const int n = uring_fifo_peek(recs, ASYNC_BATCH_LINES, AOS_WAIT_FOREVER);
+    uint16_t off = 0;
+    int i = 0;
+
+    /* a record is shorter than ULOG_SIZE, the first one always fits */
+    for (; i < n && off + recs[i]->len + 1 <= ASYNC_BATCH_SIZE; i++) {
+        batch_line[i].off  = off;
+        batch_line[i].len  = recs[i]->len;
+        batch_line[i].pri  = recs[i]->pri;
+        batch_line[i].type = recs[i]->type;
+        memcpy(&batch_buf[off], recs[i]->text, recs[i]->len);
+        off += recs[i]->len;
+        batch_buf[off++] = recs[i]->type == ulog_rec_log ? '\n' : '\0';
+    }
+    uring_fifo_release(i);
+    return i;
+}
+
+static void batch_pop(const int n)
+{
+    int first = 0;
+    memset(session_failed, 0, sizeof(session_failed));
+    while (first < n) {
+        int end = first + 1;
+        if (batch_line[first].type == ulog_rec_cmd) {
+            /* syslog management, the lines before it are out already */
+            ulog_man_handler(&batch_buf[batch_line[first].off]);
+            first++;
+            continue;
+        }
+        if (batch_line[first].type == ulog_rec_raw) {
+            /* printf text through vfs, not filtered */
+            pop_out_raw(&batch_buf[batch_line[first].off], batch_line[first].len);
+            first++;
+            continue;
+        }
+        while (end < n && batch_line[end].type == ulog_rec_log) {
+            end++;
+        }
+#if LOG_DIR_ASYNC
+        session_pop(ulog_session_std, first, end, pop_out_on_std, true);
 #endif
 
 #if ULOG_POP_UDP_ENABLE
-            if (check_pass_pop_out(ulog_session_udp, severity)) {
-                pop_out_on_udp(&((char*)log_text)[LOG_PREFIX_LEN], log_len);
-            }
+        /* one syslog message per datagram */
+        session_pop(ulog_session_udp, first, end, pop_out_on_udp, false);
 #endif
 
 #if ULOG_POP_FS_ENABLE
-            if (check_pass_pop_out(ulog_session_file, severity)) {
-                pop_out_on_fs(&((char*)log_text)[LOG_PREFIX_LEN], log_len);
-            }
+        session_pop(ulog_session_file, first, end, pop_out_on_fs_lines, true);
 #endif
 
 #if ULOG_POP_CLOUD_ENABLE
-            if ((FACILITY_NORMAL_LOG_NO_POP_CLOUD != (pri & 0xF8))
-                && check_pass_pop_out(ulog_session_cloud, severity)) {
-                uagent_send(UAGENT_MOD_ULOG, ULOG_SHOW, strlen(text_info+1), text_info + 1, 0);
-            }
+        session_pop(ulog_session_cloud, first, end, pop_out_on_cloud, false);
 #endif
-
-        } else if (0 == strncmp(str, ULOG_CMD_PREFIX, strlen(ULOG_CMD_PREFIX))) {
-            /* syslog management */
-            ulog_man_handler(&str[strlen(ULOG_CMD_PREFIX)]);
-        } else { /* unkown format */
-            puts(log_text);
-        }
+        first = end;
     }
 }
 
-static void ulog_handler_panic(void* para, void* log_text, const uint16_t log_len)
+static void ulog_handler_panic(void* para, const ulog_rec_t* rec)
 {
-    if (log_text && log_len > LOG_PREFIX_LEN) {
+    if (rec->type != ulog_rec_cmd) {
 #if defined (AOS_COMP_DEBUG) && AOS_COMP_DEBUG
-        aos_debug_printf("%s", &((char*)log_text)[LOG_PREFIX_LEN]);
+        aos_debug_printf("%s", rec->text);
 #else
-        puts(&((char*)log_text)[LOG_PREFIX_LEN]);
+        fputs(rec->text, stdout);
+        if (rec->type == ulog_rec_log) {
+            putchar('\n');
+        }
 #endif
     }
 }
@@ -103,9 +212,9 @@ static void ulog_handler_panic(void* para, void* log_text, const uint16_t log_le
 static void log_routine(void* para)
 {
     while (1) {
-        /* PRI      HEADER            MSG */
-        /* <130>Oct 9 22:33:20.111 soc kernel.c[111]: The audit daemon is exiting. */
-        uring_fifo_pop_cb(ulog_handler_normal, NULL);
+        /* HEADER            MSG */
+        /* [ 22.111]<I>[soc]<app_task> The audit daemon is exiting. */
+        batch_pop(batch_fill());
     }
 }
 
@@ -130,6 +239,11 @@ void ulog_async_flush()
     uring_fifo_flush(ulog_handler_panic, NULL);
 }
 
+void ulog_async_stat(ulog_session_stat_t stat[ulog_session_size])
+{
+    memcpy(stat, session_stat, sizeof(session_stat));
+}
+
 void ulog_man_handler(const char* raw_str)
 {
     if (raw_str != NULL) {
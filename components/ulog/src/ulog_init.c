@@ -4,6 +4,7 @@
 
 #include "ulog/ulog.h"
 #include "ulog_api.h"
+#include "ulog_ring_fifo.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -39,6 +40,22 @@ __attribute__((weak)) void on_show_ulog_file()
 }
 
 #ifdef ULOG_CONFIG_ASYNC
+static void show_ulog_stat(void)
+{
+    uring_fifo_stat_t fifo;
+    ulog_session_stat_t stat[ulog_session_size];
+    uint8_t i;
+
+    uring_fifo_stat(&fifo);
+    ulog_async_stat(stat);
+    aos_cli_printf("fifo pushed %u dropped %u high water %u\r\n",
+                   (unsigned)fifo.pushed, (unsigned)fifo.dropped, (unsigned)fifo.high_water);
+    for (i = 0; i < ulog_session_size; i++) {
+        aos_cli_printf("session %d written %u dropped %u\r\n",
+                       i, (unsigned)stat[i].written, (unsigned)stat[i].dropped);
+    }
+}
+
 static void cmd_cli_ulog(char *pwbuf, int blen, int argc, char *argv[])
 {
     bool exit_loop = false;
@@ -52,6 +69,9 @@ static void cmd_cli_ulog(char *pwbuf, int blen, int argc, char *argv[])
         case 'f':
             on_show_ulog_file();
             break;
+        case 'd':
+            show_ulog_stat();
+            break;
         case 'x': {
 #ifdef ULOG_CONFIG_POP_FS
             char *buf = (char*)aos_malloc(512);
@@ -5,12 +5,55 @@
 #include "ulog_ring_fifo.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdatomic.h>
 #include "aos/kernel.h"
 #include "ulog_config.h"
 
-static aos_queue_t ulog_queue;
-static uint8_t*    ulog_buffer;
+/**
+ * Records sit in a byte ring as a 32-bit state word followed by the ulog_rec_t.
+ * A producer claims room by moving head with a CAS, writes the record, then
+ * publishes its size in the state word. The log task reads the state words from
+ * tail on: 0 means the record is still being written, SLOT_PAD marks the unused
+ * end of the ring before a record that did not fit there. Released room is
+ * zeroed, so a stale word is never taken for a published one.
+ *
+ * Positions run over [0, wrap), a multiple of the ring size far larger than it,
+ * so head comes back to the same value only after gigabytes of log and a
+ * producer preempted inside its CAS loop cannot be fooled by it.
+ */
+#define SLOT_PAD   0x80000000u
+#define SLOT_HDR   (sizeof(uint32_t) + sizeof(ulog_rec_t))
+#define SLOT_ALIGN(x) (((x) + 3) & ~3u)
+
+typedef struct {
+    uint8_t*    buf;
+    uint32_t    size;
+    uint32_t    wrap;
+    atomic_uint head;       /* end of the claimed room */
+    atomic_uint tail;       /* start of the room not released yet, log task writes it */
+    atomic_uint sleeping;   /* log task waits on sem */
+    atomic_uint pushed;
+    atomic_uint dropped;
+    uint32_t    high_water;
+    aos_sem_t   sem;
+} uring_t;
+
+static uring_t ulog_ring;
+
+static inline atomic_uint* slot_state(const uint32_t pos)
+{
+    return (atomic_uint*)&ulog_ring.buf[pos % ulog_ring.size];
+}
+
+static inline uint32_t ring_advance(const uint32_t pos, const uint32_t n)
+{
+    return pos + n >= ulog_ring.wrap ? pos + n - ulog_ring.wrap : pos + n;
+}
 
+static inline uint32_t ring_used(const uint32_t tail, const uint32_t head)
+{
+    return head >= tail ? head - tail : head + ulog_ring.wrap - tail;
+}
 
 /**
 * This function will create a ring fifo for ulog.
@@ -21,13 +64,20 @@ static uint8_t*    ulog_buffer;
 int uring_fifo_init()
 {
     int rc = -1;
-    if (ulog_buffer == NULL) {
-        ulog_buffer = aos_malloc(DEFAULT_ASYNC_BUF_SIZE);
-        if (ulog_buffer != NULL) {
-            rc = aos_queue_new(&ulog_queue, ulog_buffer, DEFAULT_ASYNC_BUF_SIZE, ULOG_SIZE);
+    if (ulog_ring.buf == NULL) {
+        const uint32_t size = DEFAULT_ASYNC_BUF_SIZE & ~3u;
+        if (size < SLOT_ALIGN(SLOT_HDR + ULOG_SIZE + 1)) {
+            return rc;
+        }
+        ulog_ring.buf = aos_zalloc(size);
+        if (ulog_ring.buf != NULL) {
+            rc = aos_sem_new(&ulog_ring.sem, 0);
             if (0 != rc) {
-                aos_free(ulog_buffer);
-                ulog_buffer = NULL;
+                aos_free(ulog_ring.buf);
+                ulog_ring.buf = NULL;
+            } else {
+                ulog_ring.size = size;
+                ulog_ring.wrap = (0xFFFFFFFFu / size - 1) * size;
             }
         }
     }
@@ -35,44 +85,208 @@ int uring_fifo_init()
     return rc;
 }
 
-/**
-* Thread Safe to put the msg into ring - fifo.
-*
-* @param[in]  queue  pointer to the queue.
-* @param[in]  msg    msg to send.
-* @param[in]  size   size of the msg.
-*
-* @return  0: success.
-*/
-int uring_fifo_push_s(const void* buf, const uint16_t len)
+char* uring_fifo_reserve(uring_fifo_slot_t* slot, const uint16_t len)
+{
+    const uint32_t need = SLOT_ALIGN(SLOT_HDR + len + 1);
+    uint32_t head, pad;
+
+    if (ulog_ring.buf == NULL || need >= ulog_ring.size) {
+        return NULL;
+    }
+
+    head = atomic_load_explicit(&ulog_ring.head, memory_order_relaxed);
+    do {
+        /* acquire: the log task zeroed the released room before moving tail */
+        const uint32_t tail = atomic_load_explicit(&ulog_ring.tail, memory_order_acquire);
+        const uint32_t off  = head % ulog_ring.size;
+
+        pad = off + need > ulog_ring.size ? ulog_ring.size - off : 0;
+        /* a full ring would put head on the unreleased slot at tail, keep a gap */
+        if (ring_used(tail, head) + pad + need >= ulog_ring.size) {
+            atomic_fetch_add_explicit(&ulog_ring.dropped, 1, memory_order_relaxed);
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&ulog_ring.head, &head,
+                                                    ring_advance(head, pad + need),
+                                                    memory_order_relaxed, memory_order_relaxed));
+
+    if (pad) {
+        atomic_store_explicit(slot_state(head), SLOT_PAD | pad, memory_order_release);
+        head = ring_advance(head, pad);
+    }
+
+    slot->pos  = head;
+    slot->size = need;
+    return ((ulog_rec_t*)&ulog_ring.buf[head % ulog_ring.size + sizeof(uint32_t)])->text;
+}
+
+void uring_fifo_commit(const uring_fifo_slot_t* slot, const uint8_t type, const uint8_t pri,
+                       const uint32_t ms, const uint16_t len)
 {
-    return aos_queue_send(&ulog_queue, (void*)buf, len);
+    const uint32_t need = SLOT_ALIGN(SLOT_HDR + len + 1);
+    ulog_rec_t* rec = (ulog_rec_t*)&ulog_ring.buf[slot->pos % ulog_ring.size + sizeof(uint32_t)];
+
+    rec->len  = len;
+    rec->pri  = pri;
+    rec->type = type;
+    rec->ms   = ms;
+    rec->text[len] = '\0';
+
+    if (need < slot->size) {
+        /* give the room the text did not use back, as a pad if others claimed after it */
+        uint32_t end = ring_advance(slot->pos, slot->size);
+        const uint32_t used = ring_advance(slot->pos, need);
+        if (!atomic_compare_exchange_strong_explicit(&ulog_ring.head, &end, used,
+                                                     memory_order_relaxed, memory_order_relaxed)) {
+            atomic_store_explicit(slot_state(used), SLOT_PAD | (slot->size - need),
+                                  memory_order_release);
+        }
+    }
+
+    /* seq_cst with the sleeping flag: the log task sees this record or we see it asleep */
+    atomic_store(slot_state(slot->pos), need);
+    atomic_fetch_add_explicit(&ulog_ring.pushed, 1, memory_order_relaxed);
+    if (atomic_load(&ulog_ring.sleeping) && atomic_exchange(&ulog_ring.sleeping, 0)) {
+        aos_sem_signal(&ulog_ring.sem);
+    }
 }
 
-int uring_fifo_pop_cb(pop_callback cb, void* cb_arg)
+int uring_fifo_push(const uint8_t type, const uint8_t pri, const uint32_t ms,
+                    const char* text, const uint16_t len)
 {
-    char tmp_buf[ULOG_SIZE];
-    size_t rcv_size = 0;
-    int rc = aos_queue_recv(&ulog_queue, AOS_WAIT_FOREVER, tmp_buf, &rcv_size);
-    if ((0 == rc) && (cb != NULL)) {
-        cb(cb_arg, tmp_buf, (uint16_t)rcv_size);
+    uring_fifo_slot_t slot;
+    char* dst = uring_fifo_reserve(&slot, len);
+
+    if (dst == NULL) {
+        return -1;
+    }
+    memcpy(dst, text, len);
+    uring_fifo_commit(&slot, type, pri, ms, len);
+    return 0;
+}
+
+int uring_fifo_push_s(const void* buf, const uint16_t len)
+{
+    const char* text = (const char*)buf;
+    uint16_t off = 0;
+    int rc = 0;
+    while (off < len && rc == 0) {
+        const uint16_t n = len - off < ULOG_SIZE - 1 ? len - off : ULOG_SIZE - 1;
+        rc = uring_fifo_push(ulog_rec_raw, 0, (uint32_t)aos_now_ms(), &text[off], n);
+        off += n;
     }
     return rc;
 }
 
+/* published records from tail on, at most max */
+static int ring_collect(const ulog_rec_t** recs, const int max)
+{
+    const uint32_t head = atomic_load_explicit(&ulog_ring.head, memory_order_relaxed);
+    uint32_t pos = atomic_load_explicit(&ulog_ring.tail, memory_order_relaxed);
+    int n = 0;
+
+    while (n < max && pos != head) {
+        const uint32_t state = atomic_load_explicit(slot_state(pos), memory_order_acquire);
+        if (state == 0) {
+            break;
+        }
+        if (!(state & SLOT_PAD)) {
+            recs[n++] = (const ulog_rec_t*)&ulog_ring.buf[pos % ulog_ring.size + sizeof(uint32_t)];
+        }
+        pos = ring_advance(pos, state & ~SLOT_PAD);
+    }
+    return n;
+}
+
+int uring_fifo_peek(const ulog_rec_t** recs, const int max, const unsigned int timeout)
+{
+    int n;
+
+    if (ulog_ring.buf == NULL) {
+        return 0;
+    }
+
+    while (0 == (n = ring_collect(recs, max)) && timeout != AOS_NO_WAIT) {
+        atomic_store(&ulog_ring.sleeping, 1);
+        if (0 != (n = ring_collect(recs, max))) {
+            atomic_store(&ulog_ring.sleeping, 0);
+            break;
+        }
+        if (0 != aos_sem_wait(&ulog_ring.sem, timeout) && timeout != AOS_WAIT_FOREVER) {
+            atomic_store(&ulog_ring.sleeping, 0);
+            return ring_collect(recs, max);
+        }
+    }
+
+    if (n > 0) {
+        const uint32_t tail = atomic_load_explicit(&ulog_ring.tail, memory_order_relaxed);
+        const uint32_t used = ring_used(tail, atomic_load_explicit(&ulog_ring.head,
+                                                                   memory_order_relaxed));
+        if (used > ulog_ring.high_water) {
+            ulog_ring.high_water = used;
+        }
+    }
+    return n;
+}
+
+void uring_fifo_release(const int n)
+{
+    const uint32_t head = atomic_load_explicit(&ulog_ring.head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ulog_ring.tail, memory_order_relaxed);
+    uint32_t pos = tail;
+    int i = 0;
+
+    if (ulog_ring.buf == NULL) {
+        return;
+    }
+
+    /* skip the pads in front of the n records and after the last one, never past head */
+    while (pos != head &&
+           (i < n || (atomic_load_explicit(slot_state(pos), memory_order_relaxed) & SLOT_PAD))) {
+        const uint32_t state = atomic_load_explicit(slot_state(pos), memory_order_relaxed);
+        if (state == 0) {
+            break;
+        }
+        if (!(state & SLOT_PAD)) {
+            i++;
+        }
+        pos = ring_advance(pos, state & ~SLOT_PAD);
+    }
+
+    /* zero the room so it reads as unpublished once producers reuse it */
+    while (tail != pos) {
+        const uint32_t off = tail % ulog_ring.size;
+        uint32_t len = ring_used(tail, pos);
+        if (len > ulog_ring.size - off) {
+            len = ulog_ring.size - off;
+        }
+        memset(&ulog_ring.buf[off], 0, len);
+        tail = ring_advance(tail, len);
+    }
+    atomic_store_explicit(&ulog_ring.tail, pos, memory_order_release);
+}
+
 /* flush ulog fifo when panic*/
 void uring_fifo_flush(pop_callback cb, void* cb_arg)
 {
-    int  rc, i;
-    size_t rcv_size;
-    char log_text[ULOG_SIZE];
+    const ulog_rec_t* recs[8];
+    int n, i;
 
-    int msg_num_in_fifo = aos_queue_get_count(&ulog_queue);
-
-    for(i = 0; i < msg_num_in_fifo; i++) {
-        rc = aos_queue_recv(&ulog_queue, AOS_NO_WAIT, (void *)log_text, &rcv_size);
-        if ((0 == rc) && (cb != NULL)) {
-            cb(cb_arg, log_text, (uint16_t)rcv_size);
+    while ((n = uring_fifo_peek(recs, sizeof(recs) / sizeof(recs[0]), AOS_NO_WAIT)) > 0) {
+        for (i = 0; i < n; i++) {
+            if (cb != NULL) {
+                cb(cb_arg, recs[i]);
+            }
         }
+        uring_fifo_release(n);
+    }
+}
+
+void uring_fifo_stat(uring_fifo_stat_t* stat)
+{
+    if (stat != NULL) {
+        stat->pushed     = atomic_load_explicit(&ulog_ring.pushed, memory_order_relaxed);
+        stat->dropped    = atomic_load_explicit(&ulog_ring.dropped, memory_order_relaxed);
+        stat->high_water = ulog_ring.high_water;
     }
 }
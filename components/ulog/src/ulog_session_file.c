@@ -638,6 +638,48 @@ static void write_fail_retry()
     }
 }
 
+/* count write_rlt bytes into the working file, roll to the next file once it is full */
+static void fs_written(const int write_rlt)
+{
+    log_file_failed = 0;
+    operating_file_offset += write_rlt;
+    if (operating_file_offset >= LOCAL_FILE_SIZE) {
+        stop_operating();
+
+        /* roll back if working index reaches end */
+        ulog_idx_type tmp_working = get_working_from_cfg_mm() + 1;
+        if (tmp_working > LOCAL_FILE_CNT) {
+            tmp_working = ULOG_FILE_IDX_START;
+        }
+        operating_file_offset = 0;
+        if (0 == update_new_log_file(tmp_working)) {
+            operating_fd = open_log_file(get_working_from_cfg_mm(), O_WRONLY, 0);
+        }
+    }
+}
+
+/* keep the lines of data, each ending with LOG_LINE_SEPARATOR, until the file is back */
+static int32_t fs_keep_lines(const char* data, const uint16_t len)
+{
+#if ULOG_RESERVED_FS
+    int32_t rc = 0;
+    uint16_t off = 0;
+    while (off < len) {
+        const char* end = memchr(&data[off], LOG_LINE_SEPARATOR, len - off);
+        const uint16_t line_len = end != NULL ? end - &data[off] : len - off;
+        if (0 != push_fs_tmp(&data[off], line_len)) {
+            SESSION_FS_INFO("*(%d)", -1);
+            rc = -1;
+        }
+        off += line_len + 1;
+    }
+    return rc;
+#else
+    SESSION_FS_INFO("$");
+    return -1;
+#endif
+}
+
 /**
 * @brief not thread-safe, but only be used in one task(ulog), so not necessary considering mutex
 * @param data
@@ -652,23 +694,8 @@ int32_t pop_out_on_fs(const char* data, const uint16_t len)
     if (operating_fd >= 0) {
         const int write_rlt = write_log_line(operating_fd, data, true);
         if (write_rlt > 0) {
-            log_file_failed = 0;
             rc = 0;
-            operating_file_offset += write_rlt;
-            if (operating_file_offset >= LOCAL_FILE_SIZE) {
-                stop_operating();
-
-                /* roll back if working index reaches end */
-                ulog_idx_type tmp_working = get_working_from_cfg_mm() + 1;
-                if (tmp_working > LOCAL_FILE_CNT) {
-                    tmp_working = ULOG_FILE_IDX_START;
-                }
-                operating_file_offset = 0;
-                if (0 == update_new_log_file(tmp_working)) {
-                    operating_fd = open_log_file(get_working_from_cfg_mm(), O_WRONLY, 0);
-                }
-            }
-
+            fs_written(write_rlt);
         } else {
             SESSION_FS_INFO("write fail %d retry %d\n", write_rlt, log_file_failed);
 #if ULOG_RESERVED_FS
@@ -694,6 +721,46 @@ int32_t pop_out_on_fs(const char* data, const uint16_t len)
     return rc;
 }
 
+/**
+* @brief pop_out_on_fs for a run of lines, each already ending with LOG_LINE_SEPARATOR.
+*        The lines up to the one that fills the working file go out in one write and
+*        one sync, then the file rolls as it does line by line.
+*        not thread-safe, but only be used in one task(ulog)
+* @param data
+* @param len
+*
+* @return -1 indicates not all lines recorded
+*
+*/
+int32_t pop_out_on_fs_lines(const char* data, const uint16_t len)
+{
+    int32_t rc = 0;
+    uint16_t off = 0;
+    while (off < len) {
+        uint16_t end = off;
+        do {
+            const char* sep = memchr(&data[end], LOG_LINE_SEPARATOR, len - end);
+            end = sep != NULL ? sep - data + 1 : len;
+        } while (end < len && operating_file_offset + (end - off) < LOCAL_FILE_SIZE);
+
+        if (operating_fd >= 0) {
+            const int write_rlt = aos_write(operating_fd, &data[off], end - off);
+            if (write_rlt > 0) {
+                aos_sync(operating_fd);
+                fs_written(write_rlt);
+            } else {
+                SESSION_FS_INFO("write fail %d retry %d\n", write_rlt, log_file_failed);
+                rc = fs_keep_lines(&data[off], end - off);
+                write_fail_retry();
+            }
+        } else {
+            rc = fs_keep_lines(&data[off], end - off);
+        }
+        off = end;
+    }
+    return rc;
+}
+
 void on_fs_record_pause(const uint32_t on, const uint32_t off)
 {
     if (on^off) {
@@ -37,12 +37,16 @@ void log_release_mutex()
     aos_mutex_unlock(&log_mutex);
 }
 
+char *ulog_format_time(char *buffer, const int len)
+{
+    return ulog_format_time_ms(buffer, len, aos_now_ms());
+}
+
 /* result like 99.356 ,i.e. s.ms */
 /* Result is like "Nov 28 15:19:20.122" */
-char *ulog_format_time(char *buffer, const int len)
+char *ulog_format_time_ms(char *buffer, const int len, const long long ms)
 {
     if(NULL!=buffer && len>4) {
-        long long ms = aos_now_ms();
 #if SYSLOG_TIME_FORMAT
         time_t rawtime;
         time(&rawtime);
@@ -95,15 +99,11 @@ int ulog_man(const char* cmd_str)
 {
 #ifdef ULOG_CONFIG_ASYNC
     int rc = -EINVAL;
-    if (NULL != cmd_str && strlen(cmd_str) > 0) {
+    const size_t cmd_str_len = NULL != cmd_str ? strlen(cmd_str) : 0;
+    if (cmd_str_len > 0 && cmd_str_len < ULOG_SIZE) {
         rc = -EPERM;
         if (log_init) {
-            const uint16_t cmd_str_size = strlen(cmd_str) + strlen(ULOG_CMD_PREFIX) + 1;
-            char* tmpbuf = (char*)aos_malloc(cmd_str_size);
-            strncpy(tmpbuf, ULOG_CMD_PREFIX, cmd_str_size);
-            strncat(tmpbuf, cmd_str, cmd_str_size - strlen(ULOG_CMD_PREFIX) - 1);
-            rc = uring_fifo_push_s(tmpbuf, cmd_str_size);
-            aos_free(tmpbuf);
+            rc = uring_fifo_push(ulog_rec_cmd, 0, (uint32_t)aos_now_ms(), cmd_str, cmd_str_len);
         }
     }
 #else /*!ULOG_CONFIG_ASYNC */
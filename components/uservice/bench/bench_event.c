@@ -0,0 +1,394 @@
+/*
+ * Copyright (C) 2019-2020 Alibaba Group Holding Limited
+ */
+
+/*
+ * Event list and delayed event cost on Linux, built once per implementation (see
+ * CMakeLists.txt):
+ *   legacy: the event list as it was, one slist of events searched on every publish with
+ *           the callbacks run under the list mutex, and delayed events in a dlist kept
+ *           sorted by a linear insert
+ *   hash:   event.c / event_timer.c of this component, events hashed by id, copy on write
+ *           subscriber arrays and a binary heap of delayed events
+ * Subscribes two callbacks to each of <events> ids, publishes <publishes> times to ids
+ * picked at random, then subscribes and unsubscribes a third callback on random ids, and
+ * adds <timers> delayed events with random timeouts and pops them all in expire order.
+ * Times are the cpu time of the calling thread.
+ */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <aos/kernel.h>
+#include <aos/list.h>
+#include <uservice/event.h>
+
+#ifndef BENCH_MODE
+#define BENCH_MODE "hash"
+#endif
+
+/* the aos symbols the event list needs, on pthreads */
+void *aos_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void *aos_zalloc(size_t size)
+{
+    return calloc(1, size);
+}
+
+void *aos_realloc(void *mem, size_t size)
+{
+    return realloc(mem, size);
+}
+
+void aos_free(void *mem)
+{
+    free(mem);
+}
+
+int aos_mutex_new(aos_mutex_t *mutex)
+{
+    pthread_mutex_t *m = malloc(sizeof(pthread_mutex_t));
+    pthread_mutex_init(m, NULL);
+    *mutex = m;
+    return 0;
+}
+
+int aos_mutex_lock(aos_mutex_t *mutex, unsigned int timeout)
+{
+    return pthread_mutex_lock(*mutex);
+}
+
+int aos_mutex_unlock(aos_mutex_t *mutex)
+{
+    return pthread_mutex_unlock(*mutex);
+}
+
+void aos_mutex_free(aos_mutex_t *mutex)
+{
+    pthread_mutex_destroy(*mutex);
+    free(*mutex);
+}
+
+#ifdef BENCH_LEGACY
+/* event.c and the timeouts of event_svr.c as they were, trimmed to what is measured */
+typedef struct event_list {
+    slist_t     events;
+    aos_mutex_t mutex;
+} event_list_t;
+
+typedef struct event {
+    uint32_t event_id;
+    slist_t  sub_list;
+
+    slist_t next;
+} event_t;
+
+typedef struct event_subscription {
+    event_callback_t ecb;
+    void *context;
+
+    slist_t next;
+} event_subscription_t;
+
+static event_t *find_event(event_list_t *evlist, uint32_t event_id)
+{
+    event_t *node;
+    slist_for_each_entry(&evlist->events, node, event_t, next) {
+        if (node->event_id == event_id) {
+            return node;
+        }
+    }
+
+    return NULL;
+}
+
+static event_subscription_t *find_event_sub(event_t *ev, event_callback_t cb, void *context)
+{
+    event_subscription_t *node;
+    slist_for_each_entry(&ev->sub_list, node, event_subscription_t, next) {
+        if (node->ecb == cb && node->context == context) {
+            return node;
+        }
+    }
+
+    return NULL;
+}
+
+static int eventlist_init(event_list_t *evlist)
+{
+    memset(evlist, 0, sizeof(event_list_t));
+    slist_init(&evlist->events);
+
+    return aos_mutex_new(&evlist->mutex);
+}
+
+static void eventlist_uninit(event_list_t *evlist)
+{
+    event_t *node;
+    slist_t *tmp_1;
+
+    slist_for_each_entry_safe(&evlist->events, tmp_1, node, event_t, next) {
+        event_subscription_t *node_sub;
+        slist_t *tmp_2;
+        slist_for_each_entry_safe(&node->sub_list, tmp_2, node_sub, event_subscription_t, next) {
+            aos_free(node_sub);
+        }
+        aos_free(node);
+    }
+    aos_mutex_free(&evlist->mutex);
+}
+
+static int eventlist_subscribe(event_list_t *evlist, uint32_t event_id, event_callback_t cb, void *context)
+{
+    int ret = -1;
+
+    aos_mutex_lock(&evlist->mutex, AOS_WAIT_FOREVER);
+    event_t *ev = find_event(evlist, event_id);
+
+    if (ev == NULL) {
+        ev = (event_t *)aos_zalloc(sizeof(event_t));
+
+        if (ev != NULL) {
+            ev->event_id = event_id;
+            slist_init(&ev->sub_list);
+            slist_add(&ev->next, &evlist->events);
+        }
+    }
+
+    if (ev != NULL && find_event_sub(ev, cb, context) == NULL) {
+        event_subscription_t *e_sub = aos_zalloc(sizeof(event_subscription_t));
+
+        if (e_sub) {
+            e_sub->ecb = cb;
+            e_sub->context = context;
+            slist_add(&e_sub->next, &ev->sub_list);
+            ret = 0;
+        }
+    }
+
+    aos_mutex_unlock(&evlist->mutex);
+
+    return ret;
+}
+
+static int eventlist_unsubscribe(event_list_t *evlist, uint32_t event_id, event_callback_t cb, void *context)
+{
+    int ret = -1;
+
+    aos_mutex_lock(&evlist->mutex, AOS_WAIT_FOREVER);
+
+    event_t *ev = find_event(evlist, event_id);
+
+    if (ev) {
+        event_subscription_t *e_sub = find_event_sub(ev, cb, context);
+
+        if (e_sub) {
+            slist_del(&e_sub->next, &ev->sub_list);
+            aos_free(e_sub);
+
+            if (slist_empty(&ev->sub_list)) {
+                slist_del(&ev->next, &evlist->events);
+                aos_free(ev);
+            }
+
+            ret = 0;
+        }
+    }
+
+    aos_mutex_unlock(&evlist->mutex);
+
+    return ret;
+}
+
+static int eventlist_publish(event_list_t *evlist, uint32_t event_id, void *data)
+{
+    aos_mutex_lock(&evlist->mutex, AOS_WAIT_FOREVER);
+
+    event_t *ev = find_event(evlist, event_id);
+
+    if (ev) {
+        event_subscription_t *node;
+        slist_for_each_entry(&ev->sub_list, node, event_subscription_t, next) {
+            if (node->ecb) {
+                node->ecb(ev->event_id, data, node->context);
+            }
+        }
+    }
+
+    aos_mutex_unlock(&evlist->mutex);
+
+    return 0;
+}
+
+typedef struct event_timers {
+    dlist_t timeouts;
+} event_timers_t;
+
+struct event_param {
+    uint32_t event_id;
+    union {
+        event_callback_t cb;
+        uint32_t         timeout;
+    };
+    void   *data;
+    dlist_t next;
+};
+
+static void eventtimer_init(event_timers_t *timers)
+{
+    dlist_init(&timers->timeouts);
+}
+
+static void eventtimer_uninit(event_timers_t *timers)
+{
+}
+
+static int eventtimer_add(event_timers_t *timers, long long expire, uint32_t event_id, void *data)
+{
+    struct event_param *timer = aos_malloc(sizeof(struct event_param));
+    if (timer == NULL)
+        return -1;
+
+    timer->timeout = expire;
+    timer->event_id = event_id;
+    timer->data = data;
+
+    struct event_param *node;
+    dlist_for_each_entry(&timers->timeouts, node, struct event_param, next) {
+        if (timer->timeout < node->timeout)
+            break;
+    }
+    dlist_add_tail(&timer->next, &node->next);
+
+    return 0;
+}
+
+static int eventtimer_pop(event_timers_t *timers, long long now, uint32_t *event_id, void **data)
+{
+    if (dlist_empty(&timers->timeouts)) {
+        return -1;
+    }
+
+    struct event_param *node = aos_container_of(timers->timeouts.next, struct event_param, next);
+    if (now < node->timeout) {
+        return -1;
+    }
+
+    *event_id = node->event_id;
+    *data = node->data;
+    dlist_del(&node->next);
+    aos_free(node);
+
+    return 0;
+}
+#else
+#include "internal.h"
+#endif
+
+static long long cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static uint32_t rand_state = 1;
+
+static uint32_t bench_rand(void)
+{
+    rand_state = rand_state * 1103515245u + 12345u;
+    return rand_state >> 8;
+}
+
+static unsigned long called;
+
+static void on_event(uint32_t event_id, const void *data, void *context)
+{
+    called += (uintptr_t)context;
+}
+
+/* ids spread like those of the services, a base per service plus a small index */
+static uint32_t event_id_of(int i)
+{
+    return 0x100u * (uint32_t)(i / 16 + 1) + (uint32_t)(i % 16);
+}
+
+int main(int argc, char **argv)
+{
+    int            events    = argc > 1 ? atoi(argv[1]) : 256;
+    int            publishes = argc > 2 ? atoi(argv[2]) : 1000000;
+    int            count     = argc > 3 ? atoi(argv[3]) : 10000;
+    int            churns    = publishes / 10;
+    event_list_t   evlist;
+    event_timers_t timers;
+    uint32_t      *ids = malloc(sizeof(uint32_t) * (publishes > count ? publishes : count));
+    long long      t0;
+    int            i;
+
+    if (ids == NULL || events <= 0 || publishes <= 0 || count <= 0) {
+        fprintf(stderr, "usage: %s [events] [publishes] [timers]\n", argv[0]);
+        return 1;
+    }
+
+    eventlist_init(&evlist);
+    for (i = 0; i < events; i++) {
+        eventlist_subscribe(&evlist, event_id_of(i), on_event, (void *)1);
+        eventlist_subscribe(&evlist, event_id_of(i), on_event, (void *)2);
+    }
+
+    for (i = 0; i < publishes; i++) {
+        ids[i] = event_id_of(bench_rand() % events);
+    }
+    t0 = cpu_ns();
+    for (i = 0; i < publishes; i++) {
+        eventlist_publish(&evlist, ids[i], NULL);
+    }
+    double publish_ns = (double)(cpu_ns() - t0) / publishes;
+    int    publish_ok = called == 3UL * publishes;
+
+    t0 = cpu_ns();
+    for (i = 0; i < churns; i++) {
+        eventlist_subscribe(&evlist, ids[i], on_event, (void *)3);
+        eventlist_unsubscribe(&evlist, ids[i], on_event, (void *)3);
+    }
+    double churn_ns = (double)(cpu_ns() - t0) / churns;
+    eventlist_uninit(&evlist);
+
+    for (i = 0; i < count; i++) {
+        ids[i] = bench_rand() % 60000;
+    }
+    eventtimer_init(&timers);
+    t0 = cpu_ns();
+    for (i = 0; i < count; i++) {
+        eventtimer_add(&timers, ids[i], i, NULL);
+    }
+    double add_ns = (double)(cpu_ns() - t0) / count;
+
+    uint32_t  event_id, prev = 0;
+    void     *data;
+    int       popped = 0, timer_ok = 1;
+    t0 = cpu_ns();
+    while (eventtimer_pop(&timers, 60000, &event_id, &data) == 0) {
+        if (popped > 0 && ids[event_id] < ids[prev]) {
+            timer_ok = 0;
+        }
+        prev = event_id;
+        popped++;
+    }
+    double pop_ns = (double)(cpu_ns() - t0) / count;
+    eventtimer_uninit(&timers);
+
+    printf("%-6s events %5d  publish %8.1f ns  sub+unsub %8.1f ns  "
+           "timers %6d  add %8.1f ns  pop %6.1f ns  %s\n",
+           BENCH_MODE, events, publish_ns, churn_ns, count, add_ns, pop_ns,
+           publish_ok && timer_ok && popped == count ? "ok" : "MISMATCH");
+
+    free(ids);
+    return 0;
+}
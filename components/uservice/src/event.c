@@ -6,30 +6,66 @@
 #include <stdint.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdatomic.h>
 #include <uservice/event.h>
 #include <sys/select.h>
 #include "internal.h"
 
 #define FD_MASK (1UL << 31)
 
+#define BUCKET_BITS_MIN 4
+#define BUCKET_BITS_MAX 12
+
+/**
+ * Subscribers of one event. An array is never changed once in place: subscribe and
+ * unsubscribe put a new copy in the event, so publish takes a reference under the
+ * mutex and runs the callbacks without it. The last reference frees the array.
+ */
+typedef struct event_subs {
+    atomic_int ref;     /* one for the event it is in, one per publish running it */
+    int        count;
+    struct {
+        event_callback_t ecb;
+        void            *context;
+    } sub[];
+} event_subs_t;
+
 typedef struct event {
-    uint32_t event_id;
-    slist_t  sub_list;
+    uint32_t      event_id;
+    event_subs_t *subs;
 
     slist_t next;
 } event_t;
 
-typedef struct event_subscription {
-    event_callback_t ecb;
-    void *context;
+static inline slist_t *event_bucket(event_list_t *evlist, uint32_t event_id)
+{
+    /* multiplicative hash, the top bits depend on all bits of the id */
+    return &evlist->buckets[(event_id * 2654435761u) >> (32 - evlist->bucket_bits)];
+}
 
-    slist_t next;
-} event_subscription_t;
+static void subs_put(event_subs_t *subs)
+{
+    if (subs && atomic_fetch_sub(&subs->ref, 1) == 1) {
+        aos_free(subs);
+    }
+}
+
+static event_subs_t *subs_new(int count)
+{
+    event_subs_t *subs = aos_malloc(sizeof(event_subs_t) + count * sizeof(subs->sub[0]));
+
+    if (subs) {
+        atomic_init(&subs->ref, 1);
+        subs->count = count;
+    }
+
+    return subs;
+}
 
 static event_t *find_event(event_list_t *evlist, uint32_t event_id)
 {
     event_t *node;
-    slist_for_each_entry(&evlist->events, node, event_t, next) {
+    slist_for_each_entry(event_bucket(evlist, event_id), node, event_t, next) {
         if (node->event_id == event_id) {
             return node;
         }
@@ -38,16 +74,48 @@ static event_t *find_event(event_list_t *evlist, uint32_t event_id)
     return NULL;
 }
 
-static event_subscription_t *find_event_sub(event_t *ev, event_callback_t cb, void *context)
+static int find_event_sub(event_subs_t *subs, event_callback_t cb, void *context)
 {
-    event_subscription_t *node;
-    slist_for_each_entry(&ev->sub_list, node, event_subscription_t, next) {
-        if (node->ecb == cb && node->context == context) {
-            return node;
+    for (int i = 0; i < subs->count; i++) {
+        if (subs->sub[i].ecb == cb && subs->sub[i].context == context) {
+            return i;
         }
     }
 
-    return NULL;
+    return -1;
+}
+
+/* double the buckets, the chains just stay longer if memory is short */
+static void eventlist_grow(event_list_t *evlist)
+{
+    int      old_count = 1 << evlist->bucket_bits;
+    slist_t *old = evlist->buckets;
+    slist_t *buckets = aos_zalloc(sizeof(slist_t) << (evlist->bucket_bits + 1));
+
+    if (buckets == NULL) {
+        return;
+    }
+
+    evlist->buckets = buckets;
+    evlist->bucket_bits++;
+
+    for (int i = 0; i < old_count; i++) {
+        event_t *node;
+        slist_t *tmp;
+        slist_for_each_entry_safe(&old[i], tmp, node, event_t, next) {
+            slist_add(&node->next, event_bucket(evlist, node->event_id));
+        }
+    }
+
+    aos_free(old);
+}
+
+static void event_free(event_list_t *evlist, event_t *ev)
+{
+    slist_del(&ev->next, event_bucket(evlist, ev->event_id));
+    evlist->count--;
+    subs_put(ev->subs);
+    aos_free(ev);
 }
 
 int eventlist_init(event_list_t *evlist)
@@ -55,9 +123,16 @@ int eventlist_init(event_list_t *evlist)
     aos_assert(evlist);
 
     memset(evlist, 0, sizeof(event_list_t));
-    slist_init(&evlist->events);
+
+    evlist->buckets = aos_zalloc(sizeof(slist_t) << BUCKET_BITS_MIN);
+    if (evlist->buckets == NULL) {
+        return -1;
+    }
+    evlist->bucket_bits = BUCKET_BITS_MIN;
 
     if (aos_mutex_new(&evlist->mutex) != 0) {
+        aos_free(evlist->buckets);
+        evlist->buckets = NULL;
         return -1;
     }
 
@@ -67,21 +142,18 @@ int eventlist_init(event_list_t *evlist)
 void eventlist_uninit(event_list_t *evlist)
 {
     aos_assert(evlist);
-    event_t *node;
-    slist_t *tmp_1;
 
     aos_mutex_lock(&evlist->mutex, AOS_WAIT_FOREVER);
 
-    slist_for_each_entry_safe(&evlist->events, tmp_1, node, event_t, next) {
-        event_subscription_t *node_sub;
-        slist_t *tmp_2;
-        slist_for_each_entry_safe(&node->sub_list, tmp_2, node_sub, event_subscription_t, next) {
-            slist_del(&node_sub->next, &node->sub_list);
-            aos_free(node_sub);
+    for (int i = 0; i < (1 << evlist->bucket_bits); i++) {
+        event_t *node;
+        slist_t *tmp;
+        slist_for_each_entry_safe(&evlist->buckets[i], tmp, node, event_t, next) {
+            event_free(evlist, node);
         }
-        slist_del(&node->next, &evlist->events);
-        aos_free(node);
     }
+    aos_free(evlist->buckets);
+    evlist->buckets = NULL;
 
     aos_mutex_unlock(&evlist->mutex);
 
@@ -100,27 +172,35 @@ static int __yoc_event_subscribe(event_list_t *evlist, uint32_t event_id, event_
 
         if (ev != NULL) {
             ev->event_id = event_id;
-            slist_init(&ev->sub_list);
-            slist_add(&ev->next, &evlist->events);
+            slist_add(&ev->next, event_bucket(evlist, event_id));
+            evlist->count++;
         }
     }
 
-    if (ev != NULL) {
-        event_subscription_t *e_sub;
-        e_sub = find_event_sub(ev, cb, context);
-        if (e_sub == NULL) {
-            e_sub = (event_subscription_t *)aos_zalloc(sizeof(event_subscription_t));
-
-            if (e_sub) {
-                e_sub->ecb = cb;
-                e_sub->context = context;
-                slist_add(&e_sub->next, &ev->sub_list);
+    if (ev != NULL && (ev->subs == NULL || find_event_sub(ev->subs, cb, context) < 0)) {
+        int           count = ev->subs ? ev->subs->count : 0;
+        event_subs_t *subs = subs_new(count + 1);
 
-                ret = 0;
+        if (subs) {
+            /* newest first, as the list it replaces */
+            subs->sub[0].ecb = cb;
+            subs->sub[0].context = context;
+            if (count) {
+                memcpy(&subs->sub[1], ev->subs->sub, count * sizeof(subs->sub[0]));
             }
+            subs_put(ev->subs);
+            ev->subs = subs;
+
+            ret = 0;
+        } else if (ev->subs == NULL) {
+            event_free(evlist, ev);
         }
     }
 
+    if (evlist->count > (2 << evlist->bucket_bits) && evlist->bucket_bits < BUCKET_BITS_MAX) {
+        eventlist_grow(evlist);
+    }
+
     aos_mutex_unlock(&evlist->mutex);
 
     return ret;
@@ -155,20 +235,24 @@ static int __yoc_event_unsubscribe(event_list_t *evlist, uint32_t event_id, even
     aos_mutex_lock(&evlist->mutex, AOS_WAIT_FOREVER);
 
     event_t *ev = find_event(evlist, event_id);
+    int      i  = ev ? find_event_sub(ev->subs, cb, context) : -1;
 
-    if (ev) {
-        event_subscription_t *e_sub = find_event_sub(ev, cb, context);
-
-        if (e_sub) {
-            slist_del(&e_sub->next, &ev->sub_list);
-            aos_free(e_sub);
-
-            if (slist_empty(&ev->sub_list)) {
-                slist_del(&ev->next, &evlist->events);
-                aos_free(ev);
-            }
+    if (i >= 0) {
+        int count = ev->subs->count;
 
+        if (count == 1) {
+            event_free(evlist, ev);
             ret = 0;
+        } else {
+            event_subs_t *subs = subs_new(count - 1);
+
+            if (subs) {
+                memcpy(subs->sub, ev->subs->sub, i * sizeof(subs->sub[0]));
+                memcpy(&subs->sub[i], &ev->subs->sub[i + 1], (count - i - 1) * sizeof(subs->sub[0]));
+                subs_put(ev->subs);
+                ev->subs = subs;
+                ret = 0;
+            }
         }
     }
 
@@ -187,14 +271,8 @@ static int __yoc_event_remove(event_list_t *evlist, uint32_t event_id)
     event_t *ev = find_event(evlist, event_id);
 
     if (ev) {
-        event_subscription_t *node;
-        slist_t               *tmp;
-        slist_for_each_entry_safe(&ev->sub_list, tmp, node, event_subscription_t, next) {
-            slist_del(&ev->next, &evlist->events);
-            aos_free(ev);
-        }
-        slist_del(&ev->next, &evlist->events);
-        aos_free(ev);
+        event_free(evlist, ev);
+        ret = 0;
     }
 
     aos_mutex_unlock(&evlist->mutex);
@@ -226,20 +304,26 @@ int eventlist_unsubscribe(event_list_t *evlist, uint32_t event_id, event_callbac
 
 static void __event_publish(event_list_t *evlist, uint32_t event_id, void *data)
 {
+    event_subs_t *subs = NULL;
+
     aos_mutex_lock(&evlist->mutex, AOS_WAIT_FOREVER);
 
     event_t *ev = find_event(evlist, event_id);
 
     if (ev) {
-        event_subscription_t *node;
-        slist_for_each_entry(&ev->sub_list, node, event_subscription_t, next) {
-            if (node->ecb) {
-                node->ecb(ev->event_id, data, node->context);
-            }
-        }
+        subs = ev->subs;
+        atomic_fetch_add(&subs->ref, 1);
     }
 
     aos_mutex_unlock(&evlist->mutex);
+
+    /* callbacks may subscribe, unsubscribe or publish on this list themselves */
+    if (subs) {
+        for (int i = 0; i < subs->count; i++) {
+            subs->sub[i].ecb(event_id, data, subs->sub[i].context);
+        }
+        subs_put(subs);
+    }
 }
 
 int eventlist_publish(event_list_t *evlist, uint32_t event_id, void *data)
@@ -300,14 +384,16 @@ int eventlist_setfd(event_list_t *evlist, void *data)
     FD_ZERO(readfds);
 
     aos_mutex_lock(&evlist->mutex, AOS_WAIT_FOREVER);
-    event_t *node;
-    slist_for_each_entry(&evlist->events, node, event_t, next) {
-        if (node->event_id > FD_MASK) {
-            uint32_t fd = node->event_id & (~FD_MASK);
-            FD_SET(fd, readfds);
-
-            if (fd > max_fd) {
-                max_fd = fd;
+    for (int i = 0; i < (1 << evlist->bucket_bits); i++) {
+        event_t *node;
+        slist_for_each_entry(&evlist->buckets[i], node, event_t, next) {
+            if (node->event_id > FD_MASK) {
+                uint32_t fd = node->event_id & (~FD_MASK);
+                FD_SET(fd, readfds);
+
+                if (fd > max_fd) {
+                    max_fd = fd;
+                }
             }
         }
     }
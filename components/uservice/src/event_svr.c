@@ -21,8 +21,8 @@
 
 static struct event_call {
     uservice_t  *svr;
-    event_list_t event;
-    dlist_t      timeouts;
+    event_list_t   event;
+    event_timers_t timeouts;
     int          event_id;
     void        *data;
     aos_task_t   select_task;
@@ -39,7 +39,6 @@ struct event_param {
         uint32_t         timeout;
     };
     void   *data;
-    dlist_t next;
 };
 
 enum {
@@ -87,23 +86,12 @@ static int process_rpc(void *context, rpc_t *rpc)
 
     case CMD_PUBLISH_EVENT:
         if (param->timeout > 0) {
-            struct event_param *timer = aos_malloc(sizeof(struct event_param));
-            if (timer == NULL)
-                break;
-
-            timer->timeout = aos_now_ms() + param->timeout;
-            timer->event_id = param->event_id;
-            timer->data = param->data;
-
             uservice_lock(ev_service.svr);
-            struct event_param *node;
-            dlist_for_each_entry(&ev_service.timeouts, node, struct event_param, next) {
-                if (timer->timeout < node->timeout)
-                    break;
-            }
-            dlist_add_tail(&timer->next, &node->next);
+            int ret = eventtimer_add(&ev_service.timeouts, aos_now_ms() + param->timeout,
+                                     param->event_id, param->data);
             uservice_unlock(ev_service.svr);
-            aos_sem_signal(&ev_service.select_sem);
+            if (ret == 0)
+                aos_sem_signal(&ev_service.select_sem);
         } else {
             eventlist_publish(&ev_service.event, param->event_id, param->data);
         }
@@ -125,7 +113,7 @@ int event_service_init(utask_t *task)
         return -1;
 
     eventlist_init(&ev_service.event);
-    dlist_init(&ev_service.timeouts);
+    eventtimer_init(&ev_service.timeouts);
     aos_sem_new(&ev_service.select_sem, 0);
 
     ev_service.svr = uservice_new("event_svr", process_rpc, NULL);
@@ -228,24 +216,19 @@ void event_unsubscribe(uint32_t event_id, event_callback_t cb, void *context)
 
 static int do_time_event()
 {
-    int delayed_ms = -1;
-
-    struct event_param *node;
-    dlist_t            *tmp;
+    int       delayed_ms;
+    uint32_t  event_id;
+    void     *data;
+    long long now = aos_now_ms();
 
     uservice_lock(ev_service.svr);
-    dlist_for_each_entry_safe(&ev_service.timeouts, tmp, node, struct event_param, next) {
-        long long now = aos_now_ms();
-
-        if (now >= node->timeout) {
-            event_publish(node->event_id, node->data);
-            dlist_del(&node->next);
-            aos_free(node);
-        } else {
-            delayed_ms = node->timeout - now;
-            break;
-        }
+    while (eventtimer_pop(&ev_service.timeouts, now, &event_id, &data) == 0) {
+        /* the publish queues an rpc, do not hold the service lock over it */
+        uservice_unlock(ev_service.svr);
+        event_publish(event_id, data);
+        uservice_lock(ev_service.svr);
     }
+    delayed_ms = eventtimer_next(&ev_service.timeouts, aos_now_ms());
     uservice_unlock(ev_service.svr);
 
     return delayed_ms;
@@ -257,7 +240,8 @@ static void select_task_entry(void *arg)
     while (1) {
         int time_ms = do_time_event();
 
-        aos_msleep(time_ms);
+        /* woken early when a delayed event is added */
+        aos_sem_wait(&ev_service.select_sem, time_ms < 0 ? AOS_WAIT_FOREVER : (unsigned int)time_ms);
     }
 }
 
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2019-2020 Alibaba Group Holding Limited
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "internal.h"
+
+#define TIMER_HEAP_MIN 8
+
+/* a fires before b, same expire time in the order they were added */
+static inline int timer_before(const event_timer_t *a, const event_timer_t *b)
+{
+    if (a->expire != b->expire) {
+        return a->expire < b->expire;
+    }
+
+    return (int32_t)(a->seq - b->seq) < 0;
+}
+
+void eventtimer_init(event_timers_t *timers)
+{
+    aos_assert(timers);
+
+    memset(timers, 0, sizeof(event_timers_t));
+}
+
+void eventtimer_uninit(event_timers_t *timers)
+{
+    aos_assert(timers);
+
+    aos_free(timers->heap);
+    memset(timers, 0, sizeof(event_timers_t));
+}
+
+int eventtimer_add(event_timers_t *timers, long long expire, uint32_t event_id, void *data)
+{
+    aos_assert(timers);
+
+    if (timers->count == timers->size) {
+        int            size = timers->size ? timers->size * 2 : TIMER_HEAP_MIN;
+        event_timer_t *heap = aos_realloc(timers->heap, size * sizeof(event_timer_t));
+
+        if (heap == NULL) {
+            return -1;
+        }
+        timers->heap = heap;
+        timers->size = size;
+    }
+
+    event_timer_t timer = { expire, timers->seq++, event_id, data };
+    int           i = timers->count++;
+
+    /* sift up */
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+
+        if (!timer_before(&timer, &timers->heap[parent])) {
+            break;
+        }
+        timers->heap[i] = timers->heap[parent];
+        i = parent;
+    }
+    timers->heap[i] = timer;
+
+    return 0;
+}
+
+int eventtimer_pop(event_timers_t *timers, long long now, uint32_t *event_id, void **data)
+{
+    aos_assert(timers && event_id && data);
+
+    if (timers->count == 0 || timers->heap[0].expire > now) {
+        return -1;
+    }
+
+    *event_id = timers->heap[0].event_id;
+    *data     = timers->heap[0].data;
+
+    /* sift the last one down from the root */
+    event_timer_t *last = &timers->heap[--timers->count];
+    int            i = 0;
+
+    while (1) {
+        int child = i * 2 + 1;
+
+        if (child >= timers->count) {
+            break;
+        }
+        if (child + 1 < timers->count && timer_before(&timers->heap[child + 1], &timers->heap[child])) {
+            child++;
+        }
+        if (!timer_before(&timers->heap[child], last)) {
+            break;
+        }
+        timers->heap[i] = timers->heap[child];
+        i = child;
+    }
+    timers->heap[i] = *last;
+
+    return 0;
+}
+
+int eventtimer_next(event_timers_t *timers, long long now)
+{
+    aos_assert(timers);
+
+    if (timers->count == 0) {
+        return -1;
+    }
+
+    long long delay = timers->heap[0].expire - now;
+
+    if (delay < 0) {
+        return 0;
+    }
+
+    return delay > INT32_MAX ? INT32_MAX : (int)delay;
+}
@@ -77,7 +77,9 @@ void rpc_free(rpc_t *rpc);
 int  rpc_wait(rpc_t *rpc);
 
 typedef struct event_list {
-    slist_t     events;
+    slist_t    *buckets;        /* events hashed by id, bucket_bits power of two */
+    uint8_t     bucket_bits;
+    uint16_t    count;
     aos_mutex_t mutex;
 } event_list_t;
 
@@ -96,6 +98,27 @@ int  eventlist_remove_fd(event_list_t *evlist, uint32_t fd);
 
 int  eventlist_setfd(event_list_t *evlist, void *readfds);
 
+/* delayed events, a binary min-heap on the expire time, locked by the caller */
+typedef struct event_timer {
+    long long expire;
+    uint32_t  seq;              /* keeps events with the same expire time in order */
+    uint32_t  event_id;
+    void     *data;
+} event_timer_t;
+
+typedef struct event_timers {
+    event_timer_t *heap;
+    int            count;
+    int            size;
+    uint32_t       seq;
+} event_timers_t;
+
+void eventtimer_init(event_timers_t *timers);
+void eventtimer_uninit(event_timers_t *timers);
+int  eventtimer_add(event_timers_t *timers, long long expire, uint32_t event_id, void *data);
+int  eventtimer_pop(event_timers_t *timers, long long now, uint32_t *event_id, void **data);
+int  eventtimer_next(event_timers_t *timers, long long now);
+
 #ifdef __cplusplus
 }
 #endif
@@ -70,6 +70,17 @@ static void voice_session_sub(void)
 }
 
 
+/* pcm of the dispatch ring, blocking up to one frame time instead of polling. The ring
+   exists only once the graph started, until then there is no data */
+static int voice_pcm_read(voice_reader_t **reader, char *data, int len)
+{
+    if (*reader == NULL && (*reader = voice_reader_open(VOICE_DATA_PCM)) == NULL) {
+        aos_msleep(20);
+        return 0;
+    }
+    return voice_reader_read(*reader, data, len, 20);
+}
+
 static void plugin_task_entry(void *arg)
 {
     static const std::string json_str = R"({
@@ -150,19 +161,25 @@ static void plugin_task_entry(void *arg)
 
     char *pcm_data = (char *)aos_malloc_check(FRAME_SIZE);
     int data_size = 0;
+    int frame_fill = 0;
+    voice_reader_t *pcm_reader = NULL;
 
     while (g_voice_priv.task_running) {
         aos_sem_wait(&g_voice_priv.pcm_sem, AOS_WAIT_FOREVER);
-
-        while ((data_size = voice_get_pcm_data(pcm_data, FRAME_SIZE)) > 0 || g_voice_priv.state == VOICE_STATE_BUSY) {
-            if (data_size > 0) {
-                g_voice_priv.event_cb(g_voice_priv.mic, MIC_EVENT_PCM_DATA, pcm_data, data_size);
-            } else {
-                aos_msleep(20);
+        frame_fill = 0;
+
+        while ((data_size = voice_pcm_read(&pcm_reader, pcm_data + frame_fill, FRAME_SIZE - frame_fill)) > 0 || g_voice_priv.state == VOICE_STATE_BUSY) {
+            /* a read that times out returns what is there, the algorithm only takes whole frames */
+            frame_fill += data_size > 0 ? data_size : 0;
+            if (frame_fill == FRAME_SIZE) {
+                g_voice_priv.event_cb(g_voice_priv.mic, MIC_EVENT_PCM_DATA, pcm_data, FRAME_SIZE);
+                frame_fill = 0;
             }
         }
     }
 
+    voice_reader_close(pcm_reader);
+
     g_voice_priv.task_exit = 1;
     aos_task_exit(0);
 }